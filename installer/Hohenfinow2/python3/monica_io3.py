@@ -16,6 +16,8 @@ import os
 import time
 import json
 import sys
+import math
+import struct
 
 import soil_io3
 #import monica_python
@@ -225,6 +227,164 @@ def parse_json_string(jsonString):
     return {"result": json.loads(jsonString), "errors": [], "success": True}
 
 
+# binary encoding of Env and Output messages (see src/io/binary-json.h)
+# send an env with env["type"] = "Env.bin" encoded by encode_binary_json to get a binary "Output.bin" message back
+
+BINARY_JSON_MAGIC = b"MBJ"
+BINARY_JSON_VERSION = 1
+
+_BJ_NULL, _BJ_FALSE, _BJ_TRUE, _BJ_INT32, _BJ_FLOAT64, _BJ_STRING, _BJ_ARRAY, _BJ_OBJECT, \
+    _BJ_INT32_ARRAY, _BJ_FLOAT64_ARRAY = range(10)
+
+
+def _is_int32(v):
+    return (isinstance(v, int) or (isinstance(v, float) and v.is_integer() \
+        and not (v == 0 and math.copysign(1.0, v) < 0))) \
+        and -2**31 <= v <= 2**31 - 1
+
+
+def _bj_write_varuint(out, v):
+    while v >= 0x80:
+        out.append((v & 0x7f) | 0x80)
+        v >>= 7
+    out.append(v)
+
+
+def _bj_write_str(out, s):
+    bs = s.encode("utf-8")
+    _bj_write_varuint(out, len(bs))
+    out.extend(bs)
+
+
+def _bj_write(out, j):
+    if j is None:
+        out.append(_BJ_NULL)
+    elif isinstance(j, bool):
+        out.append(_BJ_TRUE if j else _BJ_FALSE)
+    elif isinstance(j, (int, float)):
+        if _is_int32(j):
+            out.append(_BJ_INT32)
+            out.extend(struct.pack("<i", int(j)))
+        else:
+            out.append(_BJ_FLOAT64)
+            out.extend(struct.pack("<d", j))
+    elif isinstance(j, str):
+        out.append(_BJ_STRING)
+        _bj_write_str(out, j)
+    elif isinstance(j, dict):
+        out.append(_BJ_OBJECT)
+        _bj_write_varuint(out, len(j))
+        for k, v in j.items():
+            _bj_write_str(out, k)
+            _bj_write(out, v)
+    elif isinstance(j, (list, tuple)):
+        all_numbers = len(j) > 0 and all(isinstance(v, (int, float)) and not isinstance(v, bool) for v in j)
+        if all_numbers and all(_is_int32(v) for v in j):
+            out.append(_BJ_INT32_ARRAY)
+            _bj_write_varuint(out, len(j))
+            out.extend(struct.pack("<%di" % len(j), *map(int, j)))
+        elif all_numbers:
+            out.append(_BJ_FLOAT64_ARRAY)
+            _bj_write_varuint(out, len(j))
+            out.extend(struct.pack("<%dd" % len(j), *j))
+        else:
+            out.append(_BJ_ARRAY)
+            _bj_write_varuint(out, len(j))
+            for v in j:
+                _bj_write(out, v)
+    else:
+        raise TypeError("Can't encode value of type " + str(type(j)) + " in binary message!")
+
+
+def encode_binary_json(j):
+    "encode j (e.g. an env) as binary message"
+    out = bytearray(BINARY_JSON_MAGIC)
+    out.append(BINARY_JSON_VERSION)
+    _bj_write(out, j)
+    return bytes(out)
+
+
+def is_binary_json(msg):
+    "is msg (bytes) a binary message instead of JSON text"
+    return len(msg) > len(BINARY_JSON_MAGIC) and msg[:len(BINARY_JSON_MAGIC)] == BINARY_JSON_MAGIC
+
+
+def decode_binary_json(msg):
+    "decode a binary message (e.g. an Output.bin message) back to dicts and lists"
+    if not is_binary_json(msg):
+        raise ValueError("Message is not a binary encoded message!")
+    if msg[len(BINARY_JSON_MAGIC)] != BINARY_JSON_VERSION:
+        raise ValueError("Unsupported binary message version: " + str(msg[len(BINARY_JSON_MAGIC)]) + "!")
+
+    buf = memoryview(msg)
+    pos = [len(BINARY_JSON_MAGIC) + 1]
+
+    def read_varuint():
+        v = 0
+        shift = 0
+        while True:
+            b = buf[pos[0]]
+            pos[0] += 1
+            v |= (b & 0x7f) << shift
+            if not b & 0x80:
+                return v
+            shift += 7
+
+    def read_str():
+        n = read_varuint()
+        s = bytes(buf[pos[0]:pos[0] + n]).decode("utf-8")
+        pos[0] += n
+        return s
+
+    def read_array(fmt, size):
+        n = read_varuint()
+        vs = list(struct.unpack_from("<%d%s" % (n, fmt), buf, pos[0]))
+        pos[0] += n * size
+        return vs
+
+    def read():
+        tag = buf[pos[0]]
+        pos[0] += 1
+        if tag == _BJ_NULL:
+            return None
+        elif tag == _BJ_FALSE:
+            return False
+        elif tag == _BJ_TRUE:
+            return True
+        elif tag == _BJ_INT32:
+            v = struct.unpack_from("<i", buf, pos[0])[0]
+            pos[0] += 4
+            return v
+        elif tag == _BJ_FLOAT64:
+            v = struct.unpack_from("<d", buf, pos[0])[0]
+            pos[0] += 8
+            return v
+        elif tag == _BJ_STRING:
+            return read_str()
+        elif tag == _BJ_ARRAY:
+            return [read() for _ in range(read_varuint())]
+        elif tag == _BJ_OBJECT:
+            o = {}
+            for _ in range(read_varuint()):
+                k = read_str()
+                o[k] = read()
+            return o
+        elif tag == _BJ_INT32_ARRAY:
+            return read_array("i", 4)
+        elif tag == _BJ_FLOAT64_ARRAY:
+            return read_array("d", 8)
+        raise ValueError("Unknown tag " + str(tag) + " in binary message!")
+
+    return read()
+
+
+def parse_json_or_binary_json(msg):
+    "parse a received message, which can be JSON text or a binary message"
+    if isinstance(msg, (bytes, bytearray)) and is_binary_json(msg):
+        return decode_binary_json(bytes(msg))
+    return json.loads(msg)
+
+
 def is_string_type(j):
     return isinstance(j, str)
 
@@ -0,0 +1,46 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+Authors:
+Michael Berg <michael.berg@zalf.de>
+
+Maintainers:
+Currently maintained by the authors.
+
+This file is part of the MONICA model.
+Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
+*/
+
+//replaces the global operator new to count the allocations per thread (see memory-accounting.h),
+//must be linked at most once into an executable
+
+#include <cstdlib>
+#include <new>
+
+#include "memory-accounting.h"
+
+void* operator new(std::size_t size)
+{
+	Monica::MemoryAccounting::countAllocation(size);
+	if(void* p = std::malloc(size == 0 ? 1 : size))
+		return p;
+	throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	Monica::MemoryAccounting::countAllocation(size);
+	return std::malloc(size == 0 ? 1 : size);
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+	std::free(p);
+}
@@ -32,6 +32,7 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 #include "voc-common.h"
 #include "photosynthesis-FvCB.h"
 #include "O3-impact.h"
+#include "model-state.h"
 
 const double PI = 3.14159265358979323;
 
@@ -5075,3 +5076,239 @@ void CropGrowth::setStage(int newStage)
 
 	vc_DevelopmentalStage = newStage;
 }
+
+template<class Archive>
+void CropGrowth::serialize(Archive& ar)
+{
+	ar(_frostKillOn,
+		 vs_Latitude,
+		 vc_AbovegroundBiomass,
+		 vc_AbovegroundBiomassOld,
+		 pc_AbovegroundOrgan,
+		 vc_ActualTranspiration,
+		 pc_AssimilatePartitioningCoeff,
+		 pc_AssimilateReallocation,
+		 vc_Assimilates,
+		 vc_AssimilationRate,
+		 vc_AstronomicDayLenght,
+		 pc_BaseDaylength,
+		 pc_BaseTemperature,
+		 pc_BeginSensitivePhaseHeatStress,
+		 vc_BelowgroundBiomass,
+		 vc_BelowgroundBiomassOld,
+		 pc_CarboxylationPathway,
+		 vc_ClearDayRadiation,
+		 pc_CO2Method,
+		 vc_CriticalNConcentration,
+		 pc_CriticalOxygenContent,
+		 pc_CriticalTemperatureHeatStress,
+		 vc_CropDiameter,
+		 vc_CropFrostRedux,
+		 vc_CropHeatRedux,
+		 vc_CropHeight,
+		 pc_CropHeightP1,
+		 pc_CropHeightP2,
+		 pc_CropName,
+		 vc_CropNDemand,
+		 vc_CropNRedux,
+		 pc_CropSpecificMaxRootingDepth,
+		 vc_CropWaterUptake,
+		 vc_CurrentTemperatureSum,
+		 vc_CurrentTotalTemperatureSum,
+		 vc_CurrentTotalTemperatureSumRoot,
+		 pc_CuttingDelayDays,
+		 vc_DaylengthFactor,
+		 pc_DaylengthRequirement,
+		 vc_DaysAfterBeginFlowering,
+		 vc_Declination,
+		 pc_DefaultRadiationUseEfficiency,
+		 vm_DepthGroundwaterTable,
+		 pc_DevelopmentAccelerationByNitrogenStress,
+		 vc_DevelopmentalStage,
+		 _noOfCropSteps,
+		 vc_DroughtImpactOnFertility,
+		 pc_DroughtImpactOnFertilityFactor,
+		 pc_DroughtStressThreshold,
+		 pc_EmergenceFloodingControlOn,
+		 pc_EmergenceMoistureControlOn,
+		 pc_EndSensitivePhaseHeatStress,
+		 vc_EffectiveDayLength,
+		 vc_ErrorStatus,
+		 vc_ErrorMessage,
+		 vc_EvaporatedFromIntercept,
+		 vc_ExtraterrestrialRadiation,
+		 pc_FieldConditionModifier,
+		 vc_FinalDevelopmentalStage,
+		 vc_FixedN,
+		 pc_FrostDehardening,
+		 pc_FrostHardening,
+		 vc_GlobalRadiation,
+		 vc_GreenAreaIndex,
+		 vc_GrossAssimilates,
+		 vc_GrossPhotosynthesis,
+		 vc_GrossPhotosynthesis_mol,
+		 vc_GrossPhotosynthesisReference_mol,
+		 vc_GrossPrimaryProduction,
+		 vc_GrowthCycleEnded,
+		 vc_GrowthRespirationAS,
+		 pc_HeatSumIrrigationStart,
+		 pc_HeatSumIrrigationEnd,
+		 vs_HeightNN,
+		 pc_InitialKcFactor,
+		 pc_InitialOrganBiomass,
+		 pc_InitialRootingDepth,
+		 vc_InterceptionStorage,
+		 vc_KcFactor,
+		 vc_LeafAreaIndex,
+		 vc_sunlitLeafAreaIndex,
+		 vc_shadedLeafAreaIndex,
+		 pc_LowTemperatureExposure,
+		 pc_LimitingTemperatureHeatStress,
+		 vc_LT50,
+		 pc_LT50cultivar,
+		 pc_LuxuryNCoeff,
+		 vc_MaintenanceRespirationAS,
+		 pc_MaxAssimilationRate,
+		 pc_MaxCropDiameter,
+		 pc_MaxCropHeight,
+		 vc_MaxNUptake,
+		 pc_MaxNUptakeParam,
+		 vc_MaxRootingDepth,
+		 pc_MinimumNConcentration,
+		 pc_MinimumTemperatureForAssimilation,
+		 pc_OptimumTemperatureForAssimilation,
+		 pc_MaximumTemperatureForAssimilation,
+		 pc_MinimumTemperatureRootGrowth,
+		 vc_NetMaintenanceRespiration,
+		 vc_NetPhotosynthesis,
+		 vc_NetPrecipitation,
+		 vc_NetPrimaryProduction,
+		 pc_NConcentrationAbovegroundBiomass,
+		 vc_NConcentrationAbovegroundBiomass,
+		 vc_NConcentrationAbovegroundBiomassOld,
+		 pc_NConcentrationB0,
+		 vc_NContentDeficit,
+		 pc_NConcentrationPN,
+		 pc_NConcentrationRoot,
+		 vc_NConcentrationRoot,
+		 vc_NConcentrationRootOld,
+		 pc_NitrogenResponseOn,
+		 pc_NumberOfDevelopmentalStages,
+		 pc_NumberOfOrgans,
+		 vc_NUptakeFromLayer,
+		 pc_OptimumTemperature,
+		 vc_OrganBiomass,
+		 vc_OrganDeadBiomass,
+		 vc_OrganGreenBiomass,
+		 vc_OrganGrowthIncrement,
+		 pc_OrganGrowthRespiration,
+		 pc_OrganIdsForPrimaryYield,
+		 pc_OrganIdsForSecondaryYield,
+		 pc_OrganIdsForCutting,
+		 pc_OrganMaintenanceRespiration,
+		 vc_OrganSenescenceIncrement,
+		 pc_OrganSenescenceRate,
+		 vc_OvercastDayRadiation,
+		 vc_OxygenDeficit,
+		 pc_PartBiologicalNFixation,
+		 pc_Perennial,
+		 vc_PhotoperiodicDaylength,
+		 vc_PhotActRadiationMean,
+		 pc_PlantDensity,
+		 vc_PotentialTranspiration,
+		 vc_ReferenceEvapotranspiration,
+		 vc_RelativeTotalDevelopment,
+		 vc_RemainingEvapotranspiration,
+		 vc_ReserveAssimilatePool,
+		 pc_ResidueNRatio,
+		 pc_RespiratoryStress,
+		 vc_RootBiomass,
+		 vc_RootBiomassOld,
+		 vc_RootDensity,
+		 vc_RootDiameter,
+		 pc_RootDistributionParam,
+		 vc_RootEffectivity,
+		 pc_RootFormFactor,
+		 pc_RootGrowthLag,
+		 vc_RootingDepth,
+		 vc_RootingDepth_m,
+		 vc_RootingZone,
+		 pc_RootPenetrationRate,
+		 vm_SaturationDeficit,
+		 vc_SoilCoverage,
+		 vs_SoilMineralNContent,
+		 vc_SoilSpecificMaxRootingDepth,
+		 vs_SoilSpecificMaxRootingDepth,
+		 pc_SpecificLeafArea,
+		 pc_SpecificRootLength,
+		 pc_StageAfterCut,
+		 pc_StageAtMaxDiameter,
+		 pc_StageAtMaxHeight,
+		 pc_StageMaxRootNConcentration,
+		 pc_StageKcFactor,
+		 pc_StageTemperatureSum,
+		 vc_StomataResistance,
+		 pc_StorageOrgan,
+		 vc_StorageOrgan,
+		 vc_TargetNConcentration,
+		 vc_TimeStep,
+		 vc_TimeUnderAnoxia,
+		 vs_Tortuosity,
+		 vc_TotalBiomass,
+		 vc_TotalBiomassNContent,
+		 vc_TotalCropHeatImpact,
+		 vc_TotalNInput,
+		 vc_TotalNUptake,
+		 vc_TotalRespired,
+		 vc_Respiration,
+		 vc_SumTotalNUptake,
+		 vc_TotalRootLength,
+		 vc_TotalTemperatureSum,
+		 vc_TemperatureSumToFlowering,
+		 vc_Transpiration,
+		 vc_TranspirationRedux,
+		 vc_TranspirationDeficit,
+		 vc_VernalisationDays,
+		 vc_VernalisationFactor,
+		 pc_VernalisationRequirement,
+		 pc_WaterDeficitResponseOn,
+		 eva2_usage,
+		 eva2_primaryYieldComponents,
+		 eva2_secondaryYieldComponents,
+		 dyingOut,
+		 vc_AccumulatedETa,
+		 vc_AccumulatedTranspiration,
+		 vc_AccumulatedPrimaryCropYield,
+		 vc_sumExportedCutBiomass,
+		 vc_exportedCutBiomass,
+		 vc_sumResidueCutBiomass,
+		 vc_residueCutBiomass,
+		 vc_CuttingDelayDays,
+		 vs_MaxEffectiveRootingDepth,
+		 vs_ImpenetrableLayerDepth,
+		 vc_AnthesisDay,
+		 vc_MaturityDay,
+		 vc_MaturityReached,
+		 _rad24,
+		 _rad240,
+		 _tfol24,
+		 _tfol240,
+		 _index24,
+		 _index240,
+		 _full24,
+		 _full240,
+		 _guentherEmissions,
+		 _jjvEmissions,
+		 _vocSpecies,
+		 _cropPhotosynthesisResults,
+		 vc_O3_shortTermDamage,
+		 vc_O3_longTermDamage,
+		 vc_O3_senescence,
+		 vc_O3_sumUptake,
+		 vc_O3_WStomatalClosure,
+		 _assimilatePartCoeffsReduced,
+		 vc_KTkc,
+		 vc_KTko);
+}
+template void CropGrowth::serialize<StateWriter>(StateWriter&);
+template void CropGrowth::serialize<StateReader>(StateReader&);
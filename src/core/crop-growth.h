@@ -348,6 +348,14 @@ namespace Monica
 			return vc_O3_sumUptake;
 		}
 
+		double get_O3_senescence() const { return vc_O3_senescence; }
+
+		double get_GlobalRadiation() const { return vc_GlobalRadiation; }
+		double get_ExtraterrestrialRadiation() const { return vc_ExtraterrestrialRadiation; }
+		size_t get_RootingZone() const { return vc_RootingZone; }
+		double get_TotalTemperatureSum() const { return vc_TotalTemperatureSum; }
+		double get_TemperatureSumToFlowering() const { return vc_TemperatureSumToFlowering; }
+
 		/*
 	 * @brief Getter for total biomass.
 	 * @return total biomass
@@ -439,6 +447,9 @@ namespace Monica
 
 		void setStage(int newStage);
 
+		template<class Archive>
+		void serialize(Archive& ar);
+
 	private:
 		bool _frostKillOn{ true };
 
@@ -125,6 +125,10 @@ namespace Monica
     }
 		AutomaticHarvestParameters getAutomaticHarvestParams() { return _automaticHarvestParams; }
 
+		//! the dynamic state of a crop are the (automatically set) seed and harvest dates
+		template<class Archive>
+		void serialize(Archive& ar) { ar(_seedDate, _harvestDate); }
+
 	private:
     int _dbId{-1};
     std::string _speciesName;
@@ -0,0 +1,145 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+Authors:
+Michael Berg <michael.berg@zalf.de>
+
+Maintainers:
+Currently maintained by the authors.
+
+This file is part of the MONICA model.
+Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
+*/
+
+#include <atomic>
+#include <fstream>
+#include <string>
+
+#ifdef WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "memory-accounting.h"
+
+using namespace Monica;
+using namespace json11;
+using namespace std;
+
+namespace
+{
+	//plain thread locals, they are used from within operator new
+	thread_local uint64_t noOfAllocations = 0;
+	thread_local uint64_t noOfAllocatedBytes = 0;
+	atomic<bool> counted{false};
+
+	//! a std::map/std::set node: color, parent, left, right plus the value
+	template<class Value>
+	size_t mapNodeBytes() { return 4 * sizeof(void*) + sizeof(Value); }
+
+	//! json11 values are held by shared_ptrs created with make_shared (control block + value object)
+	const size_t jsonValueBytes = 2 * sizeof(long) + sizeof(void*) + sizeof(string);
+
+	//! heap bytes of a string, nothing if it fits into the small string buffer
+	size_t stringHeapBytes(const string& s)
+	{
+		static const size_t ssoCapacity = string().capacity();
+		return s.capacity() <= ssoCapacity ? 0 : s.capacity() + 1;
+	}
+}
+
+void MemoryAccounting::countAllocation(size_t size)
+{
+	noOfAllocations++;
+	noOfAllocatedBytes += size;
+	if(!counted.load(memory_order_relaxed))
+		counted.store(true, memory_order_relaxed);
+}
+
+MemoryAccounting::AllocationCount MemoryAccounting::threadAllocationCount()
+{
+	AllocationCount ac;
+	ac.allocations = noOfAllocations;
+	ac.bytes = noOfAllocatedBytes;
+	return ac;
+}
+
+bool MemoryAccounting::allocationsCounted()
+{
+	return counted.load(memory_order_relaxed);
+}
+
+void MemoryAccounting::resetPeakRSS()
+{
+#ifdef __linux__
+	//since Linux 4.0 writing 5 resets VmHWM
+	ofstream ofs("/proc/self/clear_refs");
+	ofs << "5";
+#endif
+}
+
+uint64_t MemoryAccounting::peakRSSKiB()
+{
+#ifdef WIN32
+	PROCESS_MEMORY_COUNTERS pmc;
+	if(GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+		return uint64_t(pmc.PeakWorkingSetSize / 1024);
+	return 0;
+#else
+#ifdef __linux__
+	ifstream ifs("/proc/self/status");
+	for(string line; getline(ifs, line);)
+		if(line.compare(0, 6, "VmHWM:") == 0)
+			return stoull(line.substr(6));
+#endif
+	rusage ru;
+	getrusage(RUSAGE_SELF, &ru);
+#ifdef __APPLE__
+	return uint64_t(ru.ru_maxrss / 1024);
+#else
+	return uint64_t(ru.ru_maxrss);
+#endif
+#endif
+}
+
+size_t MemoryAccounting::approxHeapBytes(const Json& j)
+{
+	switch(j.type())
+	{
+	case Json::NUL:
+	case Json::BOOL:
+		return 0;
+	case Json::NUMBER:
+		return jsonValueBytes;
+	case Json::STRING:
+		return jsonValueBytes + stringHeapBytes(j.string_value());
+	case Json::ARRAY:
+	{
+		const auto& a = j.array_items();
+		size_t bytes = jsonValueBytes + a.capacity() * sizeof(Json);
+		for(const auto& v : a)
+			bytes += approxHeapBytes(v);
+		return bytes;
+	}
+	case Json::OBJECT:
+	{
+		size_t bytes = jsonValueBytes;
+		for(const auto& p : j.object_items())
+			bytes += mapNodeBytes<Json::object::value_type>() + stringHeapBytes(p.first) + approxHeapBytes(p.second);
+		return bytes;
+	}
+	}
+	return 0;
+}
+
+size_t MemoryAccounting::approxHeapBytes(const vector<map<Climate::ACD, double>>& climateData)
+{
+	size_t bytes = climateData.capacity() * sizeof(map<Climate::ACD, double>);
+	for(const auto& m : climateData)
+		bytes += m.size() * mapNodeBytes<map<Climate::ACD, double>::value_type>();
+	return bytes;
+}
@@ -0,0 +1,65 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+Authors:
+Michael Berg <michael.berg@zalf.de>
+
+Maintainers:
+Currently maintained by the authors.
+
+This file is part of the MONICA model.
+Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
+*/
+
+#ifndef MONICA_MEMORY_ACCOUNTING_H_
+#define MONICA_MEMORY_ACCOUNTING_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "json11/json11.hpp"
+#include "climate/climate-common.h"
+
+namespace Monica
+{
+	/*!
+	 * Accounting of the memory used by runs (Env::memoryStats).
+	 * Allocations are only counted if the counting allocator (counting-allocator.cpp) is linked into the executable,
+	 * which is the case for monica-bench and for all executables if built with MONICA_COUNT_ALLOCATIONS.
+	 */
+	namespace MemoryAccounting
+	{
+		struct AllocationCount
+		{
+			std::uint64_t allocations{0};
+			std::uint64_t bytes{0};
+		};
+
+		//! called by the counting allocator for every allocation
+		void countAllocation(std::size_t size);
+
+		//! the allocations of the calling thread so far
+		AllocationCount threadAllocationCount();
+
+		//! true if the counting allocator is linked in, else all counts are zero
+		bool allocationsCounted();
+
+		//! reset the peak resident set size of the process (if the OS supports it)
+		void resetPeakRSS();
+
+		//! peak resident set size of the process in KiB (since the last reset on Linux)
+		std::uint64_t peakRSSKiB();
+
+		//! estimated heap bytes held by the values of j (the shared null and bool values are not counted)
+		std::size_t approxHeapBytes(const json11::Json& j);
+
+		//! estimated heap bytes held by a history of daily climate data
+		std::size_t approxHeapBytes(const std::vector<std::map<Climate::ACD, double>>& climateData);
+	}
+}
+
+#endif //MONICA_MEMORY_ACCOUNTING_H_
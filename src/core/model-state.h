@@ -0,0 +1,337 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+Authors:
+Michael Berg <michael.berg@zalf.de>
+
+Maintainers:
+Currently maintained by the authors.
+
+This file is part of the MONICA model.
+Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
+*/
+
+#ifndef MODEL_STATE_H_
+#define MODEL_STATE_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <list>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+
+#include "json11/json11.hpp"
+#include "tools/date.h"
+#include "../io/binary-json.h"
+
+namespace Monica
+{
+	/*!
+	 * Archives to capture and restore the complete dynamic state of a running model.
+	 *
+	 * Every stateful class implements
+	 *   template<class Archive> void serialize(Archive& ar);
+	 * and passes its members to ar(...). The same function is used for writing
+	 * and reading, so the member list exists exactly once per class and
+	 * can't get out of sync between the two directions.
+	 * Archive::isReading can be used for the few cases where restoring state
+	 * needs more than assigning a value (e.g. recreating the crop growth module).
+	 */
+	class StateWriter
+	{
+	public:
+		static const bool isReading = false;
+
+		StateWriter() {}
+
+		const std::string& data() const { return _data; }
+		std::string& dataNC() { return _data; }
+
+		//! writing can't fail, exists to keep serialize functions archive agnostic
+		void setFailed() {}
+
+		void writeBytes(const void* p, std::size_t n)
+		{
+			_data.append(static_cast<const char*>(p), n);
+		}
+
+		void operator()() {}
+
+		template<class T, class T2, class... Ts>
+		void operator()(T& t, T2& t2, Ts&... ts)
+		{
+			(*this)(t);
+			(*this)(t2, ts...);
+		}
+
+		template<class T>
+		typename std::enable_if<std::is_arithmetic<T>::value || std::is_enum<T>::value>::type
+		operator()(T& t) { writeBytes(&t, sizeof(T)); }
+
+		template<class T>
+		typename std::enable_if<std::is_class<T>::value>::type
+		operator()(T& t) { t.serialize(*this); }
+
+		void operator()(std::string& s)
+		{
+			writeSize(s.size());
+			writeBytes(s.data(), s.size());
+		}
+
+		void operator()(Tools::Date& d)
+		{
+			bool valid = d.isValid();
+			(*this)(valid);
+			if(valid)
+			{
+				std::int32_t day = d.day(), month = d.month(), year = d.year();
+				bool isRelative = !d.isAbsoluteDate(), useLeapYears = d.useLeapYears();
+				(*this)(day, month, year, isRelative, useLeapYears);
+			}
+		}
+
+		//! JSON values (e.g. the collected results) in the binary encoding, to restore them without parsing text
+		void operator()(json11::Json& j)
+		{
+			std::string s = encodeBinaryJson(j);
+			(*this)(s);
+		}
+
+		template<class T>
+		void operator()(std::vector<T>& v)
+		{
+			writeSize(v.size());
+			writeElements(v, std::integral_constant<bool, std::is_arithmetic<T>::value>());
+		}
+
+		void operator()(std::vector<bool>& v)
+		{
+			writeSize(v.size());
+			for(bool b : v)
+				(*this)(b);
+		}
+
+		template<class K, class V>
+		void operator()(std::map<K, V>& m)
+		{
+			writeSize(m.size());
+			for(auto& p : m)
+			{
+				K k = p.first;
+				(*this)(k, p.second);
+			}
+		}
+
+		template<class T>
+		void operator()(std::set<T>& s)
+		{
+			writeSize(s.size());
+			for(T t : s)
+				(*this)(t);
+		}
+
+		template<class T>
+		void operator()(std::list<T>& l)
+		{
+			writeSize(l.size());
+			for(auto& t : l)
+				(*this)(t);
+		}
+
+	private:
+		void writeSize(std::size_t size)
+		{
+			std::uint64_t s = size;
+			writeBytes(&s, sizeof(s));
+		}
+
+		template<class T>
+		void writeElements(std::vector<T>& v, std::true_type)
+		{
+			if(!v.empty())
+				writeBytes(v.data(), v.size()*sizeof(T));
+		}
+
+		template<class T>
+		void writeElements(std::vector<T>& v, std::false_type)
+		{
+			for(auto& t : v)
+				(*this)(t);
+		}
+
+		std::string _data;
+	};
+
+	//----------------------------------------------------------------------------
+
+	//! reads state written by StateWriter, a truncated or otherwise broken
+	//! state will not throw, but leave good() returning false
+	class StateReader
+	{
+	public:
+		static const bool isReading = true;
+
+		StateReader(const std::string& data, std::size_t pos = 0)
+			: _data(data), _pos(pos) {}
+
+		bool good() const { return _good; }
+
+		//! mark the state as not restorable (e.g. if information needed besides the state is missing)
+		void setFailed() { _good = false; }
+
+		std::size_t position() const { return _pos; }
+
+		bool readBytes(void* p, std::size_t n)
+		{
+			if(!_good || _pos + n > _data.size())
+			{
+				_good = false;
+				return false;
+			}
+			std::memcpy(p, _data.data() + _pos, n);
+			_pos += n;
+			return true;
+		}
+
+		void operator()() {}
+
+		template<class T, class T2, class... Ts>
+		void operator()(T& t, T2& t2, Ts&... ts)
+		{
+			(*this)(t);
+			(*this)(t2, ts...);
+		}
+
+		template<class T>
+		typename std::enable_if<std::is_arithmetic<T>::value || std::is_enum<T>::value>::type
+		operator()(T& t) { readBytes(&t, sizeof(T)); }
+
+		template<class T>
+		typename std::enable_if<std::is_class<T>::value>::type
+		operator()(T& t) { t.serialize(*this); }
+
+		void operator()(std::string& s)
+		{
+			std::size_t size = readSize();
+			s.assign(_good ? _data.data() + _pos : "", size);
+			_pos += size;
+		}
+
+		void operator()(Tools::Date& d)
+		{
+			bool valid = false;
+			(*this)(valid);
+			if(valid)
+			{
+				std::int32_t day = 0, month = 0, year = 0;
+				bool isRelative = false, useLeapYears = true;
+				(*this)(day, month, year, isRelative, useLeapYears);
+				d = Tools::Date(day, month, year, isRelative, useLeapYears);
+			}
+			else
+				d = Tools::Date();
+		}
+
+		void operator()(json11::Json& j)
+		{
+			std::string s;
+			(*this)(s);
+			if(!_good)
+				return;
+			auto r = decodeBinaryJson(s);
+			if(r.success())
+				j = r.result;
+			else
+				_good = false;
+		}
+
+		template<class T>
+		void operator()(std::vector<T>& v)
+		{
+			v.resize(readSize());
+			readElements(v, std::integral_constant<bool, std::is_arithmetic<T>::value>());
+		}
+
+		void operator()(std::vector<bool>& v)
+		{
+			v.resize(readSize());
+			for(std::size_t i = 0, size = v.size(); i < size; i++)
+			{
+				bool b = false;
+				(*this)(b);
+				v[i] = b;
+			}
+		}
+
+		template<class K, class V>
+		void operator()(std::map<K, V>& m)
+		{
+			m.clear();
+			for(std::size_t i = 0, size = readSize(); i < size; i++)
+			{
+				K k{};
+				(*this)(k);
+				(*this)(m[k]);
+			}
+		}
+
+		template<class T>
+		void operator()(std::set<T>& s)
+		{
+			s.clear();
+			for(std::size_t i = 0, size = readSize(); i < size; i++)
+			{
+				T t{};
+				(*this)(t);
+				s.insert(t);
+			}
+		}
+
+		template<class T>
+		void operator()(std::list<T>& l)
+		{
+			l.resize(readSize());
+			for(auto& t : l)
+				(*this)(t);
+		}
+
+	private:
+		//! read a container size, an impossible size marks the state as broken
+		//! so that a corrupt state can't trigger huge allocations
+		std::size_t readSize()
+		{
+			std::uint64_t s = 0;
+			if(!readBytes(&s, sizeof(s)) || s > _data.size() - _pos)
+			{
+				_good = false;
+				return 0;
+			}
+			return std::size_t(s);
+		}
+
+		template<class T>
+		void readElements(std::vector<T>& v, std::true_type)
+		{
+			if(!v.empty() && !readBytes(v.data(), v.size()*sizeof(T)))
+				v.clear();
+		}
+
+		template<class T>
+		void readElements(std::vector<T>& v, std::false_type)
+		{
+			for(auto& t : v)
+				(*this)(t);
+		}
+
+		const std::string& _data;
+		std::size_t _pos{0};
+		bool _good{true};
+	};
+}
+
+#endif
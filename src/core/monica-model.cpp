@@ -94,6 +94,161 @@ MonicaModel::MonicaModel(const CentralParameterProvider& cpp)
   , vw_AtmosphericCO2Concentration(_envPs.p_AtmosphericCO2)
 {}
 
+MonicaModel::MonicaModel(const MonicaModel& other, CropPtr currentCrop)
+	: MonicaModel(other.parameterProvider())
+{
+	StateWriter sw;
+	other.saveState(sw);
+	StateReader sr(sw.data());
+	restoreState(sr, currentCrop ? currentCrop : other._currentCrop);
+}
+
+CentralParameterProvider MonicaModel::parameterProvider() const
+{
+	CentralParameterProvider cpp;
+	cpp.siteParameters = _sitePs;
+	cpp.userSoilMoistureParameters = _smPs;
+	cpp.userEnvironmentParameters = _envPs;
+	cpp.userCropParameters = _cropPs;
+	cpp.userSoilTemperatureParameters = _soilTempPs;
+	cpp.userSoilTransportParameters = _soilTransPs;
+	cpp.userSoilOrganicParameters = _soilOrganicPs;
+	cpp.simulationParameters = _simPs;
+	cpp.groundwaterInformation = _groundwaterInformation;
+	return cpp;
+}
+
+void MonicaModel::saveState(StateWriter& sw) const
+{
+	//writing doesn't change the model, the non const serialize is just shared with reading
+	const_cast<MonicaModel*>(this)->serialize(sw);
+}
+
+bool MonicaModel::restoreState(StateReader& sr, CropPtr currentCrop)
+{
+	_currentCrop = currentCrop;
+	serialize(sr);
+	return sr.good();
+}
+
+bool MonicaModel::restoreSoilState(StateReader& sr)
+{
+	_currentCrop.reset();
+	delete _currentCropGrowth;
+	_currentCropGrowth = nullptr;
+	_soilTransport.remove_Crop();
+	_soilColumn.remove_Crop();
+	_soilMoisture.remove_Crop();
+	_soilOrganic.remove_Crop();
+
+	//the soil modules follow the crop growth flag, see serialize
+	bool hasCropGrowth = false;
+	sr(hasCropGrowth,
+		 _soilColumn,
+		 _soilTemperature,
+		 _soilMoisture,
+		 _soilOrganic,
+		 _soilTransport);
+	return sr.good();
+}
+
+/*!
+ * The simulation parameters are part of the configuration (see parameterProvider()),
+ * the current crop itself belongs to the cultivation method and has to be supplied when restoring.
+ */
+template<class Archive>
+void MonicaModel::serialize(Archive& ar)
+{
+	//the crop growth module has to exist before the soil state is restored,
+	//because creating it touches the soil modules
+	bool hasCropGrowth = _currentCropGrowth != nullptr;
+	ar(hasCropGrowth);
+	if(Archive::isReading)
+	{
+		delete _currentCropGrowth;
+		_currentCropGrowth = nullptr;
+		_soilTransport.remove_Crop();
+		_soilColumn.remove_Crop();
+		_soilMoisture.remove_Crop();
+		_soilOrganic.remove_Crop();
+
+		if(hasCropGrowth && _currentCrop && _currentCrop->isValid())
+			createCropGrowth();
+	}
+
+	ar(_soilColumn,
+		 _soilTemperature,
+		 _soilMoisture,
+		 _soilOrganic,
+		 _soilTransport);
+
+	if(hasCropGrowth)
+	{
+		if(_currentCropGrowth)
+			ar(*_currentCropGrowth);
+		else //restoring without the crop, the remaining state can't be interpreted anymore
+		{
+			ar.setFailed();
+			return;
+		}
+	}
+
+	ar(_rad24, _rad240, _tfol24, _tfol240,
+		 _index24, _index240,
+		 _full24, _full240,
+		 _sumFertiliser,
+		 _sumOrgFertiliser,
+		 _dailySumFertiliser,
+		 _dailySumOrgFertiliser,
+		 _dailySumOrganicFertilizerDM,
+		 _sumOrganicFertilizerDM,
+		 _humusBalanceCarryOver,
+		 _dailySumIrrigationWater,
+		 _optCarbonExportedResidues,
+		 _optCarbonReturnedResidues,
+		 _currentStepDate,
+		 _climateData,
+		 _currentEvents,
+		 _previousDaysEvents,
+		 _clearCropUponNextDay,
+		 p_daysWithCrop,
+		 p_accuNStress,
+		 p_accuWaterStress,
+		 p_accuHeatStress,
+		 p_accuOxygenStress,
+		 vw_AtmosphericCO2Concentration,
+		 vw_AtmosphericO3Concentration,
+		 vs_GroundwaterDepth,
+		 _cultivationMethodCount);
+}
+template void MonicaModel::serialize<StateWriter>(StateWriter&);
+template void MonicaModel::serialize<StateReader>(StateReader&);
+
+
+void MonicaModel::createCropGrowth()
+{
+	auto addOMFunc = [this](std::map<int, double> layer2amount, double nconc)
+	{
+		this->_soilOrganic.addOrganicMatter(this->_currentCrop->residueParameters(), layer2amount, nconc); 
+	};
+	auto cps = _currentCrop->cropParameters();
+	_currentCropGrowth = new CropGrowth(_soilColumn,
+																			*cps,
+																			_sitePs,
+																			_cropPs,
+																			_simPs,
+																			[this](string event){ this->addEvent(event); },
+																			addOMFunc,
+																			_currentCrop->getEva2TypeUsage());
+
+	if (_currentCrop->perennialCropParameters())
+		_currentCropGrowth->setPerennialCropParameters(_currentCrop->perennialCropParameters());
+
+	_soilTransport.put_Crop(_currentCropGrowth);
+	_soilColumn.put_Crop(_currentCropGrowth);
+	_soilMoisture.put_Crop(_currentCropGrowth);
+	_soilOrganic.put_Crop(_currentCropGrowth);
+}
 
 /**
  * @brief Simulation of crop seed.
@@ -116,27 +271,8 @@ void MonicaModel::seedCrop(CropPtr crop)
 		_currentCrop = crop;
 		_cultivationMethodCount++;
 
-		auto addOMFunc = [this](std::map<int, double> layer2amount, double nconc)
-		{
-			this->_soilOrganic.addOrganicMatter(this->_currentCrop->residueParameters(), layer2amount, nconc); 
-		};
-    auto cps = _currentCrop->cropParameters();
-    _currentCropGrowth = new CropGrowth(_soilColumn,
-                                        *cps,
-                                        _sitePs,
-                                        _cropPs,
-                                        _simPs,
-																				[this](string event){ this->addEvent(event); },
-																				addOMFunc,
-                                        crop->getEva2TypeUsage());
-
-    if (_currentCrop->perennialCropParameters())
-      _currentCropGrowth->setPerennialCropParameters(_currentCrop->perennialCropParameters());
-
-    _soilTransport.put_Crop(_currentCropGrowth);
-    _soilColumn.put_Crop(_currentCropGrowth);
-    _soilMoisture.put_Crop(_currentCropGrowth);
-    _soilOrganic.put_Crop(_currentCropGrowth);
+		createCropGrowth();
+		auto cps = _currentCrop->cropParameters();
 
 //    debug() << "seedDate: "<< _currentCrop->seedDate().toString()
 //            << " harvestDate: " << _currentCrop->harvestDate().toString() << endl;
@@ -641,18 +777,30 @@ void MonicaModel::generalStep()
     addDailySumFertiliser(fertilizerAmount);
 	}
 
-  _soilTemperature.step(tmin, tmax, globrad);
+	{
+		ProfileTimer timer(_profile, RunProfile::SoilTemperature);
+		_soilTemperature.step(tmin, tmax, globrad);
+	}
 
   // first try to get ReferenceEvapotranspiration from climate data
   auto et0_it = climateData.find(Climate::et0);
   double et0 = et0_it == climateData.end() ? -1.0 : et0_it->second;  
 
-  _soilMoisture.step(vs_GroundwaterDepth, precip, tmax, tmin,
-	  (relhumid / 100.0), tavg, wind, _envPs.p_WindSpeedHeight, globrad,
-	  julday, et0);
+	{
+		ProfileTimer timer(_profile, RunProfile::SoilMoisture);
+		_soilMoisture.step(vs_GroundwaterDepth, precip, tmax, tmin,
+			(relhumid / 100.0), tavg, wind, _envPs.p_WindSpeedHeight, globrad,
+			julday, et0);
+	}
   
-	_soilOrganic.step(tavg, precip, wind);
-	_soilTransport.step();
+	{
+		ProfileTimer timer(_profile, RunProfile::SoilOrganic);
+		_soilOrganic.step(tavg, precip, wind);
+	}
+	{
+		ProfileTimer timer(_profile, RunProfile::SoilTransport);
+		_soilTransport.step();
+	}
 }
 
 pair<double, double> laiSunShade(double latitude, int doy, int hour, double lai)
@@ -727,9 +875,12 @@ void MonicaModel::cropStep()
 
   double vw_WindSpeedHeight = _envPs.p_WindSpeedHeight;
 
-  _currentCropGrowth->step(tavg, tmax, tmin, globrad, sunhours, date,
-                           (relhumid / 100.0), wind, vw_WindSpeedHeight,
-                           vw_AtmosphericCO2Concentration, vw_AtmosphericO3Concentration, precip, et0);
+	{
+		ProfileTimer timer(_profile, RunProfile::CropGrowth);
+		_currentCropGrowth->step(tavg, tmax, tmin, globrad, sunhours, date,
+														 (relhumid / 100.0), wind, vw_WindSpeedHeight,
+														 vw_AtmosphericCO2Concentration, vw_AtmosphericO3Concentration, precip, et0);
+	}
   if(_simPs.p_UseAutomaticIrrigation)
   {
     const AutomaticIrrigationParameters& aips = _simPs.p_AutoIrrigationParams;
@@ -43,6 +43,8 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 #include "tools/helper.h"
 #include "soil/soil.h"
 #include "soil/constants.h"
+#include "model-state.h"
+#include "run-profile.h"
 #include "../run/cultivation-method.h"
 
 
@@ -63,8 +65,30 @@ namespace Monica
 	public:
 		MonicaModel(const CentralParameterProvider& cpp);
 
+		//! deep copy of a running model, the copy can be stepped independently from other
+		//! @param currentCrop if the caller copied the crops as well (e.g. together with the cultivation methods)
+		//! the copy's replacement for other's current crop, by default the copy shares the crop object with other
+		MonicaModel(const MonicaModel& other, CropPtr currentCrop = CropPtr());
+
+		MonicaModel& operator=(const MonicaModel&) = delete;
+
 		~MonicaModel();
 
+		//! write the complete dynamic state of the model (soil, crop, accumulated values)
+		void saveState(StateWriter& sw) const;
+
+		//! restore a state written by saveState into a model created from the same parameters
+		//! @param currentCrop the crop which was planted when the state has been saved
+		//! @return false if the state couldn't be read completely
+		bool restoreState(StateReader& sr, CropPtr currentCrop);
+
+		//! restore only the soil part of a state written by saveState (e.g. the result of a spin-up run),
+		//! the model will be without crop afterwards
+		bool restoreSoilState(StateReader& sr);
+
+		template<class Archive>
+		void serialize(Archive& ar);
+
 		void step();
 		
 		void generalStep();
@@ -274,7 +298,14 @@ namespace Monica
 		double optCarbonReturnedResidues() const { return _optCarbonReturnedResidues; }
 		double humusBalanceCarryOver() const { return _humusBalanceCarryOver; }
 
+		//! time the module steps into profile (not owned), nullptr disables profiling
+		void setProfile(RunProfile* profile) { _profile = profile; }
+
 	private:
+		CentralParameterProvider parameterProvider() const;
+
+		void createCropGrowth();
+
 		const SiteParameters _sitePs;
 		const UserSoilMoistureParameters _smPs;
 		const UserEnvironmentParameters _envPs;
@@ -336,6 +367,8 @@ namespace Monica
 		double vs_GroundwaterDepth{0.0};
 
 		int _cultivationMethodCount{0};
+
+		RunProfile* _profile{nullptr};
 	};
 }
 
@@ -74,6 +74,9 @@ namespace Monica
 
 		virtual json11::Json to_json() const;
 
+		template<class Archive>
+		void serialize(Archive& ar) { ar(organId, yieldPercentage, yieldDryMatter); }
+
 		int organId{ -1 };
 		double yieldPercentage{ 0.0 };
 		double yieldDryMatter{ 0.0 };
@@ -314,6 +317,9 @@ namespace Monica
 		//! @param vo_NO3
 		inline void setNO3(double NO3) { vo_NO3 = NO3; }
 
+		template<class Archive>
+		void serialize(Archive& ar) { ar(id, name, vo_Carbamid, vo_NO3, vo_NH4); }
+
 	private:
 		std::string id;
 		std::string name;
@@ -0,0 +1,97 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+Authors:
+Michael Berg <michael.berg@zalf.de>
+
+Maintainers:
+Currently maintained by the authors.
+
+This file is part of the MONICA model.
+Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
+*/
+
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+
+#include "run-profile.h"
+#include "json11/json11-helper.h"
+
+using namespace Monica;
+using namespace Tools;
+using namespace json11;
+using namespace std;
+
+string RunProfile::name(Section s)
+{
+	switch(s)
+	{
+	case Step: return "step";
+	case ClimateData: return "climate-data";
+	case Worksteps: return "worksteps";
+	case SoilTemperature: return "soil-temperature";
+	case SoilMoisture: return "soil-moisture";
+	case SoilOrganic: return "soil-organic";
+	case SoilTransport: return "soil-transport";
+	case CropGrowth: return "crop-growth";
+	case DailyFunctions: return "daily-functions";
+	case OutputEvents: return "output-events";
+	case OutputStore: return "output-store";
+	default: return "unknown";
+	}
+}
+
+Json RunProfile::to_json() const
+{
+	J11Object res;
+	for(int i = 0; i < _NoOfSections; i++)
+	{
+		const auto& e = _entries[i];
+		if(e.calls == 0)
+			continue;
+		res[name(Section(i))] = J11Object
+		{{"total", e.totalSeconds}
+		,{"calls", double(e.calls)}
+		,{"max", e.maxSeconds}
+		};
+	}
+	return res;
+}
+
+string RunProfile::toTable(const Json& profile)
+{
+	vector<pair<string, Json>> es(profile.object_items().begin(), profile.object_items().end());
+	sort(es.begin(), es.end(), [](const pair<string, Json>& l, const pair<string, Json>& r)
+	{
+		return l.second["total"].number_value() > r.second["total"].number_value();
+	});
+
+	double stepTotal = profile["step"]["total"].number_value();
+
+	ostringstream oss;
+	oss
+		<< left << setw(18) << "section"
+		<< right << setw(12) << "total ms"
+		<< setw(8) << "%"
+		<< setw(10) << "calls"
+		<< setw(12) << "mean us"
+		<< setw(12) << "max us" << endl;
+	for(const auto& p : es)
+	{
+		double total = p.second["total"].number_value();
+		double calls = p.second["calls"].number_value();
+		oss
+			<< left << setw(18) << p.first
+			<< right << fixed << setprecision(1)
+			<< setw(12) << total * 1e3
+			<< setw(8) << (stepTotal > 0 ? total / stepTotal * 100.0 : 0.0)
+			<< setw(10) << setprecision(0) << calls
+			<< setw(12) << setprecision(1) << (calls > 0 ? total / calls * 1e6 : 0.0)
+			<< setw(12) << p.second["max"].number_value() * 1e6 << endl;
+	}
+	return oss.str();
+}
@@ -0,0 +1,107 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+Authors:
+Michael Berg <michael.berg@zalf.de>
+
+Maintainers:
+Currently maintained by the authors.
+
+This file is part of the MONICA model.
+Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
+*/
+
+#ifndef MONICA_RUN_PROFILE_H_
+#define MONICA_RUN_PROFILE_H_
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "json11/json11.hpp"
+
+namespace Monica
+{
+	/*!
+	 * Time spent in the sections of a run (the model's modules and the run's management and output machinery),
+	 * filled by ProfileTimers if profiling is enabled for the run (Env::profile).
+	 */
+	class RunProfile
+	{
+	public:
+		enum Section
+		{
+			Step,              //!< a whole simulated day
+			ClimateData,       //!< providing the day's climate data
+			Worksteps,         //!< applying worksteps and cycling through the crop rotation
+			SoilTemperature,
+			SoilMoisture,
+			SoilOrganic,
+			SoilTransport,
+			CropGrowth,
+			DailyFunctions,    //!< the daily functions registered by worksteps
+			OutputEvents,      //!< evaluating the output events, including OutputStore
+			OutputStore,       //!< storing and aggregating the results
+			_NoOfSections
+		};
+
+		static std::string name(Section s);
+
+		struct Entry
+		{
+			double totalSeconds{0};
+			std::uint64_t calls{0};
+			double maxSeconds{0};
+		};
+
+		void add(Section s, double seconds)
+		{
+			auto& e = _entries[s];
+			e.totalSeconds += seconds;
+			e.calls++;
+			if(seconds > e.maxSeconds)
+				e.maxSeconds = seconds;
+		}
+
+		const Entry& entry(Section s) const { return _entries[s]; }
+
+		//! {"section-name": {"total": seconds, "calls": n, "max": seconds}, ...} for the sections being called
+		json11::Json to_json() const;
+
+		//! a table of the sections in profile (as returned by to_json), sorted by total time
+		static std::string toTable(const json11::Json& profile);
+
+	private:
+		Entry _entries[_NoOfSections];
+	};
+
+	//! adds the time from construction to destruction to a section of profile, does nothing if profile is null
+	class ProfileTimer
+	{
+	public:
+		ProfileTimer(RunProfile* profile, RunProfile::Section section)
+			: _profile(profile), _section(section)
+		{
+			if(_profile)
+				_start = std::chrono::steady_clock::now();
+		}
+
+		~ProfileTimer()
+		{
+			if(_profile)
+				_profile->add(_section, std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count());
+		}
+
+		ProfileTimer(const ProfileTimer&) = delete;
+		ProfileTimer& operator=(const ProfileTimer&) = delete;
+
+	private:
+		RunProfile* _profile;
+		RunProfile::Section _section;
+		std::chrono::steady_clock::time_point _start;
+	};
+}
+
+#endif //MONICA_RUN_PROFILE_H_
@@ -32,6 +32,7 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 #include "crop-growth.h"
 #include "soilcolumn.h"
 #include "tools/debug.h"
+#include "model-state.h"
 #include "soil/constants.h"
 
 using namespace Monica;
@@ -215,16 +216,15 @@ applyMineralFertiliserViaNMinMethod(MineralFertiliserParameters fp,
 {
 	if (at(0).get_Vs_SoilMoisture_m3() > at(0).vs_FieldCapacity())
 	{
-		_delayedNMinApplications.push_back([=]()
-		{
-			return this->applyMineralFertiliserViaNMinMethod(fp,
-				vf_SamplingDepth,
-				vf_CropNTarget,
-				vf_CropNTarget30,
-				vf_FertiliserMinApplication,
-				vf_FertiliserMaxApplication,
-				vf_TopDressingDelay);
-		});
+		DelayedNMinApplication da;
+		da.fp = fp;
+		da.samplingDepth = vf_SamplingDepth;
+		da.cropNTarget = vf_CropNTarget;
+		da.cropNTarget30 = vf_CropNTarget30;
+		da.fertiliserMinApplication = vf_FertiliserMinApplication;
+		da.fertiliserMaxApplication = vf_FertiliserMaxApplication;
+		da.topDressingDelay = vf_TopDressingDelay;
+		_delayedNMinApplications.push_back(da);
 
 		debug() << "Soil too wet for fertilisation. Fertiliser event adjourned to next day." << endl;
 		return 0.0;
@@ -329,10 +329,17 @@ double SoilColumn::applyPossibleTopDressing()
  * then removes the first fertilizer item in list.
  */
 double SoilColumn::applyPossibleDelayedFerilizer() {
-	list<std::function<double()> > delayedApps = _delayedNMinApplications;
+	list<DelayedNMinApplication> delayedApps = _delayedNMinApplications;
 	double n_amount = 0.0;
 	while (!delayedApps.empty()) {
-		n_amount += delayedApps.front()();
+		const auto& da = delayedApps.front();
+		n_amount += applyMineralFertiliserViaNMinMethod(da.fp,
+			da.samplingDepth,
+			da.cropNTarget,
+			da.cropNTarget30,
+			da.fertiliserMinApplication,
+			da.fertiliserMaxApplication,
+			da.topDressingDelay);
 		delayedApps.pop_front();
 		_delayedNMinApplications.pop_front();
 	}
@@ -731,3 +738,24 @@ double SoilColumn::sumSoilTemperature(int layers) const
    }
 	*/
 
+
+template<class Archive>
+void SoilColumn::serialize(Archive& ar)
+{
+	std::vector<SoilLayer>& layers = *this;
+	ar(layers,
+		 vs_SurfaceWaterStorage,
+		 vs_InterceptionStorage,
+		 vm_GroundwaterTable,
+		 vs_FluxAtLowerBoundary,
+		 vq_CropNUptake,
+		 vt_SoilSurfaceTemperature,
+		 vm_SnowDepth,
+		 _vs_NumberOfOrganicLayers,
+		 _vf_TopDressing,
+		 _vf_TopDressingPartition,
+		 _vf_TopDressingDelay,
+		 _delayedNMinApplications);
+}
+template void SoilColumn::serialize<StateWriter>(StateWriter&);
+template void SoilColumn::serialize<StateReader>(StateReader&);
@@ -88,6 +88,21 @@ namespace Monica
 
     bool incorporation{false};  //!< True if organic fertilizer is added with a subsequent incorporation.
 		bool noVolatilization{true}; //!< true means it's a crop residue and won't participate in vo_volatilisation()
+
+    template<class Archive>
+    void serialize(Archive& ar)
+    {
+      ar(vo_AOM_Slow, vo_AOM_Fast,
+         vo_AOM_SlowDecRate_to_SMB_Slow, vo_AOM_SlowDecRate_to_SMB_Fast,
+         vo_AOM_FastDecRate_to_SMB_Slow, vo_AOM_FastDecRate_to_SMB_Fast,
+         vo_AOM_SlowDecCoeff, vo_AOM_FastDecCoeff,
+         vo_AOM_SlowDecCoeffStandard, vo_AOM_FastDecCoeffStandard,
+         vo_PartAOM_Slow_to_SMB_Slow, vo_PartAOM_Slow_to_SMB_Fast,
+         vo_CN_Ratio_AOM_Slow, vo_CN_Ratio_AOM_Fast,
+         vo_DaysAfterApplication, vo_AOM_DryMatterContent, vo_AOM_NH4Content,
+         vo_AOM_SlowDelta, vo_AOM_FastDelta,
+         incorporation, noVolatilization);
+    }
   };
 
   //----------------------------------------------------------------------------
@@ -169,6 +184,20 @@ namespace Monica
 
     double vs_Soil_CN_Ratio() const { return _sps.vs_Soil_CN_Ratio; }
 
+    //! the static soil parameters are not part of the state,
+    //! except for the organic carbon content, which changes during a run
+    template<class Archive>
+    void serialize(Archive& ar)
+    {
+      double soc = vs_SoilOrganicCarbon();
+      ar(vs_LayerThickness, vs_SoilWaterFlux, vo_AOM_Pool,
+         vs_SOM_Slow, vs_SOM_Fast, vs_SMB_Slow, vs_SMB_Fast,
+         vs_SoilCarbamid, vs_SoilNH4, vs_SoilNO2, vs_SoilNO3, vs_SoilFrozen,
+         soc, vs_SoilMoisture_m3, vs_SoilTemperature);
+      if(Archive::isReading && soc != vs_SoilOrganicCarbon())
+        set_SoilOrganicCarbon(soc);
+    }
+
     // members ------------------------------------------------------------
 
     double vs_LayerThickness; //!< Soil layer's vertical extension [m]
@@ -198,6 +227,28 @@ namespace Monica
 
   //----------------------------------------------------------------------------
 
+  //! a fertiliser application via the Nmin method, which had to be postponed
+  //! because the soil was too wet
+  struct DelayedNMinApplication
+  {
+    MineralFertiliserParameters fp;
+    double samplingDepth{0.0};
+    double cropNTarget{0.0};
+    double cropNTarget30{0.0};
+    double fertiliserMinApplication{0.0};
+    double fertiliserMaxApplication{0.0};
+    int topDressingDelay{0};
+
+    template<class Archive>
+    void serialize(Archive& ar)
+    {
+      ar(fp, samplingDepth, cropNTarget, cropNTarget30,
+         fertiliserMinApplication, fertiliserMaxApplication, topDressingDelay);
+    }
+  };
+
+  //----------------------------------------------------------------------------
+
   /**
    * @author Claas Nendel, Michael Berg
    *
@@ -293,6 +344,9 @@ namespace Monica
 
 	void clearTopDressingParams() { _vf_TopDressing = 0.0, _vf_TopDressingDelay = 0; }
 
+    template<class Archive>
+    void serialize(Archive& ar);
+
   private:
     int calculateNumberOfOrganicLayers();
 
@@ -305,7 +359,7 @@ namespace Monica
 
     CropGrowth* cropGrowth{nullptr};
 
-    std::list<std::function<double()>> _delayedNMinApplications;
+    std::list<DelayedNMinApplication> _delayedNMinApplications;
 
     double pm_CriticalMoistureDepth;
   };
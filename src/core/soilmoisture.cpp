@@ -28,6 +28,7 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 #include "crop-growth.h"
 #include "monica-model.h"
 #include "tools/debug.h"
+#include "model-state.h"
 #include "tools/algorithms.h"
 #include "soil/conversion.h"
 
@@ -2015,3 +2016,101 @@ void SoilMoisture::remove_Crop() {
   crop = NULL;
 }
 
+
+template<class Archive>
+void SnowComponent::serialize(Archive& ar)
+{
+	ar(vm_SnowDensity,
+		 vm_SnowDepth,
+		 vm_FrozenWaterInSnow,
+		 vm_LiquidWaterInSnow,
+		 vm_WaterToInfiltrate,
+		 vm_maxSnowDepth,
+		 vm_AccumulatedSnowDepth);
+}
+template void SnowComponent::serialize<StateWriter>(StateWriter&);
+template void SnowComponent::serialize<StateReader>(StateReader&);
+
+template<class Archive>
+void FrostComponent::serialize(Archive& ar)
+{
+	ar(vm_FrostDepth,
+		 vm_accumulatedFrostDepth,
+		 vm_NegativeDegreeDays,
+		 vm_ThawDepth,
+		 vm_FrostDays,
+		 vm_LambdaRedux,
+		 vm_TemperatureUnderSnow,
+		 vm_HydraulicConductivityRedux);
+}
+template void FrostComponent::serialize<StateWriter>(StateWriter&);
+template void FrostComponent::serialize<StateReader>(StateReader&);
+
+template<class Archive>
+void SoilMoisture::serialize(Archive& ar)
+{
+	ar(vm_ActualEvaporation,
+		 vm_ActualEvapotranspiration,
+		 vm_ActualTranspiration,
+		 vm_AvailableWater,
+		 vm_CapillaryRise,
+		 pm_CapillaryRiseRate,
+		 vm_CapillaryWater,
+		 vm_CapillaryWater70,
+		 vm_Evaporation,
+		 vm_Evapotranspiration,
+		 vm_FieldCapacity,
+		 vm_FluxAtLowerBoundary,
+		 vm_GravitationalWater,
+		 vm_GrossPrecipitation,
+		 vm_GroundwaterAdded,
+		 vm_GroundwaterDischarge,
+		 vm_GroundwaterTable,
+		 vm_HeatConductivity,
+		 vm_HydraulicConductivityRedux,
+		 vm_Infiltration,
+		 vm_Interception,
+		 vc_KcFactor,
+		 vm_Lambda,
+		 vm_LambdaReduced,
+		 vs_Latitude,
+		 vm_LayerThickness,
+		 pm_LayerThickness,
+		 pm_LeachingDepth,
+		 pm_LeachingDepthLayer,
+		 vw_MaxAirTemperature,
+		 pm_MaxPercolationRate,
+		 vw_MeanAirTemperature,
+		 vw_MinAirTemperature,
+		 vc_NetPrecipitation,
+		 vw_NetRadiation,
+		 vm_PermanentWiltingPoint,
+		 vc_PercentageSoilCoverage,
+		 vm_PercolationRate,
+		 vw_Precipitation,
+		 vm_ReferenceEvapotranspiration,
+		 vw_RelativeHumidity,
+		 vm_ResidualEvapotranspiration,
+		 vm_SaturatedHydraulicConductivity,
+		 vm_SoilMoisture,
+		 vm_SoilMoisture_crit,
+		 vm_SoilMoistureDeficit,
+		 vm_SoilPoreVolume,
+		 vc_StomataResistance,
+		 vm_SurfaceRoughness,
+		 vm_SurfaceRunOff,
+		 vm_SumSurfaceRunOff,
+		 vm_SurfaceWaterStorage,
+		 pt_TimeStep,
+		 vm_TotalWaterRemoval,
+		 vm_Transpiration,
+		 vm_TranspirationDeficit,
+		 vm_WaterFlux,
+		 vw_WindSpeed,
+		 vw_WindSpeedHeight,
+		 vm_XSACriticalSoilMoisture,
+		 snowComponent,
+		 frostComponent);
+}
+template void SoilMoisture::serialize<StateWriter>(StateWriter&);
+template void SoilMoisture::serialize<StateReader>(StateReader&);
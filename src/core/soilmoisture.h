@@ -58,6 +58,9 @@ namespace Monica
       double getMaxSnowDepth() const {return this->vm_maxSnowDepth; }
       double getAccumulatedSnowDepth() const {return this->vm_AccumulatedSnowDepth; }
 
+      template<class Archive>
+      void serialize(Archive& ar);
+
     private:
       double calcSnowMelt(double vw_MeanAirTemperature);
       double calcNetPrecipitation(double mean_air_temperature, double net_precipitation, double& net_precipitation_water, double& net_precipitation_snow);
@@ -115,6 +118,9 @@ namespace Monica
       double getAccumulatedFrostDepth() const { return vm_accumulatedFrostDepth; }
       double getTemperatureUnderSnow() const { return vm_TemperatureUnderSnow; }
 
+      template<class Archive>
+      void serialize(Archive& ar);
+
     private:
       double getMeanBulkDensity();
       double getMeanFieldCapacity();
@@ -237,6 +243,9 @@ namespace Monica
     void put_Crop(Monica::CropGrowth* crop);
     void remove_Crop();
 
+    template<class Archive>
+    void serialize(Archive& ar);
+
 //    void fm_SoilFrost(double vw_MeanAirTemperature,
 //                      double vm_SnowDepth);
 
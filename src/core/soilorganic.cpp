@@ -32,6 +32,7 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 #include "soil/constants.h"
 #include "tools/algorithms.h"
 #include "stics-nit-denit-n2o.h"
+#include "model-state.h"
 
 using namespace std;
 using namespace Monica;
@@ -1912,3 +1913,46 @@ double SoilOrganic::get_Organic_N(int i) const {
 
   return orgN;
 }
+
+template<class Archive>
+void SoilOrganic::serialize(Archive& ar)
+{
+	ar(addedOrganicMatter,
+		 irrigationAmount,
+		 vo_ActAmmoniaOxidationRate,
+		 vo_ActNitrificationRate,
+		 vo_ActDenitrificationRate,
+		 vo_AOM_FastDeltaSum,
+		 vo_AOM_FastInput,
+		 vo_AOM_FastSum,
+		 vo_AOM_SlowDeltaSum,
+		 vo_AOM_SlowInput,
+		 vo_AOM_SlowSum,
+		 vo_CBalance,
+		 vo_DecomposerRespiration,
+		 vo_ErrorMessage,
+		 vo_InertSoilOrganicC,
+		 vo_N2O_Produced,
+		 vo_NetEcosystemExchange,
+		 vo_NetEcosystemProduction,
+		 vo_NetNMineralisation,
+		 vo_NetNMineralisationRate,
+		 vo_Total_NH3_Volatilised,
+		 vo_NH3_Volatilised,
+		 vo_SMB_CO2EvolutionRate,
+		 vo_SMB_FastDelta,
+		 vo_SMB_SlowDelta,
+		 vs_SoilMineralNContent,
+		 vo_SoilOrganicC,
+		 vo_SOM_FastDelta,
+		 vo_SOM_FastInput,
+		 vo_SOM_SlowDelta,
+		 vo_SumDenitrification,
+		 vo_SumNetNMineralisation,
+		 vo_SumN2O_Produced,
+		 vo_SumNH3_Volatilised,
+		 vo_TotalDenitrification,
+		 incorporation);
+}
+template void SoilOrganic::serialize<StateWriter>(StateWriter&);
+template void SoilOrganic::serialize<StateReader>(StateReader&);
@@ -59,6 +59,9 @@ namespace Monica
 
     void step(double vw_Precipitation, double vw_MeanAirTemperature, double vw_WindSpeed);
 
+    //! mineralisation, immobilisation and turnover of the organic matter pools of all layers (part of step)
+    void fo_MIT();
+
     void addOrganicMatter(OrganicMatterParametersPtr addedOrganicMatter,
 													std::map<int, double> layer2amount,
 													double nConcentration = 0);
@@ -122,10 +125,12 @@ namespace Monica
       return vo_ActDenitrificationRate.at(i);
     }
 
+    template<class Archive>
+    void serialize(Archive& ar);
+
   private:
     //void fo_OM_Input(bool vo_AOM_Addition);
     void fo_Urea(double vo_RainIrrigation);
-    void fo_MIT();
     void fo_Volatilisation(bool vo_AOM_Addition, double vw_MeanAirTemperature, double vw_WindSpeed);
     
     // MONICA nitrification code
@@ -27,6 +27,7 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 #include "soilcolumn.h"
 #include "monica-model.h"
 #include "tools/debug.h"
+#include "model-state.h"
 
 using namespace std;
 using namespace Climate;
@@ -432,3 +433,26 @@ double SoilTemperature::get_AvgTopSoilTemperature(double sumLT) const
 
 	return count < 1 ? 0 : tempSum / double(count);
 }
+
+template<class Archive>
+void SoilTemperature::serialize(Archive& ar)
+{
+	ar(vt_SoilSurfaceTemperature,
+		 _soilColumn_vt_GroundLayer,
+		 _soilColumn_vt_BottomLayer,
+		 vs_SoilMoisture_const,
+		 vt_SoilTemperature,
+		 vt_V,
+		 vt_VolumeMatrix,
+		 vt_VolumeMatrixOld,
+		 vt_B,
+		 vt_MatrixPrimaryDiagonal,
+		 vt_MatrixSecundaryDiagonal,
+		 vt_HeatFlow,
+		 vt_HeatConductivity,
+		 vt_HeatConductivityMean,
+		 vt_HeatCapacity,
+		 _dampingFactor);
+}
+template void SoilTemperature::serialize<StateWriter>(StateWriter&);
+template void SoilTemperature::serialize<StateReader>(StateReader&);
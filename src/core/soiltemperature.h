@@ -68,6 +68,9 @@ namespace Monica
     double dampingFactor() const { return _dampingFactor; }
     void setDampingFactor(double factor) { _dampingFactor = factor; }
 
+    template<class Archive>
+    void serialize(Archive& ar);
+
     double vt_SoilSurfaceTemperature;
 
   private:
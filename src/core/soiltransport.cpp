@@ -26,6 +26,7 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 #include "crop-growth.h"
 #include "tools/debug.h"
 #include "tools/debug.h"
+#include "model-state.h"
 
 using namespace std;
 using namespace Monica;
@@ -453,3 +454,30 @@ void SoilTransport::remove_Crop() {
   crop = NULL;
 }
 
+
+template<class Archive>
+void SoilTransport::serialize(Archive& ar)
+{
+	ar(vq_Convection,
+		 vq_CropNUptake,
+		 vq_DiffusionCoeff,
+		 vq_Dispersion,
+		 vq_DispersionCoeff,
+		 vq_FieldCapacity,
+		 vq_LayerThickness,
+		 vs_LeachingDepth,
+		 vq_LeachingAtBoundary,
+		 vs_NDeposition,
+		 vc_NUptakeFromLayer,
+		 vq_PoreWaterVelocity,
+		 vs_SoilMineralNContent,
+		 vq_SoilMoisture,
+		 vq_SoilNO3,
+		 vq_SoilNO3_aq,
+		 vq_TimeStep,
+		 vq_CurrentTimeStep,
+		 vq_TotalDispersion,
+		 vq_PercolationRate);
+}
+template void SoilTransport::serialize<StateWriter>(StateWriter&);
+template void SoilTransport::serialize<StateReader>(StateReader&);
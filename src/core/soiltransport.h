@@ -70,6 +70,9 @@ namespace Monica
 	double get_vq_Dispersion(int i_Layer) const;
 	double get_vq_Convection(int i_Layer) const;
 
+    template<class Archive>
+    void serialize(Archive& ar);
+
   private:
     //methods
     void calculateSoilTransportStep();
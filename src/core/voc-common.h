@@ -123,6 +123,9 @@ namespace Voc
 		double jj{0}; //umol m-2 s-1 ... electron provision (unit leaf area)
 		double jj1000{0}; //umol m-2 s-1 ... electron provision (unit leaf area) under normalized conditions 
 		double jv{0}; //umol m-2 s-1 ... used electron transport for photosynthesis (unit leaf area)
+
+		template<class Archive>
+		void serialize(Archive& ar) { ar(kc, ko, oi, ci, comp, vcMax, jMax, jj, jj1000, jv); }
 	};
 
 	struct SpeciesData
@@ -181,6 +184,13 @@ namespace Voc
 		// vegstructure  specific_foliage_area sla_vtfl  double  V : F  0.0  m ^ 2 : g : 10 ^ -3
 		// specific leaf area (pc_SpecificLeafArea / cps.cultivarParams.pc_SpecificLeafArea) pc_SpecificLeafArea[vc_DevelopmentalStage]
 		double sla{0};
+
+		template<class Archive>
+		void serialize(Archive& ar)
+		{
+			ar(id, EF_MONOS, EF_MONO, EF_ISO, THETA, FAGE, CT_IS, CT_MT, HA_IS, HA_MT, DS_IS, DS_MT, HD_IS, HD_MT,
+				 HDJ, SDJ, KC25, KO25, VCMAX25, QJVC, AEKC, AEKO, AEJM, AEVC, SLAMIN, SCALE_I, SCALE_M, mFol, lai, sla);
+		}
 	};
 
 	//----------------------------------------------------------------------------
@@ -238,6 +248,12 @@ namespace Voc
 
 		double isoprene_emission{0.0}; //!< [umol m-2Ground ts-1] isoprene emissions per timestep
 		double monoterpene_emission{0.0}; //!< [umol m-2Ground ts-1] monoterpene emissions per timestep
+
+		template<class Archive>
+		void serialize(Archive& ar)
+		{
+			ar(speciesId_2_isoprene_emission, speciesId_2_monoterpene_emission, isoprene_emission, monoterpene_emission);
+		}
 	};
 
 	//----------------------------------------------------------------------------
@@ -0,0 +1,326 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+Authors:
+Michael Berg <michael.berg@zalf.de>
+
+Maintainers:
+Currently maintained by the authors.
+
+This file is part of the MONICA model.
+Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
+*/
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <limits>
+
+#include "binary-json.h"
+
+using namespace Monica;
+using namespace Tools;
+using namespace json11;
+using namespace std;
+
+namespace
+{
+	enum Tag : uint8_t { Null = 0, False, True, Int32, Float64, String, Array, Object, Int32Array, Float64Array };
+
+	bool isInt32(double d)
+	{
+		return d >= double(numeric_limits<int32_t>::min())
+			&& d <= double(numeric_limits<int32_t>::max())
+			&& std::floor(d) == d
+			&& !(d == 0 && std::signbit(d));
+	}
+
+	struct Writer
+	{
+		string& out;
+
+		void u8(uint8_t v) { out.push_back(char(v)); }
+
+		void varuint(uint64_t v)
+		{
+			while(v >= 0x80)
+			{
+				u8(uint8_t(v) | 0x80);
+				v >>= 7;
+			}
+			u8(uint8_t(v));
+		}
+
+		void i32(int32_t v)
+		{
+			auto u = uint32_t(v);
+			for(int i = 0; i < 4; i++)
+				u8(uint8_t(u >> (8 * i)));
+		}
+
+		void f64(double v)
+		{
+			uint64_t u;
+			memcpy(&u, &v, sizeof(u));
+			for(int i = 0; i < 8; i++)
+				u8(uint8_t(u >> (8 * i)));
+		}
+
+		void str(const string& s)
+		{
+			varuint(s.size());
+			out.append(s);
+		}
+
+		void value(const Json& j)
+		{
+			switch(j.type())
+			{
+			case Json::NUL: u8(Null); break;
+			case Json::BOOL: u8(j.bool_value() ? True : False); break;
+			case Json::NUMBER:
+			{
+				double d = j.number_value();
+				if(isInt32(d))
+					u8(Int32), i32(int32_t(d));
+				else
+					u8(Float64), f64(d);
+				break;
+			}
+			case Json::STRING: u8(String), str(j.string_value()); break;
+			case Json::ARRAY: array(j.array_items()); break;
+			case Json::OBJECT:
+			{
+				const auto& o = j.object_items();
+				u8(Object);
+				varuint(o.size());
+				for(const auto& p : o)
+				{
+					str(p.first);
+					value(p.second);
+				}
+				break;
+			}
+			}
+		}
+
+		void array(const Json::array& a)
+		{
+			//arrays of numbers (e.g. result columns, climate data) are stored as typed arrays
+			bool allNumbers = !a.empty(), allInts = true;
+			for(const auto& j : a)
+			{
+				if(!j.is_number())
+				{
+					allNumbers = false;
+					break;
+				}
+				allInts = allInts && isInt32(j.number_value());
+			}
+
+			if(allNumbers)
+			{
+				u8(allInts ? Int32Array : Float64Array);
+				varuint(a.size());
+				for(const auto& j : a)
+					allInts ? i32(int32_t(j.number_value())) : f64(j.number_value());
+			}
+			else
+			{
+				u8(Array);
+				varuint(a.size());
+				for(const auto& j : a)
+					value(j);
+			}
+		}
+	};
+
+	struct Reader
+	{
+		const string& in;
+		size_t pos{0};
+		string error;
+
+		bool fail(const string& msg)
+		{
+			if(error.empty())
+				error = msg + " at byte " + to_string(pos) + "!";
+			return false;
+		}
+
+		bool has(size_t n) { return n <= in.size() - pos || fail("Unexpected end of binary message"); }
+
+		uint8_t u8() { return has(1) ? uint8_t(in[pos++]) : 0; }
+
+		uint64_t varuint()
+		{
+			uint64_t v = 0;
+			for(int shift = 0; shift < 64 && error.empty(); shift += 7)
+			{
+				auto b = u8();
+				v |= uint64_t(b & 0x7f) << shift;
+				if(!(b & 0x80))
+					return v;
+			}
+			fail("Invalid length in binary message");
+			return 0;
+		}
+
+		//! a count of elements each at least minSize bytes long, which has to fit into the rest of the message
+		size_t count(size_t minSize)
+		{
+			auto n = varuint();
+			if(error.empty() && n > (in.size() - pos) / minSize)
+				return fail("Invalid element count in binary message"), 0;
+			return size_t(n);
+		}
+
+		int32_t i32()
+		{
+			if(!has(4))
+				return 0;
+			uint32_t u = 0;
+			for(int i = 0; i < 4; i++)
+				u |= uint32_t(uint8_t(in[pos++])) << (8 * i);
+			return int32_t(u);
+		}
+
+		double f64()
+		{
+			if(!has(8))
+				return 0;
+			uint64_t u = 0;
+			for(int i = 0; i < 8; i++)
+				u |= uint64_t(uint8_t(in[pos++])) << (8 * i);
+			double d;
+			memcpy(&d, &u, sizeof(d));
+			return d;
+		}
+
+		string str()
+		{
+			auto n = count(1);
+			if(!error.empty())
+				return string();
+			string s = in.substr(pos, n);
+			pos += n;
+			return s;
+		}
+
+		Json value(int depth = 0)
+		{
+			if(depth > 512)
+				return fail("Binary message nested too deeply"), Json();
+
+			auto tag = u8();
+			if(!error.empty())
+				return Json();
+
+			switch(tag)
+			{
+			case Null: return Json();
+			case False: return Json(false);
+			case True: return Json(true);
+			case Int32: return Json(int(i32()));
+			case Float64: return Json(f64());
+			case String: return Json(str());
+			case Array:
+			{
+				auto n = count(1);
+				J11Array a;
+				a.reserve(n);
+				for(size_t i = 0; i < n && error.empty(); i++)
+					a.push_back(value(depth + 1));
+				return a;
+			}
+			case Object:
+			{
+				auto n = count(2);
+				J11Object o;
+				for(size_t i = 0; i < n && error.empty(); i++)
+				{
+					auto key = str();
+					o[key] = value(depth + 1);
+				}
+				return o;
+			}
+			case Int32Array:
+			{
+				auto n = count(4);
+				J11Array a;
+				a.reserve(n);
+				for(size_t i = 0; i < n && error.empty(); i++)
+					a.push_back(int(i32()));
+				return a;
+			}
+			case Float64Array:
+			{
+				auto n = count(8);
+				J11Array a;
+				a.reserve(n);
+				for(size_t i = 0; i < n && error.empty(); i++)
+					a.push_back(f64());
+				return a;
+			}
+			default:
+				return fail(string("Unknown tag ") + to_string(int(tag)) + " in binary message"), Json();
+			}
+		}
+	};
+}
+
+string Monica::encodeBinaryJson(const Json& j)
+{
+	string out = binaryJsonMagic;
+	out.push_back(char(binaryJsonVersion));
+	Writer{out}.value(j);
+	return out;
+}
+
+bool Monica::isBinaryJson(const string& msg)
+{
+	return msg.size() > binaryJsonMagic.size()
+		&& msg.compare(0, binaryJsonMagic.size(), binaryJsonMagic) == 0;
+}
+
+EResult<Json> Monica::decodeBinaryJson(const string& msg)
+{
+	if(!isBinaryJson(msg))
+		return{Json(), string("Message is not a binary encoded message!")};
+
+	auto version = uint8_t(msg[binaryJsonMagic.size()]);
+	if(version != binaryJsonVersion)
+		return{Json(), string("Unsupported binary message version: ") + to_string(int(version)) + "!"};
+
+	Reader r{msg, binaryJsonMagic.size() + 1};
+	auto j = r.value();
+	if(r.error.empty() && r.pos != msg.size())
+		r.fail("Trailing bytes after binary message");
+	if(!r.error.empty())
+		return{Json(), r.error};
+	return{j};
+}
+
+EResult<Json> Monica::parseJsonOrBinaryJson(const string& msg)
+{
+	if(isBinaryJson(msg))
+		return decodeBinaryJson(msg);
+
+	string err;
+	auto j = Json::parse(msg, err);
+	if(!err.empty())
+		return{j, string("Couldn't parse JSON message: ") + err + "!"};
+	return{j};
+}
+
+bool Monica::isBinaryMsgType(const string& msgType)
+{
+	return msgType.size() > 4 && msgType.compare(msgType.size() - 4, 4, ".bin") == 0;
+}
+
+string Monica::baseMsgType(const string& msgType)
+{
+	return isBinaryMsgType(msgType) ? msgType.substr(0, msgType.size() - 4) : msgType;
+}
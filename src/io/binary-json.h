@@ -0,0 +1,63 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+Authors:
+Michael Berg <michael.berg@zalf.de>
+
+Maintainers:
+Currently maintained by the authors.
+
+This file is part of the MONICA model.
+Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
+*/
+
+#ifndef MONICA_BINARY_JSON_H_
+#define MONICA_BINARY_JSON_H_
+
+#include <string>
+
+#include "json11/json11.hpp"
+#include "json11/json11-helper.h"
+
+namespace Monica
+{
+	/*!
+	 * Compact binary encoding of JSON values, used to send Env and Output messages
+	 * (types "Env.bin" and "Output.bin") via ZeroMQ instead of JSON text.
+	 *
+	 * message := magic "MBJ" version:u8 value
+	 * value   := tag:u8 payload, all numbers little endian
+	 *   0 null, 1 false, 2 true
+	 *   3 int32, 4 float64
+	 *   5 string     := length:varuint bytes
+	 *   6 array      := count:varuint value*
+	 *   7 object     := count:varuint (key:string-payload value)*
+	 *   8 int32[]    := count:varuint int32*    (arrays of integral numbers only)
+	 *   9 float64[]  := count:varuint float64*  (arrays of numbers only, e.g. result columns)
+	 * src/python/monica_io3.py contains the matching Python implementation.
+	 */
+	const std::string binaryJsonMagic = "MBJ";
+	const unsigned char binaryJsonVersion = 1;
+
+	//! encode j into a binary message
+	std::string encodeBinaryJson(const json11::Json& j);
+
+	//! is msg a binary encoded message (instead of JSON text)
+	bool isBinaryJson(const std::string& msg);
+
+	//! decode a binary message back to JSON
+	Tools::EResult<json11::Json> decodeBinaryJson(const std::string& msg);
+
+	//! parse msg either as binary message or as JSON text
+	Tools::EResult<json11::Json> parseJsonOrBinaryJson(const std::string& msg);
+
+	//! does a message type request the binary encoding (e.g. "Env.bin")
+	bool isBinaryMsgType(const std::string& msgType);
+
+	//! the message type without the ".bin" suffix
+	std::string baseMsgType(const std::string& msgType);
+}
+
+#endif //MONICA_BINARY_JSON_H_
@@ -16,7 +16,11 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 */
 
 #include <iostream>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
 #include <mutex>
+#include <atomic>
 #include <memory>
 #include <tuple>
 
@@ -27,8 +31,10 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 #include "../run/run-monica.h"
 //#include "../core/monica-typedefs.h"
 #include "tools/helper.h"
+#include "json11/json11-helper.h"
 
 #include "database-io.h"
+#include "binary-json.h"
 
 using namespace Monica;
 using namespace Tools;
@@ -200,241 +206,698 @@ namespace
 			+ (cropId == -1 ? "" : string("WHERE crop_id = ") + to_string(cropId) + " ")
 			+ "ORDER BY crop_id, organ_id";
 	}
+
+	SpeciesParameters readSpeciesParameters(DBPtr& con, const string& species)
+	{
+		SpeciesParameters sps;
+
+		DBRow row;
+		con->select(speciesSelect(species));
+		debug() << speciesSelect(species) << endl;
+		if(!(row = con->getRow()).empty())
+		{
+			int i = 0;
+
+			sps.pc_SpeciesId = row[i++];
+			sps.pc_CarboxylationPathway = stoi(row[i++]);
+			sps.pc_MinimumTemperatureForAssimilation = stof(row[i++]);
+			sps.pc_MinimumNConcentration = stof(row[i++]);
+			sps.pc_NConcentrationPN = stof(row[i++]);
+			sps.pc_NConcentrationB0 = stof(row[i++]);
+			sps.pc_NConcentrationAbovegroundBiomass = stof(row[i++]);
+			sps.pc_NConcentrationRoot = stof(row[i++]);
+			sps.pc_InitialKcFactor = stof(row[i++]);
+			sps.pc_DevelopmentAccelerationByNitrogenStress = stoi(row[i++]);
+			sps.pc_PartBiologicalNFixation = stof(row[i++]);
+			sps.pc_LuxuryNCoeff = stof(row[i++]);
+			sps.pc_SamplingDepth = stof(row[i++]);
+			sps.pc_TargetNSamplingDepth = stof(row[i++]);
+			sps.pc_TargetN30 = stof(row[i++]);
+			sps.pc_DefaultRadiationUseEfficiency = stof(row[i++]);
+			sps.pc_StageAtMaxHeight = stof(row[i++]);
+			sps.pc_MaxCropDiameter = stof(row[i++]);
+			sps.pc_StageAtMaxDiameter = stof(row[i++]);
+			sps.pc_MaxNUptakeParam = stof(row[i++]);
+			sps.pc_RootDistributionParam = stof(row[i++]);
+			sps.pc_PlantDensity = (int)stof(row[i++]);
+			sps.pc_RootGrowthLag = stof(row[i++]);
+			sps.pc_MinimumTemperatureRootGrowth = stof(row[i++]);
+			sps.pc_InitialRootingDepth = stof(row[i++]);
+			sps.pc_RootPenetrationRate = stof(row[i++]);
+			sps.pc_RootFormFactor = stof(row[i++]);
+			sps.pc_SpecificRootLength = stof(row[i++]);
+			sps.pc_StageAfterCut = stoi(row[i++]);
+			sps.pc_LimitingTemperatureHeatStress = stof(row[i++]);
+			sps.pc_DroughtImpactOnFertilityFactor = stof(row[i++]);
+			sps.pc_CuttingDelayDays = stoi(row[i++]);
+			sps.pc_FieldConditionModifier = stof(row[i++]);
+			sps.pc_AssimilateReallocation = stof(row[i++]);
+		}
+
+		con->select(organSelect(species));
+		debug() << organSelect(species) << endl;
+		while(!(row = con->getRow()).empty())
+		{
+			sps.pc_InitialOrganBiomass.push_back(stod(row[2]));
+			sps.pc_OrganMaintenanceRespiration.push_back(stod(row[3]));
+			sps.pc_AbovegroundOrgan.push_back(stob(row[4]));
+			sps.pc_OrganGrowthRespiration.push_back(stod(row[5]));
+			sps.pc_StorageOrgan.push_back(stob(row[6]));
+		}
+
+		con->select(devStageSpeciesSelect(species));
+		debug() << devStageSpeciesSelect(species) << endl;
+
+		while(!(row = con->getRow()).empty())
+		{
+			sps.pc_BaseTemperature.push_back(stod(row[2]));
+			sps.pc_CriticalOxygenContent.push_back(stod(row[3]));
+			sps.pc_StageMaxRootNConcentration.push_back(stod(row[4]));
+		}
+
+		return sps;
+	}
+
+	CultivarParameters readCultivarParameters(DBPtr& con, const string& species, const string& cultivar)
+	{
+		CultivarParameters cps;
+
+		int cropId = -1;
+
+		DBRow row;
+		con->select(cultivarSelect(species, cultivar));
+		debug() << cultivarSelect(species, cultivar) << endl;
+		if(!(row = con->getRow()).empty())
+		{
+			int i = 0;
+
+			cropId = stoi(row[i++]);
+			i++;
+			cps.pc_CultivarId = row[i++];
+			cps.pc_Description = row[i++];
+			cps.pc_Perennial = stob(row[i++]);
+			//cps.pc_PermanentCultivarId = row[i++];
+			cps.pc_MaxAssimilationRate = stof(row[i++]);
+			cps.pc_MaxCropHeight = stof(row[i++]);
+			cps.pc_CropHeightP1 = stof(row[i++]);
+			cps.pc_CropHeightP2 = stof(row[i++]);
+			cps.pc_CropSpecificMaxRootingDepth = stof(row[i++]);
+			cps.pc_ResidueNRatio = stof(row[i++]);
+			cps.pc_HeatSumIrrigationStart = stof(row[i++]);
+			cps.pc_HeatSumIrrigationEnd = stof(row[i++]);
+			cps.pc_CriticalTemperatureHeatStress = stof(row[i++]);
+			cps.pc_BeginSensitivePhaseHeatStress = stof(row[i++]);
+			cps.pc_EndSensitivePhaseHeatStress = stof(row[i++]);
+			cps.pc_LT50cultivar = stof(row[i++]);
+			cps.pc_FrostHardening = stof(row[i++]);
+			cps.pc_FrostDehardening = stof(row[i++]);
+			cps.pc_LowTemperatureExposure = stof(row[i++]);
+			cps.pc_RespiratoryStress = stof(row[i++]);
+			cps.pc_LatestHarvestDoy = stoi(row[i++]);
+		}
+
+		con->select(devStageCultivarSelect(cropId));
+		debug() << devStageCultivarSelect(cropId) << endl;
+		while(!(row = con->getRow()).empty())
+		{
+			int i = 2;
+
+			cps.pc_StageTemperatureSum.push_back(stod(row[i++]));
+			cps.pc_OptimumTemperature.push_back(stod(row[i++]));
+			cps.pc_VernalisationRequirement.push_back(stod(row[i++]));
+			cps.pc_DaylengthRequirement.push_back(stod(row[i++]));
+			cps.pc_BaseDaylength.push_back(stod(row[i++]));
+			cps.pc_DroughtStressThreshold.push_back(stod(row[i++]));
+			cps.pc_SpecificLeafArea.push_back(stod(row[i++]));
+			cps.pc_StageKcFactor.push_back(stod(row[i++]));
+		}
+
+		con->select(odsDepParamsSelect(cropId));
+		debug() << odsDepParamsSelect(cropId) << endl;
+		while(!(row = con->getRow()).empty())
+		{
+			size_t organId = stoi(row[1]);
+			size_t devStageId = stoi(row[2]);
+
+			auto& sov = stoi(row[3]) == 1 ? cps.pc_AssimilatePartitioningCoeff : cps.pc_OrganSenescenceRate;
+
+			if(sov.size() < devStageId)
+				sov.resize(devStageId);
+			auto& ds = sov[devStageId - 1];
+
+			if(ds.size() < organId)
+				ds.resize(organId);
+
+			ds[organId - 1] = stod(row[4]);
+		}
+
+		cps.pc_OrganIdsForPrimaryYield.clear();
+		cps.pc_OrganIdsForSecondaryYield.clear();
+		con->select(yieldPartsSelect(cropId));
+		debug() << yieldPartsSelect(cropId) << endl;
+		while(!(row = con->getRow()).empty())
+		{
+			bool isPrimary = stob(row[2]);
+
+			YieldComponent yc;
+			yc.organId = stoi(row[1]);
+			yc.yieldPercentage = stod(row[3]) / 100.0;
+			yc.yieldDryMatter = stod(row[4]);
+
+			// normal case, uses yield partitioning from crop database
+			if(isPrimary)
+				cps.pc_OrganIdsForPrimaryYield.push_back(yc);
+			else
+				cps.pc_OrganIdsForSecondaryYield.push_back(yc);
+		}
+
+		// get cutting parts if there are some data available
+		cps.pc_OrganIdsForCutting.clear();
+		con->select(cuttingPartsSelect(cropId));
+		while(!(row = con->getRow()).empty())
+		{
+			YieldComponent yc;
+			yc.organId = stoi(row[1]);
+			//bool isPrimary = stoi(row[2]) == 1;
+			yc.yieldPercentage = stof(row[3]) / 100.0;
+			yc.yieldDryMatter = stof(row[4]);
+
+			cps.pc_OrganIdsForCutting.push_back(yc);
+		}
+
+		return cps;
+	}
 }
 
-SpeciesParametersPtr Monica::getSpeciesParametersFromMonicaDB(const string& species,
-                                                              std::string abstractDbSchema)
+//------------------------------------------------------------------------------
+
+namespace
 {
-	SpeciesParametersPtr sps = make_shared<SpeciesParameters>();
+	//2: with AOM_CarbamidContent of the organic fertilisers and crop residues
+	const int parameterCatalogueSnapshotVersion = 2;
 
-	DBPtr con(newConnection(abstractDbSchema));
-	DBRow row;
-	con->select(speciesSelect(species));
-	debug() << speciesSelect(species) << endl;
-	if(!(row = con->getRow()).empty())
+	typedef map<string, shared_ptr<const ParameterCatalogue>> Catalogues;
+
+	//! the published catalogues per schema, replaced as a whole when publishing
+	//! old versions are never deleted, because lookups on other threads might still use them
+	atomic<const Catalogues*> publishedCatalogues{nullptr};
+	mutex publishMutex;
+
+	const ParameterCatalogue* findCatalogue(const string& abstractDbSchema)
 	{
-		int i = 0;
+		auto cs = publishedCatalogues.load(memory_order_acquire);
+		if(!cs)
+			return nullptr;
+		auto ci = cs->find(abstractDbSchema);
+		return ci != cs->end() ? ci->second.get() : nullptr;
+	}
 
-		sps->pc_SpeciesId = row[i++];
-		sps->pc_CarboxylationPathway = stoi(row[i++]);
-		sps->pc_MinimumTemperatureForAssimilation = stof(row[i++]);
-		sps->pc_MinimumNConcentration = stof(row[i++]);
-		sps->pc_NConcentrationPN = stof(row[i++]);
-		sps->pc_NConcentrationB0 = stof(row[i++]);
-		sps->pc_NConcentrationAbovegroundBiomass = stof(row[i++]);
-		sps->pc_NConcentrationRoot = stof(row[i++]);
-		sps->pc_InitialKcFactor = stof(row[i++]);
-		sps->pc_DevelopmentAccelerationByNitrogenStress = stoi(row[i++]);
-		sps->pc_PartBiologicalNFixation = stof(row[i++]);
-		sps->pc_LuxuryNCoeff = stof(row[i++]);
-		sps->pc_SamplingDepth = stof(row[i++]);
-		sps->pc_TargetNSamplingDepth = stof(row[i++]);
-		sps->pc_TargetN30 = stof(row[i++]);
-		sps->pc_DefaultRadiationUseEfficiency = stof(row[i++]);
-		sps->pc_StageAtMaxHeight = stof(row[i++]);
-		sps->pc_MaxCropDiameter = stof(row[i++]);
-		sps->pc_StageAtMaxDiameter = stof(row[i++]);
-		sps->pc_MaxNUptakeParam = stof(row[i++]);
-		sps->pc_RootDistributionParam = stof(row[i++]);
-		sps->pc_PlantDensity = (int)stof(row[i++]);
-		sps->pc_RootGrowthLag = stof(row[i++]);
-		sps->pc_MinimumTemperatureRootGrowth = stof(row[i++]);
-		sps->pc_InitialRootingDepth = stof(row[i++]);
-		sps->pc_RootPenetrationRate = stof(row[i++]);
-		sps->pc_RootFormFactor = stof(row[i++]);
-		sps->pc_SpecificRootLength = stof(row[i++]);
-		sps->pc_StageAfterCut = stoi(row[i++]);
-		sps->pc_LimitingTemperatureHeatStress = stof(row[i++]);
-		sps->pc_DroughtImpactOnFertilityFactor = stof(row[i++]);
-		sps->pc_CuttingDelayDays = stoi(row[i++]);
-		sps->pc_FieldConditionModifier = stof(row[i++]);
-		sps->pc_AssimilateReallocation = stof(row[i++]);
+	//! publishMutex has to be held
+	void publish(shared_ptr<const ParameterCatalogue> catalogue, const string& abstractDbSchema)
+	{
+		auto old = publishedCatalogues.load(memory_order_relaxed);
+		auto cs = old ? new Catalogues(*old) : new Catalogues;
+		(*cs)[abstractDbSchema] = catalogue;
+		publishedCatalogues.store(cs, memory_order_release);
 	}
 
-	con->select(organSelect(species));
-	debug() << organSelect(species) << endl;
-	while(!(row = con->getRow()).empty())
+	template<class T>
+	const T* lookup(const ParameterCatalogue::Index<T>& index, const string& id)
 	{
-		sps->pc_InitialOrganBiomass.push_back(stod(row[2]));
-		sps->pc_OrganMaintenanceRespiration.push_back(stod(row[3]));
-		sps->pc_AbovegroundOrgan.push_back(stob(row[4]));
-		sps->pc_OrganGrowthRespiration.push_back(stod(row[5]));
-		sps->pc_StorageOrgan.push_back(stob(row[6]));
+		auto ci = index.find(id);
+		return ci != index.end() ? &ci->second : nullptr;
 	}
 
-	con->select(devStageSpeciesSelect(species));
-	debug() << devStageSpeciesSelect(species) << endl;
+	//! compare the values, not their JSON, so values missing in to_json are noticed too
+	bool sameParameters(const OrganicMatterParameters& l, const OrganicMatterParameters& r)
+	{
+		return l.vo_AOM_DryMatterContent == r.vo_AOM_DryMatterContent
+			&& l.vo_AOM_NH4Content == r.vo_AOM_NH4Content
+			&& l.vo_AOM_NO3Content == r.vo_AOM_NO3Content
+			&& l.vo_AOM_CarbamidContent == r.vo_AOM_CarbamidContent
+			&& l.vo_AOM_SlowDecCoeffStandard == r.vo_AOM_SlowDecCoeffStandard
+			&& l.vo_AOM_FastDecCoeffStandard == r.vo_AOM_FastDecCoeffStandard
+			&& l.vo_PartAOM_to_AOM_Slow == r.vo_PartAOM_to_AOM_Slow
+			&& l.vo_PartAOM_to_AOM_Fast == r.vo_PartAOM_to_AOM_Fast
+			&& l.vo_CN_Ratio_AOM_Slow == r.vo_CN_Ratio_AOM_Slow
+			&& l.vo_CN_Ratio_AOM_Fast == r.vo_CN_Ratio_AOM_Fast
+			&& l.vo_PartAOM_Slow_to_SMB_Slow == r.vo_PartAOM_Slow_to_SMB_Slow
+			&& l.vo_PartAOM_Slow_to_SMB_Fast == r.vo_PartAOM_Slow_to_SMB_Fast
+			&& l.vo_NConcentration == r.vo_NConcentration;
+	}
 
-	while(!(row = con->getRow()).empty())
+	bool sameParameters(const OrganicFertiliserParameters& l, const OrganicFertiliserParameters& r)
 	{
-		sps->pc_BaseTemperature.push_back(stod(row[2]));
-		sps->pc_CriticalOxygenContent.push_back(stod(row[3]));
-		sps->pc_StageMaxRootNConcentration.push_back(stod(row[4]));
+		return l.id == r.id && l.name == r.name
+			&& sameParameters(static_cast<const OrganicMatterParameters&>(l), static_cast<const OrganicMatterParameters&>(r));
 	}
 
-	return sps;
+	bool sameParameters(const CropResidueParameters& l, const CropResidueParameters& r)
+	{
+		return l.species == r.species && l.residueType == r.residueType
+			&& sameParameters(static_cast<const OrganicMatterParameters&>(l), static_cast<const OrganicMatterParameters&>(r));
+	}
+
+	bool sameParameters(const MineralFertiliserParameters& l, const MineralFertiliserParameters& r)
+	{
+		return l.getId() == r.getId() && l.getName() == r.getName()
+			&& l.getCarbamid() == r.getCarbamid() && l.getNH4() == r.getNH4() && l.getNO3() == r.getNO3();
+	}
+
+	//! the crop parameters are compared by their JSON, which catches values not being read back from it
+	bool sameParameters(const Json11Serializable& l, const Json11Serializable& r)
+	{
+		return l.to_json().dump() == r.to_json().dump();
+	}
+
+	template<class K, class T>
+	bool sameParameters(const unordered_map<K, T>& l, const unordered_map<K, T>& r)
+	{
+		if(l.size() != r.size())
+			return false;
+		for(const auto& p : l)
+		{
+			auto ci = r.find(p.first);
+			if(ci == r.end() || !sameParameters(p.second, ci->second))
+				return false;
+		}
+		return true;
+	}
 }
 
-CultivarParametersPtr Monica::getCultivarParametersFromMonicaDB(const string& species,
-                                                                const string& cultivar,
-                                                                std::string abstractDbSchema)
+shared_ptr<const ParameterCatalogue> ParameterCatalogue::readFromMonicaDB(const string& abstractDbSchema)
 {
-	CultivarParametersPtr cps = make_shared<CultivarParameters>();
-
-	int cropId = -1;
+	shared_ptr<ParameterCatalogue> pc(new ParameterCatalogue);
 
 	DBPtr con(newConnection(abstractDbSchema));
 	DBRow row;
-	con->select(cultivarSelect(species, cultivar));
-	debug() << cultivarSelect(species, cultivar) << endl;
-	if(!(row = con->getRow()).empty())
-	{
-		int i = 0;
 
-		cropId = stoi(row[i++]);
-		i++;
-		cps->pc_CultivarId = row[i++];
-		cps->pc_Description = row[i++];
-		cps->pc_Perennial = stob(row[i++]);
-		//cps->pc_PermanentCultivarId = row[i++];
-		cps->pc_MaxAssimilationRate = stof(row[i++]);
-		cps->pc_MaxCropHeight = stof(row[i++]);
-		cps->pc_CropHeightP1 = stof(row[i++]);
-		cps->pc_CropHeightP2 = stof(row[i++]);
-		cps->pc_CropSpecificMaxRootingDepth = stof(row[i++]);
-		cps->pc_ResidueNRatio = stof(row[i++]);
-		cps->pc_HeatSumIrrigationStart = stof(row[i++]);
-		cps->pc_HeatSumIrrigationEnd = stof(row[i++]);
-		cps->pc_CriticalTemperatureHeatStress = stof(row[i++]);
-		cps->pc_BeginSensitivePhaseHeatStress = stof(row[i++]);
-		cps->pc_EndSensitivePhaseHeatStress = stof(row[i++]);
-		cps->pc_LT50cultivar = stof(row[i++]);
-		cps->pc_FrostHardening = stof(row[i++]);
-		cps->pc_FrostDehardening = stof(row[i++]);
-		cps->pc_LowTemperatureExposure = stof(row[i++]);
-		cps->pc_RespiratoryStress = stof(row[i++]);
-		cps->pc_LatestHarvestDoy = stoi(row[i++]);
-	}
+	//the species and cultivars need further queries per row, so collect their ids first
+	vector<string> speciesIds;
+	con->select("select id from species order by id");
+	while(!(row = con->getRow()).empty())
+		speciesIds.push_back(row[0]);
+	for(const auto& speciesId : speciesIds)
+		pc->_species[speciesId] = readSpeciesParameters(con, speciesId);
 
-	con->select(devStageCultivarSelect(cropId));
-	debug() << devStageCultivarSelect(cropId) << endl;
+	vector<DBRow> cultivarRows;
+	con->select("select crop_id, species_id, id from cultivar order by crop_id");
 	while(!(row = con->getRow()).empty())
+		cultivarRows.push_back(row);
+	for(const auto& cr : cultivarRows)
 	{
-		int i = 2;
-
-		cps->pc_StageTemperatureSum.push_back(stod(row[i++]));
-		cps->pc_OptimumTemperature.push_back(stod(row[i++]));
-		cps->pc_VernalisationRequirement.push_back(stod(row[i++]));
-		cps->pc_DaylengthRequirement.push_back(stod(row[i++]));
-		cps->pc_BaseDaylength.push_back(stod(row[i++]));
-		cps->pc_DroughtStressThreshold.push_back(stod(row[i++]));
-		cps->pc_SpecificLeafArea.push_back(stod(row[i++]));
-		cps->pc_StageKcFactor.push_back(stod(row[i++]));
+		pc->_cultivars[cr[1]][cr[2]] = readCultivarParameters(con, cr[1], cr[2]);
+		if(!cr[0].empty())
+			pc->addCrop(stoi(cr[0]), cr[1], cr[2]);
 	}
 
-	con->select(odsDepParamsSelect(cropId));
-	debug() << odsDepParamsSelect(cropId) << endl;
+	con->select("select id, name, no3, nh4, carbamid from mineral_fertiliser");
 	while(!(row = con->getRow()).empty())
 	{
-		size_t organId = stoi(row[1]);
-		size_t devStageId = stoi(row[2]);
+		string id = row[0];
+		string name = row[1];
+		double no3 = satof(row[2]);
+		double nh4 = satof(row[3]);
+		double carbamid = satof(row[4]);
 
-		auto& sov = stoi(row[3]) == 1 ? cps->pc_AssimilatePartitioningCoeff : cps->pc_OrganSenescenceRate;
+		pc->_mineralFertilisers[id] = MineralFertiliserParameters(id, name, carbamid, no3, nh4);
+	}
 
-		if(sov.size() < devStageId)
-			sov.resize(devStageId);
-		auto& ds = sov[devStageId - 1];
+	con->select(
+		"select "
+		"id, "
+		"name, "
+		"dm, "
+		"nh4_n, "
+		"no3_n, "
+		"nh2_n, "
+		"k_slow, "
+		"k_fast, "
+		"part_s, "
+		"part_f, "
+		"cn_s, "
+		"cn_f, "
+		"smb_s, "
+		"smb_f "
+		"from organic_fertiliser");
+	while(!(row = con->getRow()).empty())
+	{
+		OrganicFertiliserParameters omp;
 
-		if(ds.size() < organId)
-			ds.resize(organId);
+		int i = 0;
 
-		ds[organId - 1] = stod(row[4]);
+		omp.id = row[i++];
+		omp.name = row[i++];
+		omp.vo_AOM_DryMatterContent = stof(row[i++]);
+		omp.vo_AOM_NH4Content = stof(row[i++]);
+		omp.vo_AOM_NO3Content = stof(row[i++]);
+		omp.vo_AOM_CarbamidContent = stof(row[i++]);
+		omp.vo_AOM_SlowDecCoeffStandard = stof(row[i++]);
+		omp.vo_AOM_FastDecCoeffStandard = stof(row[i++]);
+		omp.vo_PartAOM_to_AOM_Slow = stof(row[i++]);
+		omp.vo_PartAOM_to_AOM_Fast = stof(row[i++]);
+		omp.vo_CN_Ratio_AOM_Slow = stof(row[i++]);
+		omp.vo_CN_Ratio_AOM_Fast = stof(row[i++]);
+		omp.vo_PartAOM_Slow_to_SMB_Slow = stof(row[i++]);
+		omp.vo_PartAOM_Slow_to_SMB_Fast = stof(row[i++]);
+
+		pc->_organicFertilisers[omp.id] = omp;
 	}
 
-	cps->pc_OrganIdsForPrimaryYield.clear();
-	cps->pc_OrganIdsForSecondaryYield.clear();
-	con->select(yieldPartsSelect(cropId));
-	debug() << yieldPartsSelect(cropId) << endl;
+	con->select(
+		"select "
+		"species_id, "
+		"residue_type, "
+		"dm, "
+		"nh4, "
+		"no3, "
+		"nh2, "
+		"k_slow, "
+		"k_fast, "
+		"part_s, "
+		"part_f, "
+		"cn_s, "
+		"cn_f, "
+		"smb_s, "
+		"smb_f "
+		"from crop_residue "
+		"order by species_id, residue_type");
 	while(!(row = con->getRow()).empty())
 	{
-		bool isPrimary = stob(row[2]);
+		CropResidueParameters omp;
 
-		YieldComponent yc;
-		yc.organId = stoi(row[1]);
-		yc.yieldPercentage = stod(row[3]) / 100.0;
-		yc.yieldDryMatter = stod(row[4]);
+		int i = 0;
 
-		// normal case, uses yield partitioning from crop database
-		if(isPrimary)
-			cps->pc_OrganIdsForPrimaryYield.push_back(yc);
-		else
-			cps->pc_OrganIdsForSecondaryYield.push_back(yc);
+		omp.species = row[i++];
+		omp.residueType = row[i++];
+		omp.vo_AOM_DryMatterContent = stoi(row[i++]);
+		omp.vo_AOM_NH4Content = stof(row[i++]);
+		omp.vo_AOM_NO3Content = stof(row[i++]);
+		omp.vo_AOM_CarbamidContent = stof(row[i++]);
+		omp.vo_AOM_SlowDecCoeffStandard = stof(row[i++]);
+		omp.vo_AOM_FastDecCoeffStandard = stof(row[i++]);
+		omp.vo_PartAOM_to_AOM_Slow = stof(row[i++]);
+		omp.vo_PartAOM_to_AOM_Fast = stof(row[i++]);
+		omp.vo_CN_Ratio_AOM_Slow = stof(row[i++]);
+		omp.vo_CN_Ratio_AOM_Fast = stof(row[i++]);
+		omp.vo_PartAOM_Slow_to_SMB_Slow = stof(row[i++]);
+		omp.vo_PartAOM_Slow_to_SMB_Fast = stof(row[i++]);
+
+		pc->_residues[omp.species][omp.residueType] = omp;
 	}
 
-	// get cutting parts if there are some data available
-	cps->pc_OrganIdsForCutting.clear();
-	con->select(cuttingPartsSelect(cropId));
+	con->select(
+		"select "
+		"id, "
+		"species_id, "
+		"cultivar_id "
+		"from crop "
+		"order by id");
 	while(!(row = con->getRow()).empty())
 	{
-		YieldComponent yc;
-		yc.organId = stoi(row[1]);
-		//bool isPrimary = stoi(row[2]) == 1;
-		yc.yieldPercentage = stof(row[3]) / 100.0;
-		yc.yieldDryMatter = stof(row[4]);
+		AMCRes res;
+		res.speciesId = row[1];
+		res.cultivarId = row[2];
+		res.name = capitalize(row[1]) + "/" + capitalize(row[2]);
+		if(!row[0].empty())
+			pc->_availableCrops[stoi(row[0])] = res;
+	}
+
+	return pc;
+}
+
+void ParameterCatalogue::addCrop(int cropId, const string& speciesId, const string& cultivarId)
+{
+	CropParameters cps;
+	if(auto sps = species(speciesId))
+		cps.speciesParams = *sps;
+	if(auto cvps = cultivar(speciesId, cultivarId))
+		cps.cultivarParams = *cvps;
+	_crops[cropId] = cps;
+}
+
+Errors ParameterCatalogue::writeSnapshot(const string& pathToFile) const
+{
+	J11Object species;
+	for(const auto& p : _species)
+		species[p.first] = p.second.to_json();
 
-		cps->pc_OrganIdsForCutting.push_back(yc);
+	J11Object cultivars;
+	for(const auto& sp : _cultivars)
+	{
+		J11Object cs;
+		for(const auto& p : sp.second)
+			cs[p.first] = p.second.to_json();
+		cultivars[sp.first] = cs;
 	}
 
-	return cps;
+	J11Array crops;
+	for(const auto& p : _crops)
+		crops.push_back(J11Array{p.first, p.second.to_json()});
+
+	J11Object mineralFertilisers;
+	for(const auto& p : _mineralFertilisers)
+		mineralFertilisers[p.first] = p.second.to_json();
+
+	J11Object organicFertilisers;
+	for(const auto& p : _organicFertilisers)
+		organicFertilisers[p.first] = p.second.to_json();
+
+	J11Object residues;
+	for(const auto& sp : _residues)
+	{
+		J11Object rs;
+		for(const auto& p : sp.second)
+			rs[p.first] = p.second.to_json();
+		residues[sp.first] = rs;
+	}
+
+	J11Array availableCrops;
+	for(const auto& p : _availableCrops)
+		availableCrops.push_back(J11Array{p.first, p.second.speciesId, p.second.cultivarId, p.second.name});
+
+	auto snapshot = encodeBinaryJson(J11Object
+	{{"type", "ParameterCatalogue"}
+	,{"version", parameterCatalogueSnapshotVersion}
+	,{"species", species}
+	,{"cultivars", cultivars}
+	,{"crops", crops}
+	,{"mineralFertilisers", mineralFertilisers}
+	,{"organicFertilisers", organicFertilisers}
+	,{"residues", residues}
+	,{"availableCrops", availableCrops}
+	});
+
+	Errors es;
+	ofstream ofs(pathToFile, ios::binary);
+	if(!(ofs << snapshot))
+		es.errors.push_back(string("Couldn't write parameter catalogue snapshot: ") + pathToFile);
+	return es;
 }
 
-CropParametersPtr Monica::getCropParametersFromMonicaDB(const string& species,
-																												const string& cultivar,
-																												std::string abstractDbSchema)
+EResult<shared_ptr<const ParameterCatalogue>> ParameterCatalogue::readSnapshot(const string& pathToFile)
 {
-	CropParametersPtr cps = make_shared<CropParameters>();
-	cps->speciesParams = *getSpeciesParametersFromMonicaDB(species, abstractDbSchema);
-	cps->cultivarParams = *getCultivarParametersFromMonicaDB(species, cultivar, abstractDbSchema);
-	return cps;
+	ifstream ifs(pathToFile, ios::binary);
+	if(!ifs)
+		return{nullptr, string("Couldn't open parameter catalogue snapshot: ") + pathToFile};
+	ostringstream oss;
+	oss << ifs.rdbuf();
+
+	auto r = decodeBinaryJson(oss.str());
+	if(r.failure())
+		return{nullptr, r.errors};
+	const auto& j = r.result;
+	if(j["type"].string_value() != "ParameterCatalogue"
+	   || j["version"].int_value() != parameterCatalogueSnapshotVersion)
+		return{nullptr, pathToFile + " is no parameter catalogue snapshot of version "
+		                + to_string(parameterCatalogueSnapshotVersion) + "!"};
+
+	shared_ptr<ParameterCatalogue> pc(new ParameterCatalogue);
+
+	for(const auto& p : j["species"].object_items())
+		pc->_species[p.first] = SpeciesParameters(p.second);
+
+	for(const auto& sp : j["cultivars"].object_items())
+		for(const auto& p : sp.second.object_items())
+			pc->_cultivars[sp.first][p.first] = CultivarParameters(p.second);
+
+	for(const auto& c : j["crops"].array_items())
+		pc->_crops[c[0].int_value()] = CropParameters(c[1]);
+
+	for(const auto& p : j["mineralFertilisers"].object_items())
+		pc->_mineralFertilisers[p.first] = MineralFertiliserParameters(p.second);
+
+	for(const auto& p : j["organicFertilisers"].object_items())
+		pc->_organicFertilisers[p.first] = OrganicFertiliserParameters(p.second);
+
+	for(const auto& sp : j["residues"].object_items())
+		for(const auto& p : sp.second.object_items())
+			pc->_residues[sp.first][p.first] = CropResidueParameters(p.second);
+
+	for(const auto& c : j["availableCrops"].array_items())
+	{
+		AMCRes res;
+		res.speciesId = c[1].string_value();
+		res.cultivarId = c[2].string_value();
+		res.name = c[3].string_value();
+		pc->_availableCrops[c[0].int_value()] = res;
+	}
+
+	return{pc};
+}
+
+bool ParameterCatalogue::sameParameters(const ParameterCatalogue& other) const
+{
+	if(_availableCrops.size() != other._availableCrops.size())
+		return false;
+	for(const auto& p : _availableCrops)
+	{
+		auto ci = other._availableCrops.find(p.first);
+		if(ci == other._availableCrops.end()
+		   || ci->second.speciesId != p.second.speciesId
+		   || ci->second.cultivarId != p.second.cultivarId
+		   || ci->second.name != p.second.name)
+			return false;
+	}
+
+	return ::sameParameters(_species, other._species)
+		&& ::sameParameters(_cultivars, other._cultivars)
+		&& ::sameParameters(_crops, other._crops)
+		&& ::sameParameters(_mineralFertilisers, other._mineralFertilisers)
+		&& ::sameParameters(_organicFertilisers, other._organicFertilisers)
+		&& ::sameParameters(_residues, other._residues);
 }
 
-const map<int, pair<SpeciesParametersPtr, CultivarParametersPtr>>&
-getAllCropParametersFromMonicaDB(std::string abstractDbSchema = "monica")
+const SpeciesParameters* ParameterCatalogue::species(const string& speciesId) const
 {
-	static mutex lockable;
+	return lookup(_species, speciesId);
+}
 
-	static bool initialized = false;
-	typedef map<int, pair<SpeciesParametersPtr, CultivarParametersPtr>> CPS;
+const CultivarParameters* ParameterCatalogue::cultivar(const string& speciesId, const string& cultivarId) const
+{
+	auto cs = lookup(_cultivars, speciesId);
+	return cs ? lookup(*cs, cultivarId) : nullptr;
+}
 
-	static CPS cpss;
+const CropParameters* ParameterCatalogue::crop(int cropId) const
+{
+	auto ci = _crops.find(cropId);
+	return ci != _crops.end() ? &ci->second : nullptr;
+}
+
+const MineralFertiliserParameters* ParameterCatalogue::mineralFertiliser(const string& id) const
+{
+	return lookup(_mineralFertilisers, id);
+}
+
+const OrganicFertiliserParameters* ParameterCatalogue::organicFertiliser(const string& id) const
+{
+	return lookup(_organicFertilisers, id);
+}
+
+const CropResidueParameters* ParameterCatalogue::residue(const string& speciesId, const string& residueType) const
+{
+	auto rs = lookup(_residues, speciesId);
+	if(!rs)
+		return nullptr;
+	//like the former query, fall back to the default residue parameters (residue type NULL) of the species
+	auto r = lookup(*rs, residueType);
+	return r ? r : lookup(*rs, string());
+}
 
-	// only initialize once
-	if(!initialized)
+const ParameterCatalogue& Monica::parameterCatalogue(const string& abstractDbSchema)
+{
+	if(auto pc = findCatalogue(abstractDbSchema))
+		return *pc;
+
+	lock_guard<mutex> lock(publishMutex);
+
+	//another thread might have read the catalogue while we waited for the lock
+	if(auto pc = findCatalogue(abstractDbSchema))
+		return *pc;
+
+	auto pc = ParameterCatalogue::readFromMonicaDB(abstractDbSchema);
+	publish(pc, abstractDbSchema);
+	return *pc;
+}
+
+void Monica::publishParameterCatalogue(shared_ptr<const ParameterCatalogue> catalogue,
+                                       const string& abstractDbSchema)
+{
+	lock_guard<mutex> lock(publishMutex);
+	publish(catalogue, abstractDbSchema);
+}
+
+Errors Monica::preloadParameterCatalogue(const string& abstractDbSchema,
+                                         const string& pathToSnapshot)
+{
+	Errors es;
+	shared_ptr<const ParameterCatalogue> pc;
+
+	if(!pathToSnapshot.empty() && ifstream(pathToSnapshot).good())
 	{
-		lock_guard<mutex> lock(lockable);
+		auto r = ParameterCatalogue::readSnapshot(pathToSnapshot);
+		if(r.success())
+			pc = r.result;
+		else
+			for(const auto& e : r.errors)
+				es.warnings.push_back(e + " Reading parameters from database instead.");
+	}
 
-		//test if after waiting for the lock the other thread
-		//already initialized the whole thing
-		if(!initialized)
+	if(!pc)
+	{
+		pc = ParameterCatalogue::readFromMonicaDB(abstractDbSchema);
+		if(!pathToSnapshot.empty())
 		{
-			DBPtr con(newConnection(abstractDbSchema));
-			DBRow row;
-			con->select("select crop_id, species_id, id from cultivar order by crop_id");
-			while(!(row = con->getRow()).empty())
-			{
-				int cropId = stoi(row[0]);
-				string speciesId = row[1];
-				string cultivarId = row[2];
+			auto wes = pc->writeSnapshot(pathToSnapshot);
+			es.errors.insert(es.errors.end(), wes.errors.begin(), wes.errors.end());
 
-				cpss[cropId] = make_pair(getSpeciesParametersFromMonicaDB(speciesId),
-																 getCultivarParametersFromMonicaDB(speciesId, cultivarId));
+			//a snapshot losing parameters would silently change the runs of every server started from it
+			if(wes.success())
+			{
+				auto r = ParameterCatalogue::readSnapshot(pathToSnapshot);
+				if(r.failure() || !pc->sameParameters(*r.result))
+				{
+					remove(pathToSnapshot.c_str());
+					es.errors.push_back(string("Parameter catalogue snapshot ") + pathToSnapshot
+					                    + " doesn't read back to the parameters of the database, removed it again.");
+				}
 			}
-
-			initialized = true;
 		}
 	}
 
-	return cpss;
+	publishParameterCatalogue(pc, abstractDbSchema);
+	return es;
+}
+
+//------------------------------------------------------------------------------
+
+SpeciesParametersPtr Monica::getSpeciesParametersFromMonicaDB(const string& species,
+                                                              std::string abstractDbSchema)
+{
+	auto sps = parameterCatalogue(abstractDbSchema).species(species);
+	return sps ? make_shared<SpeciesParameters>(*sps) : make_shared<SpeciesParameters>();
+}
+
+CultivarParametersPtr Monica::getCultivarParametersFromMonicaDB(const string& species,
+                                                                const string& cultivar,
+                                                                std::string abstractDbSchema)
+{
+	auto cps = parameterCatalogue(abstractDbSchema).cultivar(species, cultivar);
+	return cps ? make_shared<CultivarParameters>(*cps) : make_shared<CultivarParameters>();
+}
+
+CropParametersPtr Monica::getCropParametersFromMonicaDB(const string& species,
+																												const string& cultivar,
+																												std::string abstractDbSchema)
+{
+	const auto& pc = parameterCatalogue(abstractDbSchema);
+	CropParametersPtr cps = make_shared<CropParameters>();
+	if(auto sps = pc.species(species))
+		cps->speciesParams = *sps;
+	if(auto cvps = pc.cultivar(species, cultivar))
+		cps->cultivarParams = *cvps;
+	return cps;
 }
 
 CropParametersPtr Monica::getCropParametersFromMonicaDB(int cropId,
@@ -442,18 +905,8 @@ CropParametersPtr Monica::getCropParametersFromMonicaDB(int cropId,
 {
 	static CropParametersPtr nothing = make_shared<CropParameters>();
 
-	auto m = getAllCropParametersFromMonicaDB(abstractDbSchema);
-	auto ci = m.find(cropId);
-	if(ci != m.end())
-	{
-		CropParametersPtr cps = make_shared<CropParameters>();
-		cps->speciesParams = *ci->second.first;
-		cps->cultivarParams = *ci->second.second;
-
-		return cps;
-	}
-
-	return nothing;
+	auto cps = parameterCatalogue(abstractDbSchema).crop(cropId);
+	return cps ? make_shared<CropParameters>(*cps) : nothing;
 }
 
 void Monica::writeCropParameters(string path, std::string abstractDbSchema)
@@ -490,40 +943,6 @@ void Monica::writeCropParameters(string path, std::string abstractDbSchema)
 
 //------------------------------------------------------------------------------
 
-const map<string, MineralFertiliserParameters>&
-getAllMineralFertiliserParametersFromMonicaDB(string abstractDbSchema = "monica")
-{
-	static mutex lockable;
-	static bool initialized = false;
-	static map<string, MineralFertiliserParameters> m;
-
-	if(!initialized)
-	{
-		lock_guard<mutex> lock(lockable);
-
-		if(!initialized)
-		{
-			DBPtr con(newConnection(abstractDbSchema));
-			DBRow row;
-			con->select("select id, name, no3, nh4, carbamid from mineral_fertiliser");
-			while(!(row = con->getRow()).empty())
-			{
-				string id = row[0];
-				string name = row[1];
-				double no3 = satof(row[2]);
-				double nh4 = satof(row[3]);
-				double carbamid = satof(row[4]);
-
-				m[id] = MineralFertiliserParameters(id, name, carbamid, no3, nh4);
-			}
-
-			initialized = true;
-		}
-	}
-
-	return m;
-}
-
 /**
 * @brief Reads mineral fertiliser parameters from monica DB
 * @param id of the fertiliser
@@ -533,17 +952,16 @@ MineralFertiliserParameters
 Monica::getMineralFertiliserParametersFromMonicaDB(const std::string& id,
                                                    string abstractDbSchema)
 {
-	auto m = getAllMineralFertiliserParametersFromMonicaDB(abstractDbSchema);
-	auto ci = m.find(id);
-	return ci != m.end() ? ci->second : MineralFertiliserParameters();
+	auto mfp = parameterCatalogue(abstractDbSchema).mineralFertiliser(id);
+	return mfp ? *mfp : MineralFertiliserParameters();
 }
 
 void Monica::writeMineralFertilisers(string path,
                                      std::string abstractDbSchema)
 {
-	for(auto p : getAllMineralFertiliserParametersFromMonicaDB(abstractDbSchema))
+	for(const auto& p : parameterCatalogue(abstractDbSchema).allMineralFertilisers())
 	{
-		auto mf = p.second;
+		const auto& mf = p.second;
 
 		if (!Tools::ensureDirExists(surround("\"", path)))
 		{
@@ -564,70 +982,6 @@ void Monica::writeMineralFertilisers(string path,
 
 //--------------------------------------------------------------------------------------
 
-const map<string, OrganicFertiliserParametersPtr>&
-getAllOrganicFertiliserParametersFromMonicaDB(std::string abstractDbSchema = "monica")
-{
-	static mutex lockable;
-	static bool initialized = false;
-	typedef map<string, OrganicFertiliserParametersPtr> Map;
-	static Map m;
-
-	if(!initialized)
-	{
-		lock_guard<mutex> lock(lockable);
-
-		if(!initialized)
-		{
-			DBPtr con(newConnection(abstractDbSchema));
-			DBRow row;
-			con->select(
-				"select "
-				"id, "
-				"name, "
-				"dm, "
-				"nh4_n, "
-				"no3_n, "
-				"nh2_n, "
-				"k_slow, "
-				"k_fast, "
-				"part_s, "
-				"part_f, "
-				"cn_s, "
-				"cn_f, "
-				"smb_s, "
-				"smb_f "
-				"from organic_fertiliser");
-			while(!(row = con->getRow()).empty())
-			{
-				OrganicFertiliserParametersPtr omp = make_shared<OrganicFertiliserParameters>();
-
-				int i = 0;
-
-				omp->id = row[i++];
-				omp->name = row[i++];
-				omp->vo_AOM_DryMatterContent = stof(row[i++]);
-				omp->vo_AOM_NH4Content = stof(row[i++]);
-				omp->vo_AOM_NO3Content = stof(row[i++]);
-				omp->vo_AOM_CarbamidContent = stof(row[i++]);
-				omp->vo_AOM_SlowDecCoeffStandard = stof(row[i++]);
-				omp->vo_AOM_FastDecCoeffStandard = stof(row[i++]);
-				omp->vo_PartAOM_to_AOM_Slow = stof(row[i++]);
-				omp->vo_PartAOM_to_AOM_Fast = stof(row[i++]);
-				omp->vo_CN_Ratio_AOM_Slow = stof(row[i++]);
-				omp->vo_CN_Ratio_AOM_Fast = stof(row[i++]);
-				omp->vo_PartAOM_Slow_to_SMB_Slow = stof(row[i++]);
-				omp->vo_PartAOM_Slow_to_SMB_Fast = stof(row[i++]);
-
-				m[omp->id] = omp;
-			}
-
-			initialized = true;
-		}
-	}
-
-	return m;
-}
-
 /**
 * @brief Reads organic fertiliser parameters from monica DB
 * @param organ_fert_id ID of fertiliser
@@ -637,30 +991,27 @@ OrganicFertiliserParametersPtr
 Monica::getOrganicFertiliserParametersFromMonicaDB(const std::string& id,
                                                    std::string abstractDbSchema)
 {
-	static OrganicFertiliserParametersPtr nothing = make_shared<OrganicFertiliserParameters>();
-
-	auto m = getAllOrganicFertiliserParametersFromMonicaDB(abstractDbSchema);
-	auto ci = m.find(id);
-	return ci != m.end() ? ci->second : nothing;
+	auto ofp = parameterCatalogue(abstractDbSchema).organicFertiliser(id);
+	return ofp ? make_shared<OrganicFertiliserParameters>(*ofp) : make_shared<OrganicFertiliserParameters>();
 }
 
 void Monica::writeOrganicFertilisers(string path, std::string abstractDbSchema)
 {
-	for(auto p : getAllOrganicFertiliserParametersFromMonicaDB(abstractDbSchema))
+	for(const auto& p : parameterCatalogue(abstractDbSchema).allOrganicFertilisers())
 	{
-		OrganicFertiliserParametersPtr of = p.second;
+		const auto& of = p.second;
 
 		if (!Tools::ensureDirExists(surround("\"", path)))
 		{
 			cerr << "Error failed to create path: '" << path << "'." << endl;
 		}
 		ofstream ofs;
-		ofs.open(path + "/" + of->id + ".json");
+		ofs.open(path + "/" + of.id + ".json");
 
 		if(ofs.good())
 		{
-			auto s = of->to_json().dump();
-			//cout << "id: " << of->id << " name: " << of->name << " ----> " << endl << s << endl;
+			auto s = of.to_json().dump();
+			//cout << "id: " << of.id << " name: " << of.name << " ----> " << endl << s << endl;
 			ofs << s;
 			ofs.close();
 		}
@@ -675,119 +1026,47 @@ Monica::getResidueParametersFromMonicaDB(const string& species,
 																				 const string& residueType,
 																				 std::string abstractDbSchema)
 {
-	DBPtr con(newConnection(abstractDbSchema));
-	DBRow row;
-	string query = string() +
-		"select "
-		"species_id, "
-		"residue_type, "
-		"dm, "
-		"nh4, "
-		"no3, "
-		"nh2, "
-		"k_slow, "
-		"k_fast, "
-		"part_s, "
-		"part_f, "
-		"cn_s, "
-		"cn_f, "
-		"smb_s, "
-		"smb_f "
-		"from crop_residue "
-		"where species_id = '"
-		+ species +
-		"' "
-		"and (residue_type = '"
-		+ residueType +
-		"' or residue_type is null) "
-		"order by species_id, residue_type desc";
-
-	//cout << "query: " << query << endl;
-	con->select(query);
-	//take the first (best matching) element
-	//at least there should always be the "default" residue parameters with
-	//type = NULL be available
-	if(!(row = con->getRow()).empty())
-	{
-		CropResidueParametersPtr omp = make_shared<CropResidueParameters>();
-
-		int i = 0;
-
-		omp->species = row[i++];
-		omp->residueType = row[i++];
-		omp->vo_AOM_DryMatterContent = stoi(row[i++]);
-		omp->vo_AOM_NH4Content = stof(row[i++]);
-		omp->vo_AOM_NO3Content = stof(row[i++]);
-		omp->vo_AOM_CarbamidContent = stof(row[i++]);
-		omp->vo_AOM_SlowDecCoeffStandard = stof(row[i++]);
-		omp->vo_AOM_FastDecCoeffStandard = stof(row[i++]);
-		omp->vo_PartAOM_to_AOM_Slow = stof(row[i++]);
-		omp->vo_PartAOM_to_AOM_Fast = stof(row[i++]);
-		omp->vo_CN_Ratio_AOM_Slow = stof(row[i++]);
-		omp->vo_CN_Ratio_AOM_Fast = stof(row[i++]);
-		omp->vo_PartAOM_Slow_to_SMB_Slow = stof(row[i++]);
-		omp->vo_PartAOM_Slow_to_SMB_Fast = stof(row[i++]);
-
-		return omp;
-	}
-
-	static CropResidueParametersPtr nothing = make_shared<CropResidueParameters>();
-	return nothing;
-}
-
-vector<CropResidueParametersPtr>
-getAllCropResidueParametersFromMonicaDB(std::string abstractDbSchema = "monica")
-{
-	vector<CropResidueParametersPtr> acrps;
-
-	DBPtr con(newConnection(abstractDbSchema));
-	DBRow row;
-	con->select("select "
-							"species_id, "
-							"residue_type "
-							"from crop_residue "
-							"order by species_id, residue_type");
-	while(!(row = con->getRow()).empty())
-	{
-		acrps.push_back(getResidueParametersFromMonicaDB(row[0], row[1]));
-	}
-
-	return acrps;
+	auto crp = parameterCatalogue(abstractDbSchema).residue(species, residueType);
+	return crp ? make_shared<CropResidueParameters>(*crp) : make_shared<CropResidueParameters>();
 }
 
 void Monica::writeCropResidues(string path, std::string abstractDbSchema)
 {
-	for(auto r : getAllCropResidueParametersFromMonicaDB(abstractDbSchema))
+	for(const auto& sp : parameterCatalogue(abstractDbSchema).allResidues())
 	{
-		string speciesPath = path + "/" + r->species;
-		bool noResidueType = r->residueType.empty();
-		string residueTypePath =
-			(noResidueType ? speciesPath
-			 : speciesPath + "/" + r->residueType) + ".json";
-
-		if (noResidueType)
+		for(const auto& p : sp.second)
 		{
-			if (!Tools::ensureDirExists(surround("\"", path)))
+			const auto& r = p.second;
+			string speciesPath = path + "/" + r.species;
+			bool noResidueType = r.residueType.empty();
+			string residueTypePath =
+				(noResidueType ? speciesPath
+				 : speciesPath + "/" + r.residueType) + ".json";
+
+			if (noResidueType)
 			{
-				cerr << "Error failed to create path: '" << path << "'." << endl;
+				if (!Tools::ensureDirExists(surround("\"", path)))
+				{
+					cerr << "Error failed to create path: '" << path << "'." << endl;
+				}
 			}
-		}
-		else
-		{
-			if (!Tools::ensureDirExists(surround("\"", speciesPath)))
+			else
 			{
-				cerr << "Error failed to create path: '" << speciesPath << "'." << endl;
+				if (!Tools::ensureDirExists(surround("\"", speciesPath)))
+				{
+					cerr << "Error failed to create path: '" << speciesPath << "'." << endl;
+				}
 			}
-		}
 
-		ofstream ofs;
-		ofs.open(residueTypePath);
-		if(ofs.good())
-		{
-			auto s = r->to_json().dump();
-			//cout << "id: " << of->id << " name: " << of->name << " ----> " << endl << s << endl;
-			ofs << s;
-			ofs.close();
+			ofstream ofs;
+			ofs.open(residueTypePath);
+			if(ofs.good())
+			{
+				auto s = r.to_json().dump();
+				//cout << "id: " << of->id << " name: " << of->name << " ----> " << endl << s << endl;
+				ofs << s;
+				ofs.close();
+			}
 		}
 	}
 }
@@ -1265,40 +1544,5 @@ vector<AMCRes> Monica::availableMonicaCrops()
 
 const map<int, AMCRes>& Monica::availableMonicaCropsM()
 {
-	static mutex lockable;
-	static map<int, AMCRes> m;
-	static bool initialized = false;
-	if(!initialized)
-	{
-		lock_guard<mutex> lock(lockable);
-
-		if(!initialized)
-		{
-			DBPtr con(newConnection("monica"));
-
-			string query(
-				"select "
-				"id, "
-				"species_id, "
-				"cultivar_id "
-				"from crop "
-				"order by id");
-			con->select(query.c_str());
-
-			DBRow row;
-			while(!(row = con->getRow()).empty())
-			{
-				AMCRes res;
-				res.speciesId = row[1];
-				res.cultivarId = row[2];
-				res.name = capitalize(row[1]) + "/" + capitalize(row[2]);
-				if(!row[0].empty()) 
-					m[stoi(row[0])] = res;
-			}
-
-			initialized = true;
-		}
-	}
-
-	return m;
+	return parameterCatalogue("monica").availableCrops();
 }
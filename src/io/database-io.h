@@ -19,6 +19,9 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 #define DATABASE_IO_H_
 
 #include <string>
+#include <map>
+#include <unordered_map>
+#include <memory>
 
 #include "../core/monica-parameters.h"
 
@@ -108,6 +111,87 @@ namespace Monica
   };
   const std::map<int, AMCRes>& availableMonicaCropsM();
 	std::vector<AMCRes> availableMonicaCrops();
+
+	//-----------------------------------------------------------
+
+	/*!
+	 * All species, cultivar, fertiliser and crop residue parameters of a database schema
+	 * (by default sqlite-db/monica.sqlite), read at once and never changed afterwards.
+	 * The lookups return pointers into the catalogue (nullptr if unknown), so they neither lock
+	 * nor allocate and can be used by any number of threads at the same time.
+	 * The get...FromMonicaDB functions above are answered from the catalogue too, but return copies.
+	 */
+	class ParameterCatalogue
+	{
+	public:
+		//! read all parameters of the schema
+		static std::shared_ptr<const ParameterCatalogue> readFromMonicaDB(const std::string& abstractDbSchema = "monica");
+
+		//! read a catalogue written by writeSnapshot, without needing the database
+		static Tools::EResult<std::shared_ptr<const ParameterCatalogue>> readSnapshot(const std::string& pathToFile);
+
+		//! write the catalogue as binary JSON (see binary-json.h), delete the file to pick up changes of the database
+		Tools::Errors writeSnapshot(const std::string& pathToFile) const;
+
+		//! do both catalogues hold the same parameters, used to check that a snapshot round-trips
+		bool sameParameters(const ParameterCatalogue& other) const;
+
+		const SpeciesParameters* species(const std::string& speciesId) const;
+
+		const CultivarParameters* cultivar(const std::string& speciesId, const std::string& cultivarId) const;
+
+		//! the crop by the crop_id of the cultivar table
+		const CropParameters* crop(int cropId) const;
+
+		const MineralFertiliserParameters* mineralFertiliser(const std::string& id) const;
+
+		const OrganicFertiliserParameters* organicFertiliser(const std::string& id) const;
+
+		//! the parameters of the residue type, else the default ones (no residue type) of the species
+		const CropResidueParameters* residue(const std::string& speciesId, const std::string& residueType = std::string()) const;
+
+		//! the crops of the crop table
+		const std::map<int, AMCRes>& availableCrops() const { return _availableCrops; }
+
+		template<class T>
+		using Index = std::unordered_map<std::string, T>;
+
+		const Index<SpeciesParameters>& allSpecies() const { return _species; }
+		//! species id -> cultivar id -> cultivar
+		const Index<Index<CultivarParameters>>& allCultivars() const { return _cultivars; }
+		const Index<MineralFertiliserParameters>& allMineralFertilisers() const { return _mineralFertilisers; }
+		const Index<OrganicFertiliserParameters>& allOrganicFertilisers() const { return _organicFertilisers; }
+		//! species id -> residue type ("" for the default) -> residue
+		const Index<Index<CropResidueParameters>>& allResidues() const { return _residues; }
+
+	private:
+		ParameterCatalogue() {}
+
+		void addCrop(int cropId, const std::string& speciesId, const std::string& cultivarId);
+
+		Index<SpeciesParameters> _species;
+		Index<Index<CultivarParameters>> _cultivars;
+		std::unordered_map<int, CropParameters> _crops;
+		Index<MineralFertiliserParameters> _mineralFertilisers;
+		Index<OrganicFertiliserParameters> _organicFertilisers;
+		Index<Index<CropResidueParameters>> _residues;
+		std::map<int, AMCRes> _availableCrops;
+	};
+
+	//! the catalogue of the schema, read from the database at the first use unless it has been preloaded
+	const ParameterCatalogue& parameterCatalogue(const std::string& abstractDbSchema = "monica");
+
+	//! make catalogue the one of the schema, lookups already running keep using the previous one
+	void publishParameterCatalogue(std::shared_ptr<const ParameterCatalogue> catalogue,
+	                               const std::string& abstractDbSchema = "monica");
+
+	/*!
+	 * read and publish the catalogue of the schema at startup, from pathToSnapshot if that exists,
+	 * else from the database, writing the snapshot to pathToSnapshot (if not empty),
+	 * a written snapshot not reading back to the same parameters is being removed again
+	 */
+	Tools::Errors preloadParameterCatalogue(const std::string& abstractDbSchema = "monica",
+	                                        const std::string& pathToSnapshot = std::string());
 }  
 
 #endif 
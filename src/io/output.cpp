@@ -187,6 +187,10 @@ Errors Output::merge(json11::Json j)
 
   errors = toStringVector(j["errors"]);
   warnings = toStringVector(j["warnings"]);
+	profile = j["profile"];
+	memoryStats = j["memoryStats"];
+	unknownTemplateId = j["unknownTemplateId"].string_value();
+	unknownConfigId = j["unknownConfigId"].string_value();
 
 	return es;
 }
@@ -210,13 +214,22 @@ json11::Json Output::to_json() const
 		});
 	}
 
-	return json11::Json::object
+	json11::Json::object out
 	{{"type", "Output"}
 	,{"customId", customId}
 	,{"data", ds}
   ,{"errors", toPrimJsonArray(errors)}
   ,{"warnings", toPrimJsonArray(warnings)}
 	};
+	if(!profile.is_null())
+		out["profile"] = profile;
+	if(!memoryStats.is_null())
+		out["memoryStats"] = memoryStats;
+	if(!unknownTemplateId.empty())
+		out["unknownTemplateId"] = unknownTemplateId;
+	if(!unknownConfigId.empty())
+		out["unknownConfigId"] = unknownConfigId;
+	return out;
 }
 
 //-----------------------------------------------------------------------------
@@ -125,6 +125,17 @@ namespace Monica
 
     std::vector<std::string> errors;
     std::vector<std::string> warnings;
+
+		//! the time spent in the sections of the run, if it has been profiled (see RunProfile::to_json)
+		json11::Json profile;
+
+		//! the allocations and memory use of the run, if requested (see MonicaRun::memoryStats)
+		json11::Json memoryStats;
+
+		//! the env template or config the job referred to, if the server didn't know it
+		//! (see EnvTemplateCache and EnvConfigCache), the client can send the job again together with it
+		std::string unknownTemplateId;
+		std::string unknownConfigId;
 	};
 }  
 
@@ -15,10 +15,16 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 
 #include <string>
 #include <algorithm>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <limits>
 #include <boost/python.hpp>
 #include <boost/python/stl_iterator.hpp>
 #include <boost/python/list.hpp>
 #include <boost/python/dict.hpp>
+#include <boost/python/numpy.hpp>
 
 #include "json11/json11.hpp"
 #include "json11/json11-helper.h"
@@ -32,6 +38,7 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 #include "climate/climate-file-io.h"
 
 using namespace boost::python;
+namespace np = boost::python::numpy;
 
 using namespace std;
 using namespace Monica;
@@ -84,9 +91,309 @@ string test(string t)
 	return t;
 }
 
+//-----------------------------------------------------------------------------
+
+namespace
+{
+	//! releases the GIL for the lifetime of the object, no Python objects may be touched meanwhile
+	struct ReleaseGIL
+	{
+		ReleaseGIL() : _state(PyEval_SaveThread()) {}
+		~ReleaseGIL() { PyEval_RestoreThread(_state); }
+		PyThreadState* _state;
+	};
+
+	//! the values of a numeric result column, owned by the NumPy array viewing them
+	struct ColumnBuffer
+	{
+		vector<double> values;
+		size_t rows{0}, cols{0};
+	};
+
+	//! a result column converted to a typed buffer (numbers or layered numbers) or to strings (e.g. dates, crop names)
+	struct Column
+	{
+		shared_ptr<ColumnBuffer> buffer;
+		vector<string> strings;
+	};
+
+	//! the typed columns of an output section
+	struct Section
+	{
+		string origSpec;
+		vector<OId> outputIds;
+		vector<Column> columns;
+	};
+
+	//! the result of a single env of a batch
+	struct BatchResult
+	{
+		Json customId;
+		vector<Section> sections;
+		vector<string> errors;
+		vector<string> warnings;
+	};
+
+	//! the values of a column as 1D (rows) or 2D (rows x layers) doubles, missing values are NaN
+	Column toColumn(const J11Array& results)
+	{
+		Column c;
+		bool numbers = true, layered = false;
+		size_t noOfLayers = 0;
+		for(const auto& v : results)
+		{
+			if(v.is_array())
+			{
+				layered = true;
+				noOfLayers = max(noOfLayers, v.array_items().size());
+				for(const auto& lv : v.array_items())
+					numbers = numbers && (lv.is_number() || lv.is_null());
+			}
+			else
+				numbers = numbers && (v.is_number() || v.is_null());
+			if(!numbers)
+				break;
+		}
+
+		if(numbers)
+		{
+			const double nan = numeric_limits<double>::quiet_NaN();
+			c.buffer = make_shared<ColumnBuffer>();
+			auto& b = *c.buffer;
+			b.rows = results.size();
+			b.cols = layered ? noOfLayers : 1;
+			b.values.assign(b.rows * b.cols, nan);
+			for(size_t r = 0; r < b.rows; r++)
+			{
+				const auto& v = results[r];
+				if(v.is_array())
+				{
+					const auto& lvs = v.array_items();
+					for(size_t l = 0; l < lvs.size(); l++)
+						if(lvs[l].is_number())
+							b.values[r * b.cols + l] = lvs[l].number_value();
+				}
+				else if(v.is_number())
+					b.values[r * b.cols] = v.number_value();
+			}
+		}
+		else
+		{
+			c.strings.reserve(results.size());
+			for(const auto& v : results)
+				c.strings.push_back(v.is_string() ? v.string_value() : v.dump());
+		}
+		return c;
+	}
+
+	//! the env of a batch entry, either an Env JSON string (e.g. from monica-zmq-run -ces) or
+	//! a dict of JSON strings as for runMonica
+	struct BatchJob
+	{
+		string envJson;
+		map<string, string> n2jos;
+	};
+
+	BatchResult runBatchJob(const BatchJob& job)
+	{
+		BatchResult res;
+		Env env;
+		//called from several threads at once, which relies on the locked IncludeFileCache of the reference resolution
+		//and the immutable ParameterCatalogue, the reference resolution and parameter reading before them weren't thread safe
+		if(job.envJson.empty())
+			env = Monica::createEnvFromJsonConfigFiles(job.n2jos);
+		else
+		{
+			auto r = parseJsonString(job.envJson);
+			if(r.failure())
+			{
+				res.errors = r.errors;
+				return res;
+			}
+			auto es = env.merge(r.result);
+			res.errors = es.errors;
+			res.warnings = es.warnings;
+			if(es.failure())
+				return res;
+		}
+		res.customId = env.customId;
+
+		if(!env.climateData.isValid())
+		{
+			EResult<DataAccessor> eda;
+			if(!env.climateCSV.empty())
+				eda = readClimateDataFromCSVStringViaHeaders(env.climateCSV, env.csvViaHeaderOptions);
+			else if(!env.pathsToClimateCSV.empty())
+				eda = readClimateDataFromCSVFilesViaHeaders(env.pathsToClimateCSV, env.csvViaHeaderOptions);
+			if(eda.failure())
+			{
+				res.errors.insert(res.errors.end(), eda.errors.begin(), eda.errors.end());
+				return res;
+			}
+			if(eda.result.isValid())
+				env.climateData = eda.result;
+		}
+
+		auto out = Monica::runMonica(env);
+		res.errors.insert(res.errors.end(), out.errors.begin(), out.errors.end());
+		res.warnings.insert(res.warnings.end(), out.warnings.begin(), out.warnings.end());
+		for(const auto& d : out.data)
+		{
+			Section s;
+			s.origSpec = d.origSpec;
+			s.outputIds = d.outputIds;
+			for(const auto& column : d.results)
+				s.columns.push_back(toColumn(column));
+			res.sections.push_back(move(s));
+		}
+		return res;
+	}
+
+	//! the metadata of a column, the fields of OId plus the name used as column header in the output files
+	dict oidToDict(const OId& oid)
+	{
+		dict d;
+		for(const auto& p : oid.to_json().object_items())
+		{
+			if(p.second.is_string())
+				d[p.first] = p.second.string_value();
+			else if(p.second.is_number())
+				d[p.first] = p.second.int_value();
+		}
+		d["outputName"] = oid.outputName();
+		d["layerAgg"] = oid.toString(oid.layerAggOp);
+		d["timeAgg"] = oid.toString(oid.timeAggOp);
+		return d;
+	}
+
+	//! a NumPy view of the column's buffer, the array keeps the buffer alive
+	object toPython(const Column& c)
+	{
+		if(!c.buffer)
+		{
+			boost::python::list l;
+			for(const auto& s : c.strings)
+				l.append(s);
+			return l;
+		}
+
+		const auto& b = *c.buffer;
+		object owner(c.buffer);
+		auto dt = np::dtype::get_builtin<double>();
+		if(b.cols == 1)
+			return np::from_data(b.values.data(), dt,
+													 boost::python::make_tuple(b.rows),
+													 boost::python::make_tuple(sizeof(double)),
+													 owner);
+		return np::from_data(b.values.data(), dt,
+												 boost::python::make_tuple(b.rows, b.cols),
+												 boost::python::make_tuple(b.cols * sizeof(double), sizeof(double)),
+												 owner);
+	}
+
+	dict toPython(const BatchResult& r)
+	{
+		dict d;
+		d["customId"] = r.customId.is_string() ? r.customId.string_value() : r.customId.dump();
+
+		boost::python::list sections;
+		for(const auto& s : r.sections)
+		{
+			boost::python::list oids, values;
+			for(size_t i = 0; i < s.columns.size(); i++)
+			{
+				oids.append(i < s.outputIds.size() ? oidToDict(s.outputIds[i]) : dict());
+				values.append(toPython(s.columns[i]));
+			}
+			dict sd;
+			sd["origSpec"] = s.origSpec;
+			sd["outputIds"] = oids;
+			sd["values"] = values;
+			sections.append(sd);
+		}
+		d["data"] = sections;
+
+		boost::python::list errors, warnings;
+		for(const auto& e : r.errors)
+			errors.append(e);
+		for(const auto& w : r.warnings)
+			warnings.append(w);
+		d["errors"] = errors;
+		d["warnings"] = warnings;
+		return d;
+	}
+}
+
+/*!
+ * run a batch of envs on noOfThreads threads (0 = number of cores) with the GIL released,
+ * every entry of envs is either an Env JSON string or a dict of JSON strings as for runMonica,
+ * returns per env a dict with the sections of the output: the column metadata ("outputIds") and per column
+ * a NumPy float64 array (2D for per layer outputs, NaN for missing values) or a list of strings (e.g. dates)
+ */
+boost::python::list rmBatch(boost::python::list envs, int noOfThreads)
+{
+	//copy the Python inputs while still holding the GIL
+	vector<BatchJob> jobs;
+	stl_input_iterator<object> begin(envs), end;
+	for(auto it = begin; it != end; ++it)
+	{
+		BatchJob job;
+		extract<string> envJson(*it);
+		if(envJson.check())
+			job.envJson = envJson();
+		else
+		{
+			dict params = extract<dict>(*it);
+			stl_input_iterator<string> kbegin(params.keys()), kend;
+			for_each(kbegin, kend, [&](string key){ job.n2jos[key] = extract<string>(params[key]); });
+		}
+		jobs.push_back(job);
+	}
+
+	vector<BatchResult> results(jobs.size());
+	{
+		ReleaseGIL noGIL;
+		atomic<size_t> nextJob{0};
+		auto work = [&]()
+		{
+			for(size_t i = nextJob++; i < jobs.size(); i = nextJob++)
+			{
+				try
+				{
+					results[i] = runBatchJob(jobs[i]);
+				}
+				catch(exception& e)
+				{
+					results[i].errors.push_back(string("Error running env: ") + e.what());
+				}
+				//nothing may escape a worker thread, it would terminate the Python process
+				catch(...)
+				{
+					results[i].errors.push_back("Unknown error running env.");
+				}
+			}
+		};
+		size_t noOfWorkers = noOfThreads > 0 ? size_t(noOfThreads) : size_t(max(1u, thread::hardware_concurrency()));
+		vector<thread> workers;
+		for(size_t t = 0, ts = min(noOfWorkers, jobs.size()); t < ts; t++)
+			workers.push_back(thread(work));
+		for(auto& w : workers)
+			w.join();
+	}
+
+	boost::python::list res;
+	for(const auto& r : results)
+		res.append(toPython(r));
+	return res;
+}
+
 BOOST_PYTHON_MODULE(monica_python)
 {
+	np::initialize();
+	class_<ColumnBuffer, shared_ptr<ColumnBuffer>, boost::noncopyable>("_ColumnBuffer", no_init);
+
   def("runMonica", rm);
+	def("runMonicaBatch", rmBatch, (arg("envs"), arg("noOfThreads") = 0));
 	def("parseOutputIdsToJsonString", parseOutputIdsToJsonString);
 	def("readClimateDataFromCSVStringViaHeadersToJsonString", readClimateDataFromCSVStringViaHeadersToJsonString);
 	def("test", test);
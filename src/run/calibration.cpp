@@ -0,0 +1,476 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+Authors:
+Michael Berg <michael.berg@zalf.de>
+
+Maintainers:
+Currently maintained by the authors.
+
+This file is part of the MONICA model.
+Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
+*/
+
+#include <fstream>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <limits>
+
+#include "tools/helper.h"
+#include "tools/algorithms.h"
+#include "../io/build-output.h"
+
+#include "calibration.h"
+
+using namespace Monica;
+using namespace std;
+using namespace Tools;
+using namespace json11;
+
+namespace
+{
+	//! sort the observations by date
+	void sortByDate(ObservedOutput& o)
+	{
+		vector<pair<Date, double>> dvs;
+		for(size_t i = 0; i < o.dates.size(); i++)
+			dvs.push_back(make_pair(o.dates[i], o.values[i]));
+		sort(dvs.begin(), dvs.end(), [](const pair<Date, double>& l, const pair<Date, double>& r){ return l.first < r.first; });
+		o.dates.clear();
+		o.values.clear();
+		for(const auto& dv : dvs)
+		{
+			o.dates.push_back(dv.first);
+			o.values.push_back(dv.second);
+		}
+	}
+
+	bool initOutputId(ObservedOutput& o)
+	{
+		auto oids = parseOutputIds(J11Array{o.outputSpec});
+		if(oids.empty())
+			return false;
+		o.oid = oids.front();
+		return true;
+	}
+}
+
+Errors CalibrationSpec::merge(json11::Json j)
+{
+	Errors res = Json11Serializable::merge(j);
+
+	set_string_value(objective, j, "objective");
+	if(objective != "rmse" && objective != "nrmse" && objective != "nse")
+		res.errors.push_back(string("Unknown objective '") + objective + "', use one of rmse, nrmse or nse.");
+
+	if(j["parameters"].is_array())
+		parameters.clear();
+	for(auto pj : j["parameters"].array_items())
+	{
+		SweepParameter sp;
+		sp.path = ParameterPath(pj["path"].string_value());
+		sp.min = pj["min"].number_value();
+		sp.max = pj["max"].number_value();
+		if(!sp.path.isValid())
+			res.errors.push_back(string("Invalid parameter path '") + pj["path"].string_value() + "'.");
+		else if(!pj["min"].is_number() || !pj["max"].is_number() || sp.max < sp.min)
+			res.errors.push_back(string("Parameter '") + sp.path.path + "' needs valid min and max values.");
+		else
+			parameters.push_back(sp);
+	}
+
+	if(j["observations"].is_array())
+		observations.clear();
+	for(auto oj : j["observations"].array_items())
+	{
+		ObservedOutput o;
+		o.outputSpec = oj["output"];
+		if(!initOutputId(o))
+		{
+			res.errors.push_back(string("Unknown output '") + o.outputSpec.dump() + "'.");
+			continue;
+		}
+		for(const auto& p : oj["values"].object_items())
+		{
+			auto d = Date::fromIsoDateString(p.first);
+			if(d.isValid() && p.second.is_number())
+			{
+				o.dates.push_back(d);
+				o.values.push_back(p.second.number_value());
+			}
+			else
+				res.errors.push_back(string("Invalid observation of '") + o.outputSpec.dump() + "' at '" + p.first + "'.");
+		}
+		sortByDate(o);
+		observations.push_back(o);
+	}
+
+	auto pathToCSV = j["path-to-observations-csv"].string_value();
+	if(!pathToCSV.empty())
+	{
+		string csvSep = j["csv-separator"].is_string() ? j["csv-separator"].string_value() : ",";
+		res.append(readObservationsCSV(pathToCSV, csvSep, observations));
+	}
+
+	int population = int(populationSize), generations = int(noOfGenerations);
+	int threads = int(noOfThreads), s = int(seed);
+	set_int_value(population, j, "population");
+	set_int_value(generations, j, "generations");
+	set_int_value(threads, j, "threads");
+	set_int_value(s, j, "seed");
+	populationSize = size_t(max(0, population));
+	noOfGenerations = size_t(max(0, generations));
+	noOfThreads = size_t(max(0, threads));
+	seed = (unsigned int)s;
+	set_double_value(differentialWeight, j, "F");
+	set_double_value(crossoverProbability, j, "CR");
+
+	return res;
+}
+
+json11::Json CalibrationSpec::to_json() const
+{
+	J11Array ps;
+	for(const auto& p : parameters)
+		ps.push_back(J11Object{{"path", p.path.path}, {"min", p.min}, {"max", p.max}});
+
+	J11Array os;
+	for(const auto& o : observations)
+	{
+		J11Object vs;
+		for(size_t i = 0; i < o.dates.size(); i++)
+			vs[o.dates[i].toIsoDateString()] = o.values[i];
+		os.push_back(J11Object{{"output", o.outputSpec}, {"values", vs}});
+	}
+
+	return J11Object
+	{{"type", "CalibrationSpec"}
+	,{"objective", objective}
+	,{"parameters", ps}
+	,{"observations", os}
+	,{"population", int(populationSize)}
+	,{"generations", int(noOfGenerations)}
+	,{"F", differentialWeight}
+	,{"CR", crossoverProbability}
+	,{"seed", int(seed)}
+	,{"threads", int(noOfThreads)}
+	};
+}
+
+vector<ParameterPath> CalibrationSpec::paths() const
+{
+	vector<ParameterPath> ps;
+	for(const auto& p : parameters)
+		ps.push_back(p.path);
+	return ps;
+}
+
+//-----------------------------------------------------------------------------
+
+Errors Monica::readObservationsCSV(const string& pathToFile,
+																	 const string& csvSep,
+																	 vector<ObservedOutput>& observations)
+{
+	Errors res;
+
+	ifstream ifs(pathToFile);
+	if(ifs.fail())
+	{
+		res.errors.push_back(string("Couldn't open observations file '") + pathToFile + "'.");
+		return res;
+	}
+
+	string line;
+	if(!getline(ifs, line))
+	{
+		res.errors.push_back(string("Observations file '") + pathToFile + "' is empty.");
+		return res;
+	}
+
+	//the first column holds the dates, all other columns are outputs
+	vector<ObservedOutput> os;
+	auto header = splitString(line, csvSep);
+	for(size_t c = 1; c < header.size(); c++)
+	{
+		ObservedOutput o;
+		o.outputSpec = trim(trim(header[c]), "\"");
+		if(!initOutputId(o))
+			res.errors.push_back(string("Unknown output '") + o.outputSpec.string_value() + "' in observations file '" + pathToFile + "'.");
+		os.push_back(o);
+	}
+
+	while(getline(ifs, line))
+	{
+		auto cols = splitString(line, csvSep);
+		if(cols.empty() || trim(cols[0]).empty())
+			continue;
+		auto d = Date::fromIsoDateString(trim(trim(cols[0]), "\""));
+		if(!d.isValid())
+		{
+			res.errors.push_back(string("Invalid date '") + cols[0] + "' in observations file '" + pathToFile + "'.");
+			continue;
+		}
+
+		for(size_t c = 1; c < cols.size() && c <= os.size(); c++)
+		{
+			auto v = trim(cols[c]);
+			if(v.empty())
+				continue;
+			try
+			{
+				os[c - 1].values.push_back(stod(v));
+				os[c - 1].dates.push_back(d);
+			}
+			catch(exception e)
+			{
+				res.errors.push_back(string("Invalid value '") + v + "' in observations file '" + pathToFile + "'.");
+			}
+		}
+	}
+
+	for(auto& o : os)
+	{
+		sortByDate(o);
+		observations.push_back(o);
+	}
+
+	return res;
+}
+
+vector<vector<double>> Monica::simulateObservedOutputs(Env env,
+																											 const vector<ObservedOutput>& observations)
+{
+	//just the observed values are needed, so don't collect any other outputs
+	env.events = Json();
+
+	const auto& ofs = buildOutputTable().ofs;
+	vector<function<Json(const MonicaModel&, OId)>> fs;
+	vector<vector<double>> simulated;
+	for(const auto& o : observations)
+	{
+		auto ofi = ofs.find(o.oid.id);
+		fs.push_back(ofi == ofs.end() ? function<Json(const MonicaModel&, OId)>() : ofi->second);
+		simulated.push_back(vector<double>(o.dates.size(), numeric_limits<double>::quiet_NaN()));
+	}
+	vector<size_t> next(observations.size(), 0);
+
+	MonicaRun run(env);
+	while(run.hasNextStep())
+	{
+		Date date = run.currentDate();
+		run.step();
+
+		for(size_t k = 0; k < observations.size(); k++)
+		{
+			const auto& ds = observations[k].dates;
+			auto& i = next[k];
+			while(i < ds.size() && ds[i] < date)
+				i++;
+			for(; i < ds.size() && ds[i] == date; i++)
+			{
+				if(!fs[k])
+					continue;
+				auto v = fs[k](run.model(), observations[k].oid);
+				if(v.is_number())
+					simulated[k][i] = v.number_value();
+			}
+		}
+	}
+
+	return simulated;
+}
+
+double Monica::rmse(const vector<double>& observed, const vector<double>& simulated)
+{
+	if(observed.empty())
+		return 0;
+
+	double sum = 0;
+	for(size_t i = 0; i < observed.size(); i++)
+		sum += (simulated.at(i) - observed[i]) * (simulated.at(i) - observed[i]);
+	return sqrt(sum / observed.size());
+}
+
+double Monica::nse(const vector<double>& observed, const vector<double>& simulated)
+{
+	if(observed.empty())
+		return numeric_limits<double>::quiet_NaN();
+
+	double mean = accumulate(observed.begin(), observed.end(), 0.0) / observed.size();
+	double sumSqErr = 0, sumSqDev = 0;
+	for(size_t i = 0; i < observed.size(); i++)
+	{
+		sumSqErr += (simulated.at(i) - observed[i]) * (simulated.at(i) - observed[i]);
+		sumSqDev += (observed[i] - mean) * (observed[i] - mean);
+	}
+	return sumSqDev > 0 ? 1 - sumSqErr / sumSqDev : numeric_limits<double>::quiet_NaN();
+}
+
+double Monica::objectiveValue(const string& objective,
+															const vector<ObservedOutput>& observations,
+															const vector<vector<double>>& simulated)
+{
+	//a parameter set which leaves observations unexplained is worse than any other
+	const double worst = numeric_limits<double>::max();
+
+	double sum = 0;
+	size_t n = 0;
+	for(size_t k = 0; k < observations.size(); k++)
+	{
+		const auto& obs = observations[k].values;
+		const auto& sim = simulated.at(k);
+		if(obs.empty())
+			continue;
+		for(auto v : sim)
+			if(!isfinite(v))
+				return worst;
+
+		double e = 0;
+		if(objective == "nse")
+			e = 1 - nse(obs, sim);
+		else
+		{
+			e = rmse(obs, sim);
+			double mean = accumulate(obs.begin(), obs.end(), 0.0) / obs.size();
+			if(objective == "nrmse" && mean != 0)
+				e /= fabs(mean);
+		}
+		if(!isfinite(e))
+			return worst;
+		sum += e;
+		n++;
+	}
+
+	return objective == "rmse" || n == 0 ? sum : sum / n;
+}
+
+//-----------------------------------------------------------------------------
+
+CalibrationResult Monica::calibrate(const Env& env,
+																		const CalibrationSpec& spec,
+																		function<void(size_t, const CalibrationResult&)> progress)
+{
+	CalibrationResult res;
+	const auto& ps = spec.parameters;
+	const size_t dims = ps.size();
+	if(dims == 0)
+		return res;
+
+	//DE/rand/1 needs at least three other members
+	const size_t np = max(size_t(4), spec.populationSize > 0 ? spec.populationSize : 10 * dims);
+	const auto paths = spec.paths();
+
+	//a misspelled path would silently evaluate the unchanged parameters in every generation
+	{
+		Env e = env;
+		vector<double> mids;
+		for(const auto& p : ps)
+			mids.push_back((p.min + p.max) / 2);
+		auto es = setParameterValues(e, paths, mids);
+		if(es.failure())
+		{
+			res.errors = es.errors;
+			return res;
+		}
+	}
+
+	auto evaluate = [&](const vector<vector<double>>& pop, vector<double>& objVals)
+	{
+		objVals.assign(pop.size(), numeric_limits<double>::max());
+		vector<char> failed(pop.size(), 0);
+		runInParallel(pop.size(), spec.noOfThreads, [&](size_t i)
+		{
+			//a parameter set making MONICA throw is just the worst candidate, it must not abort the calibration
+			try
+			{
+				Env e = env;
+				setParameterValues(e, paths, pop[i]);
+				objVals[i] = objectiveValue(spec.objective, spec.observations, simulateObservedOutputs(e, spec.observations));
+			}
+			catch(...)
+			{
+				objVals[i] = numeric_limits<double>::max();
+				failed[i] = 1;
+			}
+		});
+		res.noOfEvaluations += pop.size();
+		res.noOfFailedEvaluations += size_t(count(failed.begin(), failed.end(), 1));
+	};
+
+	auto updateBest = [&](const vector<vector<double>>& pop, const vector<double>& objVals)
+	{
+		auto bi = min_element(objVals.begin(), objVals.end()) - objVals.begin();
+		if(res.bestValues.empty() || objVals[bi] < res.bestObjectiveValue)
+		{
+			res.bestValues = pop[bi];
+			res.bestObjectiveValue = objVals[bi];
+		}
+		res.bestObjectiveValuePerGeneration.push_back(res.bestObjectiveValue);
+	};
+
+	auto valueIn = [&](size_t d, double u){ return ps[d].min + u*(ps[d].max - ps[d].min); };
+
+	//initial population spread over the parameter space
+	vector<vector<double>> pop = latinHypercubeSample(np, dims, spec.seed);
+	for(auto& member : pop)
+		for(size_t d = 0; d < dims; d++)
+			member[d] = valueIn(d, member[d]);
+	vector<double> objVals;
+	evaluate(pop, objVals);
+	updateBest(pop, objVals);
+	if(progress)
+		progress(0, res);
+
+	//the random numbers are drawn sequentially, so the calibration is reproducible independent of the threads
+	mt19937 gen(spec.seed);
+	uniform_real_distribution<double> u01(0.0, 1.0);
+	uniform_int_distribution<size_t> randomMember(0, np - 1);
+	uniform_int_distribution<size_t> randomDim(0, dims - 1);
+
+	vector<vector<double>> trials(np, vector<double>(dims));
+	vector<double> trialObjVals;
+	for(size_t g = 1; g <= spec.noOfGenerations; g++)
+	{
+		for(size_t i = 0; i < np; i++)
+		{
+			size_t a, b, c;
+			do a = randomMember(gen); while(a == i);
+			do b = randomMember(gen); while(b == i || b == a);
+			do c = randomMember(gen); while(c == i || c == a || c == b);
+
+			size_t jrand = randomDim(gen);
+			for(size_t d = 0; d < dims; d++)
+			{
+				if(d == jrand || u01(gen) < spec.crossoverProbability)
+				{
+					double v = pop[a][d] + spec.differentialWeight*(pop[b][d] - pop[c][d]);
+					//values outside of the bounds are replaced randomly
+					trials[i][d] = v < ps[d].min || v > ps[d].max ? valueIn(d, u01(gen)) : v;
+				}
+				else
+					trials[i][d] = pop[i][d];
+			}
+		}
+
+		evaluate(trials, trialObjVals);
+
+		for(size_t i = 0; i < np; i++)
+		{
+			if(trialObjVals[i] <= objVals[i])
+			{
+				pop[i] = trials[i];
+				objVals[i] = trialObjVals[i];
+			}
+		}
+
+		updateBest(pop, objVals);
+		if(progress)
+			progress(g, res);
+	}
+
+	return res;
+}
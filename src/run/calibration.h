@@ -0,0 +1,122 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+Authors:
+Michael Berg <michael.berg@zalf.de>
+
+Maintainers:
+Currently maintained by the authors.
+
+This file is part of the MONICA model.
+Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
+*/
+
+#ifndef MONICA_CALIBRATION_H_
+#define MONICA_CALIBRATION_H_
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "json11/json11.hpp"
+#include "json11/json11-helper.h"
+#include "tools/date.h"
+#include "run-monica.h"
+#include "parameter-sweep.h"
+#include "../io/output.h"
+
+namespace Monica
+{
+	//! observed values of a single output (as defined in the output table, e.g. "Yield" or ["Mois", 1])
+	struct ObservedOutput
+	{
+		json11::Json outputSpec;
+		OId oid;
+		std::vector<Tools::Date> dates; //!< sorted ascending
+		std::vector<double> values;
+	};
+
+	/*!
+	 * Definition of a calibration:
+	 * {
+	 *   "objective": "rmse" | "nrmse" | "nse",
+	 *   "parameters": [{"path": "cultivar.MaxAssimilationRate", "min": 30, "max": 80}, ...],
+	 *   "observations": [{"output": "Yield", "values": {"1993-07-27": 6500, ...}}, ...],
+	 *   "path-to-observations-csv": "obs.csv", -> alternatively a csv file, first column Date, the other columns named by outputs
+	 *   "csv-separator": ",",
+	 *   "population": 0,      -> 0 = 10 * number of parameters
+	 *   "generations": 50,
+	 *   "F": 0.7,             -> differential weight
+	 *   "CR": 0.9,            -> crossover probability
+	 *   "seed": 1,
+	 *   "threads": 0          -> 0 = use all cores
+	 * }
+	 * With multiple observed outputs the objective is the sum of the RMSEs (rmse),
+	 * the mean of the RMSEs normalized by the mean observation (nrmse) or the mean of (1 - NSE) (nse).
+	 */
+	struct CalibrationSpec : public Tools::Json11Serializable
+	{
+		CalibrationSpec() {}
+
+		CalibrationSpec(json11::Json j) { merge(j); }
+
+		virtual Tools::Errors merge(json11::Json j);
+
+		virtual json11::Json to_json() const;
+
+		std::vector<ParameterPath> paths() const;
+
+		std::string objective{"rmse"};
+		std::vector<SweepParameter> parameters;
+		std::vector<ObservedOutput> observations;
+		std::size_t populationSize{0};
+		std::size_t noOfGenerations{50};
+		double differentialWeight{0.7};
+		double crossoverProbability{0.9};
+		unsigned int seed{1};
+		std::size_t noOfThreads{0};
+	};
+
+	//! read observations from a csv file with a header row, the first column holds iso dates,
+	//! the other columns are named by output names, empty cells are missing values
+	Tools::Errors readObservationsCSV(const std::string& pathToFile,
+																		const std::string& csvSep,
+																		std::vector<ObservedOutput>& observations);
+
+	//! run env and return the simulated values at the observation dates (NaN if not available),
+	//! nothing else is being stored during the run
+	std::vector<std::vector<double>> simulateObservedOutputs(Env env,
+																													 const std::vector<ObservedOutput>& observations);
+
+	double rmse(const std::vector<double>& observed, const std::vector<double>& simulated);
+
+	double nse(const std::vector<double>& observed, const std::vector<double>& simulated);
+
+	//! objective value to minimize (see CalibrationSpec)
+	double objectiveValue(const std::string& objective,
+												const std::vector<ObservedOutput>& observations,
+												const std::vector<std::vector<double>>& simulated);
+
+	struct CalibrationResult
+	{
+		std::vector<double> bestValues;
+		double bestObjectiveValue{0};
+		std::size_t noOfEvaluations{0};
+		//! evaluations in which MONICA threw, they got the worst objective value
+		std::size_t noOfFailedEvaluations{0};
+		std::vector<double> bestObjectiveValuePerGeneration;
+		//! e.g. parameter paths which couldn't be set, nothing has been calibrated then
+		std::vector<std::string> errors;
+	};
+
+	//! calibrate the parameters of spec by differential evolution (DE/rand/1/bin),
+	//! the members of a population are evaluated in parallel
+	CalibrationResult calibrate(const Env& env,
+															const CalibrationSpec& spec,
+															std::function<void(std::size_t, const CalibrationResult&)> progress
+															= std::function<void(std::size_t, const CalibrationResult&)>());
+}
+
+#endif //MONICA_CALIBRATION_H_
@@ -22,6 +22,7 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 #include <cmath>
 #include <utility>
 #include <mutex>
+#include <algorithm>
 
 #include "db/abstract-db-connections.h"
 #include "climate/climate-common.h"
@@ -46,6 +47,24 @@ using namespace Tools;
 using namespace Climate;
 
 
+namespace
+{
+	//! return the copy of crop (creating it if necessary), so crops shared in the original are shared in the copies as well
+	CropPtr copyOfCrop(CropPtr crop, map<const Crop*, CropPtr>& cropCopies)
+	{
+		if(!crop)
+			return crop;
+
+		auto ci = cropCopies.find(crop.get());
+		if(ci != cropCopies.end())
+			return ci->second;
+
+		auto copy = make_shared<Crop>(*crop);
+		cropCopies[crop.get()] = copy;
+		return copy;
+	}
+}
+
 std::pair<Date, bool> makeInitAbsDate(Date date, Date initDate, bool addYear, bool forceInitYear = false)
 {
 	bool addedYear = false;
@@ -204,6 +223,13 @@ json11::Json Sowing::to_json(bool includeFullCropParameters) const
 	return o;
 }
 
+Sowing* Sowing::deepClone(map<const Crop*, CropPtr>& cropCopies) const
+{
+	auto s = clone();
+	s->_crop = copyOfCrop(_crop, cropCopies);
+	return s;
+}
+
 bool Sowing::apply(MonicaModel* model)
 {
 	Workstep::apply(model);
@@ -502,6 +528,13 @@ json11::Json Harvest::to_json(bool includeFullCropParameters) const
 	};
 }
 
+Harvest* Harvest::deepClone(map<const Crop*, CropPtr>& cropCopies) const
+{
+	auto h = clone();
+	h->_crop = copyOfCrop(_crop, cropCopies);
+	return h;
+}
+
 bool Harvest::apply(MonicaModel* model)
 {
 	Workstep::apply(model);
@@ -1233,6 +1266,91 @@ CultivationMethod::CultivationMethod(json11::Json j)
 	merge(j);
 }
 
+CultivationMethod CultivationMethod::deepCopy(map<const Crop*, CropPtr>& cropCopies) const
+{
+	CultivationMethod cm(*this);
+
+	//the same workstep can be referenced from all three lists
+	map<const Workstep*, WSPtr> wsCopies;
+	auto copyOfWS = [&](WSPtr ws)
+	{
+		auto ci = wsCopies.find(ws.get());
+		if(ci != wsCopies.end())
+			return ci->second;
+		
+		WSPtr copy(ws->deepClone(cropCopies));
+		wsCopies[ws.get()] = copy;
+		return copy;
+	};
+
+	for(auto& ws : cm._allWorksteps)
+		ws = copyOfWS(ws);
+	for(auto& ws : cm._allAbsWorksteps)
+		ws = copyOfWS(ws);
+	for(auto& ws : cm._unfinishedDynamicWorksteps)
+		ws = copyOfWS(ws);
+	cm._crop = copyOfCrop(_crop, cropCopies);
+
+	return cm;
+}
+
+template<class Archive>
+void CultivationMethod::serialize(Archive& ar)
+{
+	//the lists of absolute and unfinished dynamic worksteps are views onto _allWorksteps,
+	//so they are stored as indices into _allWorksteps
+	auto toIndices = [&](const vector<WSPtr>& wss)
+	{
+		vector<int32_t> is;
+		for(auto ws : wss)
+		{
+			auto it = find(_allWorksteps.begin(), _allWorksteps.end(), ws);
+			is.push_back(it == _allWorksteps.end() ? -1 : int32_t(it - _allWorksteps.begin()));
+		}
+		return is;
+	};
+	auto fromIndices = [&](const vector<int32_t>& is, vector<WSPtr>& wss)
+	{
+		wss.clear();
+		for(auto i : is)
+		{
+			if(i < 0 || size_t(i) >= _allWorksteps.size())
+			{
+				ar.setFailed();
+				return;
+			}
+			wss.push_back(_allWorksteps.at(i));
+		}
+	};
+
+	uint64_t noOfWorksteps = _allWorksteps.size();
+	ar(noOfWorksteps);
+	if(noOfWorksteps != _allWorksteps.size())
+	{
+		//the state belongs to a different cultivation method
+		ar.setFailed();
+		return;
+	}
+
+	auto absIs = toIndices(_allAbsWorksteps);
+	auto udIs = toIndices(_unfinishedDynamicWorksteps);
+	ar(absIs, udIs);
+	if(Archive::isReading)
+	{
+		fromIndices(absIs, _allAbsWorksteps);
+		fromIndices(udIs, _unfinishedDynamicWorksteps);
+	}
+
+	for(auto ws : _allWorksteps)
+		ar(*ws);
+
+	if(_crop)
+		ar(*_crop);
+}
+
+template void CultivationMethod::serialize<StateWriter>(StateWriter&);
+template void CultivationMethod::serialize<StateReader>(StateReader&);
+
 Errors CultivationMethod::merge(json11::Json j)
 {
 	Errors res;
@@ -35,6 +35,7 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 #include "soil/soil.h"
 #include "../core/monica-parameters.h"
 #include "../core/crop.h"
+#include "../core/model-state.h"
 #include "../io/output.h"
 
 namespace Monica
@@ -54,6 +55,10 @@ namespace Monica
 
     virtual Workstep* clone() const = 0;
 
+		//! clone with own copies of the objects a plain clone shares (the crop),
+		//! cropCopies maps the already copied crops to their copies and will be extended
+		virtual Workstep* deepClone(std::map<const Crop*, CropPtr>& cropCopies) const { return clone(); }
+
     virtual Tools::Errors merge(json11::Json j);
 
     virtual json11::Json to_json() const;
@@ -101,7 +106,14 @@ namespace Monica
 			return std::function<double(MonicaModel*)>(); 
 		};
 
+		//! write/restore the state the workstep changes while being applied (e.g. for checkpoints)
+		virtual void serialize(StateWriter& ar) { serializeState(ar); }
+		virtual void serialize(StateReader& ar) { serializeState(ar); }
+
 	protected:
+		template<class Archive>
+		void serializeState(Archive& ar) { ar(_date, _absDate, _daysAfterEventCount, _isActive); }
+
 		Tools::Date _date;
 		Tools::Date _absDate;
 		int _applyNoOfDaysAfterEvent{0};
@@ -125,6 +137,8 @@ namespace Monica
 
     virtual Sowing* clone() const {return new Sowing(*this); }
 
+		virtual Sowing* deepClone(std::map<const Crop*, CropPtr>& cropCopies) const;
+
     virtual Tools::Errors merge(json11::Json j);
 
 		virtual json11::Json to_json() const { return to_json(true); }
@@ -143,6 +157,18 @@ namespace Monica
 
     CropPtr crop() const { return _crop; }
 
+		virtual void serialize(StateWriter& ar) { serializeState(ar); }
+		virtual void serialize(StateReader& ar) { serializeState(ar); }
+
+	protected:
+		template<class Archive>
+		void serializeState(Archive& ar)
+		{
+			Workstep::serializeState(ar);
+			if(_crop)
+				ar(*_crop);
+		}
+
   private:
     CropPtr _crop;
 		int _plantDensity{-1}; //[plants m-2]
@@ -185,7 +211,17 @@ namespace Monica
 
 		virtual std::function<double(MonicaModel*)> registerDailyFunction(std::function<std::vector<double>&()> getDailyValues);
 
+		virtual void serialize(StateWriter& ar) { serializeState(ar); }
+		virtual void serialize(StateReader& ar) { serializeState(ar); }
+
 	private:
+		template<class Archive>
+		void serializeState(Archive& ar)
+		{
+			Sowing::serializeState(ar);
+			ar(_absEarliestDate, _absLatestDate, _inSowingRange, _cropSeeded);
+		}
+
 		Tools::Date _absEarliestDate;
 		Tools::Date _earliestDate;
 		Tools::Date _latestDate;
@@ -237,6 +273,8 @@ namespace Monica
 
     virtual Harvest* clone() const { return new Harvest(*this); }
 
+		virtual Harvest* deepClone(std::map<const Crop*, CropPtr>& cropCopies) const;
+
     virtual Tools::Errors merge(json11::Json j);
 
 		virtual json11::Json to_json() const { return to_json(true); }
@@ -306,7 +344,17 @@ namespace Monica
 
 		virtual Tools::Date absLatestDate() const { return _absLatestDate; }
 
+		virtual void serialize(StateWriter& ar) { serializeState(ar); }
+		virtual void serialize(StateReader& ar) { serializeState(ar); }
+
 	private:
+		template<class Archive>
+		void serializeState(Archive& ar)
+		{
+			Workstep::serializeState(ar);
+			ar(_absLatestDate, _cropHarvested);
+		}
+
 		std::string _harvestTime; //!< Harvest time parameter
 		Tools::Date _latestDate;
 		Tools::Date _absLatestDate;
@@ -421,7 +469,17 @@ namespace Monica
 
 		virtual bool reinit(Tools::Date date, bool addYear = false, bool forceInitYear = false);
 
+		virtual void serialize(StateWriter& ar) { serializeState(ar); }
+		virtual void serialize(StateReader& ar) { serializeState(ar); }
+
 	private:
+		template<class Archive>
+		void serializeState(Archive& ar)
+		{
+			Workstep::serializeState(ar);
+			ar(_appliedFertilizer);
+		}
+
 		Tools::Date _initialDate;
 		MineralFertiliserParameters _partition;
 		double _Ndemand{0};
@@ -570,6 +628,10 @@ namespace Monica
 
     virtual json11::Json to_json() const;
 
+		//! copy with own worksteps and crops, in contrast to a plain copy, which shares them with the original
+		//! @param cropCopies maps already copied crops to their copies (crops can be shared between cultivation methods)
+		CultivationMethod deepCopy(std::map<const Crop*, CropPtr>& cropCopies) const;
+
 		template<class Application>
 		void addApplication(const Application& a)
 		{
@@ -645,6 +707,10 @@ namespace Monica
 
 		bool repeat() const { return _repeat; }
 
+		//! write/restore the progress of the cultivation method (worksteps still to apply and their state)
+		template<class Archive>
+		void serialize(Archive& ar);
+
 	private:
 		std::vector<WSPtr> _allWorksteps;
 		std::vector<WSPtr> _allAbsWorksteps;
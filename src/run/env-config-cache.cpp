@@ -0,0 +1,230 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+Authors:
+Michael Berg <michael.berg@zalf.de>
+
+Maintainers:
+Currently maintained by the authors.
+
+This file is part of the MONICA model.
+Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
+*/
+
+#include <algorithm>
+
+#include "env-config-cache.h"
+#include "env-json-from-json-config.h"
+#include "env-template-cache.h"
+
+using namespace Monica;
+using namespace Tools;
+using namespace json11;
+using namespace std;
+
+namespace
+{
+	const char* partNames[] = {"crop", "site", "sim"};
+
+	//! drop the least recently used entry of m if it is full
+	template<typename Map>
+	void makeRoom(Map& m, size_t maxSize)
+	{
+		if(maxSize == 0 || m.size() < maxSize)
+			return;
+		auto lru = min_element(m.begin(), m.end(), [](const auto& l, const auto& r)
+		{
+			return l.second.second < r.second.second;
+		});
+		m.erase(lru);
+	}
+}
+
+EnvConfigCache::ResolvedPart EnvConfigCache::resolveUncached(const Json& part, const string& includeFileBasePath)
+{
+	auto rp = make_shared<Resolved>();
+	rp->part = Monica::resolveJsonConfig(part, includeFileBasePath, &rp->includedFiles);
+	return rp;
+}
+
+EnvConfigCache::ResolvedPart EnvConfigCache::resolve(const Json& part, const string& includeFileBasePath)
+{
+	auto key = includeFileBasePath + "\n" + part.dump();
+	ResolvedPart cached;
+	{
+		lock_guard<mutex> lock(_mutex);
+		auto it = _resolvedParts.find(key);
+		if(it != _resolvedParts.end())
+		{
+			it->second.second = ++_useCount;
+			cached = it->second.first;
+		}
+	}
+	//checking the files (outside the lock) is just a stat per file, reading and parsing them again is left to changed ones
+	if(cached && includedFilesUnchanged(cached->includedFiles))
+		return cached;
+
+	auto rp = resolveUncached(part, includeFileBasePath);
+
+	//failed resolutions (e.g. missing include files) are tried again with the next job
+	if(rp->part.success())
+	{
+		lock_guard<mutex> lock(_mutex);
+		if(_resolvedParts.find(key) == _resolvedParts.end())
+			makeRoom(_resolvedParts, _maxNoOfResolvedParts);
+		_resolvedParts[key] = make_pair(rp, ++_useCount);
+	}
+	return rp;
+}
+
+Errors EnvConfigCache::registerConfig(const string& id, const Json& config)
+{
+	auto c = make_shared<Config>();
+	for(auto name : partNames)
+		if(config[name].is_object())
+			c->parts[name] = config[name];
+
+	Errors es;
+	c->includeFileBasePath = config["sim"]["include-file-base-path"].string_value();
+	for(const auto& p : c->parts)
+	{
+		auto rp = resolveUncached(p.second, c->includeFileBasePath);
+		for(const auto& e : rp->part.errors)
+			es.errors.push_back(e);
+		c->resolvedParts[p.first] = rp;
+	}
+
+	lock_guard<mutex> lock(_mutex);
+	if(_configs.find(id) == _configs.end())
+		makeRoom(_configs, _maxNoOfConfigs);
+	_configs[id] = make_pair(c, ++_useCount);
+
+	return es;
+}
+
+Errors EnvConfigCache::registerIfUnknown(const string& id, const Json& msg)
+{
+	if(id.empty() || !msg["config"].is_object() || hasConfig(id))
+		return Errors();
+	return registerConfig(id, msg["config"]);
+}
+
+bool EnvConfigCache::hasConfig(const string& id) const
+{
+	lock_guard<mutex> lock(_mutex);
+	return _configs.find(id) != _configs.end();
+}
+
+bool EnvConfigCache::removeConfig(const string& id)
+{
+	lock_guard<mutex> lock(_mutex);
+	return _configs.erase(id) > 0;
+}
+
+size_t EnvConfigCache::size() const
+{
+	lock_guard<mutex> lock(_mutex);
+	return _configs.size();
+}
+
+string EnvConfigCache::configId(const Json& msg)
+{
+	return msg["configId"].string_value();
+}
+
+EResult<Json> EnvConfigCache::createEnvJson(const Json& job)
+{
+	shared_ptr<const Config> c;
+	auto id = configId(job);
+	if(!id.empty())
+	{
+		lock_guard<mutex> lock(_mutex);
+		auto it = _configs.find(id);
+		if(it == _configs.end())
+			return{Json(), string("Unknown env config '") + id + "'!"};
+		it->second.second = ++_useCount;
+		c = it->second.first;
+	}
+
+	const auto& overrides = job["overrides"];
+
+	//the unresolved part used by the job, its own one, else the one of the config
+	auto unresolved = [&](const string& name)
+	{
+		Json part = job[name];
+		if(part.is_null() && c)
+		{
+			auto it = c->parts.find(name);
+			if(it != c->parts.end())
+				part = it->second;
+		}
+		if(!overrides[name].is_null())
+			part = applyMergePatch(part, overrides[name]);
+		return part;
+	};
+
+	//the sim.json defines the base path of the include files of all parts
+	auto simj = unresolved("sim");
+	auto basePath = simj["include-file-base-path"].string_value();
+
+	map<string, Json> resolved;
+	map<string, ResolvedPart> refreshedParts;
+	Errors es;
+	for(auto name : partNames)
+	{
+		ResolvedPart rp;
+		//parts taken unchanged from the config have been resolved when registering it,
+		//unless a file they include changed since then
+		bool unchanged = c && job[name].is_null() && overrides[name].is_null()
+			&& basePath == c->includeFileBasePath;
+		if(unchanged)
+		{
+			auto it = c->resolvedParts.find(name);
+			if(it != c->resolvedParts.end() && includedFilesUnchanged(it->second->includedFiles))
+				rp = it->second;
+		}
+		if(!rp)
+		{
+			auto part = string(name) == "sim" ? simj : unresolved(name);
+			if(!part.is_object())
+			{
+				es.errors.push_back(string("Missing ") + name + ".json for job of env config '" + id + "'!");
+				continue;
+			}
+			rp = resolve(part, basePath);
+			if(unchanged && rp->part.success())
+				refreshedParts[name] = rp;
+		}
+		for(const auto& e : rp->part.errors)
+			es.errors.push_back(e);
+		resolved[name] = rp->part.result;
+	}
+
+	//keep the parts resolved again in the config, if it hasn't been replaced meanwhile
+	if(!refreshedParts.empty())
+	{
+		auto nc = make_shared<Config>(*c);
+		for(const auto& p : refreshedParts)
+			nc->resolvedParts[p.first] = p.second;
+		lock_guard<mutex> lock(_mutex);
+		auto it = _configs.find(id);
+		if(it != _configs.end() && it->second.first == c)
+			it->second.first = nc;
+	}
+
+	if(es.failure())
+		return{Json(), es.errors};
+
+	auto env = createEnvJsonFromResolvedJsonObjects(resolved["crop"], resolved["site"], resolved["sim"], false);
+	if(!overrides["env"].is_null())
+		env = applyMergePatch(env, overrides["env"]);
+
+	auto envm = env.object_items();
+	if(!job["customId"].is_null())
+		envm["customId"] = job["customId"];
+	if(job["sharedId"].is_string())
+		envm["sharedId"] = job["sharedId"];
+	return{envm};
+}
@@ -0,0 +1,111 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+Authors:
+Michael Berg <michael.berg@zalf.de>
+
+Maintainers:
+Currently maintained by the authors.
+
+This file is part of the MONICA model.
+Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
+*/
+
+#ifndef MONICA_ENV_CONFIG_CACHE_H_
+#define MONICA_ENV_CONFIG_CACHE_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+#include "json11/json11.hpp"
+#include "json11/json11-helper.h"
+#include "env-json-from-json-config.h"
+
+namespace Monica
+{
+	/*!
+	 * The sim/crop/site.json configurations of the servers, so that clients can send a configuration
+	 * (or just a reference to a registered one) plus per job overrides instead of a complete Env.
+	 * The server resolves the references and functions ("ref", "include-from-file", texture and humus conversions ...)
+	 * and creates the Env itself.
+	 *
+	 * Messages understood by the servers:
+	 *   {"type": "EnvConfig", "configId": "grid-1", "sim": {...}, "crop": {...}, "site": {...}} -> register (or replace) configuration
+	 *   {"type": "EnvConfig", "configId": "grid-1"}                                            -> remove configuration
+	 *   {"type": "EnvFromConfig", "configId": "grid-1", "customId": ..., "sharedId": ...,
+	 *    "site": {...}, "overrides": {"sim": {...}, "crop": {...}, "site": {...}, "env": {...}}} -> run the resulting Env
+	 * A job's own "sim", "crop" or "site" replace the ones of the configuration, without configId all three are required.
+	 * The overrides are merge patches (RFC 7396) of the unresolved sim/crop/site.json (so they may contain references
+	 * and functions too) and of the created Env JSON ("env").
+	 *
+	 * Configurations are registered per server process. Behind a proxy or after a worker restart a job may reach
+	 * a server not knowing its configuration, it is answered with an Output carrying "unknownConfigId",
+	 * so that the client can send the job again with the configuration as "config": {"sim": ..., "crop": ..., "site": ...}
+	 * of the "EnvFromConfig" (or "EnvBatch") message, which servers not knowing it register first (see registerIfUnknown).
+	 *
+	 * The resolved parts of registered configurations are kept, other (inline or overridden) parts are
+	 * cached by their content, so e.g. only the per cell site.json of a grid is being resolved for every job.
+	 * Both are resolved again, once a file they include has changed on disk (modification time or size).
+	 */
+	class EnvConfigCache
+	{
+	public:
+		EnvConfigCache(std::size_t maxNoOfConfigs = 64, std::size_t maxNoOfResolvedParts = 1024)
+			: _maxNoOfConfigs(maxNoOfConfigs), _maxNoOfResolvedParts(maxNoOfResolvedParts) {}
+
+		//! resolve the parts of config and store them under id
+		Tools::Errors registerConfig(const std::string& id, const json11::Json& config);
+
+		//! register the configuration "config" carried by an "EnvFromConfig" or "EnvBatch" message, if id is not known yet
+		Tools::Errors registerIfUnknown(const std::string& id, const json11::Json& msg);
+
+		bool hasConfig(const std::string& id) const;
+
+		bool removeConfig(const std::string& id);
+
+		std::size_t size() const;
+
+		//! the Env JSON of an "EnvFromConfig" job, the climate data are left to be read when running the Env
+		Tools::EResult<json11::Json> createEnvJson(const json11::Json& job);
+
+		//! the config id of an "EnvConfig" or "EnvFromConfig" message
+		static std::string configId(const json11::Json& msg);
+
+	private:
+		struct Resolved
+		{
+			Tools::EResult<json11::Json> part;
+			//! the files the part includes, with their stamps when they were read
+			std::vector<IncludedFile> includedFiles;
+		};
+		typedef std::shared_ptr<const Resolved> ResolvedPart;
+
+		//! resolve part, recording the files it includes
+		static ResolvedPart resolveUncached(const json11::Json& part, const std::string& includeFileBasePath);
+
+		struct Config
+		{
+			std::map<std::string, json11::Json> parts;
+			std::map<std::string, ResolvedPart> resolvedParts;
+			std::string includeFileBasePath;
+		};
+
+		//! the resolved part, from the content cache if it has been resolved before and its included files are unchanged
+		ResolvedPart resolve(const json11::Json& part, const std::string& includeFileBasePath);
+
+		std::size_t _maxNoOfConfigs{64};
+		std::size_t _maxNoOfResolvedParts{1024};
+		mutable std::mutex _mutex;
+		std::map<std::string, std::pair<std::shared_ptr<const Config>, std::uint64_t>> _configs;
+		std::map<std::string, std::pair<ResolvedPart, std::uint64_t>> _resolvedParts;
+		std::uint64_t _useCount{0};
+	};
+}
+
+#endif //MONICA_ENV_CONFIG_CACHE_H_
@@ -17,6 +17,11 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 #include <fstream>
 #include <string>
 #include <set>
+#include <map>
+#include <mutex>
+#include <ctime>
+#include <cstdint>
+#include <sys/stat.h>
 
 #include "env-json-from-json-config.h"
 #include "tools/debug.h"
@@ -37,121 +42,250 @@ using namespace Climate;
 
 //-----------------------------------------------------------------------------
 
-const map<string, function<EResult<Json>(const Json&, const Json&)>>& supportedPatterns();
+typedef function<EResult<Json>(const Json&, const Json&)> PatternFunction;
 
-EResult<Json> Monica::findAndReplaceReferences(const Json& root, const Json& j)
+//! the functions of the JSON configs, except "ref" and "include-from-file", which are part of the resolver
+const map<string, PatternFunction>& supportedPatterns();
+
+namespace
 {
-	auto sp = supportedPatterns();
+	//! the JSON files included via "include-from-file", they are read and parsed again only if they changed on disk
+	class IncludeFileCache
+	{
+	public:
+		//! the content of the file and (if given) its stamp as of the time it has been read
+		EResult<Json> get(const string& pathToFile, IncludedFile* includedFile = nullptr)
+		{
+			struct stat st;
+			if(stat(pathToFile.c_str(), &st) != 0)
+				return{Json(), string("Couldn't include file with path: '") + pathToFile + "'!"};
+			if(includedFile)
+				*includedFile = IncludedFile{pathToFile, int64_t(st.st_mtime), int64_t(st.st_size)};
+
+			{
+				lock_guard<mutex> lock(_mutex);
+				auto it = _files.find(pathToFile);
+				if(it != _files.end() && it->second.mtime == st.st_mtime && it->second.size == int64_t(st.st_size))
+					return{it->second.json};
+			}
 
-	//auto jstr = j.dump();
-	bool success = true;
-	vector<string> errors;
+			auto jo = readAndParseJsonFile(pathToFile);
+			if(jo.failure() || jo.result.is_null())
+				return{Json(), string("Couldn't include file with path: '") + pathToFile + "'!"};
+
+			lock_guard<mutex> lock(_mutex);
+			_files[pathToFile] = Entry{st.st_mtime, int64_t(st.st_size), jo.result};
+			return{jo.result};
+		}
+
+	private:
+		struct Entry
+		{
+			time_t mtime;
+			int64_t size;
+			Json json;
+		};
 
-	if(j.is_array() && j.array_items().size() > 0)
+		mutex _mutex;
+		map<string, Entry> _files;
+	};
+
+	IncludeFileCache& includeFileCache()
+	{
+		static IncludeFileCache cache;
+		return cache;
+	}
+
+	/*!
+	 * Resolves the references and functions of a JSON config in a single pass.
+	 * Nodes without references are shared with the input instead of being copied
+	 * and every reference is resolved only once per root.
+	 */
+	class Resolver
 	{
-		J11Array arr;
+	public:
+		Resolver(const Json& root, vector<IncludedFile>* includedFiles = nullptr)
+			: _root(root), _patterns(supportedPatterns()), _includedFiles(includedFiles) {}
 
-		bool arrayIsReferenceFunction = false;
-		if(j[0].is_string())
+		//! resolve j into res, returns false if j didn't change (res is then j itself)
+		bool resolve(const Json& j, Json& res)
 		{
-			auto p = sp.find(j[0].string_value());
-			if(p != sp.end())
+			if(j.is_array() && !j.array_items().empty())
 			{
-				arrayIsReferenceFunction = true;
-
-				//check for nested function invocations in the arguments
-				J11Array funcArr;
-				for(auto i : j.array_items())
+				const auto& arr = j.array_items();
+				if(arr[0].is_string())
 				{
-					auto r = findAndReplaceReferences(root, i);
-					success = success && r.success();
-					if(!r.success())
-						for(auto e : r.errors)
-							errors.push_back(e);
-					funcArr.push_back(r.result);
+					const auto& name = arr[0].string_value();
+					if(name == "ref")
+						return resolveRef(resolveArgs(arr), res), true;
+					if(name == "include-from-file")
+						return includeFile(resolveArgs(arr), res), true;
+					auto p = _patterns.find(name);
+					if(p != _patterns.end())
+						return invoke(p->second, resolveArgs(arr), res), true;
 				}
 
-				//invoke function
-				auto jaes = (p->second)(root, funcArr);
-
-				success = success && jaes.success();
-				if(!jaes.success())
-					for(auto e : jaes.errors)
-						errors.push_back(e);
-
-				//if successful try to recurse into result for functions in result
-				if(jaes.success())
+				J11Array resArr;
+				bool changed = false;
+				for(size_t i = 0; i < arr.size(); i++)
 				{
-					auto r = findAndReplaceReferences(root, jaes.result);
-					success = success && r.success();
-					if(!r.success())
-						for(auto e : r.errors)
-							errors.push_back(e);
-					return{r.result, errors};
+					Json r;
+					if(resolve(arr[i], r))
+					{
+						if(!changed)
+						{
+							resArr.reserve(arr.size());
+							resArr.assign(arr.begin(), arr.begin() + i);
+							changed = true;
+						}
+						resArr.push_back(r);
+					}
+					else if(changed)
+						resArr.push_back(arr[i]);
 				}
-				else
-					return{J11Object(), errors};
+				res = changed ? Json(resArr) : j;
+				return changed;
 			}
+			else if(j.is_object())
+			{
+				J11Object resObj;
+				bool changed = false;
+				for(const auto& p : j.object_items())
+				{
+					Json r;
+					if(resolve(p.second, r))
+					{
+						if(!changed)
+							resObj = j.object_items(), changed = true;
+						resObj[p.first] = r;
+					}
+				}
+				res = changed ? Json(resObj) : j;
+				return changed;
+			}
+
+			res = j;
+			return false;
 		}
 
-		if(!arrayIsReferenceFunction)
-			for(auto jv : j.array_items())
+		const vector<string>& errors() const { return _errors; }
+
+	private:
+		//! the arguments of a function with nested function invocations resolved
+		J11Array resolveArgs(const J11Array& arr)
+		{
+			J11Array args;
+			args.reserve(arr.size());
+			for(const auto& a : arr)
 			{
-				auto r = findAndReplaceReferences(root, jv);
-				success = success && r.success();
-				if(!r.success())
-					for(auto e : r.errors)
-						errors.push_back(e);
-				arr.push_back(r.result);
+				Json r;
+				resolve(a, r);
+				args.push_back(r);
 			}
+			return args;
+		}
 
-		return{arr, errors};
-	}
-	else if(j.is_object())
-	{
-		J11Object obj;
+		//! the result of a function is being resolved too, as it might contain references itself
+		void invoke(const PatternFunction& f, const J11Array& args, Json& res)
+		{
+			auto er = f(_root, args);
+			_errors.insert(_errors.end(), er.errors.begin(), er.errors.end());
+			if(er.success())
+				resolve(er.result, res);
+			else
+				res = J11Object();
+		}
 
-		for(auto p : j.object_items())
+		//! ["ref", key1, key2] -> root[key1][key2]
+		void resolveRef(const J11Array& args, Json& res)
 		{
-			auto r = findAndReplaceReferences(root, p.second);
-			success = success && r.success();
-			if(!r.success())
-				for(auto e : r.errors)
-					errors.push_back(e);
-			obj[p.first] = r.result;
+			if(args.size() == 3
+				 && args[1].is_string()
+				 && args[2].is_string())
+			{
+				auto key = make_pair(args[1].string_value(), args[2].string_value());
+				auto it = _refs.find(key);
+				if(it != _refs.end())
+				{
+					res = it->second;
+					return;
+				}
+
+				if(!_resolvingRefs.insert(key).second)
+				{
+					_errors.push_back(string("Circular reference: ") + Json(args).dump() + "!");
+					res = J11Object();
+					return;
+				}
+				resolve(_root[key.first][key.second], res);
+				_resolvingRefs.erase(key);
+				_refs[key] = res;
+				return;
+			}
+			_errors.push_back(string("Couldn't resolve reference: ") + Json(args).dump() + "!");
+			res = J11Object();
 		}
 
-		return{obj, errors};
-	}
+		//! ["include-from-file", path], relative paths are relative to the root's "include-file-base-path"
+		void includeFile(const J11Array& args, Json& res)
+		{
+			if(args.size() == 2
+				 && args[1].is_string())
+			{
+				string basePath = string_valueD(_root, "include-file-base-path", ".");
+				string pathToFile = args[1].string_value();
+				if(!isAbsolutePath(pathToFile))
+					pathToFile = basePath + "/" + pathToFile;
+				pathToFile = replaceEnvVars(pathToFile);
+				pathToFile = fixSystemSeparator(pathToFile);
+				IncludedFile includedFile;
+				auto er = includeFileCache().get(pathToFile, &includedFile);
+				if(er.success())
+				{
+					if(_includedFiles)
+						_includedFiles->push_back(includedFile);
+					resolve(er.result, res);
+					return;
+				}
+				_errors.insert(_errors.end(), er.errors.begin(), er.errors.end());
+			}
+			else
+				_errors.push_back(string("Couldn't include file with function: ") + Json(args).dump() + "!");
+			res = J11Object();
+		}
 
-	return{j, errors};
+		const Json& _root;
+		const map<string, PatternFunction>& _patterns;
+		vector<IncludedFile>* _includedFiles{nullptr};
+		map<pair<string, string>, Json> _refs;
+		set<pair<string, string>> _resolvingRefs;
+		vector<string> _errors;
+	};
 }
 
-//-----------------------------------------------------------------------------
+EResult<Json> Monica::findAndReplaceReferences(const Json& root, const Json& j, vector<IncludedFile>* includedFiles)
+{
+	Resolver resolver(root, includedFiles);
+	Json res;
+	resolver.resolve(j, res);
+	return{res, resolver.errors()};
+}
 
-const map<string, function<EResult<Json>(const Json&, const Json&)>>& supportedPatterns()
+bool Monica::includedFilesUnchanged(const vector<IncludedFile>& includedFiles)
 {
-	auto ref = [](const Json& root, const Json& j) -> EResult<Json>
+	for(const auto& f : includedFiles)
 	{
-		static map<pair<string, string>, EResult<Json>> cache;
-		if(j.array_items().size() == 3
-			 && j[1].is_string()
-			 && j[2].is_string())
-		{
-			string key1 = j[1].string_value();
-			string key2 = j[2].string_value();
-
-			auto it = cache.find(make_pair(key1, key2));
-			if(it != cache.end())
-				return it->second;
-			
-			auto res = findAndReplaceReferences(root, root[key1][key2]);
-			cache[make_pair(key1, key2)] = res;
-			return res;
-		}
-		return{j, string("Couldn't resolve reference: ") + j.dump() + "!"};
-	};
+		struct stat st;
+		if(stat(f.path.c_str(), &st) != 0 || int64_t(st.st_mtime) != f.mtime || int64_t(st.st_size) != f.size)
+			return false;
+	}
+	return true;
+}
 
+//-----------------------------------------------------------------------------
+
+const map<string, PatternFunction>& supportedPatterns()
+{
 	/*
 	auto fromDb = [](const Json&, const Json& j) -> EResult<Json>
 	{
@@ -298,29 +432,6 @@ const map<string, function<EResult<Json>(const Json&, const Json&)>>& supportedP
 	};
 	*/
 
-	auto fromFile = [](const Json& root, const Json& j) -> EResult<Json>
-	{
-		string error;
-
-		if(j.array_items().size() == 2
-		   && j[1].is_string())
-		{
-			string basePath = string_valueD(root, "include-file-base-path", ".");
-			string pathToFile = j[1].string_value();
-			if(!isAbsolutePath(pathToFile))
-				pathToFile = basePath + "/" + pathToFile;
-			pathToFile = replaceEnvVars(pathToFile);
-			pathToFile = fixSystemSeparator(pathToFile);
-			auto jo = readAndParseJsonFile(pathToFile);
-			if(jo.success() && !jo.result.is_null())
-				return{jo.result};
-			
-			return{j, string("Couldn't include file with path: '") + pathToFile + "'!"};
-		}
-
-		return{j, string("Couldn't include file with function: ") + j.dump() + "!"};
-	};
-
 	auto humus2corg = [](const Json&, const Json& j) -> EResult<Json>
 	{
 		if(j.array_items().size() == 2
@@ -395,10 +506,8 @@ const map<string, function<EResult<Json>(const Json&, const Json&)>>& supportedP
 		return{j, string("Couldn't convert percent to decimal percent value: ") + j.dump() + "!"};
 	};
 
-	static map<string, function<EResult<Json>(const Json&,const Json&)>> m{
+	static map<string, PatternFunction> m{
 			//{"include-from-db", fromDb},
-			{"include-from-file", fromFile},
-			{"ref", ref},
 			{"humus_st2corg", humus2corg},
 			{"humus-class->corg", humus2corg},
 			{"ld_eff2trd", bdc2rd},
@@ -424,6 +533,18 @@ Json Monica::createEnvJsonFromJsonStrings(std::map<std::string, std::string> par
 	return createEnvJsonFromJsonObjects(ps);
 }
 
+EResult<Json> Monica::resolveJsonConfig(Json j, const string& includeFileBasePath, vector<IncludedFile>* includedFiles)
+{
+	string err;
+	if(!j.has_shape({{"include-file-base-path", Json::STRING}}, err))
+	{
+		auto m = j.object_items();
+		m["include-file-base-path"] = includeFileBasePath;
+		j = m;
+	}
+	return findAndReplaceReferences(j, j, includedFiles);
+}
+
 Json Monica::createEnvJsonFromJsonObjects(std::map<std::string, json11::Json> params)
 {
 	vector<Json> cropSiteSim;
@@ -436,24 +557,12 @@ Json Monica::createEnvJsonFromJsonObjects(std::map<std::string, json11::Json> pa
 
 	string pathToParameters = cropSiteSim.at(2)["include-file-base-path"].string_value();
 
-	auto addBasePath = [&](Json& j, string basePath)
-	{
-		string err;
-		if(!j.has_shape({{"include-file-base-path", Json::STRING}}, err))
-		{
-			auto m = j.object_items();
-			m["include-file-base-path"] = pathToParameters;
-			j = m;
-		}
-	};
-
 	vector<Json> cropSiteSim2;
 	//collect all errors in all files and don't stop as early as possible
 	set<string> errors;
 	for(auto& j : cropSiteSim)
 	{
-		addBasePath(j, pathToParameters);
-		auto r = findAndReplaceReferences(j, j);
+		auto r = resolveJsonConfig(j, pathToParameters);
 		if(r.success())
 			cropSiteSim2.push_back(r.result);
 		else
@@ -467,15 +576,33 @@ Json Monica::createEnvJsonFromJsonObjects(std::map<std::string, json11::Json> pa
 		return Json();
 	}
 
-	auto cropj = cropSiteSim2.at(0);
-	auto sitej = cropSiteSim2.at(1);
-	auto simj = cropSiteSim2.at(2);
+	return createEnvJsonFromResolvedJsonObjects(cropSiteSim2.at(0), cropSiteSim2.at(1), cropSiteSim2.at(2));
+}
 
+Json Monica::createEnvJsonFromResolvedJsonObjects(const Json& cropj,
+																									const Json& sitej,
+																									const Json& simj,
+																									bool readClimateData)
+{
 	J11Object env;
 	env["type"] = "Env";
 
 	//store debug mode in env, take from sim.json, but prefer params map
 	env["debugMode"] = simj["debug?"].bool_value();
+	env["profile"] = simj["profile?"].bool_value();
+	env["memoryStats"] = simj["memory-stats?"].bool_value();
+
+	//write checkpoints of the run at the given date(s) and/or start from a previously written checkpoint
+	if(simj["checkpoint-at"].is_string())
+		env["checkpointAt"] = J11Array{simj["checkpoint-at"]};
+	else if(simj["checkpoint-at"].is_array())
+		env["checkpointAt"] = simj["checkpoint-at"];
+	env["pathToCheckpoints"] = simj["path-to-checkpoints"].is_string() 
+		? simj["path-to-checkpoints"].string_value() 
+		: simj["output"]["path-to-output"].string_value();
+	env["startFromCheckpoint"] = simj["start-from-checkpoint"].string_value();
+	env["spinUpUntil"] = simj["spin-up-until"].string_value();
+	env["pathToSpinUpCache"] = simj["path-to-spin-up-cache"].string_value();
 
 	J11Object cpp = {
 			{"type", "CentralParameterProvider"}
@@ -499,6 +626,10 @@ Json Monica::createEnvJsonFromJsonObjects(std::map<std::string, json11::Json> pa
 	auto csvos = simj["climate.csv-options"].object_items();
 	csvos["latitude"] = double_valueD(sitej["SiteParameters"], "Latitude", 0.0);
 	env["csvViaHeaderOptions"] = csvos;
+
+	//else the climate data are being read when running the env (from pathToClimateCSV)
+	if(!readClimateData)
+		return env;
 		
 	if(simj["climate.csv"].is_string() && !simj["climate.csv"].string_value().empty())
 		env["climateData"] = printPossibleErrors(readClimateDataFromCSVFileViaHeaders(simj["climate.csv"].string_value(),
@@ -17,6 +17,8 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 #define MONICA_ENV_JSON_FROM_JSON_CONFIG_H
 
 #include <string>
+#include <vector>
+#include <cstdint>
 
 #include "tools/date.h"
 #include "run-monica.h"
@@ -25,12 +27,38 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 
 namespace Monica
 {
+	//! a file included via "include-from-file", with its modification time and size when it was read
+	struct IncludedFile
+	{
+		std::string path;
+		std::int64_t mtime{0};
+		std::int64_t size{0};
+	};
+
+	//! the files included while resolving are appended to includedFiles (if given)
 	Tools::EResult<json11::Json> findAndReplaceReferences(const json11::Json& root, 
-																												const json11::Json& j);
+																												const json11::Json& j,
+																												std::vector<IncludedFile>* includedFiles = nullptr);
 
   json11::Json createEnvJsonFromJsonStrings(std::map<std::string, std::string> params);
 
   json11::Json createEnvJsonFromJsonObjects(std::map<std::string, json11::Json> params);
+
+	//! resolve the references and functions of a sim/crop/site.json, includeFileBasePath is used
+	//! for "include-from-file" if j doesn't define its own "include-file-base-path",
+	//! the files included while resolving are appended to includedFiles (if given)
+	Tools::EResult<json11::Json> resolveJsonConfig(json11::Json j, const std::string& includeFileBasePath,
+																								 std::vector<IncludedFile>* includedFiles = nullptr);
+
+	//! are the files still unchanged on disk, so a config including them would be resolved to the same result
+	bool includedFilesUnchanged(const std::vector<IncludedFile>& includedFiles);
+
+	//! the Env JSON of already resolved crop/site/sim.json objects,
+	//! if readClimateData is false the climate data are left to be read when running the env
+	json11::Json createEnvJsonFromResolvedJsonObjects(const json11::Json& crop,
+																										const json11::Json& site,
+																										const json11::Json& sim,
+																										bool readClimateData = true);
 }
 
 #endif //MONICA_ENV_FROM_JSON_H
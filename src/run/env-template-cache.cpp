@@ -0,0 +1,254 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+Authors:
+Michael Berg <michael.berg@zalf.de>
+
+Maintainers:
+Currently maintained by the authors.
+
+This file is part of the MONICA model.
+Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
+*/
+
+#include <set>
+#include <algorithm>
+
+#include "env-template-cache.h"
+
+using namespace Monica;
+using namespace Tools;
+using namespace json11;
+using namespace std;
+
+Json Monica::applyMergePatch(const Json& target, const Json& patch)
+{
+	if(!patch.is_object())
+		return patch;
+
+	J11Object res = target.is_object() ? target.object_items() : J11Object();
+	for(const auto& p : patch.object_items())
+	{
+		if(p.second.is_null())
+			res.erase(p.first);
+		else
+		{
+			auto it = res.find(p.first);
+			res[p.first] = applyMergePatch(it == res.end() ? Json() : it->second, p.second);
+		}
+	}
+	return res;
+}
+
+//-----------------------------------------------------------------------------
+
+namespace
+{
+	//! merge j into a fresh T, as Env::merge does, and replace t by it
+	template<typename T>
+	Errors mergeFresh(T& t, const Json& j)
+	{
+		T fresh;
+		auto es = fresh.merge(j);
+		t = fresh;
+		return es;
+	}
+
+	EResult<Env> toEResult(const Env& env, const Errors& es)
+	{
+		EResult<Env> res{env, es.errors};
+		res.warnings = es.warnings;
+		return res;
+	}
+
+	template<typename Vector>
+	Errors extractAndStore(const Json& jv, Vector& vec)
+	{
+		Errors es;
+		vec.clear();
+		for(const auto& j : jv.array_items())
+		{
+			typename Vector::value_type v;
+			es.append(v.merge(j));
+			vec.push_back(v);
+		}
+		return es;
+	}
+
+	//! the top level keys of an Env delta, which can be applied to the already parsed template
+	const set<string>& incrementalKeys()
+	{
+		static const set<string> keys
+		{"type", "params", "climateData", "climateCSV", "pathToClimateCSV", "csvViaHeaderOptions"
+		, "customId", "sharedId", "debugMode", "profile", "memoryStats", "events", "outputs", "cropRotation", "cropRotations"};
+		return keys;
+	}
+}
+
+Errors EnvTemplateCache::registerTemplate(const string& id, Json envJson)
+{
+	auto t = make_shared<Template>();
+	t->json = envJson;
+	auto es = t->env.merge(envJson);
+
+	lock_guard<mutex> lock(_mutex);
+	if(_templates.find(id) == _templates.end() && _maxNoOfTemplates > 0 && _templates.size() >= _maxNoOfTemplates)
+	{
+		auto lru = min_element(_templates.begin(), _templates.end(), [](const auto& l, const auto& r)
+		{
+			return l.second.second < r.second.second;
+		});
+		_templates.erase(lru);
+	}
+	_templates[id] = make_pair(t, ++_useCount);
+
+	return es;
+}
+
+Errors EnvTemplateCache::registerIfUnknown(const string& id, const Json& msg)
+{
+	if(!msg["env"].is_object() || hasTemplate(id))
+		return Errors();
+	return registerTemplate(id, msg["env"]);
+}
+
+bool EnvTemplateCache::removeTemplate(const string& id)
+{
+	lock_guard<mutex> lock(_mutex);
+	return _templates.erase(id) > 0;
+}
+
+bool EnvTemplateCache::hasTemplate(const string& id) const
+{
+	lock_guard<mutex> lock(_mutex);
+	return _templates.find(id) != _templates.end();
+}
+
+size_t EnvTemplateCache::size() const
+{
+	lock_guard<mutex> lock(_mutex);
+	return _templates.size();
+}
+
+string EnvTemplateCache::templateId(const Json& msg)
+{
+	if(msg["templateId"].is_string())
+		return msg["templateId"].string_value();
+	if(msg["sharedId"].is_string())
+		return msg["sharedId"].string_value();
+	return msg["env"]["sharedId"].string_value();
+}
+
+EResult<Env> EnvTemplateCache::createEnv(const string& id, const Json& delta)
+{
+	shared_ptr<const Template> t;
+	{
+		lock_guard<mutex> lock(_mutex);
+		auto it = _templates.find(id);
+		if(it == _templates.end())
+			return{Env(), string("Unknown env template '") + id + "'!"};
+		it->second.second = ++_useCount;
+		t = it->second.first;
+	}
+
+	if(!delta.is_null() && !delta.is_object())
+		return{Env(), string("Delta for env template '") + id + "' is not a JSON object!"};
+
+	bool incremental = true;
+	for(const auto& p : delta.object_items())
+	{
+		if(incrementalKeys().count(p.first) == 0
+			 || (p.first == "params" && !p.second.is_object()))
+		{
+			incremental = false;
+			break;
+		}
+	}
+
+	//everything else is rare enough to merge into the template and create the Env from scratch
+	if(!incremental)
+	{
+		Env env;
+		auto es = env.merge(applyMergePatch(t->json, delta));
+		return toEResult(env, es);
+	}
+
+	Env env = t->env;
+	Errors es;
+	bool copyCropRotation = true, copyCropRotations = true;
+
+	for(const auto& p : delta.object_items())
+	{
+		const auto& key = p.first;
+		if(key == "type")
+			continue;
+
+		if(key == "params")
+		{
+			auto& ps = env.params;
+			for(const auto& sp : p.second.object_items())
+			{
+				auto j = applyMergePatch(t->json["params"][sp.first], sp.second);
+				if(sp.first == "userCropParameters") es.append(mergeFresh(ps.userCropParameters, j));
+				else if(sp.first == "userEnvironmentParameters") es.append(mergeFresh(ps.userEnvironmentParameters, j));
+				else if(sp.first == "userSoilMoistureParameters") es.append(mergeFresh(ps.userSoilMoistureParameters, j));
+				else if(sp.first == "userSoilTemperatureParameters") es.append(mergeFresh(ps.userSoilTemperatureParameters, j));
+				else if(sp.first == "userSoilTransportParameters") es.append(mergeFresh(ps.userSoilTransportParameters, j));
+				else if(sp.first == "userSoilOrganicParameters") es.append(mergeFresh(ps.userSoilOrganicParameters, j));
+				else if(sp.first == "simulationParameters") es.append(mergeFresh(ps.simulationParameters, j));
+				else if(sp.first == "siteParameters") es.append(mergeFresh(ps.siteParameters, j));
+			}
+			continue;
+		}
+
+		auto j = applyMergePatch(t->json[key], p.second);
+		if(key == "climateData")
+			es.append(mergeFresh(env.climateData, j));
+		else if(key == "climateCSV")
+			env.climateCSV = j.string_value();
+		else if(key == "pathToClimateCSV")
+		{
+			env.pathsToClimateCSV.clear();
+			if(j.is_string() && !j.string_value().empty())
+				env.pathsToClimateCSV.push_back(j.string_value());
+			else if(j.is_array())
+				for(auto path : toStringVector(j.array_items()))
+					if(!path.empty())
+						env.pathsToClimateCSV.push_back(path);
+		}
+		else if(key == "csvViaHeaderOptions")
+			env.csvViaHeaderOptions = j;
+		else if(key == "customId")
+			env.customId = j;
+		else if(key == "sharedId")
+			env.sharedId = j.string_value();
+		else if(key == "debugMode")
+			env.debugMode = j.bool_value();
+		else if(key == "profile")
+			env.profile = j.bool_value();
+		else if(key == "memoryStats")
+			env.memoryStats = j.bool_value();
+		else if(key == "events")
+			env.events = j;
+		else if(key == "outputs")
+			env.outputs = j;
+		else if(key == "cropRotation")
+			es.append(extractAndStore(j, env.cropRotation)), copyCropRotation = false;
+		else if(key == "cropRotations")
+			es.append(extractAndStore(j, env.cropRotations)), copyCropRotations = false;
+	}
+
+	//worksteps and crops keep state while running, so every env needs its own ones
+	map<const Crop*, CropPtr> cropCopies;
+	if(copyCropRotation)
+		for(auto& cm : env.cropRotation)
+			cm = cm.deepCopy(cropCopies);
+	if(copyCropRotations)
+		for(auto& cr : env.cropRotations)
+			for(auto& cm : cr.cropRotation)
+				cm = cm.deepCopy(cropCopies);
+
+	return toEResult(env, es);
+}
@@ -0,0 +1,90 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+Authors:
+Michael Berg <michael.berg@zalf.de>
+
+Maintainers:
+Currently maintained by the authors.
+
+This file is part of the MONICA model.
+Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
+*/
+
+#ifndef MONICA_ENV_TEMPLATE_CACHE_H_
+#define MONICA_ENV_TEMPLATE_CACHE_H_
+
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+#include "json11/json11.hpp"
+#include "json11/json11-helper.h"
+#include "run-monica.h"
+
+namespace Monica
+{
+	//! apply a JSON merge patch (RFC 7396) to target
+	json11::Json applyMergePatch(const json11::Json& target, const json11::Json& patch);
+
+	/*!
+	 * Parsed base Envs (templates) of the servers, so that jobs only have to carry a delta against them.
+	 *
+	 * Messages understood by the servers:
+	 *   {"type": "EnvTemplate", "templateId": "grid-1", "env": {...full Env...}} -> register (or replace) template
+	 *   {"type": "EnvTemplate", "templateId": "grid-1", "env": null}              -> remove template
+	 *   {"type": "EnvDelta", "templateId": "grid-1", "delta": {...merge patch...}} -> run template patched by delta
+	 * If templateId is missing the sharedId of the env/message is used.
+	 *
+	 * Templates are registered per server process. Behind a proxy or after a worker restart a delta may reach
+	 * a server not knowing its template, it is answered with an Output carrying "unknownTemplateId",
+	 * so that the client can send the job again with the template as "env" of the "EnvDelta" (or "EnvBatch") message,
+	 * which servers not knowing the template register before running the delta (see registerIfUnknown).
+	 *
+	 * Deltas touching only the frequently changing parts (params sections, climate data/references,
+	 * customId, sharedId, events, outputs) reuse the parsed template and parse just these parts,
+	 * other deltas are merged into the template JSON and parsed completely.
+	 */
+	class EnvTemplateCache
+	{
+	public:
+		EnvTemplateCache(std::size_t maxNoOfTemplates = 64) : _maxNoOfTemplates(maxNoOfTemplates) {}
+
+		//! parse envJson and store it under id, the least recently used template is dropped if the cache is full
+		Tools::Errors registerTemplate(const std::string& id, json11::Json envJson);
+
+		//! register the template "env" carried by an "EnvDelta" or "EnvBatch" message, if id is not known yet
+		Tools::Errors registerIfUnknown(const std::string& id, const json11::Json& msg);
+
+		bool removeTemplate(const std::string& id);
+
+		bool hasTemplate(const std::string& id) const;
+
+		std::size_t size() const;
+
+		//! an Env of the template id patched by delta, the Env has its own worksteps and crops,
+		//! so it can be run in parallel to other Envs created from the same template
+		Tools::EResult<Env> createEnv(const std::string& id, const json11::Json& delta);
+
+		//! the template id of an "EnvTemplate" or "EnvDelta" message
+		static std::string templateId(const json11::Json& msg);
+
+	private:
+		struct Template
+		{
+			json11::Json json;
+			Env env;
+		};
+
+		std::size_t _maxNoOfTemplates{64};
+		mutable std::mutex _mutex;
+		std::map<std::string, std::pair<std::shared_ptr<const Template>, std::uint64_t>> _templates;
+		std::uint64_t _useCount{0};
+	};
+}
+
+#endif //MONICA_ENV_TEMPLATE_CACHE_H_
@@ -0,0 +1,145 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+Authors:
+Michael Berg <michael.berg@zalf.de>
+
+Maintainers:
+Currently maintained by the authors.
+
+This file is part of the MONICA model.
+Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
+*/
+
+#ifndef MONICA_FAIR_SHARE_QUEUE_H_
+#define MONICA_FAIR_SHARE_QUEUE_H_
+
+#include <string>
+#include <deque>
+#include <list>
+#include <map>
+#include <utility>
+#include <algorithm>
+#include <cstring>
+
+#include "json11/json11.hpp"
+
+namespace Monica
+{
+	//! the scheduling class of a job
+	struct JobClass
+	{
+		std::string tenant;
+		bool interactive{false};
+	};
+
+	//! the scheduling class of a job message (Env, EnvDelta, EnvBatch),
+	//! "priority": "interactive" | "high" | number > 0 marks interactive jobs,
+	//! "tenant" the tenant bulk jobs are being shared between, jobs without one share the default tenant
+	//! (sharedId or templateId identify templates and routes, a tenant may use many of them)
+	inline JobClass jobClassOf(const json11::Json& msg)
+	{
+		JobClass jc;
+		const auto& p = msg["priority"];
+		jc.interactive = p.is_number() ? p.number_value() > 0
+			: p.string_value() == "interactive" || p.string_value() == "high";
+		jc.tenant = msg["tenant"].string_value();
+		return jc;
+	}
+
+	//! true if the (JSON or binary JSON) job message might contain scheduling fields at all,
+	//! so that messages without them don't have to be parsed
+	inline bool mayHaveJobClass(const char* msg, std::size_t size)
+	{
+		auto contains = [=](const char* word)
+		{
+			return std::search(msg, msg + size, word, word + std::strlen(word)) != msg + size;
+		};
+		return contains("priority") || contains("tenant");
+	}
+
+	/*!
+	 * Queue of jobs in two scheduling classes: interactive jobs are always taken first (in order of arrival),
+	 * bulk jobs are shared between the tenants by deficit round robin, every tenant may take
+	 * weight (default 1) jobs per round. With a single tenant this is a plain FIFO queue.
+	 */
+	template<typename T>
+	class FairShareQueue
+	{
+	public:
+		void setWeight(const std::string& tenant, int weight) { _tenants[tenant].weight = std::max(1, weight); }
+
+		void push(T job, const JobClass& jc) { add(std::move(job), jc, false); }
+
+		//! put a job back to the front of its queue, e.g. to retry it
+		void pushFront(T job, const JobClass& jc) { add(std::move(job), jc, true); }
+
+		bool empty() const { return _size == 0; }
+
+		std::size_t size() const { return _size; }
+
+		std::size_t noOfInteractiveJobs() const { return _interactive.size(); }
+
+		std::size_t noOfTenants() const { return _active.size(); }
+
+		//! take the next job, the queue must not be empty
+		T pop()
+		{
+			_size--;
+			if(!_interactive.empty())
+			{
+				T job = std::move(_interactive.front());
+				_interactive.pop_front();
+				return job;
+			}
+
+			auto& t = _tenants[_active.front()];
+			//a new turn of the tenant at the head of the round
+			if(t.deficit < 1)
+				t.deficit += t.weight;
+			T job = std::move(t.jobs.front());
+			t.jobs.pop_front();
+			t.deficit--;
+			if(t.jobs.empty())
+			{
+				t.deficit = 0;
+				_active.pop_front();
+			}
+			else if(t.deficit < 1)
+				_active.splice(_active.end(), _active, _active.begin());
+			return job;
+		}
+
+	private:
+		void add(T&& job, const JobClass& jc, bool atFront)
+		{
+			_size++;
+			if(jc.interactive)
+			{
+				atFront ? _interactive.push_front(std::move(job)) : _interactive.push_back(std::move(job));
+				return;
+			}
+
+			auto& t = _tenants[jc.tenant];
+			if(t.jobs.empty())
+				_active.push_back(jc.tenant);
+			atFront ? t.jobs.push_front(std::move(job)) : t.jobs.push_back(std::move(job));
+		}
+
+		struct Tenant
+		{
+			std::deque<T> jobs;
+			int weight{1};
+			int deficit{0};
+		};
+
+		std::deque<T> _interactive;
+		std::map<std::string, Tenant> _tenants;
+		std::list<std::string> _active; //!< tenants with jobs, in round robin order
+		std::size_t _size{0};
+	};
+}
+
+#endif //MONICA_FAIR_SHARE_QUEUE_H_
@@ -0,0 +1,294 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+Authors:
+Michael Berg <michael.berg@zalf.de>
+
+Maintainers:
+Currently maintained by the authors.
+
+This file is part of the MONICA model.
+Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
+*/
+
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <thread>
+#include <cstring>
+
+#ifdef WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET socket_handle;
+#define closeSocket closesocket
+#define isValidSocket(s) ((s) != INVALID_SOCKET)
+#define sendFlags 0
+#else
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+typedef int socket_handle;
+#define closeSocket close
+#define isValidSocket(s) ((s) >= 0)
+//a client closing the connection early must not kill the process by SIGPIPE
+#ifdef MSG_NOSIGNAL
+#define sendFlags MSG_NOSIGNAL
+#else
+#define sendFlags 0
+#endif
+#endif
+
+#include "metrics.h"
+#include "json11/json11-helper.h"
+
+using namespace Monica;
+using namespace Tools;
+using namespace json11;
+using namespace std;
+
+namespace
+{
+	const vector<double> defaultSecondsBuckets =
+	{0.001, 0.005, 0.01, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60, 300};
+
+	string formatValue(double v)
+	{
+		ostringstream oss;
+		oss.precision(12);
+		oss << v;
+		return oss.str();
+	}
+
+	string withLabels(const string& name, const string& labels, const string& extraLabel = string())
+	{
+		if(labels.empty() && extraLabel.empty())
+			return name;
+		return name + "{" + labels + (!labels.empty() && !extraLabel.empty() ? "," : "") + extraLabel + "}";
+	}
+}
+
+MetricsRegistry& Monica::metrics()
+{
+	static MetricsRegistry registry;
+	return registry;
+}
+
+string Monica::label(const string& key, const string& value)
+{
+	string escaped;
+	for(auto c : value)
+	{
+		if(c == '\\' || c == '"')
+			escaped += '\\';
+		if(c == '\n')
+			escaped += "\\n";
+		else
+			escaped += c;
+	}
+	return key + "=\"" + escaped + "\"";
+}
+
+void Monica::describeJobMetrics(MetricsRegistry& m)
+{
+	m.describe("monica_jobs_received_total", "counter", "Jobs (envs) received, the envs of a batch count individually.");
+	m.describe("monica_jobs_completed_total", "counter", "Jobs run without errors.");
+	m.describe("monica_jobs_failed_total", "counter", "Jobs with errors.");
+	m.describe("monica_jobs_in_progress", "gauge", "Jobs received but not yet answered.");
+	m.describe("monica_job_phase_seconds", "histogram",
+						 "Seconds spent per job in the phases receive, parse, create-env, climate-load, simulate, serialize and send.");
+	m.describe("monica_result_bytes", "histogram", "Size of the serialized results.");
+	m.setBuckets("monica_result_bytes", {1e3, 1e4, 1e5, 1e6, 1e7, 1e8});
+	m.describe("monica_busy_seconds_total", "counter",
+						 "Seconds spent running jobs, the rate divided by the number of running threads is the utilisation.");
+}
+
+void MetricsRegistry::describe(const string& name, const string& type, const string& help)
+{
+	lock_guard<mutex> lock(_mutex);
+	auto& f = _families[name];
+	f.type = type;
+	f.help = help;
+}
+
+void MetricsRegistry::setBuckets(const string& name, vector<double> upperBounds)
+{
+	sort(upperBounds.begin(), upperBounds.end());
+	lock_guard<mutex> lock(_mutex);
+	auto& f = _families[name];
+	f.buckets = upperBounds;
+	f.histograms.clear();
+}
+
+void MetricsRegistry::inc(const string& name, double value, const string& labels)
+{
+	lock_guard<mutex> lock(_mutex);
+	_families[name].values[labels] += value;
+}
+
+void MetricsRegistry::set(const string& name, double value, const string& labels)
+{
+	lock_guard<mutex> lock(_mutex);
+	_families[name].values[labels] = value;
+}
+
+void MetricsRegistry::observe(const string& name, double value, const string& labels)
+{
+	lock_guard<mutex> lock(_mutex);
+	auto& f = _families[name];
+	if(f.buckets.empty())
+		f.buckets = defaultSecondsBuckets;
+	auto& h = f.histograms[labels];
+	if(h.counts.empty())
+		h.counts.resize(f.buckets.size() + 1);
+	auto bucket = size_t(lower_bound(f.buckets.begin(), f.buckets.end(), value) - f.buckets.begin());
+	h.counts[bucket]++;
+	h.sum += value;
+	h.count++;
+}
+
+string MetricsRegistry::toPrometheusText() const
+{
+	lock_guard<mutex> lock(_mutex);
+	ostringstream oss;
+	for(const auto& p : _families)
+	{
+		const auto& name = p.first;
+		const auto& f = p.second;
+		if(!f.help.empty())
+			oss << "# HELP " << name << " " << f.help << "\n";
+		oss << "# TYPE " << name << " " << f.type << "\n";
+
+		for(const auto& v : f.values)
+			oss << withLabels(name, v.first) << " " << formatValue(v.second) << "\n";
+
+		for(const auto& hp : f.histograms)
+		{
+			const auto& h = hp.second;
+			uint64_t cumulative = 0;
+			for(size_t i = 0; i < f.buckets.size(); i++)
+			{
+				cumulative += h.counts[i];
+				oss << withLabels(name + "_bucket", hp.first, label("le", formatValue(f.buckets[i]))) << " " << cumulative << "\n";
+			}
+			oss << withLabels(name + "_bucket", hp.first, label("le", "+Inf")) << " " << h.count << "\n";
+			oss << withLabels(name + "_sum", hp.first) << " " << formatValue(h.sum) << "\n";
+			oss << withLabels(name + "_count", hp.first) << " " << h.count << "\n";
+		}
+	}
+	return oss.str();
+}
+
+Json MetricsRegistry::to_json() const
+{
+	lock_guard<mutex> lock(_mutex);
+	J11Object res;
+	for(const auto& p : _families)
+	{
+		const auto& f = p.second;
+		J11Object vs;
+		for(const auto& v : f.values)
+			vs[v.first] = v.second;
+		for(const auto& hp : f.histograms)
+		{
+			J11Array counts;
+			for(auto c : hp.second.counts)
+				counts.push_back(double(c));
+			vs[hp.first] = J11Object
+			{{"buckets", toPrimJsonArray(f.buckets)}
+			,{"counts", counts}
+			,{"sum", hp.second.sum}
+			,{"count", double(hp.second.count)}
+			};
+		}
+		res[p.first] = vs;
+	}
+	return res;
+}
+
+//-----------------------------------------------------------------------------
+
+double MetricsTimer::stop()
+{
+	if(!_stopped)
+	{
+		_stopped = true;
+		_seconds = chrono::duration<double>(chrono::steady_clock::now() - _start).count();
+		_registry.observe(_name, _seconds, _labels);
+	}
+	return _seconds;
+}
+
+//-----------------------------------------------------------------------------
+
+bool Monica::serveMetricsHttp(int port, const string& address, MetricsRegistry& registry)
+{
+#ifdef WIN32
+	WSADATA wsaData;
+	if(WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+		return false;
+#endif
+
+	socket_handle listener = socket(AF_INET, SOCK_STREAM, 0);
+	if(!isValidSocket(listener))
+		return false;
+	int yes = 1;
+	setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&yes, sizeof(yes));
+
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	if(address == "*")
+		addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	else if(inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1)
+	{
+		cerr << "Invalid metrics endpoint address: " << address << "!" << endl;
+		closeSocket(listener);
+		return false;
+	}
+	addr.sin_port = htons(uint16_t(port));
+	if(::bind(listener, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, 8) != 0)
+	{
+		cerr << "Couldn't bind metrics endpoint to " << address << ":" << port << "!" << endl;
+		closeSocket(listener);
+		return false;
+	}
+
+	//every request (whatever path) gets the metrics, the connection is closed afterwards
+	thread([listener, &registry]()
+	{
+		while(true)
+		{
+			socket_handle client = accept(listener, nullptr, nullptr);
+			if(!isValidSocket(client))
+				continue;
+
+			char buf[4096];
+			recv(client, buf, sizeof(buf), 0);
+
+			auto body = registry.toPrometheusText();
+			ostringstream oss;
+			oss
+				<< "HTTP/1.0 200 OK\r\n"
+				<< "Content-Type: text/plain; version=0.0.4\r\n"
+				<< "Content-Length: " << body.size() << "\r\n"
+				<< "Connection: close\r\n\r\n"
+				<< body;
+			auto response = oss.str();
+			for(size_t sent = 0; sent < response.size();)
+			{
+				auto n = send(client, response.data() + sent, int(response.size() - sent), sendFlags);
+				if(n <= 0)
+					break;
+				sent += size_t(n);
+			}
+			closeSocket(client);
+		}
+	}).detach();
+
+	return true;
+}
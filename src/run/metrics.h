@@ -0,0 +1,118 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+Authors:
+Michael Berg <michael.berg@zalf.de>
+
+Maintainers:
+Currently maintained by the authors.
+
+This file is part of the MONICA model.
+Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
+*/
+
+#ifndef MONICA_METRICS_H_
+#define MONICA_METRICS_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+#include "json11/json11.hpp"
+
+namespace Monica
+{
+	/*!
+	 * Thread safe registry of counters, gauges and histograms of a MONICA server or proxy.
+	 * Metrics are identified by name and an optional label string in Prometheus syntax (e.g. phase="simulate"),
+	 * use label() to create it.
+	 */
+	class MetricsRegistry
+	{
+	public:
+		//! set the Prometheus type ("counter", "gauge", "histogram") and help text of the metric name
+		void describe(const std::string& name, const std::string& type, const std::string& help);
+
+		//! the upper bounds of the buckets of histogram name, default are buckets for seconds
+		void setBuckets(const std::string& name, std::vector<double> upperBounds);
+
+		void inc(const std::string& name, double value = 1.0, const std::string& labels = std::string());
+
+		void set(const std::string& name, double value, const std::string& labels = std::string());
+
+		void observe(const std::string& name, double value, const std::string& labels = std::string());
+
+		//! all metrics in Prometheus text exposition format (version 0.0.4)
+		std::string toPrometheusText() const;
+
+		json11::Json to_json() const;
+
+	private:
+		struct Histogram
+		{
+			std::vector<std::uint64_t> counts; //!< per bucket, not cumulative
+			double sum{0};
+			std::uint64_t count{0};
+		};
+
+		struct Family
+		{
+			std::string type{"untyped"};
+			std::string help;
+			std::vector<double> buckets;
+			std::map<std::string, double> values;
+			std::map<std::string, Histogram> histograms;
+		};
+
+		mutable std::mutex _mutex;
+		std::map<std::string, Family> _families;
+	};
+
+	//! the metrics of this process
+	MetricsRegistry& metrics();
+
+	//! describe the job metrics of the MONICA servers: monica_jobs_{received,completed,failed}_total,
+	//! monica_jobs_in_progress, monica_job_phase_seconds{phase=...}, monica_result_bytes and monica_busy_seconds_total
+	void describeJobMetrics(MetricsRegistry& registry = metrics());
+
+	//! a label string key="value" (value escaped), to be joined by commas for multiple labels
+	std::string label(const std::string& key, const std::string& value);
+
+	//! observes the seconds from construction until stop() (or destruction) in histogram name
+	class MetricsTimer
+	{
+	public:
+		MetricsTimer(std::string name, std::string labels = std::string(), MetricsRegistry& registry = metrics())
+			: _registry(registry), _name(name), _labels(labels), _start(std::chrono::steady_clock::now()) {}
+
+		~MetricsTimer() { stop(); }
+
+		//! observe the elapsed seconds (just once) and return them
+		double stop();
+
+	private:
+		MetricsRegistry& _registry;
+		std::string _name;
+		std::string _labels;
+		std::chrono::steady_clock::time_point _start;
+		bool _stopped{false};
+		double _seconds{0};
+	};
+
+	//! the interface the metrics endpoint is bound to by default, use "*" to expose it on all interfaces
+	const std::string defaultMetricsAddress = "127.0.0.1";
+
+	//! serve the registry's metrics as Prometheus text via HTTP on address:port in a background thread,
+	//! address is an IPv4 address or "*" for all interfaces,
+	//! returns false if the address is invalid or the port couldn't be bound
+	bool serveMetricsHttp(int port,
+												const std::string& address = defaultMetricsAddress,
+												MetricsRegistry& registry = metrics());
+}
+
+#endif //MONICA_METRICS_H_
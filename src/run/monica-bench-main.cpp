@@ -0,0 +1,390 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+Authors:
+Michael Berg <michael.berg@zalf.de>
+
+Maintainers:
+Currently maintained by the authors.
+
+This file is part of the MONICA model.
+Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
+*/
+
+#include <cstdlib>
+#include <cstdio>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <ctime>
+
+#include "json11/json11.hpp"
+
+#include "tools/helper.h"
+#include "tools/algorithms.h"
+#include "tools/debug.h"
+#include "../run/run-monica.h"
+#include "json11/json11-helper.h"
+#include "scenario-setup.h"
+#include "../core/memory-accounting.h"
+#include "db/abstract-db-connections.h"
+#include "../resource/version.h"
+
+using namespace std;
+using namespace Monica;
+using namespace Tools;
+using namespace json11;
+
+string appName = "monica-bench";
+string version = "1.0.0";
+
+namespace
+{
+	//! a modification of the setup and the number of years to tile the climate data to (0 = as is)
+	struct Scenario
+	{
+		string name;
+		string description;
+		function<void(ScenarioSetup&)> modify;
+		int noOfYears{0};
+		function<void(Env&)> modifyEnv;
+	};
+
+	//! the output ids of the setup's daily outputs (without text outputs), repeated until there are noOfOutputs
+	J11Array outputIds(const ScenarioSetup& setup, size_t noOfOutputs)
+	{
+		J11Array base;
+		const auto& events = setup.sim["output"]["events"].array_items();
+		for(size_t i = 0; i + 1 < events.size(); i += 2)
+		{
+			if(events[i].string_value() != "daily")
+				continue;
+			for(const auto& oid : events[i + 1].array_items())
+			{
+				auto name = oid.is_array() ? oid[0].string_value() : oid.string_value();
+				if(name != "Date" && name != "Crop")
+					base.push_back(oid);
+			}
+		}
+
+		J11Array oids;
+		for(size_t i = 0; !base.empty() && oids.size() < noOfOutputs; i++)
+			oids.push_back(base[i % base.size()]);
+		return oids;
+	}
+
+	void setEvents(ScenarioSetup& setup, const string& event, const J11Array& oids)
+	{
+		setup.sim = withValue(setup.sim, "output", withValue(setup.sim["output"], "events", J11Array{event, oids}));
+	}
+
+	vector<Scenario> scenarios()
+	{
+		vector<Scenario> ss;
+
+		ss.push_back({"hohenfinow2", "the setup as is", [](ScenarioSetup&) {}});
+
+		//the crop rotations of the setup are limited to its years, so use the cyclic rotation
+		for(int years : {30, 100, 300})
+		{
+			ss.push_back({"climate-tiled/" + to_string(years) + "y", "climate data tiled to " + to_string(years) + " years",
+				[](ScenarioSetup& s) { s.crop = withoutKey(s.crop, "cropRotations"); }, years});
+		}
+
+		for(size_t n : {10, 50, 150})
+		{
+			ss.push_back({"outputs/daily/" + to_string(n), to_string(n) + " daily outputs",
+				[n](ScenarioSetup& s) { setEvents(s, "daily", outputIds(s, n)); }});
+			ss.push_back({"outputs/yearly/" + to_string(n), to_string(n) + " outputs aggregated yearly",
+				[n](ScenarioSetup& s) { setEvents(s, "yearly", outputIds(s, n)); }});
+		}
+
+		for(bool on : {false, true})
+		{
+			ss.push_back({string("fvcb/") + (on ? "on" : "off"),
+				string("hourly FvCB photosynthesis ") + (on ? "enabled" : "disabled"), [](ScenarioSetup&) {}, 0,
+				[on](Env& env) { env.params.userCropParameters.__enable_hourly_FvCB_photosynthesis__ = on; }});
+		}
+
+		ss.push_back({"aom-applications/30y", "9 organic fertilizations per rotation over 30 years",
+			[](ScenarioSetup& s)
+			{
+				s.crop = withValue(withoutKey(s.crop, "cropRotations"), "cropRotation", heavyOrganicFertilizationRotation());
+			}, 30});
+
+		return ss;
+	}
+
+	//---------------------------------------------------------------------------
+
+	struct Result
+	{
+		string name;
+		string description;
+		size_t noOfDays{0};
+		vector<double> seconds;
+		double allocationsPerDay{0};
+		double allocatedBytesPerDay{0};
+		uint64_t peakRSSKiB{0};
+		Json memoryStats; //!< of the last repetition
+		size_t noOfErrors{0};
+
+		double median() const
+		{
+			auto s = seconds;
+			sort(s.begin(), s.end());
+			return s.empty() ? 0 : s.size() % 2 == 1 ? s[s.size() / 2] : (s[s.size() / 2 - 1] + s[s.size() / 2]) / 2.0;
+		}
+
+		double min() const { return seconds.empty() ? 0 : *min_element(seconds.begin(), seconds.end()); }
+
+		double daysPerSecond() const { return median() > 0 ? noOfDays / median() : 0; }
+
+		Json to_json() const
+		{
+			return J11Object
+			{{"name", name}
+			,{"description", description}
+			,{"iterations", int(seconds.size())}
+			,{"real_time", median() * 1000.0}
+			,{"min_time", min() * 1000.0}
+			,{"time_unit", "ms"}
+			,{"times", toPrimJsonArray(seconds)}
+			,{"simulated_days", int(noOfDays)}
+			,{"days_per_second", daysPerSecond()}
+			,{"allocations_per_day", allocationsPerDay}
+			,{"allocated_bytes_per_day", allocatedBytesPerDay}
+			,{"peak_rss_kib", double(peakRSSKiB)}
+			,{"store_bytes", memoryStats["storeBytes"]}
+			,{"climate_history_bytes", memoryStats["climateHistoryBytes"]}
+			,{"aom_pool_bytes", memoryStats["aomPoolBytes"]}
+			,{"errors", int(noOfErrors)}
+			};
+		}
+	};
+
+	EResult<Env> createEnv(ScenarioSetup setup, const Scenario& scenario)
+	{
+		if(scenario.modify)
+			scenario.modify(setup);
+
+		if(scenario.noOfYears > 0)
+		{
+			auto es = tileClimate(setup, scenario.noOfYears);
+			if(es.failure())
+				return {Env(), es.errors};
+		}
+
+		auto eenv = createScenarioEnv(setup);
+		if(eenv.failure())
+			return eenv;
+		if(scenario.modifyEnv)
+			scenario.modifyEnv(eenv.result);
+		eenv.result.debugMode = false;
+		eenv.result.memoryStats = true;
+		return eenv;
+	}
+
+	Result runScenario(const Env& env, const Scenario& scenario, int noOfRepetitions)
+	{
+		Result res;
+		res.name = scenario.name;
+		res.description = scenario.description;
+		res.noOfDays = env.climateData.noOfStepsPossible();
+
+		MemoryAccounting::resetPeakRSS();
+		uint64_t allocations = 0, bytes = 0;
+		for(int i = 0; i < max(1, noOfRepetitions); i++)
+		{
+			//copying the env is part of the setup, not of the run
+			Env e = env;
+			auto before = MemoryAccounting::threadAllocationCount();
+			auto start = chrono::steady_clock::now();
+			auto out = runMonica(move(e));
+			res.seconds.push_back(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+			auto after = MemoryAccounting::threadAllocationCount();
+			allocations += after.allocations - before.allocations;
+			bytes += after.bytes - before.bytes;
+			res.noOfErrors = out.errors.size();
+			res.memoryStats = out.memoryStats;
+		}
+		res.peakRSSKiB = MemoryAccounting::peakRSSKiB();
+		double days = double(max(size_t(1), res.noOfDays)) * res.seconds.size();
+		res.allocationsPerDay = allocations / days;
+		res.allocatedBytesPerDay = bytes / days;
+		return res;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	setlocale(LC_ALL, "");
+	setlocale(LC_NUMERIC, "C");
+
+	//init path to db-connections.ini
+	if(auto monicaHome = getenv("MONICA_HOME"))
+	{
+		auto pathToFile = string(monicaHome) + Tools::pathSeparator() + "db-connections.ini";
+		//init for dll/so
+		initPathToDB(pathToFile);
+		//init for monica-bench
+		Db::dbConnectionParameters(pathToFile);
+	}
+
+	string pathToSimJson = "./sim.json";
+	int noOfRepetitions = 3;
+	string filter;
+	string pathToJsonOutput;
+	bool listOnly = false;
+
+	auto printHelp = [=]()
+	{
+		cout
+			<< appName << " [options] [path-to-sim-json]" << endl
+			<< endl
+			<< "Runs the benchmark scenarios based on the given setup (default: " << pathToSimJson << ", e.g. installer/Hohenfinow2/sim.json)" << endl
+			<< "and reports simulated days per second, allocations per simulated day, peak RSS" << endl
+			<< "and the memory held by the results, the climate data history and the AOM pools at the end of the run." << endl
+			<< endl
+			<< "options:" << endl
+			<< endl
+			<< " -h | --help ... this help output" << endl
+			<< " -v | --version ... outputs " << appName << " version" << endl
+			<< endl
+			<< " -l | --list ... list the scenarios" << endl
+			<< " -f | --filter TEXT ... run only scenarios whose name contains TEXT" << endl
+			<< " -r | --repetitions NUMBER (default: " << noOfRepetitions << ") ... run every scenario NUMBER times, the median time is reported" << endl
+			<< " -j | --json FILE ... write the results as JSON to FILE ('-' = stdout) to track them across versions" << endl;
+	};
+
+	for(auto i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if(arg == "-l" || arg == "--list")
+			listOnly = true;
+		else if((arg == "-f" || arg == "--filter")
+						&& i + 1 < argc)
+			filter = argv[++i];
+		else if((arg == "-r" || arg == "--repetitions")
+						&& i + 1 < argc)
+			noOfRepetitions = stoi(argv[++i]);
+		else if((arg == "-j" || arg == "--json")
+						&& i + 1 < argc)
+			pathToJsonOutput = argv[++i];
+		else if(arg == "-h" || arg == "--help")
+			printHelp(), exit(0);
+		else if(arg == "-v" || arg == "--version")
+			cout << appName << " version " << version << endl, exit(0);
+		else
+			pathToSimJson = argv[i];
+	}
+
+	auto scens = scenarios();
+	if(listOnly)
+	{
+		for(const auto& s : scens)
+			cout << s.name << " ... " << s.description << endl;
+		return 0;
+	}
+
+	auto esetup = readScenarioSetup(pathToSimJson);
+	if(esetup.failure())
+	{
+		for(const auto& e : esetup.errors)
+			cerr << e << endl;
+		return 1;
+	}
+	const auto& setup = esetup.result;
+
+	//don't let JSON output on stdout be mixed with the table
+	ostream& out = pathToJsonOutput == "-" ? cerr : cout;
+	out
+		<< left << setw(26) << "scenario"
+		<< right << setw(8) << "days"
+		<< setw(12) << "median ms"
+		<< setw(12) << "min ms"
+		<< setw(12) << "days/s"
+		<< setw(12) << "allocs/day"
+		<< setw(12) << "KiB/day"
+		<< setw(14) << "peak RSS KiB"
+		<< setw(12) << "store KiB"
+		<< setw(12) << "climate KiB"
+		<< setw(10) << "AOM KiB" << endl;
+
+	J11Array benchmarks;
+	int exitCode = 0;
+	for(const auto& scenario : scens)
+	{
+		if(!filter.empty() && scenario.name.find(filter) == string::npos)
+			continue;
+
+		auto eenv = createEnv(setup, scenario);
+		if(eenv.failure())
+		{
+			for(const auto& e : eenv.errors)
+				cerr << scenario.name << ": " << e << endl;
+			exitCode = 1;
+			continue;
+		}
+
+		auto res = runScenario(eenv.result, scenario, noOfRepetitions);
+		if(res.noOfErrors > 0)
+			exitCode = 1;
+		benchmarks.push_back(res.to_json());
+
+		out
+			<< left << setw(26) << res.name
+			<< right << setw(8) << res.noOfDays
+			<< fixed << setprecision(1)
+			<< setw(12) << res.median() * 1000.0
+			<< setw(12) << res.min() * 1000.0
+			<< setw(12) << res.daysPerSecond()
+			<< setw(12) << res.allocationsPerDay
+			<< setw(12) << res.allocatedBytesPerDay / 1024.0
+			<< setw(14) << res.peakRSSKiB
+			<< setw(12) << res.memoryStats["storeBytes"].number_value() / 1024.0
+			<< setw(12) << res.memoryStats["climateHistoryBytes"].number_value() / 1024.0
+			<< setw(10) << res.memoryStats["aomPoolBytes"].number_value() / 1024.0
+			<< (res.noOfErrors > 0 ? "  (run had errors)" : "") << endl;
+	}
+
+	if(!pathToJsonOutput.empty())
+	{
+		char date[32];
+		auto now = time(nullptr);
+		strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+		J11Object context
+		{{"executable", appName}
+		,{"monica_version", VER_FILE_VERSION_STR}
+		,{"setup", pathToSimJson}
+		,{"num_cpus", int(thread::hardware_concurrency())}
+		,{"repetitions", noOfRepetitions}
+		,{"date", date}
+		};
+		auto json = Json(J11Object{{"context", context}, {"benchmarks", benchmarks}}).dump();
+		if(pathToJsonOutput == "-")
+			cout << json << endl;
+		else
+		{
+			ofstream ofs(pathToJsonOutput);
+			if(!ofs)
+			{
+				cerr << "Couldn't write JSON results to: " << pathToJsonOutput << endl;
+				return 1;
+			}
+			ofs << json << endl;
+		}
+	}
+
+	return exitCode;
+}
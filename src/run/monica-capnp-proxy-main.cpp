@@ -18,6 +18,9 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 #include <tuple>
 #include <vector>
 #include <algorithm>
+#include <deque>
+#include <map>
+#include <cstdint>
 
 #include <kj/debug.h>
 #include <kj/common.h>
@@ -29,9 +32,14 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 #include <kj/thread.h>
 
 #include "tools/debug.h"
+#include "tools/helper.h"
 #include "db/abstract-db-connections.h"
+#include "json11/json11-helper.h"
 
 #include "run-monica-capnp.h"
+#include "fair-share-queue.h"
+#include "metrics.h"
+#include "trace.h"
 
 #include "model.capnp.h"
 #include "common.capnp.h"
@@ -68,94 +76,299 @@ class RunMonicaProxy final : public rpc::Model::EnvInstanceProxy::Server
 	friend class Unregister;
 
 	typedef rpc::Model::EnvInstance::Client MonicaClient;
-	struct X {
+
+	//! a registered MONICA instance, the generation distinguishes different workers using the same slot
+	struct Worker {
 		MonicaClient client{ nullptr };
-		int jobs{ 0 };
+		int inFlight{ 0 };
+		int capacity{ 1 };
+		bool active{ false };
+		uint64_t generation{ 0 };
 	};
 
-	std::vector<X> _xs;
+	//! a job waiting to be dispatched, the caller waits on the fulfiller's promise
+	struct Job {
+		Job(RunContext context, kj::Own<kj::PromiseFulfiller<void>>&& fulfiller, JobClass jobClass)
+			: context(context), fulfiller(kj::mv(fulfiller)), jobClass(jobClass) {}
+		RunContext context;
+		kj::Own<kj::PromiseFulfiller<void>> fulfiller;
+		JobClass jobClass;
+		int attempts{ 0 };
+		//! only set if tracing
+		int64_t queuedUs{ 0 };
+		int64_t dispatchedUs{ 0 };
+		std::string customId;
+	};
 
-public:
-	RunMonicaProxy() {}
+	struct TaskErrorHandler : public kj::TaskSet::ErrorHandler {
+		void taskFailed(kj::Exception&& exception) override {
+			cout << "proxy task failed: " << exception.getDescription().cStr() << endl;
+		}
+	};
 
-	RunMonicaProxy(vector<rpc::Model::EnvInstance::Client>& monicas) {
+	std::vector<Worker> _workers;
+	//! interactive jobs first, bulk jobs shared fairly between the tenants
+	FairShareQueue<kj::Own<Job>> _queue;
+	int _defaultCapacity{ 1 };
+	size_t _maxQueueLength{ 0 };
+	int _maxAttempts{ 3 };
+	uint64_t _nextGeneration{ 1 };
+	TaskErrorHandler _taskErrorHandler;
+	kj::TaskSet _tasks{ _taskErrorHandler };
+
+public:
+	RunMonicaProxy() { describeMetrics(); }
+
+	//! @param defaultCapacity the number of jobs a registering worker may run in parallel
+	//! @param maxQueueLength the number of jobs waiting for a free worker, before new jobs are rejected (0 = unlimited)
+	//! @param maxAttempts the number of workers a job is tried on, before it fails
+	RunMonicaProxy(vector<rpc::Model::EnvInstance::Client>& monicas,
+		int defaultCapacity = 1,
+		size_t maxQueueLength = 0,
+		int maxAttempts = 3)
+		: _defaultCapacity(std::max(1, defaultCapacity))
+		, _maxQueueLength(maxQueueLength)
+		, _maxAttempts(std::max(1, maxAttempts)) {
+		describeMetrics();
+		//the local MONICA threads run one job at a time
 		for (auto&& client : monicas) {
-			_xs.push_back({ kj::mv(client), 0 });
+			addWorker(kj::mv(client), 1);
 		}
 	}
 
 	kj::Promise<void> run(RunContext context) override //run @0 (env :Env) -> (result :Common.StructuredText);
 	{
-		if (_xs.empty())
-			return kj::READY_NOW;
+		metrics().inc("monica_proxy_jobs_received_total");
+		//backpressure: callers have to wait (in the queue) for a free worker and are rejected if too many are waiting
+		if (_maxQueueLength > 0 && _queue.size() >= _maxQueueLength && !hasFreeWorker()) {
+			metrics().inc("monica_proxy_jobs_rejected_total");
+			return KJ_EXCEPTION(OVERLOADED, "all MONICA workers are busy and the proxy's queue is full");
+		}
 
-		X* min = &_xs.front();
-		size_t id = 0;
-		if (min->jobs > 0 || min->jobs < 0) {
-			for (auto size = _xs.size(); id < size; id++) {
-				auto& x = _xs[id];
-				if (x.jobs < 0) //skip empty storage places
-					continue;
-				if (x.jobs < min->jobs) {
-					min = &x;
-					if (min->jobs == 0) //stop searching if a worker has nothing to do
-						break;
-				}
-			}
+		auto paf = kj::newPromiseAndFulfiller<void>();
+		std::string customId;
+		bool tracing = TraceWriter::instance() != nullptr;
+		auto jc = jobClassOf(context, tracing ? &customId : nullptr);
+		auto job = kj::heap<Job>(context, kj::mv(paf.fulfiller), jc);
+		if (tracing) {
+			job->queuedUs = TraceWriter::nowUs();
+			job->customId = customId;
 		}
-		if (min->jobs < 0) //just empty storage places, no clients connected
-			return kj::READY_NOW;
-
-		auto req = min->client.runRequest();
-		req.setEnv(context.getParams().getEnv());
-		min->jobs++;
-		cout << "added job to worker: " << id << " now " << min->jobs << " in worker queue" << endl;
-		return req.send().then([context, id, this](auto&& res) mutable {
-			if (id < this->_xs.size()) {
-				X& x = _xs[id];
-				x.jobs--;
-				cout << "finished job of worker: " << id << " now " << x.jobs << " in worker queue" << endl;
-				context.setResults(res);
-			}
-			}, [context, id, this](kj::Exception&& exception) {
-				cout << "job for worker with id: " << id << " failed" << endl;
-				cout << "Exception: " << exception.getDescription().cStr() << endl;
-				//try to erase id from map, so it can't be used anymore
-				if (id < this->_xs.size()) {
-					_xs[id] = { nullptr, -1 };
-				}
-			});
+		_queue.push(kj::mv(job), jc);
+		dispatch();
+		return kj::mv(paf.promise);
 	}
 
+	void setTenantWeight(const std::string& tenant, int weight) { _queue.setWeight(tenant, weight); }
+
 	kj::Promise<void> registerEnvInstance(RegisterEnvInstanceContext context) override  // registerEnvInstance @0 (instance :EnvInstance) -> (unregister :Common.Callback);
 	{
-		auto instance = context.getParams().getInstance();
-		bool filledEmptySlot = false;
-		int id = 0;
-		for (X& x : _xs) {
-			if (x.jobs < 0) {
-				x = { kj::mv(instance), 0 };
-				filledEmptySlot = true;
+		auto id = addWorker(context.getParams().getInstance(), _defaultCapacity);
+		cout << "added service to proxy: " << noOfActiveWorkers() << " services registered now" << endl;
+		context.getResults().setUnregister(kj::heap<Unregister>(*this, id));
+		dispatch();
+		return kj::READY_NOW;
+	}
+
+private:
+	static void describeMetrics() {
+		auto& m = metrics();
+		m.describe("monica_proxy_jobs_received_total", "counter", "Jobs received from the clients.");
+		m.describe("monica_proxy_jobs_rejected_total", "counter", "Jobs rejected because the queue was full.");
+		m.describe("monica_proxy_jobs_dispatched_total", "counter", "Jobs sent to a worker, retries count again.");
+		m.describe("monica_proxy_jobs_completed_total", "counter", "Jobs answered by a worker.");
+		m.describe("monica_proxy_jobs_requeued_total", "counter", "Jobs queued again after their worker disconnected or was overloaded.");
+		m.describe("monica_proxy_jobs_failed_total", "counter", "Jobs failed, by the job itself or on all attempts.");
+		m.describe("monica_proxy_jobs_queued", "gauge", "Jobs waiting for a free worker.");
+		m.describe("monica_proxy_jobs_queued_interactive", "gauge", "Interactive jobs waiting for a free worker.");
+		m.describe("monica_proxy_workers", "gauge", "Registered workers.");
+		m.describe("monica_proxy_worker_utilisation", "gauge", "Jobs in flight divided by the capacity of the worker.");
+	}
+
+	void updateMetrics() {
+		auto& m = metrics();
+		m.set("monica_proxy_jobs_queued", double(_queue.size()));
+		m.set("monica_proxy_jobs_queued_interactive", double(_queue.noOfInteractiveJobs()));
+		m.set("monica_proxy_workers", double(noOfActiveWorkers()));
+		for (size_t id = 0; id < _workers.size(); id++) {
+			const auto& w = _workers[id];
+			m.set("monica_proxy_worker_utilisation", w.active ? double(w.inFlight) / w.capacity : 0.0, label("worker", std::to_string(id)));
+		}
+	}
+
+	//! the scheduling class from the "priority" and "tenant" fields of the env's JSON and its "customId" (if requested, when tracing),
+	//! this runs on the event loop thread, so the env is parsed (once) only if it might contain scheduling fields or customId is requested
+	static JobClass jobClassOf(RunContext& context, std::string* customId = nullptr) {
+		auto env = context.getParams().getEnv();
+		if (!env.hasRest() || !env.getRest().getStructure().isJson())
+			return JobClass();
+		auto text = env.getRest().getValue();
+		bool scheduling = mayHaveJobClass(text.cStr(), text.size());
+		if (!scheduling && !customId)
+			return JobClass();
+		std::string err;
+		auto j = Json::parse(text.cStr(), err);
+		if (customId) {
+			const auto& cid = j["customId"];
+			*customId = cid.is_string() ? cid.string_value() : cid.is_null() ? std::string() : cid.dump();
+		}
+		return scheduling ? Monica::jobClassOf(j) : JobClass();
+	}
+
+	//! the span of a job in the proxy's trace
+	static void traceJob(const char* name, const Job& job, int64_t startUs, size_t workerId) {
+		if (auto tracer = TraceWriter::instance())
+			tracer->complete(name, "proxy", startUs, TraceWriter::nowUs(),
+				J11Object{ {"customId", job.customId}, {"worker", int(workerId)}, {"attempt", job.attempts} });
+	}
+
+	size_t addWorker(MonicaClient&& client, int capacity) {
+		size_t id = 0;
+		for (; id < _workers.size(); id++) {
+			if (!_workers[id].active)
 				break;
+		}
+		if (id == _workers.size())
+			_workers.push_back(Worker());
+
+		auto& w = _workers[id];
+		w.client = kj::mv(client);
+		w.inFlight = 0;
+		w.capacity = capacity;
+		w.active = true;
+		w.generation = _nextGeneration++;
+		return id;
+	}
+
+	void removeWorker(size_t id) {
+		if (id < _workers.size() && _workers[id].active) {
+			//jobs still running on the worker will either finish or fail and be requeued
+			_workers[id] = Worker();
+			updateMetrics();
+		}
+	}
+
+	size_t noOfActiveWorkers() const {
+		return std::count_if(_workers.begin(), _workers.end(), [](const Worker& w) { return w.active; });
+	}
+
+	bool hasFreeWorker() const {
+		return std::any_of(_workers.begin(), _workers.end(), [](const Worker& w) { return w.active && w.inFlight < w.capacity; });
+	}
+
+	//! the active worker with the lowest relative load and a free slot or -1
+	int leastLoadedWorker() const {
+		int best = -1;
+		double bestLoad = 1.0;
+		for (size_t id = 0; id < _workers.size(); id++) {
+			const auto& w = _workers[id];
+			if (!w.active || w.inFlight >= w.capacity)
+				continue;
+			double load = double(w.inFlight) / w.capacity;
+			if (best < 0 || load < bestLoad) {
+				best = int(id);
+				bestLoad = load;
+				if (load == 0)
+					break;
 			}
-			id++;
 		}
-		if (!filledEmptySlot) {
-			_xs.push_back({ kj::mv(instance), 0 });
-			id = _xs.size() - 1;
+		return best;
+	}
+
+	//! send queued jobs to workers as long as there are free slots
+	void dispatch() {
+		while (!_queue.empty()) {
+			int id = leastLoadedWorker();
+			if (id < 0)
+				break;
+
+			auto job = _queue.pop();
+			//drop jobs whose callers went away
+			if (!job->fulfiller->isWaiting())
+				continue;
+
+			send(size_t(id), kj::mv(job));
 		}
+		updateMetrics();
+	}
 
-		int count = 0;
-		for (X& x : _xs) {
-			if (x.jobs >= 0)
-				count++;
+	void send(size_t id, kj::Own<Job>&& job) {
+		auto& w = _workers[id];
+		auto generation = w.generation;
+		auto req = w.client.runRequest();
+		req.setEnv(job->context.getParams().getEnv());
+		w.inFlight++;
+		job->attempts++;
+		metrics().inc("monica_proxy_jobs_dispatched_total");
+		if (TraceWriter::instance()) {
+			traceJob("queued", *job, job->queuedUs, id);
+			job->dispatchedUs = TraceWriter::nowUs();
 		}
-				
-		cout << "added service to proxy: " << count << " services registered now" << endl;
+		cout << "added job to worker: " << id << " now " << w.inFlight << " of " << w.capacity << " jobs running" << endl;
 
-		context.getResults().setUnregister(kj::heap<Unregister>(*this, id));
+		auto jobPtr = job.get();
+		_tasks.add(req.send().then([this, id, generation, jobPtr](auto&& res) mutable {
+			if (jobPtr->fulfiller->isWaiting()) {
+				jobPtr->context.setResults(res);
+				jobPtr->fulfiller->fulfill();
+			}
+			metrics().inc("monica_proxy_jobs_completed_total");
+			traceJob("worker", *jobPtr, jobPtr->dispatchedUs, id);
+			this->jobDone(id, generation);
+			cout << "finished job of worker: " << id << endl;
+		}, [this, id, generation, jobPtr](kj::Exception&& exception) mutable {
+			cout << "job for worker with id: " << id << " failed" << endl;
+			cout << "Exception: " << exception.getDescription().cStr() << endl;
+			traceJob("worker-failed", *jobPtr, jobPtr->dispatchedUs, id);
+			auto type = exception.getType();
+			if (type == kj::Exception::Type::DISCONNECTED) {
+				//the worker is gone, so don't use it anymore and give the job to another one
+				if (id < _workers.size() && _workers[id].generation == generation)
+					removeWorker(id);
+				this->requeueOrFail(jobPtr, kj::mv(exception));
+				this->dispatch();
+			}
+			else if (type == kj::Exception::Type::OVERLOADED) {
+				//the worker is alive but busy, another one might take the job
+				this->requeueOrFail(jobPtr, kj::mv(exception));
+				this->jobDone(id, generation);
+			}
+			else {
+				//the job itself failed (e.g. it made MONICA throw), it would fail on every other worker too
+				metrics().inc("monica_proxy_jobs_failed_total");
+				if (jobPtr->fulfiller->isWaiting())
+					jobPtr->fulfiller->reject(kj::mv(exception));
+				this->jobDone(id, generation);
+			}
+		}).attach(kj::mv(job)));
+	}
 
-		return kj::READY_NOW;
+	void jobDone(size_t id, uint64_t generation) {
+		if (id < _workers.size() && _workers[id].generation == generation && _workers[id].inFlight > 0)
+			_workers[id].inFlight--;
+		dispatch();
+	}
+
+	//! give the job another try on a different worker (its worker disconnected or was overloaded), before the caller gets the error
+	void requeueOrFail(Job* job, kj::Exception&& exception) {
+		if (!job->fulfiller->isWaiting())
+			return;
+		if (job->attempts < _maxAttempts) {
+			auto paf = kj::newPromiseAndFulfiller<void>();
+			auto requeued = kj::heap<Job>(job->context, kj::mv(job->fulfiller), job->jobClass);
+			requeued->attempts = job->attempts;
+			requeued->customId = job->customId;
+			if (TraceWriter::instance())
+				requeued->queuedUs = TraceWriter::nowUs();
+			job->fulfiller = kj::mv(paf.fulfiller);
+			_queue.pushFront(kj::mv(requeued), job->jobClass);
+			metrics().inc("monica_proxy_jobs_requeued_total");
+			cout << "requeued job after " << job->attempts << " attempt(s)" << endl;
+		}
+		else {
+			metrics().inc("monica_proxy_jobs_failed_total");
+			job->fulfiller->reject(kj::mv(exception));
+		}
 	}
 };
 
@@ -165,9 +378,7 @@ Unregister::~Unregister() {
 
 void Unregister::unreg() {
 	cout << "unregistering id: " << _monicaServerId << endl;
-	if (_monicaServerId < _proxy._xs.size()) {
-		_proxy._xs[_monicaServerId] = { nullptr, -1 };
-	}
+	_proxy.removeWorker(_monicaServerId);
 }
 
 kj::Promise<void> Unregister::call(CallContext context) // call @0 ();
@@ -347,6 +558,13 @@ int main(int argc, const char* argv[]) {
 	int port = -1;
 	uint no_of_threads = 0;
 	bool startMonicaThreadsInDebugMode = false;
+	int workerCapacity = 1;
+	int maxQueueLength = 1000;
+	int maxAttempts = 3;
+	map<string, int> tenantWeights;
+	int metricsPort = -1;
+	string metricsAddress = defaultMetricsAddress;
+	string pathToTraceFile;
 
 	//init path to db-connections.ini
 	if (auto monicaHome = getenv("MONICA_HOME"))
@@ -374,7 +592,21 @@ int main(int argc, const char* argv[]) {
 			<< " -p | --port ... PORT (default: none)] "
 			"... runs the server bound to the port, PORT may be ommited to choose port automatically." << endl
 			<< " -t | --monica-threads ... NUMBER (default: " << no_of_threads << ")] "
-			"... starts additionally to the proxy NUMBER of MONICA threads which can be served via the proxy." << endl;
+			"... starts additionally to the proxy NUMBER of MONICA threads which can be served via the proxy." << endl
+			<< " -c | --worker-capacity ... NUMBER (default: " << workerCapacity << ")] "
+			"... number of jobs a registering MONICA service is sent in parallel." << endl
+			<< " -q | --max-queue-length ... NUMBER (default: " << maxQueueLength << ")] "
+			"... number of jobs waiting for a free MONICA service, before new jobs are rejected (0 = unlimited)." << endl
+			<< " -a | --max-attempts ... NUMBER (default: " << maxAttempts << ")] "
+			"... number of MONICA services a job is tried on if they disconnect or are overloaded, before it fails." << endl
+			<< " -tw | --tenant-weight ... TENANT=WEIGHT "
+			"... TENANT's bulk jobs get WEIGHT times the share of a tenant with default weight 1 (may be repeated)." << endl
+			<< " -m | --metrics-port ... PORT "
+			"... serve Prometheus metrics (job counts, queue length, worker utilisation) via HTTP on PORT." << endl
+			<< " -ma | --metrics-address ... ADDRESS (default: " << metricsAddress << ")] "
+			"... interface the metrics endpoint is bound to, * for all interfaces." << endl
+			<< " -tr | --trace ... FILE "
+			"... write a Chrome trace (chrome://tracing, Perfetto) of the time jobs spend queued and at the workers to FILE." << endl;
 	};
 
 	if (argc >= 1)
@@ -395,6 +627,42 @@ int main(int argc, const char* argv[]) {
 				if (i + 1 < argc && argv[i + 1][0] != '-')
 					no_of_threads = stoi(argv[++i]);
 			}
+			else if (arg == "-c" || arg == "--worker-capacity")
+			{
+				if (i + 1 < argc && argv[i + 1][0] != '-')
+					workerCapacity = stoi(argv[++i]);
+			}
+			else if (arg == "-q" || arg == "--max-queue-length")
+			{
+				if (i + 1 < argc && argv[i + 1][0] != '-')
+					maxQueueLength = stoi(argv[++i]);
+			}
+			else if (arg == "-a" || arg == "--max-attempts")
+			{
+				if (i + 1 < argc && argv[i + 1][0] != '-')
+					maxAttempts = stoi(argv[++i]);
+			}
+			else if ((arg == "-tw" || arg == "--tenant-weight") && i + 1 < argc)
+			{
+				auto tw = splitString(argv[++i], "=");
+				if (tw.size() == 2)
+					tenantWeights[tw[0]] = stoi(tw[1]);
+			}
+			else if (arg == "-m" || arg == "--metrics-port")
+			{
+				if (i + 1 < argc && argv[i + 1][0] != '-')
+					metricsPort = stoi(argv[++i]);
+			}
+			else if (arg == "-ma" || arg == "--metrics-address")
+			{
+				if (i + 1 < argc)
+					metricsAddress = argv[++i];
+			}
+			else if (arg == "-tr" || arg == "--trace")
+			{
+				if (i + 1 < argc && argv[i + 1][0] != '-')
+					pathToTraceFile = argv[++i];
+			}
 			else if (arg == "-h" || arg == "--help")
 				printHelp(), exit(0);
 			else if (arg == "-v" || arg == "--version")
@@ -403,6 +671,12 @@ int main(int argc, const char* argv[]) {
 
 		debug() << "starting Cap'n Proto MONICA proxy" << endl;
 
+		if (metricsPort > 0 && !serveMetricsHttp(metricsPort, metricsAddress))
+			cerr << "Couldn't serve metrics on port: " << metricsPort << "! Continuing without metrics endpoint." << endl;
+
+		if (!pathToTraceFile.empty() && !TraceWriter::start(pathToTraceFile, appName))
+			cerr << "Couldn't write trace to file: " << pathToTraceFile << "! Continuing without tracing." << endl;
+
 		auto ioContext = kj::setupAsyncIo();
 		int callCount = 0;
 		int handleCount = 0;
@@ -431,7 +705,10 @@ int main(int argc, const char* argv[]) {
 			clients.push_back(kj::mv(promAndClient.client));
 		}
 		//init the proxy, which will be 
-		mainInterface = kj::heap<RunMonicaProxy>(clients);
+		auto proxy = kj::heap<RunMonicaProxy>(clients, workerCapacity, size_t(std::max(0, maxQueueLength)), maxAttempts);
+		for (const auto& p : tenantWeights)
+			proxy->setTenantWeight(p.first, p.second);
+		mainInterface = kj::mv(proxy);
 
 		port = portPromise.addBranch().wait(ioContext.waitScope);
 		if (port == 0) {
@@ -35,6 +35,8 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 #include "tools/debug.h"
 
 #include "run-monica-capnp.h"
+#include "metrics.h"
+#include "trace.h"
 
 #include "model.capnp.h"
 #include "common.capnp.h"
@@ -70,6 +72,14 @@ int main(int argc, const char* argv[]) {
   //bool hideServer = false;
   bool startedServerInDebugMode = false;
 
+  string pathToResultCache;
+  bool useResultCache = false;
+  int resultCacheSizeMB = 1024;
+  int metricsPort = -1;
+  std::string metricsAddress = defaultMetricsAddress;
+  string pathToTraceFile;
+  string workerId;
+
   //init path to db-connections.ini
   if (auto monicaHome = getenv("MONICA_HOME")) {
     auto pathToFile = string(monicaHome) + Tools::pathSeparator() + "db-connections.ini";
@@ -114,7 +124,19 @@ int main(int argc, const char* argv[]) {
       << " -fp | --factory-port ... PORT (default: " << factoryPort << ")] "
       "... connects server to factory running on given port." << endl
       << " -rt | --registration-token ... REGISTRATION_TOKEN (default: " << registrationToken << ")] "
-      "... a token proving the authority to register this MONICA instance at the factory." << endl;
+      "... a token proving the authority to register this MONICA instance at the factory." << endl
+      << " -rc | --result-cache ... [DIR] "
+      "... answer envs which have been run before from a cache, keep the results in DIR if given, else in memory only" << endl
+      << " -rcs | --result-cache-size ... MB (default: " << resultCacheSizeMB << ")] "
+      "... maximum size of the result cache directory" << endl
+      << " -m | --metrics-port ... PORT "
+      "... serve Prometheus metrics (job counts, phase timings, result sizes, utilisation) via HTTP on PORT" << endl
+      << " -ma | --metrics-address ... ADDRESS (default: " << metricsAddress << ")] "
+      "... interface the metrics endpoint is bound to, * for all interfaces" << endl
+      << " -tr | --trace ... FILE "
+      "... write a Chrome trace (chrome://tracing, Perfetto) of the job phases to FILE, {pid} is replaced by the process id" << endl
+      << " -wid | --worker-id ... ID (default: process id) "
+      "... name of this server in the trace" << endl;
   };
 
   if (argc >= 1) {
@@ -153,6 +175,25 @@ int main(int argc, const char* argv[]) {
       } else if (arg == "-rt" || arg == "--registration-token") {
         if (i + 1 < argc && argv[i + 1][0] != '-')
           registrationToken = argv[++i];
+      } else if (arg == "-rc" || arg == "--result-cache") {
+        useResultCache = true;
+        if (i + 1 < argc && argv[i + 1][0] != '-')
+          pathToResultCache = argv[++i];
+      } else if (arg == "-rcs" || arg == "--result-cache-size") {
+        if (i + 1 < argc && argv[i + 1][0] != '-')
+          resultCacheSizeMB = stoi(argv[++i]);
+      } else if (arg == "-m" || arg == "--metrics-port") {
+        if (i + 1 < argc && argv[i + 1][0] != '-')
+          metricsPort = stoi(argv[++i]);
+      } else if (arg == "-ma" || arg == "--metrics-address") {
+        if (i + 1 < argc)
+          metricsAddress = argv[++i];
+      } else if (arg == "-tr" || arg == "--trace") {
+        if (i + 1 < argc && argv[i + 1][0] != '-')
+          pathToTraceFile = argv[++i];
+      } else if (arg == "-wid" || arg == "--worker-id") {
+        if (i + 1 < argc && argv[i + 1][0] != '-')
+          workerId = argv[++i];
       } else if (arg == "-h" || arg == "--help")
         printHelp(), exit(0);
       else if (arg == "-v" || arg == "--version")
@@ -161,9 +202,19 @@ int main(int argc, const char* argv[]) {
 
     debug() << "starting Cap'n Proto MONICA server" << endl;
 
+    describeJobMetrics();
+    if (metricsPort > 0 && !serveMetricsHttp(metricsPort, metricsAddress))
+      cerr << "Couldn't serve metrics on port: " << metricsPort << "! Continuing without metrics endpoint." << endl;
+
+    //the server runs until being killed, the trace file stays valid as every event is flushed
+    if (!pathToTraceFile.empty() && !TraceWriter::start(pathToTraceFile, appName, workerId))
+      cerr << "Couldn't write trace to file: " << pathToTraceFile << "! Continuing without tracing." << endl;
+
     //create monica server implementation
     auto runMonicaImpl_ = kj::heap<RunMonicaImpl>(startedServerInDebugMode);
     auto& runMonicaImpl = *runMonicaImpl_;
+    if (useResultCache)
+      runMonicaImpl.setResultCache(make_shared<ResultCache>(pathToResultCache, uint64_t(max(0, resultCacheSizeMB)) * 1024 * 1024));
     rpc::Model::EnvInstance::Client runMonicaImplClient = kj::mv(runMonicaImpl_); // kj::heap<RunMonicaImpl>(startedServerInDebugMode);
     debug() << "created monica" << endl;
 
@@ -0,0 +1,503 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+Authors:
+Michael Berg <michael.berg@zalf.de>
+
+Maintainers:
+Currently maintained by the authors.
+
+This file is part of the MONICA model.
+Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
+*/
+
+#include <cstdlib>
+#include <cstdio>
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <ctime>
+
+#include "json11/json11.hpp"
+
+#include "tools/helper.h"
+#include "tools/algorithms.h"
+#include "tools/date.h"
+#include "../run/run-monica.h"
+#include "../core/monica-model.h"
+#include "../core/crop-growth.h"
+#include "../core/photosynthesis-FvCB.h"
+#include "../core/O3-impact.h"
+#include "json11/json11-helper.h"
+#include "scenario-setup.h"
+#include "db/abstract-db-connections.h"
+#include "../resource/version.h"
+
+using namespace std;
+using namespace Monica;
+using namespace Tools;
+using namespace json11;
+
+string appName = "monica-kernel-bench";
+string version = "1.0.0";
+
+namespace
+{
+	//! keeps the results of the side effect free kernels alive, so the calls can't be optimized away
+	volatile double sink = 0;
+
+	double climateValue(const map<Climate::ACD, double>& cd, Climate::ACD acd, double def = -1.0)
+	{
+		auto it = cd.find(acd);
+		return it == cd.end() ? def : it->second;
+	}
+
+	//! the model state of a run at a captured date and the kernel inputs derived from the captured day
+	struct State
+	{
+		string name;
+		Date date;
+		shared_ptr<MonicaRun> run; //!< the fork of the run at date, never stepped further
+		map<Climate::ACD, double> climate; //!< the climate data of the last simulated day (the day before date)
+
+		//the inputs of the 24 hourly FvCB and O3 calls of the last simulated day, as CropGrowth derives them
+		vector<FvCB::FvCB_canopy_hourly_in> fvcbIns;
+		FvCB::FvCB_canopy_hourly_params fvcbParams;
+		vector<O3impact::O3_impact_in> o3Ins;
+		O3impact::O3_impact_params o3Params;
+		bool waterDeficitResponseOn{true};
+
+		const MonicaModel& model() const { return run->model(); }
+		bool hasCrop() const { return model().cropGrowth() != nullptr; }
+	};
+
+	//! derive the hourly FvCB and O3 inputs like CropGrowth::fc_CropPhotosynthesis does
+	void deriveHourlyInputs(State& s)
+	{
+		const auto& m = s.model();
+		auto cg = m.cropGrowth();
+		if(!cg)
+			return;
+
+		double tmin = climateValue(s.climate, Climate::tmin, 0);
+		double tavg = climateValue(s.climate, Climate::tavg, 0);
+		double tmax = climateValue(s.climate, Climate::tmax, 0);
+		double lat = m.siteParameters().vs_Latitude;
+		int julday = m.currentStepDate().julianDay();
+
+		int sunriseH = 0;
+		for(int h = 1; h < 24; h++)
+		{
+			if(hourlyRad(cg->get_GlobalRadiation(), lat, julday, h) > 0
+				 && hourlyRad(cg->get_GlobalRadiation(), lat, julday, h - 1) == 0.0)
+			{
+				sunriseH = h;
+				break;
+			}
+		}
+
+		s.fvcbParams.Vcmax_25 = m.currentCrop()->cropParameters()->speciesParams.VCMAX25
+			* cg->get_O3_shortTermDamage() * cg->get_O3_senescence();
+		s.o3Params.gamma3 = 0.05;
+		s.o3Params.gamma1 = 0.025;
+		s.waterDeficitResponseOn = m.simulationParameters().pc_WaterDeficitResponseOn;
+
+		int rootDepth = cg->get_RootingDepth();
+		double fc = 0, wp = 0, swc = 0;
+		for(int i = 0; i < rootDepth; i++)
+		{
+			fc += m.soilColumn()[i].vs_FieldCapacity();
+			wp += m.soilColumn()[i].vs_PermanentWiltingPoint();
+			swc += m.soilColumn()[i].get_Vs_SoilMoisture_m3();
+		}
+
+		for(int h = 0; h < 24; h++)
+		{
+			FvCB::FvCB_canopy_hourly_in in;
+			double hourlyTemp = hourlyT(tmin, tmax, h, sunriseH);
+			in.leaf_temp = hourlyTemp;
+			in.global_rad = hourlyRad(cg->get_GlobalRadiation(), lat, julday, h);
+			in.extra_terr_rad = hourlyRad(cg->get_ExtraterrestrialRadiation(), lat, julday, h);
+			in.LAI = cg->get_LeafAreaIndex();
+			in.solar_el = solarElevation(h, lat, julday);
+			in.VPD = hourlyVaporPressureDeficit(hourlyTemp, tmin, tavg, tmax);
+			in.Ca = m.get_AtmosphericCO2Concentration();
+			s.fvcbIns.push_back(in);
+
+			if(rootDepth < 1)
+				continue;
+
+			//the stomatal conductance is an output of FvCB
+			auto res = FvCB::FvCB_canopy_hourly_C3(in, s.fvcbParams);
+			double sunWeight = res.sunlit.LAI / (res.sunlit.LAI + res.shaded.LAI);
+			double gs = (1 - sunWeight) * res.shaded.gs / res.shaded.LAI;
+			if(res.sunlit.LAI > 0)
+				gs += sunWeight * res.sunlit.gs / res.sunlit.LAI;
+
+			O3impact::O3_impact_in o3in;
+			o3in.FC = fc / (rootDepth + 1);
+			o3in.WP = wp / (rootDepth + 1);
+			o3in.SWC = swc / (rootDepth + 1);
+			o3in.ET0 = cg->get_ReferenceEvapotranspiration();
+			o3in.O3a = m.get_AtmosphericO3Concentration();
+			o3in.gs = gs;
+			o3in.h = h;
+			o3in.reldev = cg->get_RelativeTotalDevelopment();
+			o3in.GDD_flo = cg->get_TemperatureSumToFlowering();
+			o3in.GDD_mat = cg->get_TotalTemperatureSum();
+			o3in.fO3s_d_prev = cg->get_O3_shortTermDamage();
+			o3in.sum_O3_up = cg->get_O3_sumUptake();
+			s.o3Ins.push_back(o3in);
+		}
+	}
+
+	//! run the setup until the given dates and capture the model state at each of them
+	EResult<vector<State>> captureStates(const ScenarioSetup& setup, const vector<pair<string, Date>>& dates)
+	{
+		vector<State> states;
+		auto eenv = createScenarioEnv(setup);
+		if(eenv.failure())
+			return {states, eenv.errors};
+		eenv.result.debugMode = false;
+
+		MonicaRun run(eenv.result);
+		for(const auto& p : dates)
+		{
+			run.runUntil(p.second);
+			if(!(run.model().currentStepDate() + 1 == p.second))
+				return {states, string("Couldn't run the setup until ") + p.second.toIsoDateString()};
+
+			State s;
+			s.name = p.first;
+			s.date = p.second;
+			s.run = make_shared<MonicaRun>(run);
+			s.climate = s.model().currentStepClimateData();
+			deriveHourlyInputs(s);
+			states.push_back(s);
+		}
+		return {states};
+	}
+
+	//---------------------------------------------------------------------------
+
+	struct Kernel
+	{
+		string name;
+		string description;
+		bool needsCrop{false};
+		//! one call of the kernel, model is a fresh copy of the state's model for every call
+		function<void(MonicaModel& model, const State& state)> call;
+		//! the kernel doesn't touch the model, so it is called without copying the model first
+		bool stateless{false};
+	};
+
+	vector<Kernel> kernels()
+	{
+		vector<Kernel> ks;
+
+		ks.push_back({"FvCB_canopy_hourly_C3", "the 24 hourly canopy photosynthesis calls of a day", true,
+			[](MonicaModel&, const State& s)
+			{
+				double gp = 0;
+				for(const auto& in : s.fvcbIns)
+					gp += FvCB::FvCB_canopy_hourly_C3(in, s.fvcbParams).canopy_gross_photos;
+				sink = gp;
+			}, true});
+
+		ks.push_back({"O3_impact_hourly", "the 24 hourly ozone uptake and damage calls of a day", true,
+			[](MonicaModel&, const State& s)
+			{
+				double up = 0;
+				for(const auto& in : s.o3Ins)
+					up += O3impact::O3_impact_hourly(in, s.o3Params, s.waterDeficitResponseOn).hourly_O3_up;
+				sink = up;
+			}, true});
+
+		ks.push_back({"SoilTemperature::step", "the soil temperature step, mainly the Cholesky solve of the heat conduction", false,
+			[](MonicaModel& m, const State& s)
+			{
+				m.soilTemperatureNC().step(climateValue(s.climate, Climate::tmin), climateValue(s.climate, Climate::tmax),
+																	 climateValue(s.climate, Climate::globrad));
+			}});
+
+		ks.push_back({"SoilTransport::fq_NTransport", "one full time step of the nitrate transport", false,
+			[](MonicaModel& m, const State&)
+			{
+				m.soilTransportNC().fq_NTransport(m.environmentParameters().p_LeachingDepth, 1.0);
+			}});
+
+		ks.push_back({"SoilMoisture::fm_PercolationWithGroundwater", "the percolation with the captured groundwater depth", false,
+			[](MonicaModel& m, const State&)
+			{
+				m.soilMoistureNC().fm_PercolationWithGroundwater(m.get_GroundwaterDepth());
+			}});
+
+		ks.push_back({"SoilMoisture::fm_Evapotranspiration", "the evapotranspiration with the day's climate data", false,
+			[](MonicaModel& m, const State& s)
+			{
+				auto cg = m.cropGrowth();
+				auto& sm = m.soilMoistureNC();
+				sm.fm_Evapotranspiration(cg ? cg->get_SoilCoverage() : 0.0, sm.get_KcFactor(), m.siteParameters().vs_HeightNN,
+																 climateValue(s.climate, Climate::tmax), climateValue(s.climate, Climate::tmin),
+																 climateValue(s.climate, Climate::relhumid) / 100.0, climateValue(s.climate, Climate::tavg),
+																 climateValue(s.climate, Climate::wind), m.environmentParameters().p_WindSpeedHeight,
+																 climateValue(s.climate, Climate::globrad), cg ? cg->get_DevelopmentalStage() : 0,
+																 m.currentStepDate().julianDay(), m.siteParameters().vs_Latitude,
+																 climateValue(s.climate, Climate::et0));
+			}});
+
+		ks.push_back({"SoilOrganic::fo_MIT", "the mineralisation, immobilisation and turnover of the organic pools", false,
+			[](MonicaModel& m, const State&) { m.soilOrganicNC().fo_MIT(); }});
+
+		ks.push_back({"CropGrowth::fc_CropWaterUptake", "the crop's water uptake", true,
+			[](MonicaModel& m, const State& s)
+			{
+				auto cg = m.cropGrowth();
+				cg->fc_CropWaterUptake(cg->get_SoilCoverage(), cg->get_RootingZone(), m.soilColumn().vm_GroundwaterTable,
+															 cg->get_ReferenceEvapotranspiration(), climateValue(s.climate, Climate::precip, 0),
+															 cg->get_CurrentTemperatureSum(), cg->get_TotalTemperatureSum());
+			}});
+
+		ks.push_back({"CropGrowth::fc_CropNUptake", "the crop's nitrogen uptake", true,
+			[](MonicaModel& m, const State&)
+			{
+				auto cg = m.cropGrowth();
+				cg->fc_CropNUptake(int(cg->get_RootingZone()), m.soilColumn().vm_GroundwaterTable,
+													 cg->get_CurrentTemperatureSum(), cg->get_TotalTemperatureSum());
+			}});
+
+		return ks;
+	}
+
+	//---------------------------------------------------------------------------
+
+	struct Result
+	{
+		string name;
+		string description;
+		vector<double> nanoseconds;
+
+		double median() const
+		{
+			auto s = nanoseconds;
+			sort(s.begin(), s.end());
+			return s.empty() ? 0 : s.size() % 2 == 1 ? s[s.size() / 2] : (s[s.size() / 2 - 1] + s[s.size() / 2]) / 2.0;
+		}
+
+		double min() const { return nanoseconds.empty() ? 0 : *min_element(nanoseconds.begin(), nanoseconds.end()); }
+
+		Json to_json() const
+		{
+			return J11Object
+			{{"name", name}
+			,{"description", description}
+			,{"iterations", int(nanoseconds.size())}
+			,{"real_time", median()}
+			,{"min_time", min()}
+			,{"time_unit", "ns"}
+			};
+		}
+	};
+
+	Result runKernel(const Kernel& kernel, const State& state, int noOfSamples)
+	{
+		Result res;
+		res.name = kernel.name + "/" + state.name;
+		res.description = kernel.description;
+
+		//the stateless kernels still get a model, but the same one for every call
+		unique_ptr<MonicaModel> shared;
+		if(kernel.stateless)
+			shared.reset(new MonicaModel(state.model()));
+
+		//the first call is a warm up and not recorded
+		for(int i = 0; i <= noOfSamples; i++)
+		{
+			unique_ptr<MonicaModel> copy;
+			if(!kernel.stateless)
+				copy.reset(new MonicaModel(state.model()));
+			auto& m = kernel.stateless ? *shared : *copy;
+
+			auto start = chrono::steady_clock::now();
+			kernel.call(m, state);
+			auto ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+			if(i > 0)
+				res.nanoseconds.push_back(ns);
+		}
+		return res;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	setlocale(LC_ALL, "");
+	setlocale(LC_NUMERIC, "C");
+
+	//init path to db-connections.ini
+	if(auto monicaHome = getenv("MONICA_HOME"))
+	{
+		auto pathToFile = string(monicaHome) + Tools::pathSeparator() + "db-connections.ini";
+		//init for dll/so
+		initPathToDB(pathToFile);
+		//init for monica-kernel-bench
+		Db::dbConnectionParameters(pathToFile);
+	}
+
+	string pathToSimJson = "./sim.json";
+	int noOfSamples = 1000;
+	string filter;
+	string pathToJsonOutput;
+	bool listOnly = false;
+	//the states are captured at these days of the second year of the setup's climate data
+	vector<pair<string, string>> stateDays{{"winter", "01-20"}, {"spring", "05-15"}, {"summer", "06-25"}};
+
+	auto printHelp = [=]()
+	{
+		cout
+			<< appName << " [options] [path-to-sim-json]" << endl
+			<< endl
+			<< "Runs the given setup (default: " << pathToSimJson << ", e.g. installer/Hohenfinow2/sim.json) until some days" << endl
+			<< "of its second year, captures the model states and times single calls of the physics kernels on copies of them." << endl
+			<< "Reports the median and minimum time per call." << endl
+			<< endl
+			<< "options:" << endl
+			<< endl
+			<< " -h | --help ... this help output" << endl
+			<< " -v | --version ... outputs " << appName << " version" << endl
+			<< endl
+			<< " -l | --list ... list the kernels" << endl
+			<< " -f | --filter TEXT ... run only kernels whose name contains TEXT" << endl
+			<< " -s | --samples NUMBER (default: " << noOfSamples << ") ... time every kernel NUMBER times per captured state" << endl
+			<< " -j | --json FILE ... write the results as JSON to FILE ('-' = stdout) to track them across versions" << endl;
+	};
+
+	for(auto i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if(arg == "-l" || arg == "--list")
+			listOnly = true;
+		else if((arg == "-f" || arg == "--filter")
+						&& i + 1 < argc)
+			filter = argv[++i];
+		else if((arg == "-s" || arg == "--samples")
+						&& i + 1 < argc)
+			noOfSamples = max(1, stoi(argv[++i]));
+		else if((arg == "-j" || arg == "--json")
+						&& i + 1 < argc)
+			pathToJsonOutput = argv[++i];
+		else if(arg == "-h" || arg == "--help")
+			printHelp(), exit(0);
+		else if(arg == "-v" || arg == "--version")
+			cout << appName << " version " << version << endl, exit(0);
+		else
+			pathToSimJson = argv[i];
+	}
+
+	auto ks = kernels();
+	if(listOnly)
+	{
+		for(const auto& k : ks)
+			cout << k.name << " ... " << k.description << (k.needsCrop ? " (states with a crop only)" : "") << endl;
+		return 0;
+	}
+
+	auto esetup = readScenarioSetup(pathToSimJson);
+	if(esetup.failure())
+	{
+		for(const auto& e : esetup.errors)
+			cerr << e << endl;
+		return 1;
+	}
+	const auto& setup = esetup.result;
+
+	auto startDate = Date::fromIsoDateString(setup.sim["climate.csv-options"]["start-date"].string_value());
+	if(!startDate.isValid())
+	{
+		cerr << "The setup has no valid climate.csv-options start-date." << endl;
+		return 1;
+	}
+	vector<pair<string, Date>> dates;
+	for(const auto& p : stateDays)
+		dates.push_back(make_pair(p.first, Date::fromIsoDateString(to_string(startDate.year() + 1) + "-" + p.second)));
+
+	auto estates = captureStates(setup, dates);
+	if(estates.failure())
+	{
+		for(const auto& e : estates.errors)
+			cerr << e << endl;
+		return 1;
+	}
+
+	//don't let JSON output on stdout be mixed with the table
+	ostream& out = pathToJsonOutput == "-" ? cerr : cout;
+	out
+		<< left << setw(52) << "kernel/state"
+		<< right << setw(12) << "median ns"
+		<< setw(12) << "min ns" << endl;
+
+	J11Array benchmarks;
+	for(const auto& kernel : ks)
+	{
+		if(!filter.empty() && kernel.name.find(filter) == string::npos)
+			continue;
+
+		for(const auto& state : estates.result)
+		{
+			if(kernel.needsCrop && !state.hasCrop())
+				continue;
+
+			auto res = runKernel(kernel, state, noOfSamples);
+			benchmarks.push_back(res.to_json());
+
+			out
+				<< left << setw(52) << res.name
+				<< right << fixed << setprecision(0)
+				<< setw(12) << res.median()
+				<< setw(12) << res.min() << endl;
+		}
+	}
+
+	if(!pathToJsonOutput.empty())
+	{
+		char date[32];
+		auto now = time(nullptr);
+		strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+		J11Array capturedStates;
+		for(const auto& s : estates.result)
+			capturedStates.push_back(J11Object{{"name", s.name}, {"date", s.date.toIsoDateString()}, {"crop", s.hasCrop()}});
+		J11Object context
+		{{"executable", appName}
+		,{"monica_version", VER_FILE_VERSION_STR}
+		,{"setup", pathToSimJson}
+		,{"num_cpus", int(thread::hardware_concurrency())}
+		,{"samples", noOfSamples}
+		,{"states", capturedStates}
+		,{"date", date}
+		};
+		auto json = Json(J11Object{{"context", context}, {"benchmarks", benchmarks}}).dump();
+		if(pathToJsonOutput == "-")
+			cout << json << endl;
+		else
+		{
+			ofstream ofs(pathToJsonOutput);
+			if(!ofs)
+			{
+				cerr << "Couldn't write JSON results to: " << pathToJsonOutput << endl;
+				return 1;
+			}
+			ofs << json << endl;
+		}
+	}
+
+	return 0;
+}
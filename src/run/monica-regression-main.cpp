@@ -0,0 +1,610 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+Authors:
+Michael Berg <michael.berg@zalf.de>
+
+Maintainers:
+Currently maintained by the authors.
+
+This file is part of the MONICA model.
+Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
+*/
+
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <algorithm>
+#include <cctype>
+
+#include "json11/json11.hpp"
+
+#include "tools/helper.h"
+#include "tools/algorithms.h"
+#include "tools/debug.h"
+#include "../run/run-monica.h"
+#include "json11/json11-helper.h"
+#include "scenario-setup.h"
+#include "../io/csv-format.h"
+#include "db/abstract-db-connections.h"
+
+using namespace std;
+using namespace Monica;
+using namespace Tools;
+using namespace json11;
+
+string appName = "monica-regression";
+string version = "1.0.0";
+
+namespace
+{
+	//! the references are kept apart from the shipped example outputs, so -u never overwrites those
+	const string pathToReferences = "testing/regression";
+
+	//! the tolerated deviation of a variable |actual - expected| <= abs + rel * |expected|
+	struct Tolerance
+	{
+		double abs{0};
+		double rel{1e-6};
+	};
+
+	//! the tolerances every scenario starts with, tiny absolute ones for the nitrogen pools which are often close to 0
+	map<string, Tolerance> defaultTolerances(const map<string, Tolerance>& additional = map<string, Tolerance>())
+	{
+		map<string, Tolerance> ts
+		{{"default", Tolerance()}
+		,{"NO3", {1e-9, 1e-6}}
+		,{"NH4", {1e-9, 1e-6}}
+		,{"NO2", {1e-9, 1e-6}}
+		,{"N2O", {1e-9, 1e-6}}
+		};
+		for(const auto& p : additional)
+			ts[p.first] = p.second;
+		return ts;
+	}
+
+	//! a reference scenario: a setup of the installer directory, its modification and the stored reference output
+	struct Scenario
+	{
+		string name;
+		string description;
+		string pathToSimJson; //!< relative to the installer directory
+		map<string, Tolerance> tolerances; //!< the tolerances the scenario is checked with, -t overrides single entries
+		function<Errors(ScenarioSetup&)> modify;
+		function<void(Env&)> modifyEnv;
+
+		//! relative to the installer directory
+		string pathToReference() const { return pathToReferences + "/" + name + ".csv"; }
+	};
+
+	Json cuttingWorkstep(string date)
+	{
+		return J11Object
+		{{"date", date}
+		,{"type", "Cutting"}
+		,{"organs", J11Object{{"Leaf", J11Array{15, "%", "left"}}, {"Shoot", J11Array{15, "%", "left"}}}}
+		,{"export", true}
+		};
+	}
+
+	vector<Scenario> scenarios()
+	{
+		vector<Scenario> ss;
+
+		ss.push_back({"hohenfinow2", "Hohenfinow2/sim.json as is", "Hohenfinow2/sim.json", defaultTolerances()});
+
+		ss.push_back({"hohenfinow2-min", "Hohenfinow2/sim-min.json as is", "Hohenfinow2/sim-min.json", defaultTolerances()});
+
+		ss.push_back({"shallow-groundwater", "Hohenfinow2 with the groundwater table between 0.8 m and 1.5 m",
+			"Hohenfinow2/sim.json", defaultTolerances({{"Groundw", {1e-6, 1e-6}}, {"Recharge", {1e-6, 1e-6}}}), nullptr,
+			[](Env& env)
+			{
+				auto& ueps = env.params.userEnvironmentParameters;
+				ueps.p_MinGroundwaterDepth = 1.5;
+				ueps.p_MaxGroundwaterDepth = 0.8;
+				ueps.p_MinGroundwaterDepthMonth = 3;
+			}});
+
+		ss.push_back({"frost", "Hohenfinow2 with 12 degC colder winters (December to February)",
+			"Hohenfinow2/sim.json", defaultTolerances({{"FrostD", {1e-6, 1e-6}}, {"ThawD", {1e-6, 1e-6}}, {"SnowD", {1e-6, 1e-6}}}),
+			[](ScenarioSetup& s)
+			{
+				return modifyClimate(s, [](int month, map<string, double>& values)
+				{
+					if(month == 12 || month <= 2)
+						for(auto acd : {"tmin", "tavg", "tmax"})
+							if(values.find(acd) != values.end())
+								values[acd] -= 12.0;
+				});
+			}});
+
+		ss.push_back({"heavy-organic-fertilization", "Hohenfinow2 winter wheat with 9 organic fertilizations of 10 t per rotation",
+			"Hohenfinow2/sim.json", defaultTolerances(),
+			[](ScenarioSetup& s)
+			{
+				s.crop = withValue(withoutKey(s.crop, "cropRotations"), "cropRotation", heavyOrganicFertilizationRotation());
+				return Errors();
+			}});
+
+		ss.push_back({"perennial-cutting", "Hohenfinow2 with clover grass ley cut three times a year",
+			"Hohenfinow2/sim.json", defaultTolerances(),
+			[](ScenarioSetup& s)
+			{
+				J11Array wss{J11Object{{"date", "0000-04-01"}, {"type", "Sowing"}, {"crop", J11Array{"ref", "crops", "CGL"}}}};
+				for(auto date : {"0000-06-20", "0000-08-20", "0001-05-20", "0001-07-15", "0001-09-10"})
+					wss.push_back(cuttingWorkstep(date));
+				wss.push_back(J11Object{{"date", "0001-10-31"}, {"type", "Harvest"}});
+				s.crop = withValue(withoutKey(s.crop, "cropRotations"), "cropRotation", J11Array{J11Object{{"worksteps", wss}}});
+				return Errors();
+			}});
+
+		return ss;
+	}
+
+	//---------------------------------------------------------------------------
+
+	//! the tolerance of a column, by its full name (e.g. Mois_1) or its base name (Mois), else the "default" one
+	Tolerance toleranceFor(const map<string, Tolerance>& tolerances, const string& column)
+	{
+		auto it = tolerances.find(column);
+		if(it == tolerances.end())
+			it = tolerances.find(column.substr(0, column.find_first_of("_/")));
+		if(it == tolerances.end())
+			it = tolerances.find("default");
+		return it == tolerances.end() ? Tolerance() : it->second;
+	}
+
+	//! one unit in the last decimal digit of a written number (the references are rounded), 0 for integers
+	double lastDigitUnit(const string& number)
+	{
+		auto dot = number.find('.');
+		if(dot == string::npos || number.find_first_of("eE") != string::npos)
+			return 0;
+		return pow(10.0, -double(number.size() - dot - 1));
+	}
+
+	bool toNumber(const string& s, double& d)
+	{
+		if(s.empty())
+			return false;
+		char* end = nullptr;
+		d = strtod(s.c_str(), &end);
+		return end && *end == '\0';
+	}
+
+	//---------------------------------------------------------------------------
+
+	//! a section of a MONICA CSV output (as written by monica-run)
+	struct Section
+	{
+		string name;
+		vector<string> columns;
+		vector<vector<string>> rows;
+	};
+
+	//! split a CSV line at sep, sep within double quotes doesn't split
+	vector<string> splitCSVLine(const string& line, const string& sep)
+	{
+		vector<string> cells;
+		string cell;
+		bool quoted = false;
+		for(size_t i = 0; i < line.size(); i++)
+		{
+			char c = line[i];
+			if(c == '"')
+				quoted = !quoted;
+			else if(!quoted && line.compare(i, sep.size(), sep) == 0)
+			{
+				cells.push_back(cell);
+				cell.clear();
+				i += sep.size() - 1;
+			}
+			else
+				cell += c;
+		}
+		cells.push_back(cell);
+		return cells;
+	}
+
+	//! units rows ([m3 m-3]) and aggregation rows (j:Mois) between the header and the data rows
+	bool isAdditionalHeaderRow(const vector<string>& cells)
+	{
+		const auto& c = cells.front();
+		return (!c.empty() && c[0] == '[') || (c.size() >= 2 && islower(c[0]) && c[1] == ':');
+	}
+
+	/*!
+	 * Parse a MONICA CSV output: sections separated by empty lines, each starting with the event specification,
+	 * followed by the header row, optional units and aggregation rows and the data rows.
+	 */
+	vector<Section> parseOutputCSV(const string& text, const string& sep)
+	{
+		vector<Section> ss;
+		bool inSection = false;
+		istringstream iss(text);
+		string line;
+		while(getline(iss, line))
+		{
+			line = trim(line, "\r");
+			if(line.empty())
+			{
+				inSection = false;
+				continue;
+			}
+
+			auto cells = splitCSVLine(line, sep);
+			if(!inSection)
+			{
+				ss.push_back(Section());
+				ss.back().name = cells.front();
+				inSection = true;
+			}
+			else if(ss.back().columns.empty())
+				ss.back().columns = cells;
+			else if(!(ss.back().rows.empty() && isAdditionalHeaderRow(cells)))
+				ss.back().rows.push_back(cells);
+		}
+		return ss;
+	}
+
+	string outputToCSV(const Output& output, const Env& env, const Json& csvOptions, const string& sep)
+	{
+		ostringstream out;
+		for(const auto& d : output.data)
+		{
+			out << "\"" << replace(d.origSpec, "\"", "") << "\"" << endl;
+			writeOutputHeaderRows(out, d.outputIds, sep, true,
+														csvOptions["include-units-row"].bool_value(),
+														csvOptions["include-aggregation-rows"].bool_value());
+			if(env.returnObjOutputs())
+				writeOutputObj(out, d.outputIds, d.resultsObj, sep);
+			else
+				writeOutput(out, d.outputIds, d.results, sep);
+			out << endl;
+		}
+		return out.str();
+	}
+
+	//---------------------------------------------------------------------------
+
+	struct Divergence
+	{
+		size_t noOfValues{0};
+		size_t noOfDivergentValues{0};
+		vector<string> structural; //!< missing sections, columns or rows
+		string first; //!< the first divergent value
+
+		struct Variable
+		{
+			size_t count{0};
+			double maxAbsDiff{0};
+		};
+		vector<pair<string, Variable>> variables; //!< in the order of their first divergence
+
+		bool diverges() const { return noOfDivergentValues > 0 || !structural.empty(); }
+
+		Variable& variable(const string& name)
+		{
+			for(auto& p : variables)
+				if(p.first == name)
+					return p.second;
+			variables.push_back(make_pair(name, Variable()));
+			return variables.back().second;
+		}
+	};
+
+	//! compare the sections of actual with the ones of expected, day by day (row by row) and variable by variable
+	Divergence compare(const vector<Section>& expected, const vector<Section>& actual, const map<string, Tolerance>& tolerances)
+	{
+		Divergence div;
+		if(expected.size() != actual.size())
+			div.structural.push_back("expected " + to_string(expected.size()) + " sections, got " + to_string(actual.size()));
+
+		for(size_t si = 0; si < min(expected.size(), actual.size()); si++)
+		{
+			const auto& es = expected[si];
+			const auto& as = actual[si];
+			string section = "section '" + es.name + "'";
+			if(es.name != as.name)
+				div.structural.push_back(section + ": got section '" + as.name + "' instead");
+			if(es.columns != as.columns)
+			{
+				size_t ci = 0;
+				while(ci < es.columns.size() && ci < as.columns.size() && es.columns[ci] == as.columns[ci])
+					ci++;
+				div.structural.push_back(section + ": columns differ from column " + to_string(ci + 1) + " on, expected "
+																 + to_string(es.columns.size()) + " columns, got " + to_string(as.columns.size()));
+			}
+			if(es.rows.size() != as.rows.size())
+			{
+				auto n = min(es.rows.size(), as.rows.size());
+				const auto& longer = es.rows.size() > n ? es.rows : as.rows;
+				div.structural.push_back(section + ": expected " + to_string(es.rows.size()) + " rows, got "
+																 + to_string(as.rows.size()) + ", first unmatched row starts with '"
+																 + longer[n].front() + "'");
+			}
+
+			auto rowKey = [&](const vector<string>& row)
+			{
+				return (es.columns.empty() ? string("row") : es.columns.front()) + "=" + row.front();
+			};
+
+			for(size_t ri = 0; ri < min(es.rows.size(), as.rows.size()); ri++)
+			{
+				const auto& er = es.rows[ri];
+				const auto& ar = as.rows[ri];
+				for(size_t ci = 0; ci < min(er.size(), ar.size()); ci++)
+				{
+					string column = ci < es.columns.size() ? es.columns[ci] : "column " + to_string(ci + 1);
+					div.noOfValues++;
+
+					double e = 0, a = 0;
+					bool numeric = toNumber(er[ci], e) && toNumber(ar[ci], a);
+					double diff = numeric ? fabs(a - e) : 0;
+					bool diverges = false;
+					if(numeric)
+					{
+						auto t = toleranceFor(tolerances, column);
+						diverges = !(diff <= t.abs + t.rel * fabs(e) + lastDigitUnit(er[ci]));
+					}
+					else
+						diverges = er[ci] != ar[ci];
+					if(!diverges)
+						continue;
+
+					div.noOfDivergentValues++;
+					auto& v = div.variable(column);
+					v.count++;
+					v.maxAbsDiff = max(v.maxAbsDiff, diff);
+					if(div.first.empty())
+					{
+						ostringstream oss;
+						oss.precision(10);
+						oss << section << " " << rowKey(er) << " " << column
+							<< ": expected " << er[ci] << ", got " << ar[ci];
+						if(numeric)
+							oss << " (|diff| " << diff << ")";
+						div.first = oss.str();
+					}
+				}
+				if(er.size() != ar.size() && div.first.empty())
+					div.first = section + " " + rowKey(er) + ": expected " + to_string(er.size())
+						+ " values, got " + to_string(ar.size());
+			}
+		}
+		return div;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	setlocale(LC_ALL, "");
+	setlocale(LC_NUMERIC, "C");
+
+	//init path to db-connections.ini
+	if(auto monicaHome = getenv("MONICA_HOME"))
+	{
+		auto pathToFile = string(monicaHome) + Tools::pathSeparator() + "db-connections.ini";
+		//init for dll/so
+		initPathToDB(pathToFile);
+		//init for monica-regression
+		Db::dbConnectionParameters(pathToFile);
+	}
+
+	string pathToInstallerDir = "./installer";
+	string filter;
+	string scenarioName;
+	string pathToOutput;
+	bool listOnly = false;
+	bool updateReferences = false;
+	bool requireReferences = false;
+	map<string, Tolerance> tolerances;
+
+	auto printHelp = [=]()
+	{
+		cout
+			<< appName << " [options] [path-to-installer-dir]" << endl
+			<< endl
+			<< "Runs the reference scenarios (setups in the installer directory, default: " << pathToInstallerDir << ")" << endl
+			<< "and compares every output value with the stored references (in " << pathToReferences << " of the installer directory)," << endl
+			<< "reports the first divergent day and variable." << endl
+			<< "Values diverge if |actual - expected| > abs + rel * |expected| + one unit in the last digit of expected." << endl
+			<< "Exits with 1 if a scenario diverges or fails, scenarios without reference are skipped (unless -r is given)." << endl
+			<< "MONICA_PARAMETERS has to point to the monica-parameters repository." << endl
+			<< endl
+			<< "options:" << endl
+			<< endl
+			<< " -h | --help ... this help output" << endl
+			<< " -v | --version ... outputs " << appName << " version" << endl
+			<< endl
+			<< " -l | --list ... list the scenarios" << endl
+			<< " -f | --filter TEXT ... run only scenarios whose name contains TEXT" << endl
+			<< " -s | --scenario NAME ... run only the scenario NAME" << endl
+			<< " -r | --require-reference ... fail scenarios without reference instead of skipping them" << endl
+			<< " -t | --tolerance NAME=ABS[,REL] ... overrides the scenario's tolerance of variable NAME" << endl
+			<< "                                   (e.g. Mois_1, Mois for all layers or default for all others)" << endl
+			<< " -o | --path-to-output DIRECTORY ... write the outputs of the diverging scenarios to DIRECTORY" << endl
+			<< " -u | --update ... write the outputs as new references (after verifying the changes)" << endl;
+	};
+
+	for(auto i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if(arg == "-l" || arg == "--list")
+			listOnly = true;
+		else if((arg == "-f" || arg == "--filter")
+						&& i + 1 < argc)
+			filter = argv[++i];
+		else if((arg == "-s" || arg == "--scenario")
+						&& i + 1 < argc)
+			scenarioName = argv[++i];
+		else if(arg == "-r" || arg == "--require-reference")
+			requireReferences = true;
+		else if((arg == "-t" || arg == "--tolerance")
+						&& i + 1 < argc)
+		{
+			auto nameAndValues = splitString(argv[++i], "=");
+			auto values = nameAndValues.size() == 2 ? splitString(nameAndValues[1], ",") : vector<string>();
+			if(values.empty() || values.size() > 2)
+			{
+				cerr << "Invalid tolerance: " << argv[i] << ", expected NAME=ABS[,REL]" << endl;
+				return 1;
+			}
+			Tolerance t;
+			t.abs = stod(values[0]);
+			if(values.size() == 2)
+				t.rel = stod(values[1]);
+			tolerances[nameAndValues[0]] = t;
+		}
+		else if((arg == "-o" || arg == "--path-to-output")
+						&& i + 1 < argc)
+			pathToOutput = argv[++i];
+		else if(arg == "-u" || arg == "--update")
+			updateReferences = true;
+		else if(arg == "-h" || arg == "--help")
+			printHelp(), exit(0);
+		else if(arg == "-v" || arg == "--version")
+			cout << appName << " version " << version << endl, exit(0);
+		else
+			pathToInstallerDir = argv[i];
+	}
+
+	auto scens = scenarios();
+	if(listOnly)
+	{
+		for(const auto& s : scens)
+			cout << s.name << " ... " << s.description << " (reference: " << s.pathToReference() << ")" << endl;
+		return 0;
+	}
+
+	auto inInstallerDir = [&](const string& path) { return fixSystemSeparator(pathToInstallerDir + "/" + path); };
+
+	if(!scenarioName.empty()
+		 && find_if(scens.begin(), scens.end(), [&](const Scenario& s) { return s.name == scenarioName; }) == scens.end())
+	{
+		cerr << "Unknown scenario: " << scenarioName << ", see -l for the available ones" << endl;
+		return 1;
+	}
+
+	int exitCode = 0;
+	for(const auto& scenario : scens)
+	{
+		if(!filter.empty() && scenario.name.find(filter) == string::npos)
+			continue;
+		if(!scenarioName.empty() && scenario.name != scenarioName)
+			continue;
+
+		auto fail = [&](const vector<string>& errors)
+		{
+			cout << scenario.name << ": FAILED" << endl;
+			for(const auto& e : errors)
+				cout << "  " << e << endl;
+			exitCode = 1;
+		};
+
+		auto esetup = readScenarioSetup(inInstallerDir(scenario.pathToSimJson));
+		if(esetup.failure())
+		{
+			fail(esetup.errors);
+			continue;
+		}
+		auto& setup = esetup.result;
+		if(scenario.modify)
+		{
+			auto es = scenario.modify(setup);
+			if(es.failure())
+			{
+				fail(es.errors);
+				continue;
+			}
+		}
+
+		auto eenv = createScenarioEnv(setup);
+		if(eenv.failure())
+		{
+			fail(eenv.errors);
+			continue;
+		}
+		auto& env = eenv.result;
+		if(scenario.modifyEnv)
+			scenario.modifyEnv(env);
+		env.debugMode = false;
+
+		auto output = runMonica(env);
+		if(!output.errors.empty())
+		{
+			fail(output.errors);
+			continue;
+		}
+
+		const auto& csvOptions = setup.sim["output"]["csv-options"];
+		string sep = csvOptions["csv-separator"].string_value();
+		if(sep.empty())
+			sep = ",";
+		auto csv = outputToCSV(output, env, csvOptions, sep);
+
+		auto pathToReference = inInstallerDir(scenario.pathToReference());
+		if(updateReferences)
+		{
+			ensureDirExists(inInstallerDir(pathToReferences));
+			ofstream ofs(pathToReference);
+			ofs << csv;
+			if(ofs.fail())
+				fail({"Couldn't write reference: " + pathToReference});
+			else
+				cout << scenario.name << ": wrote reference " << pathToReference << endl;
+			continue;
+		}
+
+		auto ref = readFile(pathToReference);
+		if(ref.failure())
+		{
+			if(requireReferences)
+			{
+				fail({"No reference " + pathToReference + " (create it with -u)"});
+				continue;
+			}
+			cout << scenario.name << ": SKIPPED, no reference " << pathToReference << " (create it with -u)" << endl;
+			continue;
+		}
+
+		auto scenarioTolerances = scenario.tolerances;
+		for(const auto& p : tolerances)
+			scenarioTolerances[p.first] = p.second;
+		auto div = compare(parseOutputCSV(ref.result, sep), parseOutputCSV(csv, sep), scenarioTolerances);
+		if(!div.diverges())
+		{
+			cout << scenario.name << ": OK (" << div.noOfValues << " values)" << endl;
+			continue;
+		}
+
+		exitCode = 1;
+		cout << scenario.name << ": DIVERGES, " << div.noOfDivergentValues << " of " << div.noOfValues << " values" << endl;
+		for(const auto& s : div.structural)
+			cout << "  " << s << endl;
+		if(!div.first.empty())
+			cout << "  first: " << div.first << endl;
+		for(const auto& p : div.variables)
+			cout << "  " << p.first << ": " << p.second.count << " values, max |diff| " << p.second.maxAbsDiff << endl;
+
+		if(!pathToOutput.empty())
+		{
+			ensureDirExists(pathToOutput);
+			auto pathToFile = fixSystemSeparator(pathToOutput + "/" + scenario.name + ".csv");
+			ofstream ofs(pathToFile);
+			ofs << csv;
+			cout << "  output: " << pathToFile << endl;
+		}
+	}
+
+	return exitCode;
+}
@@ -19,6 +19,7 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 #include <fstream>
 #include <string>
 #include <tuple>
+#include <iomanip>
 
 #include "json11/json11.hpp"
 
@@ -55,6 +56,8 @@ int main(int argc, char** argv)
 	}
 	
 	bool debug = false, debugSet = false;
+	bool profile = false;
+	bool memoryStats = false;
 	string startDate, endDate;
 	string pathToOutput;
 	string pathToOutputFile;
@@ -73,6 +76,8 @@ int main(int argc, char** argv)
 			<< " -v   | --version ... outputs " << appName << " version" << endl
 			<< endl
 			<< " -d   | --debug ... show debug outputs" << endl
+			<< " -p   | --profile ... print the time spent in MONICA's modules after the run" << endl
+			<< " -m   | --memory-stats ... print the allocations and memory use of the run" << endl
 			//<< " -sd  | --start-date ISO-DATE (default: start of given climate data) ... date in iso-date-format yyyy-mm-dd" << endl
 			//<< " -ed  | --end-date ISO-DATE (default: end of given climate data) ... date in iso-date-format yyyy-mm-dd" << endl
 			<< " -w   | --write-output-files ... write MONICA output files" << endl
@@ -91,6 +96,10 @@ int main(int argc, char** argv)
 			string arg = argv[i];
 			if(arg == "-d" || arg == "--debug")
 				debug = debugSet = true;
+			else if(arg == "-p" || arg == "--profile")
+				profile = true;
+			else if(arg == "-m" || arg == "--memory-stats")
+				memoryStats = true;
 			//else if((arg == "-sd" || arg == "--start-date")
 			//				&& i + 1 < argc)
 			//	startDate = argv[++i];
@@ -144,6 +153,11 @@ int main(int argc, char** argv)
 		//set debug mode in run-monica ... in libmonica has to be set separately in runMonica
 		activateDebug = simm["debug?"].bool_value();
 
+		if(profile)
+			simm["profile?"] = true;
+		if(memoryStats)
+			simm["memory-stats?"] = true;
+
 		if(!pathToOutput.empty())
 			simm["path-to-output"] = pathToOutput;
 
@@ -232,6 +246,11 @@ int main(int argc, char** argv)
 
 		Output output = runMonica(env);
 
+		if(!output.profile.is_null())
+			cerr << RunProfile::toTable(output.profile);
+		for(const auto& p : output.memoryStats.object_items())
+			cerr << p.first << ": " << fixed << setprecision(1) << p.second.number_value() << endl;
+
 		if(pathToOutputFile.empty() && simm["output"]["write-file?"].bool_value())
 			pathToOutputFile = fixSystemSeparator(simm["output"]["path-to-output"].string_value() + "/"
 																						+ simm["output"]["file-name"].string_value());
@@ -0,0 +1,395 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+Authors:
+Michael Berg <michael.berg@zalf.de>
+
+Maintainers:
+Currently maintained by the authors.
+
+This file is part of the MONICA model.
+Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
+*/
+
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <mutex>
+#include <memory>
+#include <algorithm>
+
+#include "json11/json11.hpp"
+
+#include "tools/helper.h"
+#include "tools/debug.h"
+#include "../run/run-monica.h"
+#include "json11/json11-helper.h"
+#include "env-from-json-config.h"
+#include "parameter-sweep.h"
+#include "calibration.h"
+#include "result-cache.h"
+#include "tools/algorithms.h"
+#include "../io/csv-format.h"
+#include "db/abstract-db-connections.h"
+
+using namespace std;
+using namespace Monica;
+using namespace Tools;
+using namespace json11;
+
+string appName = "monica-sweep";
+string version = "1.0.0";
+
+namespace
+{
+	//! prefix all lines in text by prefix
+	string prefixLines(const string& text, const string& prefix)
+	{
+		string res;
+		istringstream iss(text);
+		for(string line; getline(iss, line);)
+			res += prefix + line + "\n";
+		return res;
+	}
+
+	string makeAbsolute(const string& pathOfSimJson, const string& path)
+	{
+		return isAbsolutePath(path) ? path : pathOfSimJson + path;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	setlocale(LC_ALL, "");
+	setlocale(LC_NUMERIC, "C");
+
+	//init path to db-connections.ini
+	if(auto monicaHome = getenv("MONICA_HOME"))
+	{
+		auto pathToFile = string(monicaHome) + Tools::pathSeparator() + "db-connections.ini";
+		//init for dll/so
+		initPathToDB(pathToFile);
+		//init for monica-sweep
+		Db::dbConnectionParameters(pathToFile);
+	}
+
+	string pathToSimJson = "./sim.json", pathToSweepJson = "./sweep.json", pathToCalibrationJson;
+	string pathToOutputFile;
+	string crop, site, climate;
+	int noOfThreads = -1;
+	string pathToResultCache;
+	bool useResultCache = false;
+
+	auto printHelp = [=]()
+	{
+		cout
+			<< appName << " [options] path-to-sim-json" << endl
+			<< endl
+			<< "runs MONICA for all parameter combinations defined in the sweep specification and" << endl
+			<< "writes the results of all runs into a single table" << endl
+			<< "or calibrates parameters against observations (--calibrate)" << endl
+			<< endl
+			<< "options:" << endl
+			<< endl
+			<< " -h   | --help ... this help output" << endl
+			<< " -v   | --version ... outputs " << appName << " version" << endl
+			<< endl
+			<< " -sw  | --path-to-sweep FILE (default: ./sweep.json) ... path to sweep specification" << endl
+			<< " -cal | --calibrate FILE ... calibrate the parameters defined in FILE instead of running a sweep" << endl
+			<< " -t   | --threads NUMBER (default: value of sweep.json:threads or number of cores) ... number of parallel runs" << endl
+			<< " -o   | --path-to-output-file FILE (default: stdout) ... path to output file" << endl
+			<< " -c   | --path-to-crop FILE (default: ./crop.json) ... path to crop.json file" << endl
+			<< " -s   | --path-to-site FILE (default: ./site.json) ... path to site.json file" << endl
+			<< " -w   | --path-to-climate FILE (default: ./climate.csv) ... path to climate.csv" << endl
+			<< " -rc  | --result-cache [DIR] ... reuse the results of runs which have been run before, keep them in DIR if given" << endl;
+	};
+
+	if(argc <= 1)
+	{
+		printHelp();
+		return 0;
+	}
+
+	for(auto i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if((arg == "-sw" || arg == "--path-to-sweep")
+			 && i + 1 < argc)
+			pathToSweepJson = argv[++i];
+		else if((arg == "-cal" || arg == "--calibrate")
+						&& i + 1 < argc)
+			pathToCalibrationJson = argv[++i];
+		else if((arg == "-t" || arg == "--threads")
+						&& i + 1 < argc)
+			noOfThreads = stoi(argv[++i]);
+		else if((arg == "-o" || arg == "--path-to-output-file")
+						&& i + 1 < argc)
+			pathToOutputFile = argv[++i];
+		else if((arg == "-c" || arg == "--path-to-crop")
+						&& i + 1 < argc)
+			crop = argv[++i];
+		else if((arg == "-s" || arg == "--path-to-site")
+						&& i + 1 < argc)
+			site = argv[++i];
+		else if((arg == "-w" || arg == "--path-to-climate")
+						&& i + 1 < argc)
+			climate = argv[++i];
+		else if(arg == "-rc" || arg == "--result-cache")
+		{
+			useResultCache = true;
+			if(i + 1 < argc && argv[i + 1][0] != '-')
+				pathToResultCache = argv[++i];
+		}
+		else if(arg == "-h" || arg == "--help")
+			printHelp(), exit(0);
+		else if(arg == "-v" || arg == "--version")
+			cout << appName << " version " << version << endl, exit(0);
+		else
+			pathToSimJson = argv[i];
+	}
+
+	string pathOfSimJson, simFileName;
+	tie(pathOfSimJson, simFileName) = splitPathToFile(pathToSimJson);
+
+	auto simj = readAndParseJsonFile(pathToSimJson);
+	if(simj.failure())
+	{
+		for(auto e : simj.errors)
+			cerr << e << endl;
+		return 1;
+	}
+	auto simm = simj.result.object_items();
+	simm["sim.json"] = pathToSimJson;
+	//the runs are independent of each other, so no debug output
+	simm["debug?"] = false;
+
+	simm["crop.json"] = makeAbsolute(pathOfSimJson, crop.empty() ? simm["crop.json"].string_value() : crop);
+	simm["site.json"] = makeAbsolute(pathOfSimJson, site.empty() ? simm["site.json"].string_value() : site);
+	if(!climate.empty())
+		simm["climate.csv"] = climate;
+	if(simm["climate.csv"].is_string())
+		simm["climate.csv"] = makeAbsolute(pathOfSimJson, simm["climate.csv"].string_value());
+	else if(simm["climate.csv"].is_array())
+	{
+		vector<string> ps;
+		for(auto j : simm["climate.csv"].array_items())
+			ps.push_back(makeAbsolute(pathOfSimJson, j.string_value()));
+		simm["climate.csv"] = toPrimJsonArray(ps);
+	}
+
+	//the base env is created just once, the runs only get their parameters changed in memory
+	map<string, string> ps;
+	ps["sim-json-str"] = json11::Json(simm).dump();
+	ps["crop-json-str"] = printPossibleErrors(readFile(simm["crop.json"].string_value()), activateDebug);
+	ps["site-json-str"] = printPossibleErrors(readFile(simm["site.json"].string_value()), activateDebug);
+	auto baseEnv = createEnvFromJsonConfigFiles(ps);
+
+	ofstream fout;
+	if(!pathToOutputFile.empty())
+	{
+		string path, filename;
+		tie(path, filename) = splitPathToFile(pathToOutputFile);
+		if(!path.empty() && !Tools::ensureDirExists(path))
+			cerr << "Error failed to create path: '" << path << "'." << endl;
+		fout.open(pathToOutputFile);
+		if(fout.fail())
+		{
+			cerr << "Error while opening output file \"" << pathToOutputFile << "\"" << endl;
+			return 1;
+		}
+	}
+	ostream& out = fout.is_open() ? fout : cout;
+
+	if(!pathToCalibrationJson.empty())
+	{
+		auto calj = readAndParseJsonFile(pathToCalibrationJson);
+		if(calj.failure())
+		{
+			for(auto e : calj.errors)
+				cerr << e << endl;
+			return 1;
+		}
+		//a relative observations file is relative to the calibration file
+		auto calm = calj.result.object_items();
+		string pathOfCalJson, calFileName;
+		tie(pathOfCalJson, calFileName) = splitPathToFile(pathToCalibrationJson);
+		if(calm["path-to-observations-csv"].is_string())
+			calm["path-to-observations-csv"] = makeAbsolute(pathOfCalJson, calm["path-to-observations-csv"].string_value());
+
+		CalibrationSpec calSpec;
+		auto es = calSpec.merge(calm);
+		if(es.failure())
+		{
+			for(auto e : es.errors)
+				cerr << e << endl;
+			return 1;
+		}
+		if(noOfThreads >= 0)
+			calSpec.noOfThreads = size_t(noOfThreads);
+
+		auto res = calibrate(baseEnv, calSpec, [](size_t generation, const CalibrationResult& r)
+		{
+			cerr << "generation " << generation << ": best objective value: " << r.bestObjectiveValue << endl;
+		});
+		if(!res.errors.empty())
+		{
+			for(auto e : res.errors)
+				cerr << e << endl;
+			return 1;
+		}
+
+		J11Object bestPs;
+		for(size_t i = 0; i < calSpec.parameters.size() && i < res.bestValues.size(); i++)
+			bestPs[calSpec.parameters[i].path.path] = res.bestValues[i];
+		out << Json(J11Object
+		{{"objective", calSpec.objective}
+		,{"bestObjectiveValue", res.bestObjectiveValue}
+		,{"noOfEvaluations", int(res.noOfEvaluations)}
+		,{"noOfFailedEvaluations", int(res.noOfFailedEvaluations)}
+		,{"parameters", bestPs}
+		,{"bestObjectiveValuePerGeneration", toPrimJsonArray(res.bestObjectiveValuePerGeneration)}
+		}).dump() << endl;
+
+		return 0;
+	}
+
+	auto sweepj = readAndParseJsonFile(pathToSweepJson);
+	if(sweepj.failure())
+	{
+		for(auto e : sweepj.errors)
+			cerr << e << endl;
+		return 1;
+	}
+	SweepSpec spec;
+	auto es = spec.merge(sweepj.result);
+	if(es.failure())
+	{
+		for(auto e : es.errors)
+			cerr << e << endl;
+		return 1;
+	}
+	if(noOfThreads >= 0)
+		spec.noOfThreads = size_t(noOfThreads);
+
+	auto paths = spec.paths();
+	auto design = createSweepDesign(spec);
+
+	string csvSep = simm["output"]["csv-options"]["csv-separator"].string_value();
+	if(csvSep.empty())
+		csvSep = ",";
+	bool includeUnitsRow = simm["output"]["csv-options"]["include-units-row"].bool_value();
+
+	//the formatted rows per run and output section
+	vector<vector<string>> rows(design.size());
+	//the errors per run, a failing run must not abort the whole sweep
+	vector<vector<string>> runErrors(design.size());
+	vector<pair<string, vector<OId>>> sections;
+	mutex sectionsMutex;
+	unique_ptr<ResultCache> resultCache;
+	if(useResultCache)
+		resultCache.reset(new ResultCache(pathToResultCache));
+
+	runInParallel(design.size(), spec.noOfThreads, [&](size_t run)
+	{
+		Env env = baseEnv;
+		auto es = setParameterValues(env, paths, design[run]);
+		runErrors[run] = es.errors;
+
+		Output output;
+		//an exception escaping a thread of runInParallel would terminate the whole sweep
+		try
+		{
+			output = resultCache ? resultCache->runMonica(env) : runMonica(env);
+		}
+		catch(exception& e)
+		{
+			output.errors.push_back(string("Exception while running: ") + e.what());
+		}
+		catch(...)
+		{
+			output.errors.push_back("Unknown exception while running.");
+		}
+		runErrors[run].insert(runErrors[run].end(), output.errors.begin(), output.errors.end());
+		for(auto e : runErrors[run])
+			cerr << "run " << run << ": " << e << endl;
+
+		ostringstream prefix;
+		prefix << run << csvSep;
+		for(auto v : design[run])
+			prefix << v << csvSep;
+
+		for(const auto& d : output.data)
+		{
+			ostringstream oss;
+			if(env.returnObjOutputs())
+				writeOutputObj(oss, d.outputIds, d.resultsObj, csvSep);
+			else
+				writeOutput(oss, d.outputIds, d.results, csvSep);
+			rows[run].push_back(prefixLines(oss.str(), prefix.str()));
+		}
+
+		lock_guard<mutex> lock(sectionsMutex);
+		if(sections.empty())
+			for(const auto& d : output.data)
+				sections.push_back(make_pair(d.origSpec, d.outputIds));
+	});
+
+	if(resultCache)
+	{
+		auto s = resultCache->stats();
+		cerr << "result cache: " << s.hits << " hits, " << s.misses << " misses, hit rate: " << s.hitRate() << endl;
+	}
+
+	//a single table per output section, the runs as rows prefixed by the run number and parameter values
+	ostringstream headerPrefix, emptyPrefix;
+	headerPrefix << "run" << csvSep;
+	emptyPrefix << csvSep;
+	for(const auto& p : paths)
+	{
+		headerPrefix << p.path << csvSep;
+		emptyPrefix << csvSep;
+	}
+
+	for(size_t s = 0; s < sections.size(); s++)
+	{
+		out << "\"" << replace(sections[s].first, "\"", "") << "\"" << endl;
+
+		ostringstream header, units;
+		writeOutputHeaderRows(header, sections[s].second, csvSep, true, false, false);
+		out << prefixLines(header.str(), headerPrefix.str());
+		if(includeUnitsRow)
+		{
+			writeOutputHeaderRows(units, sections[s].second, csvSep, false, true, false);
+			out << prefixLines(units.str(), emptyPrefix.str());
+		}
+
+		for(const auto& runRows : rows)
+			if(s < runRows.size())
+				out << runRows[s];
+		out << endl;
+	}
+
+	//the errors of the failed runs as own table, so they can be told apart from the runs without results
+	if(any_of(runErrors.begin(), runErrors.end(), [](const vector<string>& es){ return !es.empty(); }))
+	{
+		out << "\"errors\"" << endl;
+		out << headerPrefix.str() << "error" << endl;
+		for(size_t run = 0; run < runErrors.size(); run++)
+		{
+			ostringstream prefix;
+			prefix << run << csvSep;
+			for(auto v : design[run])
+				prefix << v << csvSep;
+			for(const auto& e : runErrors[run])
+				out << prefix.str() << "\"" << replace(e, "\"", "'") << "\"" << endl;
+		}
+		out << endl;
+	}
+
+	return 0;
+}
@@ -17,8 +17,24 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 #include <iostream>
 #include <fstream>
 #include <cstdlib>
+#include <cerrno>
+#include <csignal>
 
 #include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+
+#ifndef WIN32
+#include <unistd.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
 
 #include "zeromq/zhelpers.hpp"
 #include "zeromq/zmq-helper.h"
@@ -34,14 +50,16 @@ using namespace json11;
 using namespace Monica;
 
 string appName = "monica-zmq-control";
-string version = "0.0.1";
+string version = "0.1.0";
 
-int stopMonicaProcesses(zmq::context_t& context,
+//! send count finish messages, returns the process ids of the MONICA processes which acknowledged them
+//! (0 for processes not sending their pid)
+vector<int> stopMonicaProcesses(zmq::context_t& context,
 	string proxyAddress,
 	int frontendProxyPort,
 	int count)
 {
-	int stopped = 0;
+	vector<int> stopped;
 
 	// setup a reply socket for managing (e.g. starting/stopping) MONICA processes
 	zmq::socket_t socket(context, ZMQ_REQ);
@@ -72,8 +90,8 @@ int stopMonicaProcesses(zmq::context_t& context,
 						auto msg = receiveMsg(socket);
 						if (msg.valid)
 						{
-							stopped++;
-							debug() << "Received ack: " << msg.type() << endl;
+							stopped.push_back(msg.json["pid"].int_value());
+							debug() << "Received ack: " << msg.type() << " from " << stopped.back() << endl;
 						}
 					}
 					catch (zmq::error_t e)
@@ -100,6 +118,489 @@ int stopMonicaProcesses(zmq::context_t& context,
 	return stopped;
 }
 
+namespace
+{
+	//! a MONICA server or proxy process started by monica-zmq-control
+	struct Worker
+	{
+		string group; //!< workers started with the same arguments
+		vector<string> args;
+		int cpu{-1}; //!< pinned to this cpu if >= 0
+		bool restart{true};
+		bool reportJobs{false};
+
+		int pid{-1};
+		int reportFd{-1};
+		string reportBuffer;
+		size_t noOfJobs{0}; //!< jobs of the current process
+		size_t noOfJobsBefore{0}; //!< jobs of the crashed processes before
+		int noOfRestarts{0};
+		bool stopping{false};
+
+		Json to_json() const
+		{
+			return J11Object
+			{{"pid", pid}
+			,{"group", group}
+			,{"cpu", cpu}
+			,{"jobs", int(noOfJobsBefore + noOfJobs)}
+			,{"restarts", noOfRestarts}
+			};
+		}
+	};
+
+	//! starts workers via fork/exec, reaps them and restarts crashed ones
+	//! on Windows the processes are just started and not being tracked
+	class Supervisor
+	{
+	public:
+		Supervisor(int maxNoOfRestarts) : _maxNoOfRestarts(maxNoOfRestarts) {}
+
+		bool start(string group, vector<string> args, int cpu, bool restart, bool reportJobs)
+		{
+			Worker w;
+			w.group = group;
+			w.args = args;
+			w.cpu = cpu;
+			w.restart = restart;
+			w.reportJobs = reportJobs;
+			if(!spawn(w))
+				return false;
+			_workers.push_back(w);
+			return true;
+		}
+
+		//! terminate the youngest count workers of group
+		int stop(const string& group, int count)
+		{
+			return stopYoungest(group, count);
+		}
+
+		//! mark the workers of group with the given pids (from the acks of finish messages sent via proxy or service)
+		//! as stopping, so they aren't counted as live anymore and won't be restarted when they exit
+		int markStopping(const string& group, const vector<int>& pids)
+		{
+			int marked = 0;
+			for(auto& w : _workers)
+			{
+				if(w.group == group && !w.stopping && w.pid > 0
+					 && find(pids.begin(), pids.end(), w.pid) != pids.end())
+					w.stopping = true, marked++;
+			}
+			return marked;
+		}
+
+		//! read the job reports, reap exited workers and restart the crashed ones
+		void update()
+		{
+#ifndef WIN32
+			for(auto& w : _workers)
+				readReports(w);
+
+			int status = 0;
+			int pid = 0;
+			while((pid = waitpid(-1, &status, WNOHANG)) > 0)
+			{
+				auto it = find_if(_workers.begin(), _workers.end(), [pid](const Worker& w){ return w.pid == pid; });
+				if(it == _workers.end())
+					continue;
+				auto& w = *it;
+				readReports(w);
+				closeReportFd(w);
+
+				bool crashed = WIFSIGNALED(status) || (WIFEXITED(status) && WEXITSTATUS(status) != 0);
+				//127 = couldn't exec the program, restarting won't help
+				bool execFailed = WIFEXITED(status) && WEXITSTATUS(status) == 127;
+				if(crashed && !w.stopping)
+				{
+					cerr << "Worker " << pid << " (" << w.group << ") died with "
+						<< (WIFSIGNALED(status) ? "signal " : "exit code ")
+						<< (WIFSIGNALED(status) ? WTERMSIG(status) : WEXITSTATUS(status)) << "!";
+					if(w.restart && !execFailed && (_maxNoOfRestarts < 0 || w.noOfRestarts < _maxNoOfRestarts))
+					{
+						w.noOfRestarts++;
+						w.noOfJobsBefore += w.noOfJobs;
+						if(spawn(w))
+						{
+							cerr << " Restarted as " << w.pid << "." << endl;
+							continue;
+						}
+					}
+					cerr << " Won't restart it." << endl;
+				}
+				else
+					debug() << "worker " << pid << " (" << w.group << ") exited" << endl;
+				_workers.erase(it);
+			}
+#endif
+		}
+
+		vector<int> reportFds() const
+		{
+			vector<int> fds;
+			for(const auto& w : _workers)
+				if(w.reportFd >= 0)
+					fds.push_back(w.reportFd);
+			return fds;
+		}
+
+		int noOfLiveWorkers(const string& group) const
+		{
+			return int(count_if(_workers.begin(), _workers.end(),
+													[&](const Worker& w){ return w.group == group && !w.stopping; }));
+		}
+
+		//! cpu for the next worker to be pinned to
+		//! pinCpus: true -> round robin over all cpus, [0, 2, ...] -> round robin over the given cpus, else -1 (not pinned)
+		int nextCpu(const Json& pinCpus)
+		{
+			if(pinCpus.is_bool() && pinCpus.bool_value())
+				return int(_nextCpu++ % max(1u, thread::hardware_concurrency()));
+			else if(pinCpus.is_array() && !pinCpus.array_items().empty())
+				return pinCpus[_nextCpu++ % pinCpus.array_items().size()].int_value();
+			return -1;
+		}
+
+		//! the workers of group or all workers if group is empty
+		Json to_json(const string& group = string()) const
+		{
+			J11Array ws;
+			for(const auto& w : _workers)
+				if(group.empty() || w.group == group)
+					ws.push_back(w.to_json());
+			return ws;
+		}
+
+	private:
+		bool spawn(Worker& w)
+		{
+#ifdef WIN32
+			string cmd = "start /b";
+			for(auto a : w.args)
+				cmd += " " + a;
+			int res = system(cmd.c_str());
+			debug() << "result of running '" << cmd << "': " << res << endl;
+			return res == 0;
+#else
+			int fds[2] = {-1, -1};
+			if(w.reportJobs && pipe(fds) != 0)
+			{
+				cerr << "Couldn't create pipe for job reports of " << w.group << "! Error: " << errno << endl;
+				fds[0] = fds[1] = -1;
+			}
+
+			auto args = w.args;
+			if(fds[1] >= 0)
+				args.push_back("-rf"), args.push_back(to_string(fds[1]));
+			vector<char*> argv;
+			for(auto& a : args)
+				argv.push_back(&a[0]);
+			argv.push_back(nullptr);
+
+			int pid = fork();
+			if(pid == 0)
+			{
+				if(fds[0] >= 0)
+					close(fds[0]);
+#ifdef __linux__
+				if(w.cpu >= 0)
+				{
+					cpu_set_t cpus;
+					CPU_ZERO(&cpus);
+					CPU_SET(w.cpu, &cpus);
+					sched_setaffinity(0, sizeof(cpus), &cpus);
+				}
+#endif
+				execvp(argv[0], argv.data());
+				_exit(127);
+			}
+
+			if(fds[1] >= 0)
+				close(fds[1]);
+			if(pid < 0)
+			{
+				cerr << "Couldn't fork to start " << w.group << "! Error: " << errno << endl;
+				if(fds[0] >= 0)
+					close(fds[0]);
+				return false;
+			}
+			if(fds[0] >= 0)
+			{
+				fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+				fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+			}
+
+			debug() << "started " << w.group << " as " << pid << endl;
+			w.pid = pid;
+			w.reportFd = fds[0];
+			w.reportBuffer.clear();
+			w.noOfJobs = 0;
+			w.stopping = false;
+			return true;
+#endif
+		}
+
+		int stopYoungest(const string& group, int count)
+		{
+			int stopped = 0;
+#ifndef WIN32
+			for(auto it = _workers.rbegin(); it != _workers.rend() && stopped < count; ++it)
+			{
+				if(it->group != group || it->stopping || it->pid <= 0)
+					continue;
+				if(kill(it->pid, SIGTERM) == 0)
+					it->stopping = true, stopped++;
+			}
+#endif
+			return stopped;
+		}
+
+#ifndef WIN32
+		//! the workers write the number of jobs done so far as line after every job
+		void readReports(Worker& w)
+		{
+			if(w.reportFd < 0)
+				return;
+
+			char buf[4096];
+			ssize_t n = 0;
+			while((n = read(w.reportFd, buf, sizeof(buf))) > 0)
+				w.reportBuffer.append(buf, size_t(n));
+			if(n == 0)
+				closeReportFd(w);
+
+			size_t pos = 0;
+			while((pos = w.reportBuffer.find('\n')) != string::npos)
+			{
+				auto line = w.reportBuffer.substr(0, pos);
+				w.reportBuffer.erase(0, pos + 1);
+				try { w.noOfJobs = size_t(stoul(line)); }
+				catch(...) {}
+			}
+		}
+
+		void closeReportFd(Worker& w)
+		{
+			if(w.reportFd >= 0)
+				close(w.reportFd);
+			w.reportFd = -1;
+		}
+#endif
+
+		int _maxNoOfRestarts{-1};
+		size_t _nextCpu{0};
+		list<Worker> _workers;
+	};
+}
+
+namespace
+{
+	//! the MONICA servers described by a start message
+	struct ServerSpec
+	{
+		ServerSpec() {}
+
+		ServerSpec(const Json& fmsg, const string& pathToServer)
+		{
+			count = fmsg["count"].int_value();
+
+			string proxyAddress = fmsg["proxy-address"].string_value();
+			int proxyFrontendPort = fmsg["proxy-frontend-port"].int_value();
+			int proxyBackendPort = fmsg["proxy-backend-port"].int_value();
+
+			//string serviceAddress = fmsg["service-address"].string_value();
+			bool isService = !fmsg["service-port"].is_null();
+			int servicePort = fmsg["service-port"].int_value();
+
+			string controlAddresses = fmsg["control-addresses"].string_value();
+			string inputAddresses = fmsg["input-addresses"].string_value();
+			string outputAddresses = fmsg["output-addresses"].string_value();
+
+			//"pin-cpus": true -> pin the workers round robin to all cpus, [0, 2, ...] -> round robin to the given cpus
+			pinCpus = fmsg["pin-cpus"];
+			//"restart": false -> don't restart crashed workers
+			restart = fmsg["restart"].is_bool() ? fmsg["restart"].bool_value() : true;
+
+			vector<string> addresses;
+			if (!proxyAddress.empty())
+			{
+				stopAddress = proxyAddress, stopPort = proxyFrontendPort;
+				addresses = {"-p", string("tcp://") + proxyAddress + ":" + to_string(proxyBackendPort)};
+			}
+			else if (isService)
+			{
+				count = max(count, 1);
+				//stopAddress = "127.0.0.1", stopPort = servicePort;
+				stopAddress = "localhost", stopPort = servicePort;
+				addresses = {"-s", string("tcp://*:") + to_string(servicePort)};
+			}
+			else if (!outputAddresses.empty() && !inputAddresses.empty())
+				addresses = {"-i", inputAddresses, "-o", outputAddresses};
+			if (!addresses.empty() && !controlAddresses.empty())
+				addresses.push_back("-c"), addresses.push_back(controlAddresses);
+
+			args = {pathToServer};
+			args.insert(args.end(), addresses.begin(), addresses.end());
+			for (auto a : args)
+				group += (group.empty() ? "" : " ") + a;
+		}
+
+		int count{0};
+		vector<string> args;
+		string group;
+		//! where to send "finish" messages to, if empty the servers can't be finished gracefully
+		string stopAddress;
+		int stopPort{-1};
+		Json pinCpus;
+		bool restart{true};
+	};
+
+	//! the number of jobs sent but not yet answered, according to the proxy (and the output proxy in a pipeline),
+	//! -1 if unknown
+	int queryOutstandingJobs(zmq::context_t& context, const string& statsAddress, const string& outputStatsAddress)
+	{
+		auto query = [&](const string& address)
+		{
+			zmq::socket_t socket(context, ZMQ_REQ);
+			socket.setsockopt(ZMQ_LINGER, 0);
+			socket.setsockopt(ZMQ_RCVTIMEO, 1000);
+			socket.setsockopt(ZMQ_SNDTIMEO, 1000);
+			try
+			{
+				socket.connect(address);
+				if (s_send(socket, Json(J11Object{{"type", "stats"}}).dump()))
+				{
+					auto msg = receiveMsg(socket);
+					if (msg.valid && msg.type() == "stats")
+						return msg.json;
+				}
+			}
+			catch (zmq::error_t e)
+			{
+				debug() << "Couldn't get stats from proxy at: " << address << "! Error: [" << e.what() << "]" << endl;
+			}
+			return Json();
+		};
+
+		auto stats = query(statsAddress);
+		if (!stats.is_object())
+			return -1;
+		if (outputStatsAddress.empty())
+			return stats["outstanding"].int_value();
+
+		//in a pipeline the results leave via the output proxy
+		auto outStats = query(outputStatsAddress);
+		if (!outStats.is_object())
+			return -1;
+		return max(0, int(stats["requests"].number_value() - outStats["requests"].number_value()));
+	}
+
+	/*!
+	 * Starts workers while jobs are waiting for longer than scaleUpAfter seconds and
+	 * finishes idle workers (via "finish" messages, so they drain cleanly) after scaleDownAfter seconds,
+	 * always keeping between minNoOfWorkers and maxNoOfWorkers.
+	 * Workers without proxy or service address (pipeline workers) are just being terminated,
+	 * but only if no job is outstanding at all.
+	 */
+	struct Autoscaler
+	{
+		bool isActive() const { return maxNoOfWorkers > 0 && !statsAddress.empty(); }
+
+		Json to_json() const
+		{
+			return J11Object
+			{{"group", spec.group}
+			,{"min", minNoOfWorkers}
+			,{"max", maxNoOfWorkers}
+			,{"scale-up-after", scaleUpAfter}
+			,{"scale-down-after", scaleDownAfter}
+			,{"proxy-stats-address", statsAddress}
+			,{"output-proxy-stats-address", outputStatsAddress}
+			,{"outstanding", outstanding}
+			};
+		}
+
+		void step(zmq::context_t& context, Supervisor& supervisor)
+		{
+			auto now = chrono::steady_clock::now();
+			if (!isActive() || now - lastCheck < chrono::seconds(1))
+				return;
+			lastCheck = now;
+
+			int live = supervisor.noOfLiveWorkers(spec.group);
+			auto startWorkers = [&](int count)
+			{
+				for (int i = 0; i < count; i++)
+					supervisor.start(spec.group, spec.args, supervisor.nextCpu(spec.pinCpus), spec.restart, true);
+				debug() << "autoscaler: started " << count << " workers" << endl;
+			};
+
+			if (live < minNoOfWorkers)
+			{
+				startWorkers(minNoOfWorkers - live);
+				return;
+			}
+
+			outstanding = queryOutstandingJobs(context, statsAddress, outputStatsAddress);
+			if (outstanding < 0)
+				return;
+
+			//hysteresis: act only if the state lasted long enough
+			int backlog = outstanding - live;
+			if (backlog > 0 && live < maxNoOfWorkers)
+			{
+				if (!hasBacklog)
+					hasBacklog = true, backlogSince = now;
+				else if (now - backlogSince >= chrono::seconds(scaleUpAfter))
+				{
+					startWorkers(min(backlog, maxNoOfWorkers - live));
+					hasBacklog = false;
+				}
+			}
+			else
+				hasBacklog = false;
+
+			int idle = live - outstanding;
+			bool canStop = !spec.stopAddress.empty() || outstanding == 0;
+			if (idle > 0 && live > minNoOfWorkers && canStop)
+			{
+				if (!isIdle)
+					isIdle = true, idleSince = now;
+				else if (now - idleSince >= chrono::seconds(scaleDownAfter))
+				{
+					int count = min(idle, live - minNoOfWorkers);
+					int stopped = 0;
+					if (spec.stopAddress.empty())
+						stopped = supervisor.stop(spec.group, count);
+					else
+					{
+						auto pids = stopMonicaProcesses(context, spec.stopAddress, spec.stopPort, count);
+						stopped = int(pids.size());
+						supervisor.markStopping(spec.group, pids);
+					}
+					debug() << "autoscaler: stopped " << stopped << " workers" << endl;
+					isIdle = false;
+				}
+			}
+			else
+				isIdle = false;
+		}
+
+		ServerSpec spec;
+		string statsAddress;
+		string outputStatsAddress;
+		int minNoOfWorkers{0};
+		int maxNoOfWorkers{0};
+		int scaleUpAfter{5}; //!< seconds
+		int scaleDownAfter{60}; //!< seconds
+
+		int outstanding{-1};
+		bool hasBacklog{false};
+		bool isIdle{false};
+		chrono::steady_clock::time_point backlogSince, idleSince, lastCheck;
+	};
+}
+
 int main(int argc,
 	char** argv)
 {
@@ -108,6 +609,11 @@ int main(int argc,
 	int frontendProxyPort = defaultProxyFrontendPort;
 	int backendProxyPort = defaultProxyBackendPort;
 	bool prs = false;
+	string pathToServer = "monica-zmq-server";
+	string pathToProxy = "monica-zmq-proxy";
+	int maxNoOfRestarts = 10;
+	int proxyStatsPort = -1;
+	int autoscaleMin = 0, autoscaleMax = 0;
 
 	auto printHelp = [=]()
 	{
@@ -124,6 +630,11 @@ int main(int argc,
 			<< " -a | --proxy-address PROXY-ADDRESS (default: " << proxyAddress << ") ... connect client to give IP address" << endl
 			<< " -f | --frontend-proxy-port PROXY-PORT (default: " << frontendProxyPort << ") ... communicate with started MONICA ZeroMQ servers via given frontend proxy port" << endl
 			<< " -b | --backend-proxy-port PROXY-PORT (default: " << backendProxyPort << ") ... connect started MONICA ZeroMQ servers to given backend proxy port" << endl
+			<< " -sp | --server-path PATH (default: " << pathToServer << ") ... MONICA ZeroMQ server executable to start" << endl
+			<< " -pp | --proxy-path PATH (default: " << pathToProxy << ") ... MONICA ZeroMQ proxy executable to start" << endl
+			<< " -mr | --max-restarts NUMBER (default: " << maxNoOfRestarts << ") ... restart a crashed process at most NUMBER times (-1 = always)" << endl
+			<< " -ps | --proxy-stats-port STATS-PORT ... port of the proxy answering 'stats' requests (see monica-zmq-proxy -s)" << endl
+			<< " -as | --autoscale MIN MAX ... keep between MIN and MAX MONICA ZeroMQ servers connected to the backend proxy port, depending on the proxy's queue (needs -ps)" << endl
 			<< " -d | --debug ... enable debug outputs" << endl;
 	};
 
@@ -142,6 +653,21 @@ int main(int argc,
 		else if ((arg == "-b" || arg == "--backend-proxy-port")
 			&& i + 1 < argc)
 			backendProxyPort = stoi(argv[++i]);
+		else if ((arg == "-sp" || arg == "--server-path")
+			&& i + 1 < argc)
+			pathToServer = argv[++i];
+		else if ((arg == "-pp" || arg == "--proxy-path")
+			&& i + 1 < argc)
+			pathToProxy = argv[++i];
+		else if ((arg == "-mr" || arg == "--max-restarts")
+			&& i + 1 < argc)
+			maxNoOfRestarts = stoi(argv[++i]);
+		else if ((arg == "-ps" || arg == "--proxy-stats-port")
+			&& i + 1 < argc)
+			proxyStatsPort = stoi(argv[++i]);
+		else if ((arg == "-as" || arg == "--autoscale")
+			&& i + 2 < argc)
+			autoscaleMin = stoi(argv[++i]), autoscaleMax = stoi(argv[++i]);
 		else if (arg == "-prs" || arg == "--pull-router-sockets")
 			prs = true;
 		else if (arg == "-d" || arg == "--debug")
@@ -157,18 +683,45 @@ int main(int argc,
 	// setup a reply socket for managing (e.g. starting/stopping) MONICA processes
 	zmq::socket_t socket(context, ZMQ_REP);
 
+	Supervisor supervisor(maxNoOfRestarts);
+
+	Autoscaler autoscaler;
+	if (autoscaleMax > 0 && proxyStatsPort > 0)
+	{
+		autoscaler.spec = ServerSpec(J11Object
+			{{"proxy-address", proxyAddress}
+			,{"proxy-frontend-port", frontendProxyPort}
+			,{"proxy-backend-port", backendProxyPort}
+			}, pathToServer);
+		autoscaler.statsAddress = string("tcp://") + proxyAddress + ":" + to_string(proxyStatsPort);
+		autoscaler.minNoOfWorkers = autoscaleMin;
+		autoscaler.maxNoOfWorkers = autoscaleMax;
+	}
+	else if (autoscaleMax > 0)
+		cerr << "Autoscaling needs the proxy's stats port (-ps)!" << endl;
+
 	string address = string("tcp://*:") + to_string(commPort);
 	try
 	{
 		socket.bind(address);
 
-		map<string, int> started;
-
 		//loop until receive finish message
 		while (true)
 		{
 			try
 			{
+				//wake up on job reports of the workers and regularly to reap and restart crashed workers
+				vector<zmq::pollitem_t> items{{(void*)socket, 0, ZMQ_POLLIN, 0}};
+				for (auto fd : supervisor.reportFds())
+					items.push_back({nullptr, fd, ZMQ_POLLIN, 0});
+				zmq::poll(items.data(), items.size(), 1000);
+
+				supervisor.update();
+				autoscaler.step(context, supervisor);
+
+				if (!(items[0].revents & ZMQ_POLLIN))
+					continue;
+
 				auto msg = receiveMsg(socket);
 				if (!msg.valid)
 					continue;
@@ -178,6 +731,7 @@ int main(int argc,
 				string msgType = msg.type();
 				if (msgType == "finish")
 				{
+					//the started processes keep running
 					J11Object resultMsg;
 					resultMsg["type"] = "ack";
 					try
@@ -195,93 +749,110 @@ int main(int argc,
 
 					break;
 				}
-				else if (msgType == "start-new"
-					|| msgType == "start-max"
-					|| msgType == "stop")
+				else if (msgType == "status")
 				{
-					Json& fmsg = msg.json;
-
-					int count = fmsg["count"].int_value();
-
-					string proxyAddress = fmsg["proxy-address"].string_value();
-					int proxyFrontendPort = fmsg["proxy-frontend-port"].int_value();
-					int proxyBackendPort = fmsg["proxy-backend-port"].int_value();
-
-					//string serviceAddress = fmsg["service-address"].string_value();
-					bool isService = !fmsg["service-port"].is_null();
-					int servicePort = fmsg["service-port"].int_value();
-
-					string controlAddresses = fmsg["control-addresses"].string_value();
-					string inputAddresses = fmsg["input-addresses"].string_value();
-					string outputAddresses = fmsg["output-addresses"].string_value();
-
-					string addresses;
-					string stopAddress;
-					int stopPort;
-					if (!proxyAddress.empty())
+					J11Object resultMsg;
+					resultMsg["type"] = "status";
+					resultMsg["workers"] = supervisor.to_json();
+					if (autoscaler.isActive())
+						resultMsg["autoscale"] = autoscaler.to_json();
+					try
 					{
-						stopAddress = proxyAddress, stopPort = proxyFrontendPort;
-						addresses = string(" -p tcp://") + proxyAddress + ":" + to_string(proxyBackendPort);
-						if (!controlAddresses.empty())
-							addresses += " -c " + controlAddresses;
+						s_send(socket, Json(resultMsg).dump());
 					}
-					else if (isService)
+					catch (zmq::error_t e)
 					{
-						count = max(count, 1);
-						//stopAddress = "127.0.0.1", stopPort = servicePort;
-						stopAddress = "localhost", stopPort = servicePort;
-						addresses = string(" -s tcp://*:") + to_string(servicePort);
-						if (!controlAddresses.empty())
-							addresses += " -c " + controlAddresses;
+						cerr
+							<< "Exception on trying to reply with status message on zmq socket with address: " << address
+							<< "! Will continue to receive requests! Error: [" << e.what() << "]" << endl;
 					}
-					else if (!outputAddresses.empty() && !inputAddresses.empty())
+				}
+				else if (msgType == "autoscale")
+				{
+					//like a start message plus
+					//"min", "max" -> number of workers, "max": 0 switches autoscaling off
+					//"proxy-stats-address": "tcp://host:port" -> where the proxy answers 'stats' requests
+					//"output-proxy-stats-address" -> in a pipeline the stats address of the output proxy
+					//"scale-up-after", "scale-down-after" -> seconds jobs have to wait or workers idle before scaling
+					Json& fmsg = msg.json;
+					autoscaler = Autoscaler();
+					autoscaler.spec = ServerSpec(fmsg, pathToServer);
+					autoscaler.minNoOfWorkers = max(0, fmsg["min"].int_value());
+					autoscaler.maxNoOfWorkers = max(autoscaler.minNoOfWorkers, fmsg["max"].int_value());
+					autoscaler.statsAddress = fmsg["proxy-stats-address"].string_value();
+					if (autoscaler.statsAddress.empty() && proxyStatsPort > 0 && !fmsg["proxy-address"].string_value().empty())
+						autoscaler.statsAddress = string("tcp://") + fmsg["proxy-address"].string_value() + ":" + to_string(proxyStatsPort);
+					autoscaler.outputStatsAddress = fmsg["output-proxy-stats-address"].string_value();
+					if (fmsg["scale-up-after"].is_number())
+						autoscaler.scaleUpAfter = fmsg["scale-up-after"].int_value();
+					if (fmsg["scale-down-after"].is_number())
+						autoscaler.scaleDownAfter = fmsg["scale-down-after"].int_value();
+
+					J11Object resultMsg;
+					resultMsg["type"] = "result";
+					resultMsg["ok"] = autoscaler.isActive() || autoscaler.maxNoOfWorkers == 0;
+					resultMsg["autoscale"] = autoscaler.to_json();
+					try
 					{
-						addresses = string(" -i ") + inputAddresses + " -o " + outputAddresses;
-						if (!controlAddresses.empty())
-							addresses += " -c " + controlAddresses;
+						s_send(socket, Json(resultMsg).dump());
 					}
+					catch (zmq::error_t e)
+					{
+						cerr
+							<< "Exception on trying to reply with result message: " << Json(resultMsg).dump()
+							<< " on zmq socket with address: " << address
+							<< "! Will continue to receive requests! Error: [" << e.what() << "]" << endl;
+					}
+				}
+				else if (msgType == "start-new"
+					|| msgType == "start-max"
+					|| msgType == "stop")
+				{
+					ServerSpec spec(msg.json, pathToServer);
+					int count = spec.count;
+					const auto& group = spec.group;
 
-#ifdef WIN32
-					string cmd = string("start /b monica-zmq-server ") + addresses;
-#else
-					string cmd = string("monica-zmq-server") + addresses + " &";
-#endif
-					//cout << "addresses: " << addresses << endl;
-
-					bool isStartMax = msgType == "startMax";
+					bool isStartMax = msgType == "start-max";
 					bool isStop = msgType == "stop";
-					int& started_ = started[addresses];
+					int live = supervisor.noOfLiveWorkers(group);
 					int successfullyStarted = 0;
-					int i = isStartMax ? started_ : 0;
+					int i = isStartMax ? live : 0;
 					int stop = 0;
 					if (isStartMax)
-						stop = max(0, started_ - count);
+						stop = max(0, live - count);
 					else if (isStop)
-						stop = max(0, min(count, started_));
+						stop = max(0, min(count, live));
 
 					if (!isStop)
 					{
 						for (; i < count; i++)
-						{
-							int res = system(cmd.c_str());
-							Tools::debug() << "result of running '" << cmd << "': " << res << endl;
-							started[addresses]++, successfullyStarted++;
-						}
+							if (supervisor.start(group, spec.args, supervisor.nextCpu(spec.pinCpus), spec.restart, true))
+								successfullyStarted++;
 					}
 
-					if ((isStartMax || isStop)
-						&& !stopAddress.empty())
+					int stopped = 0;
+					if (stop > 0)
 					{
-						auto stopped = stopMonicaProcesses(context, stopAddress, stopPort, stop);
-						if (isStop)
-							started_ -= stopped;
+						//workers behind a proxy or service are being finished gracefully, else terminated
+						if (!spec.stopAddress.empty())
+						{
+							auto pids = stopMonicaProcesses(context, spec.stopAddress, spec.stopPort, stop);
+							stopped = int(pids.size());
+							supervisor.markStopping(group, pids);
+						}
+						else
+							stopped = supervisor.stop(group, stop);
 					}
 
+					supervisor.update();
+
 					J11Object resultMsg;
 					resultMsg["type"] = "result";
 					resultMsg["started"] = successfullyStarted;
 					if (isStartMax || isStop)
-						resultMsg["stopped"] = stop;
+						resultMsg["stopped"] = stopped;
+					resultMsg["live"] = supervisor.noOfLiveWorkers(group);
+					resultMsg["workers"] = supervisor.to_json(group);
 					try
 					{
 						s_send(socket, Json(resultMsg).dump());
@@ -304,27 +875,33 @@ int main(int argc,
 					int outFrontendPort = fmsg["output-frontend-port"].int_value();
 					int outBackendPort = fmsg["output-backend-port"].int_value();
 
-					string inArgs = string(" -f ") + to_string(inFrontendPort) + " -b " + to_string(inBackendPort);
-					string outArgs = string(" -f ") + to_string(outFrontendPort) + " -b " + to_string(outBackendPort);
-
-#ifdef WIN32
-					string inCmd = string("start /b monica-zmq-proxy -p ") + inArgs;
-					string outCmd = string("start /b monica-zmq-proxy -p") + (prs ? "rs " : " ") + outArgs;
-#else
-					string inCmd = string("monica-zmq-proxy -p ") + inArgs + " &";
-					string outCmd = string("monica-zmq-proxy -p") + (prs ? "rs " : " ") + outArgs + " &";
-#endif
-					//cout << "inCmd: " << inCmd << " outCmd: " << outCmd << endl;
-
-					int res = system(inCmd.c_str());
-					Tools::debug() << "result of running '" << inCmd << "': " << res << endl;
-
-					res = system(outCmd.c_str());
-					Tools::debug() << "result of running '" << outCmd << "': " << res << endl;
+					vector<string> inArgs{pathToProxy, "-p", "-f", to_string(inFrontendPort), "-b", to_string(inBackendPort)};
+					vector<string> outArgs{pathToProxy, prs ? "-prs" : "-p", "-f", to_string(outFrontendPort), "-b", to_string(outBackendPort)};
+					//the stats ports are needed for autoscaling the pipeline workers
+					if (fmsg["input-stats-port"].is_number())
+						inArgs.push_back("-s"), inArgs.push_back(to_string(fmsg["input-stats-port"].int_value()));
+					if (fmsg["output-stats-port"].is_number())
+						outArgs.push_back("-s"), outArgs.push_back(to_string(fmsg["output-stats-port"].int_value()));
+					string inGroup = "input-proxy:" + to_string(inFrontendPort) + "-" + to_string(inBackendPort);
+					string outGroup = "output-proxy:" + to_string(outFrontendPort) + "-" + to_string(outBackendPort);
+
+					bool ok = true;
+					if (msgType == "start-pipeline-proxies")
+					{
+						if (supervisor.noOfLiveWorkers(inGroup) == 0)
+							ok = supervisor.start(inGroup, inArgs, -1, true, false) && ok;
+						if (supervisor.noOfLiveWorkers(outGroup) == 0)
+							ok = supervisor.start(outGroup, outArgs, -1, true, false) && ok;
+					}
+					else
+					{
+						supervisor.stop(inGroup, 1);
+						supervisor.stop(outGroup, 1);
+					}
 
 					J11Object resultMsg;
 					resultMsg["type"] = "result";
-					resultMsg["ok"] = true;
+					resultMsg["ok"] = ok;
 					try
 					{
 						s_send(socket, Json(resultMsg).dump());
@@ -58,6 +58,7 @@ int main(int argc, char** argv)
 	int outputPort = defaultOutputPort;
 	string pubControlAddress = defaultPublisherControlAddress;
 	int pubControlPort = defaultPublisherControlPort;
+	bool pinCpus = false;
 	
 	auto printHelp = [=]()
 	{
@@ -75,6 +76,8 @@ int main(int argc, char** argv)
 			<< " -n   | --start-new COUNT] ... start COUNT new MONICA nodes" << endl
 			<< " -m   | --start-max COUNT ... start maximum COUNT MONICA nodes" << endl
 			<< " -s   | --stop] COUNT ... stop COUNT MONICA nodes" << endl
+			<< " -st  | --status ... show the MONICA nodes started by the control node and their job counts" << endl
+			<< " -pin | --pin-cpus ... pin the started MONICA nodes round robin to the cpus of the control node" << endl
 			<< " -c   | --connect-to-proxy ... connect MONICA service to a ZeroMQ proxy and use proxy address/port defaults" << endl
 			<< " -pa  | --proxy-address ADDRESS (default: " << inputAddress << ") ... proxy address to connect MONICA service to" << endl
 			<< " -pfp | --proxy-frontend-port PORT (default: " << inputPort << ") ... proxy client side port of proxy to be used by MONICA service" << endl
@@ -111,6 +114,10 @@ int main(int argc, char** argv)
 			else if((arg == "-s" || arg == "--stop")
 							&& i + 1 < argc)
 				command = "stop", count = atoi(argv[++i]);
+			else if(arg == "-st" || arg == "--status")
+				command = "status";
+			else if(arg == "-pin" || arg == "--pin-cpus")
+				pinCpus = true;
 			else if((arg == "-c" || arg == "--connect-to-proxy"))
 				connectToZmqProxy = true;
 			else if((arg == "-pa" || arg == "--proxy-address")
@@ -163,6 +170,8 @@ int main(int argc, char** argv)
 				resultMsg["count"] = count;
 				resultMsg["control-address"] = pubControlAddress;
 				resultMsg["control-port"] = pubControlPort;
+				if(pinCpus)
+					resultMsg["pin-cpus"] = true;
 				if(usePipeline)
 				{
 					resultMsg["input-address"] = inputAddress;
@@ -200,6 +209,15 @@ int main(int argc, char** argv)
 								<< " MONICA instances" << endl;
 							else if(command == "stop")
 								cout << "OK: successfully stopped " << msg.json["stopped"].int_value() << " MONICA instances" << endl;
+							cout << "running: " << msg.json["live"].int_value() << " MONICA instances" << endl;
+						}
+						if(msg.json["workers"].is_array())
+						{
+							for(const auto& w : msg.json["workers"].array_items())
+								cout
+								<< "pid: " << w["pid"].int_value() << " cpu: " << w["cpu"].int_value()
+								<< " jobs: " << w["jobs"].int_value() << " restarts: " << w["restarts"].int_value()
+								<< " [" << w["group"].string_value() << "]" << endl;
 						}
 					}
 					catch(zmq::error_t e)
@@ -14,18 +14,251 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 */
 
 #include <cstdlib>
+#include <cstdint>
+#include <map>
+#include <vector>
+#include <memory>
 
 #include "zeromq/zhelpers.hpp"
+#include "zeromq/zmq-helper.h"
+#include "json11/json11.hpp"
+#include "json11/json11-helper.h"
 #include "tools/debug.h"
 #include "monica-zmq-defaults.h"
+#include "fair-share-queue.h"
+#include "metrics.h"
+#include "trace.h"
+#include "../io/binary-json.h"
 #include "tools/helper.h"
 
 using namespace Tools;
 using namespace std;
 using namespace Monica;
+using namespace json11;
 
 string appName = "monica-zmq-proxy";
-string version = "0.0.1";
+string version = "0.1.0";
+
+namespace
+{
+	//! forward a (multipart) message from one socket to the other
+	void forwardMsg(zmq::socket_t& from, zmq::socket_t& to)
+	{
+		while(true)
+		{
+			zmq::message_t part;
+			from.recv(&part);
+			int more = 0;
+			size_t moreSize = sizeof(more);
+			from.getsockopt(ZMQ_RCVMORE, &more, &moreSize);
+			to.send(part, more ? ZMQ_SNDMORE : 0);
+			if(!more)
+				break;
+		}
+	}
+
+	typedef vector<zmq::message_t> MultipartMsg;
+
+	MultipartMsg receiveMultipartMsg(zmq::socket_t& socket)
+	{
+		MultipartMsg msg;
+		while(true)
+		{
+			msg.emplace_back();
+			socket.recv(&msg.back());
+			int more = 0;
+			size_t moreSize = sizeof(more);
+			socket.getsockopt(ZMQ_RCVMORE, &more, &moreSize);
+			if(!more)
+				break;
+		}
+		return msg;
+	}
+
+	void sendMultipartMsg(zmq::socket_t& socket, MultipartMsg& msg)
+	{
+		for(size_t i = 0; i < msg.size(); i++)
+			socket.send(msg[i], i + 1 < msg.size() ? ZMQ_SNDMORE : 0);
+	}
+
+	//! the customId of a parsed job or result message
+	string customIdOf(const Json& j)
+	{
+		const auto& cid = j["customId"];
+		return cid.is_string() ? cid.string_value() : cid.is_null() ? string() : cid.dump();
+	}
+
+	//! the customId of a job or result message, only used when tracing, as it means parsing the whole message
+	string customIdOf(const MultipartMsg& msg)
+	{
+		if(msg.empty())
+			return string();
+		auto r = parseJsonOrBinaryJson(string(static_cast<const char*>(msg.back().data()), msg.back().size()));
+		return r.success() ? customIdOf(r.result) : string();
+	}
+
+	//! the scheduling class of a job message, the last frame is the job,
+	//! it is parsed (once) only if it might contain scheduling fields at all or customId is requested (when tracing)
+	JobClass jobClassOf(const MultipartMsg& msg, string* customId = nullptr)
+	{
+		if(msg.empty())
+			return JobClass();
+		string job(static_cast<const char*>(msg.back().data()), msg.back().size());
+		bool scheduling = mayHaveJobClass(job.data(), job.size());
+		if(!scheduling && !customId)
+			return JobClass();
+		auto r = parseJsonOrBinaryJson(job);
+		if(!r.success())
+			return JobClass();
+		if(customId)
+			*customId = customIdOf(r.result);
+		return scheduling ? Monica::jobClassOf(r.result) : JobClass();
+	}
+
+	//! a job waiting in the proxy, with the time it arrived (if tracing)
+	struct QueuedMsg
+	{
+		MultipartMsg msg;
+		int64_t queuedUs{0};
+		string customId;
+	};
+
+	/*!
+	 * Proxy which counts the forwarded messages (also as Prometheus metrics) and answers "stats" requests on statsSocket (if given),
+	 * for request/reply sockets the difference between requests and replies is the number of jobs
+	 * queued at or being run by the workers.
+	 * If maxInFlight > 0 (request/reply sockets only), at most maxInFlight jobs are being sent to the workers,
+	 * the others wait in the proxy and are dispatched by their scheduling class, interactive jobs first,
+	 * bulk jobs fairly shared between the tenants (see FairShareQueue).
+	 * If tracing, the time jobs wait in the proxy ("queued") and at the workers ("dispatched", until their reply)
+	 * are written as spans, jobs and replies are matched by their customId.
+	 */
+	void managedProxy(zmq::socket_t& frontend,
+										zmq::socket_t& backend,
+										zmq::socket_t* statsSocket,
+										bool requestReply,
+										size_t maxInFlight,
+										size_t maxQueueLength,
+										const map<string, int>& tenantWeights)
+	{
+		uint64_t noOfRequests = 0, noOfReplies = 0;
+		auto inFlight = [&](){ return noOfRequests - min(noOfRequests, noOfReplies); };
+
+		bool schedule = requestReply && maxInFlight > 0;
+		FairShareQueue<QueuedMsg> queue;
+		for(const auto& p : tenantWeights)
+			queue.setWeight(p.first, p.second);
+
+		auto& m = metrics();
+		m.describe("monica_proxy_requests_total", "counter", "Messages forwarded from the clients to the workers.");
+		m.describe("monica_proxy_replies_total", "counter", "Messages forwarded from the workers to the clients.");
+		m.describe("monica_proxy_jobs_in_flight", "gauge", "Jobs sent to the workers and not yet answered (request/reply sockets only).");
+		m.describe("monica_proxy_jobs_queued", "gauge", "Jobs waiting in the proxy to be dispatched.");
+		m.describe("monica_proxy_jobs_queued_interactive", "gauge", "Interactive jobs waiting in the proxy to be dispatched.");
+		auto updateMetrics = [&]()
+		{
+			m.set("monica_proxy_requests_total", double(noOfRequests));
+			m.set("monica_proxy_replies_total", double(noOfReplies));
+			if(requestReply)
+				m.set("monica_proxy_jobs_in_flight", double(inFlight()));
+			m.set("monica_proxy_jobs_queued", double(queue.size()));
+			m.set("monica_proxy_jobs_queued_interactive", double(queue.noOfInteractiveJobs()));
+		};
+
+		auto tracer = TraceWriter::instance();
+		map<string, int64_t> dispatchedUs;
+		auto dispatched = [&](const string& customId, int64_t queuedUs)
+		{
+			auto now = TraceWriter::nowUs();
+			if(queuedUs > 0)
+				tracer->complete("queued", "proxy", queuedUs, now, J11Object{{"customId", customId}});
+			if(requestReply && !customId.empty())
+				dispatchedUs[customId] = now;
+		};
+
+		zmq::pollitem_t items[] =
+		{{(void*)frontend, 0, ZMQ_POLLIN, 0}
+		,{(void*)backend, 0, ZMQ_POLLIN, 0}
+		,{statsSocket ? (void*)*statsSocket : nullptr, 0, ZMQ_POLLIN, 0}
+		};
+
+		while(true)
+		{
+			//don't take new jobs if the queue is full, ZeroMQ's high water marks will then push back on the clients
+			items[0].events = !schedule || queue.size() < maxQueueLength ? ZMQ_POLLIN : 0;
+			zmq::poll(&items[0], statsSocket ? 3 : 2, -1);
+
+			if(items[0].revents & ZMQ_POLLIN)
+			{
+				if(schedule)
+				{
+					QueuedMsg qm;
+					qm.msg = receiveMultipartMsg(frontend);
+					if(tracer)
+						qm.queuedUs = TraceWriter::nowUs();
+					auto jc = jobClassOf(qm.msg, tracer ? &qm.customId : nullptr);
+					queue.push(move(qm), jc);
+				}
+				else if(tracer)
+				{
+					auto msg = receiveMultipartMsg(frontend);
+					auto customId = customIdOf(msg);
+					sendMultipartMsg(backend, msg);
+					noOfRequests++;
+					dispatched(customId, 0);
+				}
+				else
+					forwardMsg(frontend, backend), noOfRequests++;
+			}
+			if(items[1].revents & ZMQ_POLLIN)
+			{
+				if(tracer && requestReply)
+				{
+					auto msg = receiveMultipartMsg(backend);
+					auto it = dispatchedUs.find(customIdOf(msg));
+					if(it != dispatchedUs.end())
+					{
+						tracer->complete("dispatched", "proxy", it->second, TraceWriter::nowUs(), J11Object{{"customId", it->first}});
+						dispatchedUs.erase(it);
+					}
+					sendMultipartMsg(frontend, msg);
+				}
+				else
+					forwardMsg(backend, frontend);
+				noOfReplies++;
+			}
+
+			while(schedule && !queue.empty() && inFlight() < maxInFlight)
+			{
+				auto qm = queue.pop();
+				sendMultipartMsg(backend, qm.msg);
+				noOfRequests++;
+				if(tracer)
+					dispatched(qm.customId, qm.queuedUs);
+			}
+
+			updateMetrics();
+
+			if(statsSocket && items[2].revents & ZMQ_POLLIN)
+			{
+				auto msg = receiveMsg(*statsSocket);
+				J11Object statsMsg
+				{{"type", "stats"}
+				,{"requests", double(noOfRequests)}
+				,{"replies", double(noOfReplies)}
+				,{"inFlight", requestReply ? double(inFlight()) : -1.0}
+				,{"queued", int(queue.size())}
+				,{"queuedInteractive", int(queue.noOfInteractiveJobs())}
+				,{"tenants", int(queue.noOfTenants())}
+				,{"outstanding", requestReply ? double(inFlight() + queue.size()) : -1.0}
+				};
+				if(msg.type() != "stats")
+					statsMsg["type"] = "error";
+				s_send(*statsSocket, Json(statsMsg).dump());
+			}
+		}
+	}
+}
 
 int main (int argc, 
 					char** argv)
@@ -36,6 +269,13 @@ int main (int argc,
 	int controlPort = defaultControlPort;
 	int frontendSocketType = ZMQ_ROUTER;
 	int backendSocketType = ZMQ_DEALER;
+	int statsPort = -1;
+	int maxInFlight = 0;
+	int maxQueueLength = 100000;
+	map<string, int> tenantWeights;
+	int metricsPort = -1;
+	string metricsAddress = defaultMetricsAddress;
+	string pathToTraceFile;
 
 	auto printHelp = [=]()
 	{
@@ -55,6 +295,14 @@ int main (int argc,
 			<< " -f | --frontend-port FRONTEND-PORT (default: " << frontendPort << ") ... run " << appName << " with given frontend port" << endl
 			<< " -b | --backend-port BACKEND-PORT (default: " << backendPort << ") ... run " << appName << " with given backend port" << endl
 			<< " -c | --start-control-node [CONTROL-NODE-PORT] (default: " << controlPort << ") ... start control node, connected to proxy, on given port" << endl
+			<< " -s | --stats-port STATS-PORT ... answer 'stats' requests (e.g. for autoscaling by the control node) on given port" << endl
+			<< " -sc | --schedule MAX-IN-FLIGHT ... send at most MAX-IN-FLIGHT jobs (e.g. the number of workers) to the workers and queue the rest," << endl
+			<< "       interactive jobs (\"priority\": \"interactive\") first, the others shared fairly between \"tenant\"s (ROUTER/DEALER only)" << endl
+			<< " -ql | --max-queue-length NUMBER (default: " << maxQueueLength << ") ... maximum number of jobs queued in the proxy when scheduling" << endl
+			<< " -tw | --tenant-weight TENANT=WEIGHT ... TENANT gets WEIGHT times the share of a tenant with default weight 1 (may be repeated)" << endl
+			<< " -m | --metrics-port PORT ... serve Prometheus metrics (forwarded messages, jobs in flight and queued) via HTTP on PORT" << endl
+			<< " -ma | --metrics-address ADDRESS (default: " << metricsAddress << ") ... interface the metrics endpoint is bound to, * for all interfaces" << endl
+			<< " -tr | --trace FILE ... write a Chrome trace (chrome://tracing, Perfetto) of the time jobs spend queued and at the workers to FILE" << endl
 			<< " -d | --debug ... enable debug outputs" << endl;
 	};
 
@@ -91,6 +339,31 @@ int main (int argc,
 			if(i + 1 < argc && argv[i + 1][0] != '-')
 				controlPort = stoi(argv[++i]);
 		}
+		else if((arg == "-s" || arg == "--stats-port")
+						&& i + 1 < argc)
+			statsPort = stoi(argv[++i]);
+		else if((arg == "-sc" || arg == "--schedule")
+						&& i + 1 < argc)
+			maxInFlight = stoi(argv[++i]);
+		else if((arg == "-ql" || arg == "--max-queue-length")
+						&& i + 1 < argc)
+			maxQueueLength = stoi(argv[++i]);
+		else if((arg == "-tw" || arg == "--tenant-weight")
+						&& i + 1 < argc)
+		{
+			auto tw = splitString(argv[++i], "=");
+			if(tw.size() == 2)
+				tenantWeights[tw[0]] = stoi(tw[1]);
+		}
+		else if((arg == "-m" || arg == "--metrics-port")
+						&& i + 1 < argc)
+			metricsPort = stoi(argv[++i]);
+		else if((arg == "-ma" || arg == "--metrics-address")
+						&& i + 1 < argc)
+			metricsAddress = argv[++i];
+		else if((arg == "-tr" || arg == "--trace")
+						&& i + 1 < argc)
+			pathToTraceFile = argv[++i];
 		else if(arg == "-p" || arg == "--pipeline-ports" || arg == "-pps" || arg == "--pull-push-sockets")
 			frontendSocketType = ZMQ_PULL, backendSocketType = ZMQ_PUSH;
 		else if(arg == "-prs" || arg == "--pull-router-sockets")
@@ -160,7 +433,12 @@ int main (int argc,
 #ifdef WIN32
 		oss << "start /b monica-zmq-control -f " << frontendPort << " -b " << backendPort << " -c " << controlPort;
 #else
-		oss << "monica-zmq-control -f " << frontendPort << " -b " << backendPort << " -c " << controlPort << " &";
+		oss << "monica-zmq-control -f " << frontendPort << " -b " << backendPort << " -c " << controlPort;
+#endif
+		if(statsPort > 0)
+			oss << " -ps " << statsPort;
+#ifndef WIN32
+		oss << " &";
 #endif
 
 		int res = system(oss.str().c_str());
@@ -170,7 +448,30 @@ int main (int argc,
 	// start the proxy
 	try
 	{
-		zmq::proxy((void*)frontend, (void*)backend, nullptr);
+		bool requestReply = frontendSocketType == ZMQ_ROUTER && backendSocketType == ZMQ_DEALER;
+		if(maxInFlight > 0 && !requestReply)
+			cerr << "Scheduling is only possible with ROUTER/DEALER sockets, will just forward the jobs!" << endl;
+
+		if(metricsPort > 0 && !serveMetricsHttp(metricsPort, metricsAddress))
+			cerr << "Couldn't serve metrics on port: " << metricsPort << "! Continuing without metrics endpoint." << endl;
+
+		if(!pathToTraceFile.empty() && !TraceWriter::start(pathToTraceFile, appName))
+			cerr << "Couldn't write trace to file: " << pathToTraceFile << "! Continuing without tracing." << endl;
+
+		if(statsPort > 0 || maxInFlight > 0 || metricsPort > 0 || TraceWriter::instance())
+		{
+			unique_ptr<zmq::socket_t> statsSocket;
+			if(statsPort > 0)
+			{
+				statsSocket.reset(new zmq::socket_t(context, ZMQ_REP));
+				statsSocket->bind(string("tcp://*:") + to_string(statsPort));
+				debug() << "Bound " << appName << " zeromq stats socket to port: " << statsPort << "!" << endl;
+			}
+			managedProxy(frontend, backend, statsSocket.get(), requestReply,
+									 size_t(max(0, maxInFlight)), size_t(max(1, maxQueueLength)), tenantWeights);
+		}
+		else
+			zmq::proxy((void*)frontend, (void*)backend, nullptr);
 	}
 	catch(zmq::error_t e)
 	{
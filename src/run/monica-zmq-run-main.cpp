@@ -37,6 +37,7 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 #include "tools/algorithms.h"
 #include "../io/csv-format.h"
 #include "monica-zmq-defaults.h"
+#include "trace.h"
 
 using namespace std;
 using namespace Monica;
@@ -61,14 +62,20 @@ int main(int argc, char** argv)
 	bool writeOutputFile = false;
 	string address = defaultInputAddress;
 	int port = defaultInputPort;
-	string pathToSimJson = "./sim.json", crop, site, climate;
+	vector<string> pathsToSimJson;
+	string crop, site, climate;
 	string dailyOutputs;
 	bool cesMode = false;
+	bool envConfigMode = false;
+	bool binaryEncoding = false;
+	bool useBatches = false;
+	size_t batchSize = 10, maxInFlight = 1;
+	string pathToTraceFile;
 
 	auto printHelp = [=]()
 	{
 		cout
-			<< appName << " [options] path-to-sim-json" << endl
+			<< appName << " [options] path-to-sim-json [path-to-sim-json ...]" << endl
 			<< endl
 			<< " -h   | --help ... this help output" << endl
 			<< " -v   | --version ... outputs MONICA version" << endl
@@ -78,6 +85,10 @@ int main(int argc, char** argv)
 			<< " -p   | --port (PROXY-)PORT (default: " << port << ") ... run server/connect client on/to given port" << endl
 			//<< " -sd  | --start-date ISO-DATE (default: start of given climate data) ... date in iso-date-format yyyy-mm-dd" << endl
 			//<< " -ed  | --end-date ISO-DATE (default: end of given climate data) ... date in iso-date-format yyyy-mm-dd" << endl
+			<< " -b   | --binary ... send env and receive output as binary encoded messages instead of JSON" << endl
+			<< " -bs  | --batch-size NUMBER (default: " << batchSize << ") ... send the envs of multiple sim.json files in batches of NUMBER envs" << endl
+			<< " -if  | --in-flight NUMBER (default: " << maxInFlight << ") ... number of batches being processed by the server(s) at the same time" << endl
+			<< " -tr  | --trace FILE ... write a Chrome trace (chrome://tracing, Perfetto) of the requests to FILE" << endl
 			<< " -w   | --write-output-files ... write MONICA output files (rmout, smout)" << endl
 			<< " -op  | --path-to-output DIRECTORY (default: .) ... path to output directory" << endl
 			<< " -o   | --path-to-output-file FILE ... path to output file" << endl
@@ -85,6 +96,8 @@ int main(int argc, char** argv)
 			<< " -c   | --path-to-crop FILE (default: ./crop.json) ... path to crop.json file" << endl
 			<< " -s   | --path-to-site FILE (default: ./site.json) ... path to site.json file" << endl
 			<< " -w   | --path-to-climate FILE (default: ./climate.csv) ... path to climate.csv" << endl
+			<< " -ec  | --env-config ... send the sim/crop/site.json to the server (as \"EnvFromConfig\" job), which creates the env itself," << endl
+			<< "        the server has to be able to read the referenced files (climate.csv, included files) too" << endl
 			<< " -ces  | --create-env-server ... start monica-zmq-run as a server on given port and create JSON env for clients" << endl;
 	};
 
@@ -136,11 +149,26 @@ int main(int argc, char** argv)
 			printHelp(), exit(0);
 		else if(arg == "-v" || arg == "--version")
 			cout << appName << " version " << version << endl, exit(0);
+		else if(arg == "-b" || arg == "--binary")
+			binaryEncoding = true;
+		else if((arg == "-bs" || arg == "--batch-size")
+						&& i + 1 < argc)
+			batchSize = size_t(stoi(argv[++i])), useBatches = true;
+		else if((arg == "-if" || arg == "--in-flight")
+						&& i + 1 < argc)
+			maxInFlight = size_t(stoi(argv[++i])), useBatches = true;
+		else if((arg == "-tr" || arg == "--trace")
+						&& i + 1 < argc)
+			pathToTraceFile = argv[++i];
 		else if(arg == "-ces" || arg == "--create-env-server")
 			cesMode = true;
+		else if(arg == "-ec" || arg == "--env-config")
+			envConfigMode = true;
 		else
-			pathToSimJson = argv[i];
+			pathsToSimJson.push_back(argv[i]);
 	}
+	if(pathsToSimJson.empty())
+		pathsToSimJson.push_back("./sim.json");
 
 	
 	if(cesMode)
@@ -210,99 +238,138 @@ int main(int argc, char** argv)
 	}
 	else
 	{
-		string pathOfSimJson, simFileName;
-		tie(pathOfSimJson, simFileName) = splitPathToFile(pathToSimJson);
+		//create the env of a sim.json, returns also the used sim.json
+		auto createEnv = [&](string pathToSimJson)
+		{
+			string pathOfSimJson, simFileName;
+			tie(pathOfSimJson, simFileName) = splitPathToFile(pathToSimJson);
 
-		auto simj = readAndParseJsonFile(pathToSimJson);
-		if(simj.failure())
-			for(auto e : simj.errors)
-				cerr << e << endl;
-		auto simm = simj.result.object_items();
+			auto simj = readAndParseJsonFile(pathToSimJson);
+			if(simj.failure())
+				for(auto e : simj.errors)
+					cerr << e << endl;
+			auto simm = simj.result.object_items();
 
-		//if(!startDate.empty())
-		//	simm["start-date"] = startDate;
+			//if(!startDate.empty())
+			//	simm["start-date"] = startDate;
 
-		//if(!endDate.empty())
-		//	simm["end-date"] = endDate;
+			//if(!endDate.empty())
+			//	simm["end-date"] = endDate;
 
-		if(debugSet)
-			simm["debug?"] = debug;
+			if(debugSet)
+				simm["debug?"] = debug;
 
-		if(!pathToOutput.empty())
-			simm["path-to-output"] = pathToOutput;
+			if(!pathToOutput.empty())
+				simm["path-to-output"] = pathToOutput;
 
-		//if(!pathToOutputFile.empty())
-		//	simm["path-to-output-file"] = pathToOutputFile;
+			//if(!pathToOutputFile.empty())
+			//	simm["path-to-output-file"] = pathToOutputFile;
 
-		simm["sim.json"] = pathToSimJson;
+			simm["sim.json"] = pathToSimJson;
 
-		if(!crop.empty())
-			simm["crop.json"] = crop;
-		auto pathToCropJson = simm["crop.json"].string_value();
-		if(!isAbsolutePath(pathToCropJson))
-			simm["crop.json"] = pathOfSimJson + pathToCropJson;
+			if(!crop.empty())
+				simm["crop.json"] = crop;
+			auto pathToCropJson = simm["crop.json"].string_value();
+			if(!isAbsolutePath(pathToCropJson))
+				simm["crop.json"] = pathOfSimJson + pathToCropJson;
 
-		if(!site.empty())
-			simm["site.json"] = site;
-		auto pathToSiteJson = simm["site.json"].string_value();
-		if(!isAbsolutePath(pathToSiteJson))
-			simm["site.json"] = pathOfSimJson + pathToSiteJson;
+			if(!site.empty())
+				simm["site.json"] = site;
+			auto pathToSiteJson = simm["site.json"].string_value();
+			if(!isAbsolutePath(pathToSiteJson))
+				simm["site.json"] = pathOfSimJson + pathToSiteJson;
 
-		if(!climate.empty())
-			simm["climate.csv"] = climate;
-		auto pathToClimateCSV = simm["climate.csv"].string_value();
-		if(!isAbsolutePath(pathToClimateCSV))
-			simm["climate.csv"] = pathOfSimJson + pathToClimateCSV;
+			if(!climate.empty())
+				simm["climate.csv"] = climate;
+			auto pathToClimateCSV = simm["climate.csv"].string_value();
+			if(!isAbsolutePath(pathToClimateCSV))
+				simm["climate.csv"] = pathOfSimJson + pathToClimateCSV;
 
-		/*
-		if(!dailyOutputs.empty())
-		{
-			auto outm = simm["output"].object_items();
-			string err;
-			J11Array daily;
+			/*
+			if(!dailyOutputs.empty())
+			{
+				auto outm = simm["output"].object_items();
+				string err;
+				J11Array daily;
 
-			string trimmedDailyOutputs = trim(dailyOutputs);
-			if(trimmedDailyOutputs.front() == '[')
-				trimmedDailyOutputs.erase(0, 1);
-			if(trimmedDailyOutputs.back() == ']')
-				trimmedDailyOutputs.pop_back();
+				string trimmedDailyOutputs = trim(dailyOutputs);
+				if(trimmedDailyOutputs.front() == '[')
+					trimmedDailyOutputs.erase(0, 1);
+				if(trimmedDailyOutputs.back() == ']')
+					trimmedDailyOutputs.pop_back();
 
-			for(auto el : splitString(trimmedDailyOutputs, ",", make_pair("[", "]")))
-			{
-				if(trim(el).at(0) == '[')
+				for(auto el : splitString(trimmedDailyOutputs, ",", make_pair("[", "]")))
 				{
-					J11Array a;
-					auto es = splitString(trim(el, "[]"), ",");
-					if(es.size() >= 1)
-						a.push_back(es.at(0));
-					if(es.size() >= 3)
-						a.push_back(stoi(es.at(1))), a.push_back(stoi(es.at(2)));
-					if(es.size() >= 4)
-						a.push_back(es.at(3));
-					daily.push_back(a);
+					if(trim(el).at(0) == '[')
+					{
+						J11Array a;
+						auto es = splitString(trim(el, "[]"), ",");
+						if(es.size() >= 1)
+							a.push_back(es.at(0));
+						if(es.size() >= 3)
+							a.push_back(stoi(es.at(1))), a.push_back(stoi(es.at(2)));
+						if(es.size() >= 4)
+							a.push_back(es.at(3));
+						daily.push_back(a);
+					}
+					else
+						daily.push_back(el);
 				}
-				else
-					daily.push_back(el);
+				outm["daily"] = daily;
+				simm["output"] = outm;
 			}
-			outm["daily"] = daily;
-			simm["output"] = outm;
-		}
-		*/
+			*/
+
+			//let the server resolve the references and create the env
+			if(envConfigMode)
+			{
+				J11Object job
+				{{"type", "EnvFromConfig"}
+				,{"sim", simm}
+				,{"crop", printPossibleErrors(readAndParseJsonFile(simm["crop.json"].string_value()), activateDebug)}
+				,{"site", printPossibleErrors(readAndParseJsonFile(simm["site.json"].string_value()), activateDebug)}
+				};
+				return make_pair(simm, Json(job));
+			}
+
+			map<string, string> ps;
+			ps["sim-json-str"] = json11::Json(simm).dump();
+			ps["crop-json-str"] = printPossibleErrors(readFile(simm["crop.json"].string_value()), activateDebug);
+			ps["site-json-str"] = printPossibleErrors(readFile(simm["site.json"].string_value()), activateDebug);
+			//ps["path-to-climate-csv"] = simm["climate.csv"].string_value();
 
-		map<string, string> ps;
-		ps["sim-json-str"] = json11::Json(simm).dump();
-		ps["crop-json-str"] = printPossibleErrors(readFile(simm["crop.json"].string_value()), activateDebug);
-		ps["site-json-str"] = printPossibleErrors(readFile(simm["site.json"].string_value()), activateDebug);
-		//ps["path-to-climate-csv"] = simm["climate.csv"].string_value();
+			auto env = createEnvJsonFromJsonStrings(ps);
+			activateDebug = env["debugMode"].bool_value();
 
-		auto env = createEnvJsonFromJsonStrings(ps);
-		activateDebug = env["debugMode"].bool_value();
+			return make_pair(simm, env);
+		};
+
+		vector<Json> envs;
+		J11Object simm;
+		for(auto pathToSimJson : pathsToSimJson)
+		{
+			auto simmAndEnv = createEnv(pathToSimJson);
+			//the first sim.json defines the output options
+			if(envs.empty())
+				simm = simmAndEnv.first;
+			envs.push_back(simmAndEnv.second);
+		}
 
 		if(activateDebug)
 			cout << "starting MONICA with JSON input files" << endl;
 
-		Json out_ = sendZmqRequestMonicaFull(&context, string("tcp://") + address + ":" + to_string(port), env);
-		Output output(out_);
+		if(!pathToTraceFile.empty() && !TraceWriter::start(pathToTraceFile, appName))
+			cerr << "Couldn't write trace to file: " << pathToTraceFile << "! Continuing without tracing." << endl;
+
+		auto serverAddress = string("tcp://") + address + ":" + to_string(port);
+		vector<Output> outputs;
+		if(envs.size() == 1 && !useBatches)
+			outputs.push_back(Output(sendZmqRequestMonicaFull(&context, serverAddress, envs.front(), binaryEncoding)));
+		else
+			for(auto outj : sendZmqBatchRequestsMonicaFull(&context, serverAddress, envs, batchSize, maxInFlight, binaryEncoding))
+				outputs.push_back(Output(outj));
+
+		TraceWriter::stop();
 
 		if(pathToOutputFile.empty() && simm["output"]["write-file?"].bool_value())
 			pathToOutputFile = fixSystemSeparator(simm["path-to-output"].string_value() + "/"
@@ -331,13 +398,18 @@ int main(int argc, char** argv)
 		bool includeUnitsRow = simm["output"]["csv-options"]["include-units-row"].bool_value();
 		bool includeAggRows = simm["output"]["csv-options"]["include-aggregation-rows"].bool_value();
 
-		for(const auto& d : output.data)
+		for(const auto& output : outputs)
 		{
-			out << "\"" << replace(d.origSpec, "\"", "") << "\"" << endl;
-			writeOutputHeaderRows(out, d.outputIds, csvSep, includeHeaderRow, includeUnitsRow, includeAggRows);
-			writeOutput(out, d.outputIds, d.results, csvSep);
-			out << endl;
+			for(auto e : output.errors)
+				cerr << e << endl;
 
+			for(const auto& d : output.data)
+			{
+				out << "\"" << replace(d.origSpec, "\"", "") << "\"" << endl;
+				writeOutputHeaderRows(out, d.outputIds, csvSep, includeHeaderRow, includeUnitsRow, includeAggRows);
+				writeOutput(out, d.outputIds, d.results, csvSep);
+				out << endl;
+			}
 		}
 
 		if(writeOutputFile)
@@ -18,6 +18,10 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 #include <fstream>
 #include <string>
 #include <tuple>
+#ifndef WIN32
+#include <unistd.h>
+#include <csignal>
+#endif
 
 #include "zeromq/zhelpers.hpp"
 #include "zeromq/zmq-helper.h"
@@ -36,6 +40,9 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 #include "tools/algorithms.h"
 #include "../io/csv-format.h"
 #include "monica-zmq-defaults.h"
+#include "result-cache.h"
+#include "metrics.h"
+#include "trace.h"
 
 using namespace std;
 using namespace Monica;
@@ -169,6 +176,17 @@ int main(int argc, char** argv)
 	bool usePipeline = false;
 	bool useRouterOutputSocket = false;
 	string controlAddress = defControlAddress;
+	int noOfBatchThreads = 1;
+	bool useResultCache = false;
+	string pathToResultCache;
+	int resultCacheSizeMB = 1024;
+	int reportFd = -1;
+	int metricsPort = -1;
+	string metricsAddress = defaultMetricsAddress;
+	string pathToTraceFile;
+	string workerId;
+	bool preloadParameters = false;
+	string pathToParameterSnapshot;
 
 	SocketOp inputOp = ZmqServer::connect;
 	SocketOp outputOp = ZmqServer::connect;
@@ -196,7 +214,16 @@ int main(int argc, char** argv)
 			<< " -co | --connect-output (default) ... connect the output port" << endl
 			<< " -o | --output-address [ADDRESS1[,ADDRESS2,...]] (default: " << outputAddress << ")] ... send results to this address(es)" << endl
 			<< " -or | --router-output-address [ADDRESS1[,ADDRESS2,...]] (default: " << outputAddress << ")] ... send results to this address(es) but use a router socket" << endl
-			<< " -c | --control-address [ADDRESS] (default: " << controlAddress << ")] ... connect MONICA server to this address for control messages" << endl;
+			<< " -c | --control-address [ADDRESS] (default: " << controlAddress << ")] ... connect MONICA server to this address for control messages" << endl
+			<< " -t | --batch-threads [NUMBER] (default: " << noOfBatchThreads << ")] ... run the envs of batch messages on NUMBER threads" << endl
+			<< " -rc | --result-cache [DIR] ... answer envs which have been run before from a cache, keep the results in DIR if given, else in memory only" << endl
+			<< " -rcs | --result-cache-size [MB] (default: " << resultCacheSizeMB << ")] ... maximum size of the result cache directory" << endl
+			<< " -rf | --report-fd [FD] ... write the number of finished jobs as line to file descriptor FD after every job (used by monica-zmq-control)" << endl
+			<< " -m | --metrics-port [PORT] ... serve Prometheus metrics (job counts, phase timings, result sizes, utilisation) via HTTP on PORT" << endl
+			<< " -ma | --metrics-address [ADDRESS] (default: " << metricsAddress << ") ... interface the metrics endpoint is bound to, * for all interfaces" << endl
+			<< " -tr | --trace [FILE] ... write a Chrome trace (chrome://tracing, Perfetto) of the job phases to FILE, {pid} is replaced by the process id" << endl
+			<< " -wid | --worker-id [ID] (default: process id) ... name of this server in the trace" << endl
+			<< " -pc | --parameter-catalogue [FILE] ... read all crop, fertiliser and residue parameters of monica.sqlite at startup, from the snapshot FILE if it exists, else from the database, then writing FILE" << endl;
 	};
 
 	zmq::context_t context(1);
@@ -250,6 +277,53 @@ int main(int argc, char** argv)
 				if(i + 1 < argc && argv[i + 1][0] != '-')
 					controlAddress = argv[++i];
 			}
+			else if(arg == "-t" || arg == "--batch-threads")
+			{
+				if(i + 1 < argc && argv[i + 1][0] != '-')
+					noOfBatchThreads = stoi(argv[++i]);
+			}
+			else if(arg == "-rc" || arg == "--result-cache")
+			{
+				useResultCache = true;
+				if(i + 1 < argc && argv[i + 1][0] != '-')
+					pathToResultCache = argv[++i];
+			}
+			else if(arg == "-rcs" || arg == "--result-cache-size")
+			{
+				if(i + 1 < argc && argv[i + 1][0] != '-')
+					resultCacheSizeMB = stoi(argv[++i]);
+			}
+			else if(arg == "-rf" || arg == "--report-fd")
+			{
+				if(i + 1 < argc && argv[i + 1][0] != '-')
+					reportFd = stoi(argv[++i]);
+			}
+			else if(arg == "-m" || arg == "--metrics-port")
+			{
+				if(i + 1 < argc && argv[i + 1][0] != '-')
+					metricsPort = stoi(argv[++i]);
+			}
+			else if(arg == "-ma" || arg == "--metrics-address")
+			{
+				if(i + 1 < argc)
+					metricsAddress = argv[++i];
+			}
+			else if(arg == "-tr" || arg == "--trace")
+			{
+				if(i + 1 < argc && argv[i + 1][0] != '-')
+					pathToTraceFile = argv[++i];
+			}
+			else if(arg == "-wid" || arg == "--worker-id")
+			{
+				if(i + 1 < argc && argv[i + 1][0] != '-')
+					workerId = argv[++i];
+			}
+			else if(arg == "-pc" || arg == "--parameter-catalogue")
+			{
+				preloadParameters = true;
+				if(i + 1 < argc && argv[i + 1][0] != '-')
+					pathToParameterSnapshot = argv[++i];
+			}
 			else if(arg == "-h" || arg == "--help")
 				printHelp(), exit(0);
 			else if(arg == "-v" || arg == "--version")
@@ -271,7 +345,44 @@ int main(int argc, char** argv)
 
 		addresses[Control] = {Subscribe, vector<string>{controlAddress}, ZmqServer::connect};
 
-		serveZmqMonicaFull(&context, addresses);
+		shared_ptr<ResultCache> resultCache;
+		if(useResultCache)
+			resultCache = make_shared<ResultCache>(pathToResultCache, uint64_t(max(0, resultCacheSizeMB)) * 1024 * 1024);
+
+		if(metricsPort > 0 && !serveMetricsHttp(metricsPort, metricsAddress))
+			cerr << "Couldn't serve metrics on port: " << metricsPort << "! Continuing without metrics endpoint." << endl;
+
+		if(!pathToTraceFile.empty() && !TraceWriter::start(pathToTraceFile, "monica-zmq-server", workerId))
+			cerr << "Couldn't write trace to file: " << pathToTraceFile << "! Continuing without tracing." << endl;
+
+		if(preloadParameters)
+		{
+			auto es = preloadParameterCatalogue("monica", pathToParameterSnapshot);
+			for(const auto& w : es.warnings)
+				cerr << w << endl;
+			for(const auto& e : es.errors)
+				cerr << e << endl;
+			debug() << "preloaded parameter catalogue" << endl;
+		}
+
+		function<void(size_t)> onJobsDone;
+#ifndef WIN32
+		if(reportFd >= 0)
+		{
+			//a gone supervisor must not kill the server
+			signal(SIGPIPE, SIG_IGN);
+			onJobsDone = [reportFd](size_t noOfJobs)
+			{
+				auto line = to_string(noOfJobs) + "\n";
+				if(write(reportFd, line.data(), line.size()) < 0)
+					debug() << "couldn't report number of jobs to fd: " << reportFd << endl;
+			};
+		}
+#endif
+
+		serveZmqMonicaFull(&context, addresses, noOfBatchThreads, resultCache, onJobsDone);
+
+		TraceWriter::stop();
 
 		debug() << "stopped ZeroMQ MONICA server" << endl;
 	}
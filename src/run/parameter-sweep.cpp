@@ -0,0 +1,506 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+Authors:
+Michael Berg <michael.berg@zalf.de>
+
+Maintainers:
+Currently maintained by the authors.
+
+This file is part of the MONICA model.
+Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
+*/
+
+#include <map>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+
+#include "tools/helper.h"
+#include "tools/algorithms.h"
+
+#include "parameter-sweep.h"
+
+using namespace Monica;
+using namespace std;
+using namespace Tools;
+using namespace json11;
+
+ParameterPath::ParameterPath(const string& p)
+	: path(p)
+{
+	auto tokens = splitString(p, ".");
+	for(size_t i = 0; i < tokens.size(); i++)
+	{
+		auto t = trim(tokens.at(i));
+		auto bi = t.find('[');
+		auto key = t.substr(0, bi);
+		if(key.empty())
+		{
+			target.clear();
+			elements.clear();
+			return;
+		}
+
+		if(i == 0)
+			target = key;
+		else
+			elements.push_back({key, -1});
+
+		//parse the array indices, e.g. [1][2]
+		while(bi != string::npos)
+		{
+			auto be = t.find(']', bi);
+			if(i == 0 || be == string::npos)
+			{
+				target.clear();
+				elements.clear();
+				return;
+			}
+			try { elements.push_back({"", stoi(t.substr(bi + 1, be - bi - 1))}); }
+			catch(exception e)
+			{
+				target.clear();
+				elements.clear();
+				return;
+			}
+			bi = t.find('[', be);
+		}
+	}
+}
+
+namespace
+{
+	//! values of parameters are partly stored as [value, unit(, description)]
+	bool isValueWithUnit(const Json& j)
+	{
+		const auto& a = j.array_items();
+		return j.is_array() && a.size() >= 2 && !a[0].is_string() && a[1].is_string();
+	}
+
+	bool setValueAtPath(Json& j,
+											const vector<ParameterPath::Element>& es,
+											size_t i,
+											double value)
+	{
+		if(isValueWithUnit(j) && (i == es.size() || j[0].is_array()))
+		{
+			auto a = j.array_items();
+			if(!setValueAtPath(a[0], es, i, value))
+				return false;
+			j = a;
+			return true;
+		}
+
+		if(i == es.size())
+		{
+			if(j.is_number())
+				j = value;
+			else if(j.is_bool())
+				j = value != 0;
+			else
+				return false;
+			return true;
+		}
+
+		const auto& e = es.at(i);
+		if(e.index >= 0)
+		{
+			if(!j.is_array() || size_t(e.index) >= j.array_items().size())
+				return false;
+			auto a = j.array_items();
+			if(!setValueAtPath(a[e.index], es, i + 1, value))
+				return false;
+			j = a;
+		}
+		else
+		{
+			if(!j.is_object())
+				return false;
+			auto o = j.object_items();
+			auto it = o.find(e.key);
+			if(it == o.end() || !setValueAtPath(it->second, es, i + 1, value))
+				return false;
+			j = o;
+		}
+		return true;
+	}
+
+	typedef vector<pair<const ParameterPath*, double>> PathValues;
+
+	Errors setValues(Json11Serializable& ps, const PathValues& pvs)
+	{
+		Errors es;
+		auto j = ps.to_json();
+		for(const auto& pv : pvs)
+			if(!setValueAtPath(j, pv.first->elements, 0, pv.second))
+				es.errors.push_back(string("Couldn't set parameter '") + pv.first->path + "'.");
+		es.append(ps.merge(j));
+		return es;
+	}
+}
+
+Errors Monica::setParameterValues(Env& env,
+																	const vector<ParameterPath>& paths,
+																	const vector<double>& values)
+{
+	Errors es;
+
+	//worksteps and crops keep state while running, so env needs its own ones
+	map<const Crop*, CropPtr> cropCopies;
+	for(auto& cm : env.cropRotation)
+		cm = cm.deepCopy(cropCopies);
+	for(auto& cr : env.cropRotations)
+		for(auto& cm : cr.cropRotation)
+			cm = cm.deepCopy(cropCopies);
+
+	map<string, PathValues> target2pvs;
+	for(size_t i = 0, size = min(paths.size(), values.size()); i < size; i++)
+	{
+		if(paths[i].isValid())
+			target2pvs[paths[i].target].push_back(make_pair(&paths[i], values[i]));
+		else
+			es.errors.push_back(string("Invalid parameter path '") + paths[i].path + "'.");
+	}
+
+	auto& cpp = env.params;
+	map<string, Json11Serializable*> paramSets
+	{{"userCropParameters", &cpp.userCropParameters}
+	,{"userEnvironmentParameters", &cpp.userEnvironmentParameters}
+	,{"userSoilMoistureParameters", &cpp.userSoilMoistureParameters}
+	,{"userSoilTemperatureParameters", &cpp.userSoilTemperatureParameters}
+	,{"userSoilTransportParameters", &cpp.userSoilTransportParameters}
+	,{"userSoilOrganicParameters", &cpp.userSoilOrganicParameters}
+	,{"simulationParameters", &cpp.simulationParameters}
+	,{"siteParameters", &cpp.siteParameters}
+	};
+
+	//crops with the same parameters will still share them after the change
+	map<const CropParameters*, CropParametersPtr> cpsCopies;
+	map<const CropResidueParameters*, CropResidueParametersPtr> rpsCopies;
+
+	for(const auto& p : target2pvs)
+	{
+		const auto& target = p.first;
+		const auto& pvs = p.second;
+
+		auto psi = paramSets.find(target);
+		if(psi != paramSets.end())
+			es.append(setValues(*psi->second, pvs));
+		else if(target == "species" || target == "cultivar")
+		{
+			for(const auto& cc : cropCopies)
+			{
+				auto crop = cc.second;
+				auto cps = crop->cropParameters();
+				if(!cps)
+					continue;
+
+				auto ci = cpsCopies.find(cps.get());
+				if(ci == cpsCopies.end())
+				{
+					auto copy = make_shared<CropParameters>(*cps);
+					cpsCopies[cps.get()] = copy;
+					cpsCopies[copy.get()] = copy;
+					crop->setCropParameters(copy);
+					if(target == "species")
+						es.append(setValues(copy->speciesParams, pvs));
+					else
+						es.append(setValues(copy->cultivarParams, pvs));
+				}
+				else
+					crop->setCropParameters(ci->second);
+			}
+		}
+		else if(target == "residue")
+		{
+			for(const auto& cc : cropCopies)
+			{
+				auto crop = cc.second;
+				auto rps = crop->residueParameters();
+				if(!rps)
+					continue;
+
+				auto ri = rpsCopies.find(rps.get());
+				if(ri == rpsCopies.end())
+				{
+					auto copy = make_shared<CropResidueParameters>(*rps);
+					rpsCopies[rps.get()] = copy;
+					rpsCopies[copy.get()] = copy;
+					crop->setResidueParameters(copy);
+					es.append(setValues(*copy, pvs));
+				}
+				else
+					crop->setResidueParameters(ri->second);
+			}
+		}
+		else
+			es.errors.push_back(string("Unknown parameter target '") + target + "'.");
+	}
+
+	return es;
+}
+
+//-----------------------------------------------------------------------------
+
+double SweepParameter::valueAt(double u) const
+{
+	if(!values.empty())
+		return values.at(std::min(values.size() - 1, size_t(u*values.size())));
+	return min + u*(max - min);
+}
+
+Errors SweepSpec::merge(json11::Json j)
+{
+	Errors res = Json11Serializable::merge(j);
+
+	set_string_value(design, j, "design");
+	int samples = int(noOfSamples), threads = int(noOfThreads), s = int(seed);
+	set_int_value(samples, j, "samples");
+	set_int_value(threads, j, "threads");
+	set_int_value(s, j, "seed");
+	noOfSamples = size_t(std::max(0, samples));
+	noOfThreads = size_t(std::max(0, threads));
+	seed = (unsigned int)s;
+
+	if(design != "grid" && design != "lhs" && design != "sobol")
+		res.errors.push_back(string("Unknown sweep design '") + design + "', use one of grid, lhs or sobol.");
+
+	if(j["parameters"].is_array())
+		parameters.clear();
+	for(auto pj : j["parameters"].array_items())
+	{
+		SweepParameter sp;
+		sp.path = ParameterPath(pj["path"].string_value());
+		if(!sp.path.isValid())
+		{
+			res.errors.push_back(string("Invalid parameter path '") + pj["path"].string_value() + "'.");
+			continue;
+		}
+
+		if(pj["values"].is_array())
+		{
+			for(auto vj : pj["values"].array_items())
+				sp.values.push_back(vj.number_value());
+		}
+		else if(pj["range"].is_array() && pj["range"].array_items().size() == 3)
+		{
+			double from = pj["range"][0].number_value();
+			double to = pj["range"][1].number_value();
+			double step = pj["range"][2].number_value();
+			if(step > 0)
+				for(size_t i = 0; from + i*step <= to + step*1e-9; i++)
+					sp.values.push_back(from + i*step);
+			else
+				res.errors.push_back(string("Range of parameter '") + sp.path.path + "' needs a positive step.");
+		}
+		else if(pj["min"].is_number() && pj["max"].is_number())
+		{
+			sp.min = pj["min"].number_value();
+			sp.max = pj["max"].number_value();
+		}
+
+		if(sp.values.empty() && (design == "grid" || !(pj["min"].is_number() && pj["max"].is_number())))
+		{
+			res.errors.push_back(string("No values for parameter '") + sp.path.path + "'.");
+			continue;
+		}
+		parameters.push_back(sp);
+	}
+
+	if(design == "sobol" && parameters.size() > maxSobolDimensions)
+		res.errors.push_back(string("A sobol design supports at most ") + to_string(maxSobolDimensions) + " parameters.");
+
+	return res;
+}
+
+json11::Json SweepSpec::to_json() const
+{
+	J11Array ps;
+	for(const auto& p : parameters)
+	{
+		J11Object pj{{"path", p.path.path}};
+		if(p.values.empty())
+			pj["min"] = p.min, pj["max"] = p.max;
+		else
+			pj["values"] = toPrimJsonArray(p.values);
+		ps.push_back(pj);
+	}
+
+	return J11Object
+	{{"type", "SweepSpec"}
+	,{"design", design}
+	,{"samples", int(noOfSamples)}
+	,{"seed", int(seed)}
+	,{"threads", int(noOfThreads)}
+	,{"parameters", ps}
+	};
+}
+
+vector<ParameterPath> SweepSpec::paths() const
+{
+	vector<ParameterPath> ps;
+	for(const auto& p : parameters)
+		ps.push_back(p.path);
+	return ps;
+}
+
+vector<vector<double>> Monica::createSweepDesign(const SweepSpec& spec)
+{
+	vector<vector<double>> design;
+	const auto& ps = spec.parameters;
+	if(ps.empty())
+		return design;
+
+	if(spec.design == "grid")
+	{
+		//full factorial design, the last parameter changes fastest
+		size_t noOfRuns = 1;
+		for(const auto& p : ps)
+			noOfRuns *= p.values.size();
+
+		for(size_t run = 0; run < noOfRuns; run++)
+		{
+			vector<double> vs(ps.size());
+			size_t rest = run;
+			for(size_t i = ps.size(); i > 0; i--)
+			{
+				const auto& values = ps[i - 1].values;
+				vs[i - 1] = values.at(rest % values.size());
+				rest /= values.size();
+			}
+			design.push_back(vs);
+		}
+	}
+	else
+	{
+		auto us = spec.design == "sobol"
+			? sobolSequence(spec.noOfSamples, ps.size())
+			: latinHypercubeSample(spec.noOfSamples, ps.size(), spec.seed);
+		for(const auto& u : us)
+		{
+			vector<double> vs(ps.size());
+			for(size_t i = 0; i < ps.size(); i++)
+				vs[i] = ps[i].valueAt(u[i]);
+			design.push_back(vs);
+		}
+	}
+
+	return design;
+}
+
+vector<vector<double>> Monica::latinHypercubeSample(size_t n, size_t dims, unsigned int seed)
+{
+	vector<vector<double>> sample(n, vector<double>(dims));
+	mt19937 gen(seed);
+	uniform_real_distribution<double> dist(0.0, 1.0);
+	vector<size_t> strata(n);
+	for(size_t d = 0; d < dims; d++)
+	{
+		iota(strata.begin(), strata.end(), 0);
+		shuffle(strata.begin(), strata.end(), gen);
+		for(size_t i = 0; i < n; i++)
+			sample[i][d] = (strata[i] + dist(gen)) / n;
+	}
+	return sample;
+}
+
+namespace
+{
+	//! primitive polynomials (degree s, coefficients a) and initial direction numbers m
+	//! for dimensions 2 to 21 (Joe & Kuo, new-joe-kuo-6.21201)
+	struct SobolInit { uint32_t s, a; uint32_t m[7]; };
+	const SobolInit sobolInits[] =
+	{{1, 0, {1}}
+	,{2, 1, {1, 3}}
+	,{3, 1, {1, 3, 1}}
+	,{3, 2, {1, 1, 1}}
+	,{4, 1, {1, 1, 3, 3}}
+	,{4, 4, {1, 3, 5, 13}}
+	,{5, 2, {1, 1, 5, 5, 17}}
+	,{5, 4, {1, 1, 5, 5, 5}}
+	,{5, 7, {1, 1, 7, 11, 19}}
+	,{5, 11, {1, 1, 5, 1, 1}}
+	,{5, 13, {1, 1, 1, 3, 11}}
+	,{5, 14, {1, 3, 5, 5, 31}}
+	,{6, 1, {1, 3, 3, 9, 7, 49}}
+	,{6, 13, {1, 1, 1, 15, 21, 21}}
+	,{6, 16, {1, 3, 1, 13, 27, 49}}
+	,{6, 19, {1, 1, 1, 15, 7, 5}}
+	,{6, 22, {1, 3, 1, 15, 13, 25}}
+	,{6, 25, {1, 1, 5, 5, 19, 61}}
+	,{7, 1, {1, 3, 7, 11, 23, 15, 103}}
+	,{7, 4, {1, 3, 7, 13, 13, 15, 69}}
+	};
+}
+
+vector<vector<double>> Monica::sobolSequence(size_t n, size_t dims)
+{
+	const int L = 32;
+	dims = min(dims, maxSobolDimensions);
+	vector<vector<double>> points(n, vector<double>(dims));
+
+	for(size_t d = 0; d < dims; d++)
+	{
+		//direction numbers, 1-indexed
+		vector<uint32_t> v(L + 1, 0);
+		if(d == 0)
+			for(int i = 1; i <= L; i++)
+				v[i] = uint32_t(1) << (L - i);
+		else
+		{
+			const auto& si = sobolInits[d - 1];
+			int s = int(si.s);
+			for(int i = 1; i <= s; i++)
+				v[i] = si.m[i - 1] << (L - i);
+			for(int i = s + 1; i <= L; i++)
+			{
+				v[i] = v[i - s] ^ (v[i - s] >> s);
+				for(int k = 1; k < s; k++)
+					v[i] ^= ((si.a >> (s - 1 - k)) & 1) * v[i - k];
+			}
+		}
+
+		//gray code construction, skipping the first point (origin)
+		uint32_t x = 0;
+		for(size_t i = 1; i <= n; i++)
+		{
+			//position of the rightmost zero bit of i - 1
+			int c = 1;
+			for(size_t value = i - 1; value & 1; value >>= 1)
+				c++;
+			x ^= v[min(c, L)];
+			points[i - 1][d] = double(x) / 4294967296.0;
+		}
+	}
+
+	return points;
+}
+
+//-----------------------------------------------------------------------------
+
+void Monica::runInParallel(size_t n, size_t noOfThreads, function<void(size_t)> f)
+{
+	if(noOfThreads == 0)
+		noOfThreads = max(1u, thread::hardware_concurrency());
+	noOfThreads = min(noOfThreads, n);
+
+	atomic<size_t> next(0);
+	auto work = [&]()
+	{
+		for(size_t i = next++; i < n; i = next++)
+			f(i);
+	};
+
+	vector<thread> threads;
+	for(size_t t = 1; t < noOfThreads; t++)
+		threads.emplace_back(work);
+	work();
+	for(auto& t : threads)
+		t.join();
+}
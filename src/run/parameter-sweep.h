@@ -0,0 +1,131 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+Authors:
+Michael Berg <michael.berg@zalf.de>
+
+Maintainers:
+Currently maintained by the authors.
+
+This file is part of the MONICA model.
+Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
+*/
+
+#ifndef MONICA_PARAMETER_SWEEP_H_
+#define MONICA_PARAMETER_SWEEP_H_
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "json11/json11.hpp"
+#include "json11/json11-helper.h"
+#include "run-monica.h"
+
+namespace Monica
+{
+	/*!
+	 * Path to a single numeric parameter of an Env.
+	 * The first element selects the parameter set, the rest is the path within the
+	 * JSON representation of that set, e.g.
+	 *   cultivar.MaxAssimilationRate
+	 *   species.BaseTemperature[2]
+	 *   siteParameters.SoilProfileParameters[0].SoilOrganicCarbon
+	 *   userSoilMoistureParameters.MaxPercolationRate
+	 * The targets species, cultivar and residue address the parameters of all crops in the crop rotation(s),
+	 * all other targets the members of the CentralParameterProvider by their JSON name.
+	 */
+	struct ParameterPath
+	{
+		ParameterPath() {}
+
+		ParameterPath(const std::string& path);
+
+		bool isValid() const { return !target.empty() && !elements.empty(); }
+
+		bool isCropTarget() const { return target == "species" || target == "cultivar" || target == "residue"; }
+
+		struct Element
+		{
+			std::string key;
+			int index{-1}; //!< if >= 0 an array index, else an object key
+		};
+
+		std::string path;
+		std::string target;
+		std::vector<Element> elements;
+	};
+
+	//! set values[i] at paths[i] in env
+	//! the crop rotation(s) of env will be copied before, so env neither shares state (worksteps, crops)
+	//! nor parameters with the Env it has been copied from and can be run in parallel to it
+	Tools::Errors setParameterValues(Env& env,
+																	 const std::vector<ParameterPath>& paths,
+																	 const std::vector<double>& values);
+
+	//---------------------------------------------------------------------------
+
+	struct SweepParameter
+	{
+		ParameterPath path;
+		std::vector<double> values; //!< explicit values or the values of a range
+		double min{0}, max{0}; //!< bounds for sampled designs, if no explicit values are given
+
+		//! map u in [0, 1) to a value of this parameter
+		double valueAt(double u) const;
+	};
+
+	/*!
+	 * Definition of a parameter sweep:
+	 * {
+	 *   "design": "grid" | "lhs" | "sobol",
+	 *   "samples": 100,  -> number of samples for lhs and sobol designs
+	 *   "seed": 1,       -> seed for the lhs design
+	 *   "threads": 0,    -> 0 = use all cores
+	 *   "parameters": [
+	 *     {"path": "cultivar.MaxAssimilationRate", "values": [40, 50, 60]},
+	 *     {"path": "species.InitialKcFactor", "range": [0.3, 0.6, 0.1]},
+	 *     {"path": "siteParameters.NDeposition", "min": 10, "max": 40}
+	 *   ]
+	 * }
+	 * A grid design runs all combinations of the values/ranges, the sampled designs
+	 * use min/max or pick from the values.
+	 */
+	struct SweepSpec : public Tools::Json11Serializable
+	{
+		SweepSpec() {}
+
+		SweepSpec(json11::Json j) { merge(j); }
+
+		virtual Tools::Errors merge(json11::Json j);
+
+		virtual json11::Json to_json() const;
+
+		std::vector<ParameterPath> paths() const;
+
+		std::string design{"grid"};
+		std::size_t noOfSamples{0};
+		unsigned int seed{1};
+		std::size_t noOfThreads{0};
+		std::vector<SweepParameter> parameters;
+	};
+
+	//! the parameter combinations of the sweep, one vector of values (in order of spec.parameters) per run
+	std::vector<std::vector<double>> createSweepDesign(const SweepSpec& spec);
+
+	//! Latin hypercube sample of n points in [0, 1)^dims
+	std::vector<std::vector<double>> latinHypercubeSample(std::size_t n, std::size_t dims, unsigned int seed);
+
+	//! the first n points (omitting the origin) of the Sobol sequence in [0, 1)^dims,
+	//! dims is limited to maxSobolDimensions
+	std::vector<std::vector<double>> sobolSequence(std::size_t n, std::size_t dims);
+	const std::size_t maxSobolDimensions = 21;
+
+	//! call f(i) for all i in [0, n) distributed over noOfThreads threads (0 = number of cores),
+	//! f must not throw (catch per call), an exception escaping a thread terminates the process
+	void runInParallel(std::size_t n, std::size_t noOfThreads, std::function<void(std::size_t)> f);
+}
+
+#endif //MONICA_PARAMETER_SWEEP_H_
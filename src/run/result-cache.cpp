@@ -0,0 +1,458 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+Authors:
+Michael Berg <michael.berg@zalf.de>
+
+Maintainers:
+Currently maintained by the authors.
+
+This file is part of the MONICA model.
+Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
+*/
+
+#include <cstdio>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iterator>
+#include <iostream>
+#include <vector>
+
+#include "result-cache.h"
+#include "metrics.h"
+#include "tools/helper.h"
+#include "json11/json11-helper.h"
+#include "../io/binary-json.h"
+#include "../resource/version.h"
+
+using namespace Monica;
+using namespace Tools;
+using namespace json11;
+using namespace std;
+
+Json ResultCacheStats::to_json() const
+{
+	return J11Object
+	{{"hits", double(hits)}
+	,{"misses", double(misses)}
+	,{"stores", double(stores)}
+	,{"evictions", double(evictions)}
+	,{"hitRate", hitRate()}
+	,{"noOfEntries", int(noOfEntries)}
+	,{"sizeInBytes", double(sizeInBytes)}
+	};
+}
+
+//-----------------------------------------------------------------------------
+
+namespace
+{
+	//! two FNV-1a hashes with different offset bases, giving a 128 bit key
+	struct KeyHasher
+	{
+		void add(const void* p, size_t n)
+		{
+			auto bs = static_cast<const unsigned char*>(p);
+			for(size_t i = 0; i < n; i++)
+			{
+				h1 = (h1 ^ bs[i]) * 1099511628211ULL;
+				h2 = (h2 ^ bs[i]) * 1099511628211ULL;
+			}
+		}
+
+		void add(const string& s)
+		{
+			uint64_t size = s.size();
+			add(&size, sizeof(size));
+			add(s.data(), s.size());
+		}
+
+		string key() const
+		{
+			ostringstream oss;
+			oss << hex << setfill('0') << setw(16) << h1 << setw(16) << h2;
+			return oss.str();
+		}
+
+		uint64_t h1{14695981039346656037ULL};
+		uint64_t h2{0x6c62272e07bb0142ULL};
+	};
+
+	const string indexFileName = "result-cache.index";
+}
+
+ResultCache::ResultCache(string pathToCacheDir,
+												 uint64_t maxSizeInBytes,
+												 uint64_t maxMemSizeInBytes)
+	: _pathToCacheDir(pathToCacheDir.empty() ? pathToCacheDir : fixSystemSeparator(pathToCacheDir))
+	, _maxSizeInBytes(maxSizeInBytes)
+	, _maxMemSizeInBytes(maxMemSizeInBytes)
+{
+	auto& m = metrics();
+	m.describe("monica_result_cache_hits_total", "counter", "Runs answered from the result cache.");
+	m.describe("monica_result_cache_misses_total", "counter", "Runs not found in the result cache.");
+	m.describe("monica_result_cache_stores_total", "counter", "Outputs stored in the result cache.");
+	m.describe("monica_result_cache_evictions_total", "counter", "Outputs dropped from the disk tier of the result cache.");
+	m.describe("monica_result_cache_hit_ratio", "gauge", "Hits divided by lookups of the result cache.");
+	m.describe("monica_result_cache_entries", "gauge", "Outputs in the result cache (on disk, in memory without a cache directory).");
+	m.describe("monica_result_cache_bytes", "gauge", "Size of the outputs in the result cache (on disk, in memory without a cache directory).");
+	m.describe("monica_result_cache_memory_bytes", "gauge", "Size of the outputs in the memory tier of the result cache.");
+
+	if(!_pathToCacheDir.empty())
+	{
+		if(ensureDirExists(_pathToCacheDir))
+			readIndex();
+		else
+		{
+			cerr << "Error couldn't create result cache directory: '" << _pathToCacheDir << "'." << endl;
+			_pathToCacheDir.clear();
+		}
+	}
+	exportGauges();
+}
+
+string ResultCache::key(const Env& env)
+{
+	KeyHasher h;
+	h.add(string(VER_FILE_VERSION_STR));
+
+	//ids, debug, profiling and memory accounting settings and the places the climate data came from don't change the results,
+	//envs with checkpoint options aren't cached at all (see runMonica) and the spin-up cache just makes the run faster
+	auto envm = env.to_json().object_items();
+	for(auto k : {"customId", "sharedId", "debugMode", "profile", "memoryStats", "climateData", "climateCSV", "pathsToClimateCSV",
+								"csvViaHeaderOptions", "pathToCheckpoints", "checkpointAt", "pathToSpinUpCache"})
+		envm.erase(k);
+	//objects are ordered by key, so the dump is canonical
+	h.add(Json(envm).dump());
+
+	auto latitude = env.params.siteParameters.vs_Latitude;
+	h.add(env.climateData.startDate().toIsoDateString());
+	for(size_t stepNo = 0, noOfSteps = env.climateData.noOfStepsPossible(); stepNo < noOfSteps; stepNo++)
+	{
+		for(auto p : env.climateData.allDataForStep(stepNo, latitude))
+		{
+			int acd = int(p.first);
+			h.add(&acd, sizeof(acd));
+			h.add(&p.second, sizeof(p.second));
+		}
+	}
+
+	return h.key();
+}
+
+string ResultCache::pathToFile(const string& key) const
+{
+	return fixSystemSeparator(_pathToCacheDir + "/" + key + ".out");
+}
+
+string ResultCache::pathToIndex() const
+{
+	return fixSystemSeparator(_pathToCacheDir + "/" + indexFileName);
+}
+
+void ResultCache::readIndex()
+{
+	//the index is a log of "key size" lines for stored and "- key" lines for removed outputs
+	ifstream ifs(pathToIndex());
+	string line;
+	while(getline(ifs, line))
+	{
+		istringstream iss(line);
+		string first, second;
+		if(!(iss >> first >> second))
+			continue;
+		_noOfIndexLines++;
+
+		if(first == "-")
+		{
+			if(_diskIndex.find(second) != _diskIndex.end())
+				removeFromDisk(second);
+			continue;
+		}
+
+		uint64_t size = 0;
+		if(!(istringstream(second) >> size))
+			continue;
+		if(_diskIndex.find(first) != _diskIndex.end())
+			removeFromDisk(first);
+		_diskEntries.push_back(make_pair(first, size));
+		_diskIndex[first] = prev(_diskEntries.end());
+		_stats.sizeInBytes += size;
+	}
+	_stats.noOfEntries = _diskEntries.size();
+}
+
+void ResultCache::appendToIndex(unique_lock<mutex>& lock, const string& lines)
+{
+	unique_lock<mutex> indexLock(_indexMutex);
+
+	_noOfIndexLines += size_t(count(lines.begin(), lines.end(), '\n'));
+	//rewrite the index from the current entries, once most of its lines are outdated
+	string snapshot;
+	bool compact = _noOfIndexLines > 2 * _diskEntries.size() + 64;
+	if(compact)
+	{
+		ostringstream oss;
+		for(const auto& e : _diskEntries)
+			oss << e.first << " " << e.second << "\n";
+		snapshot = oss.str();
+		_noOfIndexLines = _diskEntries.size();
+	}
+	lock.unlock();
+
+	auto path = pathToIndex();
+	if(compact)
+	{
+		auto tmpPath = path + ".tmp";
+		ofstream ofs(tmpPath, ios::trunc);
+		ofs << snapshot;
+		ofs.close();
+		if(ofs.fail() || rename(tmpPath.c_str(), path.c_str()) != 0)
+		{
+			cerr << "Error couldn't write result cache index: '" << path << "'." << endl;
+			remove(tmpPath.c_str());
+		}
+	}
+	else
+	{
+		ofstream ofs(path, ios::app);
+		ofs << lines;
+		ofs.close();
+		if(ofs.fail())
+			cerr << "Error couldn't append to result cache index: '" << path << "'." << endl;
+	}
+}
+
+string ResultCache::removeFromDisk(const string& key)
+{
+	auto it = _diskIndex.find(key);
+	_stats.sizeInBytes -= it->second->second;
+	_diskEntries.erase(it->second);
+	_diskIndex.erase(it);
+	_stats.noOfEntries = _diskEntries.size();
+	return "- " + key + "\n";
+}
+
+void ResultCache::insertIntoMemory(const string& key, shared_ptr<const string> data)
+{
+	if(data->size() > _maxMemSizeInBytes)
+		return;
+
+	auto it = _memIndex.find(key);
+	if(it != _memIndex.end())
+	{
+		_memSizeInBytes -= it->second->second->size();
+		_memEntries.erase(it->second);
+		_memIndex.erase(it);
+	}
+	_memEntries.push_back(make_pair(key, data));
+	_memIndex[key] = prev(_memEntries.end());
+	_memSizeInBytes += data->size();
+
+	//drop the least recently used outputs
+	while(_memSizeInBytes > _maxMemSizeInBytes)
+	{
+		const auto& e = _memEntries.front();
+		_memSizeInBytes -= e.second->size();
+		_memIndex.erase(e.first);
+		_memEntries.pop_front();
+	}
+}
+
+void ResultCache::exportGauges() const
+{
+	auto s = stats();
+	uint64_t memSizeInBytes = 0;
+	{
+		lock_guard<mutex> lock(_mutex);
+		memSizeInBytes = _memSizeInBytes;
+	}
+	auto& m = metrics();
+	m.set("monica_result_cache_hit_ratio", s.hitRate());
+	m.set("monica_result_cache_entries", double(s.noOfEntries));
+	m.set("monica_result_cache_bytes", double(s.sizeInBytes));
+	m.set("monica_result_cache_memory_bytes", double(memSizeInBytes));
+}
+
+bool ResultCache::get(const string& key, Output& out)
+{
+	shared_ptr<const string> data;
+	bool onDisk = false;
+	{
+		lock_guard<mutex> lock(_mutex);
+		auto mit = _memIndex.find(key);
+		if(mit != _memIndex.end())
+		{
+			data = mit->second->second;
+			_memEntries.splice(_memEntries.end(), _memEntries, mit->second);
+		}
+		auto dit = _diskIndex.find(key);
+		if(dit != _diskIndex.end())
+		{
+			_diskEntries.splice(_diskEntries.end(), _diskEntries, dit->second);
+			onDisk = true;
+		}
+	}
+
+	//read from disk without holding the lock, a file evicted meanwhile just makes it a miss
+	bool fromDisk = !data && onDisk;
+	if(fromDisk)
+	{
+		ifstream ifs(pathToFile(key), ios::binary);
+		if(ifs.good())
+		{
+			string bytes((istreambuf_iterator<char>(ifs)), istreambuf_iterator<char>());
+			if(!ifs.bad())
+				data = make_shared<const string>(move(bytes));
+		}
+	}
+
+	unique_lock<mutex> lock(_mutex);
+	if(data)
+	{
+		_stats.hits++;
+		if(fromDisk)
+			insertIntoMemory(key, data);
+	}
+	else
+	{
+		_stats.misses++;
+		//the index is out of sync with the directory, so drop the entry
+		if(fromDisk && _diskIndex.find(key) != _diskIndex.end() && _busy.find(key) == _busy.end())
+			appendToIndex(lock, removeFromDisk(key));
+	}
+	if(lock.owns_lock())
+		lock.unlock();
+
+	metrics().inc(data ? "monica_result_cache_hits_total" : "monica_result_cache_misses_total");
+	exportGauges();
+	if(!data)
+		return false;
+
+	auto r = decodeBinaryJson(*data);
+	if(r.failure())
+	{
+		for(auto e : r.errors)
+			cerr << "Error in cached result '" << key << "': " << e << endl;
+		return false;
+	}
+	out = Output(r.result);
+	return true;
+}
+
+void ResultCache::put(const string& key, const Output& out)
+{
+	auto data = make_shared<const string>(encodeBinaryJson(out.to_json()));
+
+	bool write = false;
+	{
+		lock_guard<mutex> lock(_mutex);
+		insertIntoMemory(key, data);
+		_stats.stores++;
+		//another thread might already be writing (or removing) the same output
+		write = !_pathToCacheDir.empty()
+			&& _diskIndex.find(key) == _diskIndex.end()
+			&& _busy.insert(key).second;
+	}
+	metrics().inc("monica_result_cache_stores_total");
+
+	if(!write)
+	{
+		exportGauges();
+		return;
+	}
+
+	//write to a temporary file first, so a partially written output will never be read
+	auto path = pathToFile(key);
+	auto tmpPath = path + ".tmp";
+	ofstream ofs(tmpPath, ios::binary | ios::trunc);
+	ofs.write(data->data(), data->size());
+	ofs.close();
+	bool written = !ofs.fail() && rename(tmpPath.c_str(), path.c_str()) == 0;
+	if(!written)
+	{
+		cerr << "Error couldn't write result to cache: '" << path << "'." << endl;
+		remove(tmpPath.c_str());
+	}
+
+	unique_lock<mutex> lock(_mutex);
+	_busy.erase(key);
+	if(!written)
+	{
+		lock.unlock();
+		exportGauges();
+		return;
+	}
+
+	_diskEntries.push_back(make_pair(key, uint64_t(data->size())));
+	_diskIndex[key] = prev(_diskEntries.end());
+	_stats.sizeInBytes += data->size();
+	_stats.noOfEntries = _diskEntries.size();
+	ostringstream lines;
+	lines << key << " " << data->size() << "\n";
+
+	//drop the least recently used outputs, but keep the one just stored,
+	//the evicted ones stay busy until their files are removed
+	vector<string> evicted;
+	while(_stats.sizeInBytes > _maxSizeInBytes && _diskEntries.size() > 1)
+	{
+		auto k = _diskEntries.front().first;
+		lines << removeFromDisk(k);
+		_busy.insert(k);
+		evicted.push_back(k);
+		_stats.evictions++;
+	}
+
+	appendToIndex(lock, lines.str());
+
+	if(!evicted.empty())
+	{
+		for(const auto& k : evicted)
+			remove(pathToFile(k).c_str());
+		{
+			lock_guard<mutex> lock2(_mutex);
+			for(const auto& k : evicted)
+				_busy.erase(k);
+		}
+		metrics().inc("monica_result_cache_evictions_total", double(evicted.size()));
+	}
+	exportGauges();
+}
+
+Output ResultCache::runMonica(const Env& env)
+{
+	//a cached result has no profile or memory stats of its run,
+	//wouldn't write the requested checkpoints and can't see a changed content of the checkpoint to start from
+	if(env.profile || env.memoryStats || !env.checkpointDates.empty() || !env.startFromCheckpoint.empty())
+		return Monica::runMonica(env);
+
+	auto k = key(env);
+	Output out;
+	if(get(k, out))
+	{
+		out.customId = env.customId;
+		return out;
+	}
+
+	out = Monica::runMonica(env);
+	//don't keep failed runs, they might succeed after fixing the setup (e.g. missing files)
+	if(out.errors.empty())
+		put(k, out);
+	return out;
+}
+
+ResultCacheStats ResultCache::stats() const
+{
+	lock_guard<mutex> lock(_mutex);
+	auto s = _stats;
+	if(_pathToCacheDir.empty())
+	{
+		s.noOfEntries = _memEntries.size();
+		s.sizeInBytes = _memSizeInBytes;
+	}
+	return s;
+}
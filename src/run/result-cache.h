@@ -0,0 +1,115 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+Authors:
+Michael Berg <michael.berg@zalf.de>
+
+Maintainers:
+Currently maintained by the authors.
+
+This file is part of the MONICA model.
+Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
+*/
+
+#ifndef MONICA_RESULT_CACHE_H_
+#define MONICA_RESULT_CACHE_H_
+
+#include <string>
+#include <map>
+#include <list>
+#include <set>
+#include <mutex>
+#include <memory>
+#include <cstdint>
+
+#include "json11/json11.hpp"
+#include "run-monica.h"
+#include "../io/output.h"
+
+namespace Monica
+{
+	struct ResultCacheStats
+	{
+		std::uint64_t hits{0};
+		std::uint64_t misses{0};
+		std::uint64_t stores{0};
+		std::uint64_t evictions{0};
+		std::size_t noOfEntries{0};
+		std::uint64_t sizeInBytes{0};
+
+		double hitRate() const { return hits + misses > 0 ? double(hits) / double(hits + misses) : 0.0; }
+
+		json11::Json to_json() const;
+	};
+
+	/*!
+	 * Content addressed cache of the outputs of MONICA runs, as MONICA is deterministic for a given Env.
+	 * The key is a hash of the canonical JSON of the Env (without ids and debug settings), the climate data
+	 * and the MONICA version. Outputs are kept in memory (up to maxMemSizeInBytes) and, if a directory is given,
+	 * also on disk as binary encoded files (up to maxSizeInBytes), both tiers drop the least recently used outputs.
+	 * Files are read and written outside of the cache's lock, the index of the directory is an append only log
+	 * (stores and removals), compacted once it has grown to twice the number of entries.
+	 * The hits, misses, stores, evictions and sizes are also exported as monica_result_cache_* metrics.
+	 * A cache directory should be used by a single process only.
+	 */
+	class ResultCache
+	{
+	public:
+		ResultCache(std::string pathToCacheDir = std::string(),
+								std::uint64_t maxSizeInBytes = std::uint64_t(1024) * 1024 * 1024,
+								std::uint64_t maxMemSizeInBytes = std::uint64_t(256) * 1024 * 1024);
+
+		//! the key of env, env needs to have its climate data already
+		static std::string key(const Env& env);
+
+		//! get the output stored under key, customId will be the one of the stored run
+		bool get(const std::string& key, Output& out);
+
+		void put(const std::string& key, const Output& out);
+
+		//! run env or return the cached output of an equal env,
+		//! envs profiling, accounting memory, writing or starting from checkpoints are always run
+		Output runMonica(const Env& env);
+
+		ResultCacheStats stats() const;
+
+	private:
+		typedef std::list<std::pair<std::string, std::shared_ptr<const std::string>>> MemEntries;
+		typedef std::list<std::pair<std::string, std::uint64_t>> DiskEntries;
+
+		std::string pathToFile(const std::string& key) const;
+		std::string pathToIndex() const;
+		void readIndex();
+		//! append lines to the index, lock (of _mutex) is released while writing,
+		//! the index lock is taken before, so the lines of concurrent calls keep their order
+		void appendToIndex(std::unique_lock<std::mutex>& lock, const std::string& lines);
+		//! drop key from the disk tier, returns the index line recording it
+		std::string removeFromDisk(const std::string& key);
+		void insertIntoMemory(const std::string& key, std::shared_ptr<const std::string> data);
+		void exportGauges() const;
+
+		std::string _pathToCacheDir;
+		std::uint64_t _maxSizeInBytes{0};
+		std::uint64_t _maxMemSizeInBytes{0};
+
+		mutable std::mutex _mutex;
+		//! the outputs in memory, least recently used first
+		MemEntries _memEntries;
+		std::map<std::string, MemEntries::iterator> _memIndex;
+		std::uint64_t _memSizeInBytes{0};
+		//! the outputs on disk, least recently used first
+		DiskEntries _diskEntries;
+		std::map<std::string, DiskEntries::iterator> _diskIndex;
+		//! outputs being written to or removed from disk right now
+		std::set<std::string> _busy;
+		std::size_t _noOfIndexLines{0};
+		ResultCacheStats _stats;
+
+		//! serializes the writes of the index file
+		std::mutex _indexMutex;
+	};
+}
+
+#endif //MONICA_RESULT_CACHE_H_
@@ -19,6 +19,8 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 #include <tuple>
 #include <vector>
 #include <algorithm>
+#include <chrono>
+#include <memory>
 
 #include <kj/debug.h>
 
@@ -52,6 +54,8 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 #include "common.capnp.h"
 
 #include "run-monica-capnp.h"
+#include "metrics.h"
+#include "trace.h"
 
 #include "common/sole.hpp"
 
@@ -97,6 +101,23 @@ DataAccessor fromCapnpData(
   return da;
 }
 
+namespace {
+  const std::string phaseSeconds = "monica_job_phase_seconds";
+
+  template<typename Context>
+  void setResult(Context& context, const Monica::Output& out) {
+    TraceSpan span("serialize");
+    span.arg("customId", out.customId);
+    MetricsTimer timer(phaseSeconds, label("phase", "serialize"));
+    auto result = out.toString();
+    metrics().observe("monica_result_bytes", double(result.size()));
+    auto rs = context.getResults();
+    rs.initResult();
+    rs.getResult().setValue(result);
+    metrics().inc("monica_jobs_in_progress", -1);
+  }
+}
+
 kj::Promise<void> RunMonicaImpl::info(InfoContext context) //override
 {
   auto rs = context.getResults();
@@ -113,19 +134,75 @@ kj::Promise<void> RunMonicaImpl::run(RunContext context) //override
 
   auto envR = context.getParams().getEnv();
 
+  metrics().inc("monica_jobs_received_total");
+  metrics().inc("monica_jobs_in_progress");
+
   auto runMonica = [context, envR, this](DataAccessor da = DataAccessor()) mutable {
     std::string err;
     auto rest = envR.getRest();
     if (!rest.getStructure().isJson()) {
+      metrics().inc("monica_jobs_failed_total");
       return Monica::Output(std::string("Error: 'rest' field is not valid JSON!"));
     }
 
+    TraceSpan parseSpan("parse");
+    MetricsTimer parseTimer(phaseSeconds, label("phase", "parse"));
     const Json& envJson = Json::parse(rest.getValue().cStr(), err);
+    parseTimer.stop();
+    parseSpan.arg("type", envJson["type"]);
+    parseSpan.arg("customId", envJson["customId"]);
+    parseSpan.end();
     //cout << "runMonica: " << envJson["customId"].dump() << endl;
 
-    Env env;
-    auto errors = env.merge(envJson);
+    //base envs can be registered once and jobs then sent as deltas against them (see env-template-cache.h)
+    auto msgType = envJson["type"].string_value();
+    if (msgType == "EnvTemplate") {
+      auto id = EnvTemplateCache::templateId(envJson);
+      Monica::Output out;
+      out.customId = id;
+      if (envJson["env"].is_null())
+        _envTemplates.removeTemplate(id);
+      else {
+        auto es = _envTemplates.registerTemplate(id, envJson["env"]);
+        out.errors = es.errors;
+        out.warnings = es.warnings;
+      }
+      return out;
+    }
 
+    auto start = std::chrono::steady_clock::now();
+    TraceSpan createEnvSpan("create-env");
+    MetricsTimer createEnvTimer(phaseSeconds, label("phase", "create-env"));
+    Env env;
+    if (msgType == "EnvDelta") {
+      auto templateId = EnvTemplateCache::templateId(envJson);
+      //the job may carry its template, for servers which don't know it (yet)
+      auto res = _envTemplates.registerIfUnknown(templateId, envJson);
+      auto ee = _envTemplates.createEnv(templateId, envJson["delta"]);
+      if (ee.failure()) {
+        Monica::Output out;
+        out.customId = envJson["delta"]["customId"];
+        out.errors = res.errors;
+        out.errors.insert(out.errors.end(), ee.errors.begin(), ee.errors.end());
+        if (!_envTemplates.hasTemplate(templateId))
+          out.unknownTemplateId = templateId;
+        metrics().inc("monica_jobs_failed_total");
+        return out;
+      }
+      env = ee.result;
+    }
+    else
+      env.merge(envJson);
+    createEnvTimer.stop();
+    createEnvSpan.arg("customId", env.customId);
+    createEnvSpan.end();
+
+    TraceSpan climateSpan("climate-load");
+    climateSpan.arg("customId", env.customId);
+    //climate data from a time series capability have been observed as climate-load phase while fetching them
+    std::unique_ptr<MetricsTimer> climateTimer;
+    if (!da.isValid())
+      climateTimer.reset(new MetricsTimer(phaseSeconds, label("phase", "climate-load")));
     EResult<DataAccessor> eda;
     if (da.isValid()) {
       eda.result = da;
@@ -137,9 +214,15 @@ kj::Promise<void> RunMonicaImpl::run(RunContext context) //override
       }
     }
 
+    if (climateTimer)
+      climateTimer->stop();
+    climateSpan.end();
+
     Monica::Output out;
     if (eda.success()) {
-      env.climateData = eda.result;
+      //keep climate data sent with the env (or template)
+      if (eda.result.isValid())
+        env.climateData = eda.result;
 
       env.debugMode = _startedServerInDebugMode && env.debugMode;
 
@@ -148,16 +231,26 @@ kj::Promise<void> RunMonicaImpl::run(RunContext context) //override
         return Soil::readCapillaryRiseRates().getRate(soilTexture, distance);
       };
 
-      out = Monica::runMonica(env);
+      TraceSpan simulateSpan("simulate");
+      simulateSpan.arg("customId", env.customId);
+      MetricsTimer simulateTimer(phaseSeconds, label("phase", "simulate"));
+      out = _resultCache ? _resultCache->runMonica(env) : Monica::runMonica(env);
     }
 
-    out.errors = eda.errors;
-    out.warnings = eda.warnings;
+    //keep the errors and warnings of the run itself
+    out.errors.insert(out.errors.end(), eda.errors.begin(), eda.errors.end());
+    out.warnings.insert(out.warnings.end(), eda.warnings.begin(), eda.warnings.end());
 
+    //count the job only now, a run failing inside runMonica has to count as failed
+    bool failed = !out.errors.empty();
+    metrics().inc(failed ? "monica_jobs_failed_total" : "monica_jobs_completed_total");
+    metrics().inc("monica_busy_seconds_total", std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
     return out;
   };
 
   if (envR.hasTimeSeries()) {
+    //fetching the climate data from the time series capability is the climate-load phase too
+    auto climateTimer = kj::heap<MetricsTimer>(phaseSeconds, label("phase", "climate-load"));
     auto ts = envR.getTimeSeries();
     auto rangeProm = ts.rangeRequest().send();
     auto headerProm = ts.headerRequest().send();
@@ -177,17 +270,14 @@ kj::Promise<void> RunMonicaImpl::run(RunContext context) //override
             headerResponse.getHeader(), dataTResponse.getData());
         });
       });
-    }).then([context, runMonica](DataAccessor da) mutable {
+    }).then([context, runMonica, KJ_MVCAP(climateTimer)](DataAccessor da) mutable {
+      climateTimer->stop();
       auto out = runMonica(da);
-      auto rs = context.getResults();
-      rs.initResult();
-      rs.getResult().setValue(out.toString());
+      setResult(context, out);
             });
   } else {
     auto out = runMonica();
-    auto rs = context.getResults();
-    rs.initResult();
-    rs.getResult().setValue(out.toString());
+    setResult(context, out);
     return kj::READY_NOW;
   }
 }
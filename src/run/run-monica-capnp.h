@@ -22,6 +22,8 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 #include <kj/thread.h>
 
 #include "climate/climate-common.h"
+#include "env-template-cache.h"
+#include "result-cache.h"
 
 #include "model.capnp.h"
 #include "common.capnp.h"
@@ -33,12 +35,17 @@ class RunMonicaImpl final : public mas::rpc::Model::EnvInstance::Server {
   bool _startedServerInDebugMode{ false };
   mas::rpc::Common::Callback::Client unregister{ nullptr };
   int idCount{ 0 };
+  EnvTemplateCache _envTemplates;
+  std::shared_ptr<ResultCache> _resultCache;
 
 public:
   RunMonicaImpl(bool startedServerInDebugMode = false) : _startedServerInDebugMode(startedServerInDebugMode) {}
 
   void setUnregister(mas::rpc::Common::Callback::Client unreg) { unregister = unreg; }
 
+  //! answer envs which have been run before from resultCache
+  void setResultCache(std::shared_ptr<ResultCache> resultCache) { _resultCache = resultCache; }
+
   kj::Promise<void> info(InfoContext context) override;
 
   kj::Promise<void> run(RunContext context) override;
@@ -30,9 +30,11 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 #include "zeromq/zmq-helper.h"
 #include "json11/json11.hpp"
 #include "run-monica-zmq.h"
+#include "trace.h"
 #include "cultivation-method.h"
 #include "tools/debug.h"
 #include "../io/database-io.h"
+#include "../io/binary-json.h"
 
 using namespace std;
 using namespace Monica;
@@ -44,7 +46,8 @@ using namespace Soil;
 
 Json Monica::sendZmqRequestMonicaFull(zmq::context_t* zmqContext, 
 																			string socketAddress,
-																			Json envJson)
+																			Json envJson,
+																			bool binaryEncoding)
 {
 	Json res;
 
@@ -58,14 +61,29 @@ Json Monica::sendZmqRequestMonicaFull(zmq::context_t* zmqContext,
 
 		//string s = envJson.dump();
 
+		TraceSpan span("request", "client");
+		span.arg("customId", envJson["customId"]);
 		try
 		{
-			if(s_send(socket, envJson.dump()))
+			bool sent = false;
+			if(binaryEncoding)
+			{
+				auto envm = envJson.object_items();
+				auto type = envJson["type"].string_value();
+				envm["type"] = (type.empty() ? string("Env") : type) + ".bin";
+				sent = s_send(socket, encodeBinaryJson(envm));
+			}
+			else
+				sent = s_send(socket, envJson.dump());
+
+			if(sent)
 			{
 				try
 				{
-					auto msg = receiveMsg(socket);
-					res = msg.json;
+					auto r = parseJsonOrBinaryJson(s_recv(socket));
+					for(auto e : r.errors)
+						cerr << e << endl;
+					res = r.result;
 				}
 				catch(zmq::error_t e)
 				{
@@ -93,4 +111,109 @@ Json Monica::sendZmqRequestMonicaFull(zmq::context_t* zmqContext,
 
 //-----------------------------------------------------------------------------
 
+vector<Json> Monica::sendZmqBatchRequestsMonicaFull(zmq::context_t* zmqContext,
+																									 string socketAddress,
+																									 const vector<Json>& envs,
+																									 size_t batchSize,
+																									 size_t maxInFlight,
+																									 bool binaryEncoding)
+{
+	vector<Json> res(envs.size());
+	batchSize = max(size_t(1), batchSize);
+	maxInFlight = max(size_t(1), maxInFlight);
+
+	//a dealer socket doesn't enforce the request/reply lockstep, so multiple batches can be in flight
+	zmq::socket_t socket(*zmqContext, ZMQ_DEALER);
+	debug() << "MONICA: connecting monica zeromq dealer socket to address: " << socketAddress << endl;
+	try
+	{
+		socket.connect(socketAddress);
+		debug() << "MONICA: connected monica zeromq dealer socket to address: " << socketAddress << endl;
+
+		size_t noOfBatches = (envs.size() + batchSize - 1) / batchSize;
+		//jobs to be created by the server from sim/crop/site.json (see EnvConfigCache) instead of complete envs
+		bool fromConfig = !envs.empty() && envs.front()["type"].string_value() == "EnvFromConfig";
+		size_t nextBatch = 0, noOfReceivedBatches = 0, inFlight = 0;
+		auto tracer = TraceWriter::instance();
+		vector<int64_t> sentUs(tracer ? noOfBatches : 0);
+		//the batches sent but not answered yet, every request gets exactly one reply (maybe an error)
+		vector<bool> outstanding(noOfBatches, false);
+		while(nextBatch < noOfBatches || inFlight > 0)
+		{
+			try
+			{
+				for(; inFlight < maxInFlight && nextBatch < noOfBatches; nextBatch++, inFlight++)
+				{
+					auto from = envs.begin() + nextBatch * batchSize;
+					auto to = envs.begin() + min(envs.size(), (nextBatch + 1) * batchSize);
+					J11Object batch
+					{{"type", binaryEncoding ? "EnvBatch.bin" : "EnvBatch"}
+					,{"customId", int(nextBatch)}
+					,{fromConfig ? "jobs" : "envs", J11Array(from, to)}
+					};
+					//empty delimiter frame, as a request socket would send
+					s_sendmore(socket, "");
+					s_send(socket, binaryEncoding ? encodeBinaryJson(batch) : Json(batch).dump());
+					outstanding[nextBatch] = true;
+					if(tracer)
+						sentUs[nextBatch] = TraceWriter::nowUs();
+				}
+
+				s_recv(socket); //empty delimiter frame
+				auto r = parseJsonOrBinaryJson(s_recv(socket));
+				for(auto e : r.errors)
+					cerr << e << endl;
+				inFlight--;
+
+				const auto& cid = r.result["customId"];
+				bool knownBatch = r.success()
+					&& baseMsgType(r.result["type"].string_value()) == "OutputBatch"
+					&& cid.is_number() && cid.number_value() == cid.int_value()
+					&& cid.int_value() >= 0 && size_t(cid.int_value()) < noOfBatches
+					&& outstanding[cid.int_value()];
+				if(!knownBatch)
+				{
+					cerr << "Ignoring reply which answers no outstanding batch, customId: " << cid.dump()
+						<< " type: " << r.result["type"].dump() << " errors: " << r.result["errors"].dump() << endl;
+					continue;
+				}
+				size_t b = size_t(cid.int_value());
+				outstanding[b] = false;
+				noOfReceivedBatches++;
+
+				const auto& outs = r.result["outputs"].array_items();
+				//the round trip of the batch, from being sent until its results are back
+				if(tracer && b < sentUs.size())
+					tracer->complete("batch", "client", sentUs[b], TraceWriter::nowUs(),
+													 J11Object{{"customId", int(b)}, {"envs", int(outs.size())}});
+				for(size_t i = 0; i < outs.size() && b * batchSize + i < res.size(); i++)
+					res[b * batchSize + i] = outs[i];
+			}
+			catch(zmq::error_t e)
+			{
+				cerr
+					<< "Exception on trying to send or receive batch messages on zmq socket with address: "
+					<< socketAddress << "! Error: [" << e.what() << "]" << endl;
+				break;
+			}
+		}
 
+		if(noOfReceivedBatches < noOfBatches)
+		{
+			cerr << "Got no results for " << (noOfBatches - noOfReceivedBatches) << " of " << noOfBatches << " batches, ids:";
+			for(size_t b = 0; b < noOfBatches; b++)
+				if(outstanding[b] || b >= nextBatch)
+					cerr << " " << b;
+			cerr << endl;
+		}
+	}
+	catch(zmq::error_t e)
+	{
+		cerr << "Coulnd't connect socket to address: " << socketAddress << "! Error: " << e.what() << endl;
+	}
+
+	debug() << "exiting sendZmqBatchRequestsMonicaFull" << endl;
+	return res;
+}
+
+//-----------------------------------------------------------------------------
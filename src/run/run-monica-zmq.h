@@ -33,9 +33,22 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 
 namespace Monica
 {
+	//! send envJson to a MONICA server and wait for the result
+	//! binaryEncoding sends the env as binary "Env.bin" message, the server will then reply in binary too
 	json11::Json sendZmqRequestMonicaFull(zmq::context_t* zmqContext, 
 																				std::string socketAddress,
-																				json11::Json envJson);
+																				json11::Json envJson,
+																				bool binaryEncoding = false);
+
+	//! send envs in "EnvBatch" messages of batchSize envs each to MONICA server(s) (or a proxy), 
+	//! keeping up to maxInFlight batches in flight, and return the outputs in order of envs,
+	//! the outputs of batches which got no or an error reply are null (the batch ids are reported on cerr)
+	std::vector<json11::Json> sendZmqBatchRequestsMonicaFull(zmq::context_t* zmqContext,
+																													 std::string socketAddress,
+																													 const std::vector<json11::Json>& envs,
+																													 std::size_t batchSize = 10,
+																													 std::size_t maxInFlight = 1,
+																													 bool binaryEncoding = false);
 }
 
 #endif
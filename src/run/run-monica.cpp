@@ -26,8 +26,14 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 #include <thread>
 #include <tuple>
 #include <limits>
+#include <fstream>
+#include <iterator>
+#include <iomanip>
+#include <list>
+#include <cstdio>
 
 #include "run-monica.h"
+#include "trace.h"
 #include "tools/debug.h"
 #include "climate/climate-common.h"
 #include "db/abstract-db-connections.h"
@@ -35,6 +41,7 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 #include "tools/algorithms.h"
 #include "../io/build-output.h"
 #include "../core/crop-growth.h"
+#include "../resource/version.h"
 
 using namespace Monica;
 using namespace std;
@@ -137,6 +144,25 @@ Errors Env::merge(json11::Json j)
 	customId = j["customId"];
 	set_string_value(sharedId, j, "sharedId");
 
+	if(j["checkpointAt"].is_array())
+	{
+		checkpointDates.clear();
+		for(auto dj : j["checkpointAt"].array_items())
+		{
+			auto d = Date::fromIsoDateString(dj.string_value());
+			if(d.isValid())
+				checkpointDates.push_back(d);
+			else
+				es.errors.push_back(string("Couldn't parse checkpoint date: '") + dj.string_value() + "'.");
+		}
+	}
+	set_string_value(pathToCheckpoints, j, "pathToCheckpoints");
+	set_string_value(startFromCheckpoint, j, "startFromCheckpoint");
+	set_iso_date_value(spinUpUntil, j, "spinUpUntil");
+	set_string_value(pathToSpinUpCache, j, "pathToSpinUpCache");
+	set_bool_value(profile, j, "profile");
+	set_bool_value(memoryStats, j, "memoryStats");
+
 	return es;
 }
 
@@ -161,6 +187,10 @@ json11::Json Env::to_json() const
 		crs.push_back(cro);
 	}
 
+	J11Array cpds;
+	for(auto d : checkpointDates)
+		cpds.push_back(d.toIsoDateString());
+
 	return J11Object
 	{{"type", "Env"}
 	,{"params", params.to_json()}
@@ -173,6 +203,13 @@ json11::Json Env::to_json() const
 	,{"csvViaHeaderOptions", csvViaHeaderOptions}
 	,{"customId", customId}
 	,{"sharedId", sharedId}
+	,{"checkpointAt", cpds}
+	,{"pathToCheckpoints", pathToCheckpoints}
+	,{"startFromCheckpoint", startFromCheckpoint}
+	,{"spinUpUntil", spinUpUntil.toIsoDateString()}
+	,{"pathToSpinUpCache", pathToSpinUpCache}
+	,{"profile", profile}
+	,{"memoryStats", memoryStats}
 	,{"events", events}
 	,{"outputs", outputs}
 	};
@@ -485,8 +522,22 @@ void StoreData::aggregateResultsObj()
 	}
 }
 
-void StoreData::storeResultsIfSpecApplies(const MonicaModel& monica, bool storeObjOutputs)
+void StoreData::storeResultsIfSpecApplies(const MonicaModel& monica, bool storeObjOutputs, RunProfile* profile)
 {
+	auto store = [&](vector<J11Array>& rs)
+	{
+		ProfileTimer timer(profile, RunProfile::OutputStore);
+		storeResults(outputIds, rs, monica);
+	};
+	auto aggregate = [&]()
+	{
+		ProfileTimer timer(profile, RunProfile::OutputStore);
+		if(storeObjOutputs)
+			aggregateResultsObj();
+		else
+			aggregateResults();
+	};
+
 	string os = spec.origSpec.dump();
 	bool isCurrentlyEndEvent = false;
 	
@@ -510,6 +561,7 @@ void StoreData::storeResultsIfSpecApplies(const MonicaModel& monica, bool storeO
 		//check for at event
 		if(spec.atf && spec.atf(monica))
 		{
+			ProfileTimer timer(profile, RunProfile::OutputStore);
 			if(storeObjOutputs)
 				storeResultsObj(outputIds, resultsObj, monica);
 			else
@@ -532,17 +584,14 @@ void StoreData::storeResultsIfSpecApplies(const MonicaModel& monica, bool storeO
 				if(spec.whilef)
 				{
 					if(spec.whilef(monica))
-						storeResults(outputIds, intermediateResults, monica);
+						store(intermediateResults);
 				}
 				else
-					storeResults(outputIds, intermediateResults, monica);
+					store(intermediateResults);
 
 				if(isCurrentlyToEvent) 
 				{
-					if(storeObjOutputs)
-						aggregateResultsObj();
-					else
-						aggregateResults();
+					aggregate();
 					withinEventFromToRange = false;
 				}
 			}
@@ -551,16 +600,13 @@ void StoreData::storeResultsIfSpecApplies(const MonicaModel& monica, bool storeO
 		else if(spec.whilef)
 		{
 			if(spec.whilef(monica)) {
-				storeResults(outputIds, intermediateResults, monica);
+				store(intermediateResults);
 			}
 			else if(!intermediateResults.empty()
 							&& !intermediateResults.front().empty())
 			{
 				//if while event was not successful but we got intermediate results, they should be aggregated
-				if(storeObjOutputs)
-					aggregateResultsObj();
-				else
-					aggregateResults();
+				aggregate();
 			}
 		}
 	}
@@ -639,196 +685,273 @@ void Monica::initPathToDB(const std::string& initialPathToIniFile)
 	Db::dbConnectionParameters(initialPathToIniFile);
 }
 
-Output Monica::runMonica(Env env)
+MonicaRun::MonicaRun(Env env)
+	: _env(env)
 {
-	Output out;
-	bool returnObjOutputs = env.returnObjOutputs();
-	out.customId = env.customId;
+	_returnObjOutputs = _env.returnObjOutputs();
 
-	activateDebug = env.debugMode;
-	if(activateDebug)
+	//the process wide activateDebug is left to the executables, runs in parallel might want different settings
+	_debugMode = _env.debugMode;
+	if(_debugMode)
 	{
-		writeDebugInputs(env, "inputs.json");
+		writeDebugInputs(_env, "inputs.json");
 	}
 
 	//prefer multiple crop rotations, but use a single rotation if there
-	if(env.cropRotations.empty() && !env.cropRotation.empty())
-		env.cropRotations.push_back(CropRotation(env.climateData.startDate(), 
-																						 env.climateData.endDate(), 
-																						 env.cropRotation));
+	if(_env.cropRotations.empty() && !_env.cropRotation.empty())
+		_env.cropRotations.push_back(CropRotation(_env.climateData.startDate(), 
+																							_env.climateData.endDate(), 
+																							_env.cropRotation));
 
 	debug() << "starting Monica" << endl;
 	debug() << "-----" << endl;
 
-	MonicaModel monica(env.params);
-	monica.simulationParametersNC().startDate = env.climateData.startDate();
-	monica.simulationParametersNC().endDate = env.climateData.endDate();
+	_monica.reset(new MonicaModel(_env.params));
+	if(_env.profile)
+	{
+		_profile.reset(new RunProfile);
+		_monica->setProfile(_profile.get());
+	}
+	_monica->simulationParametersNC().startDate = _env.climateData.startDate();
+	_monica->simulationParametersNC().endDate = _env.climateData.endDate();
 
 	debug() << "currentDate" << endl;
-	Date currentDate = env.climateData.startDate();
-	
+	_currentDate = _env.climateData.startDate();
+	_noOfSteps = _env.climateData.noOfStepsPossible();
+
+	registerDailyFunctions();
+
+	tie(_currentCM, _nextAbsoluteCMApplicationDate) = findNextCultivationMethod(_currentDate, false);
+
+	_store = setupStorage(_env.events, _env.climateData.startDate(), _env.climateData.endDate());
+
+	if(!_env.startFromCheckpoint.empty())
+		restoreCheckpointFromFile(_env.startFromCheckpoint);
+
+	//the allocations of the setup are not part of the run's allocations per day
+	_allocationsAtStart = MemoryAccounting::threadAllocationCount();
+	_stepNoAtStart = _stepNo;
+}
+
+MonicaRun::MonicaRun(const MonicaRun& other)
+	: _env(other._env)
+	, _returnObjOutputs(other._returnObjOutputs)
+	, _debugMode(other._debugMode)
+	, _stepNo(other._stepNo)
+	, _noOfSteps(other._noOfSteps)
+	, _currentDate(other._currentDate)
+	, _crIndex(other._crIndex)
+	, _cmIndex(other._cmIndex)
+	, _nextAbsoluteCMApplicationDate(other._nextAbsoluteCMApplicationDate)
+	, _dailyValues(other._dailyValues)
+	, _store(other._store)
+	, _errors(other._errors)
+{
+	//the copied env still shares the worksteps and crops with other, 
+	//but they keep state while running, so the fork needs its own ones
+	map<const Crop*, CropPtr> cropCopies;
+	map<const CultivationMethod*, CultivationMethod*> cmCopies;
+	for(size_t i = 0, size = _env.cropRotations.size(); i < size; i++)
+	{
+		const auto& ocr = other._env.cropRotations.at(i).cropRotation;
+		auto& cr = _env.cropRotations.at(i).cropRotation;
+		for(size_t k = 0, size2 = cr.size(); k < size2; k++)
+		{
+			cr[k] = ocr.at(k).deepCopy(cropCopies);
+			cmCopies[&ocr.at(k)] = &cr[k];
+		}
+	}
+
+	for(auto cm : other._cropRotation)
+		_cropRotation.push_back(cmCopies[cm]);
+	_currentCM = other._currentCM ? cmCopies[other._currentCM] : nullptr;
+
+	for(auto ws : other._additionalWorksteps)
+		_additionalWorksteps.push_back(WSPtr(ws->deepClone(cropCopies)));
+
+	auto crop = other._monica->currentCrop();
+	auto cci = crop ? cropCopies.find(crop.get()) : cropCopies.end();
+	_monica.reset(new MonicaModel(*other._monica, cci == cropCopies.end() ? crop : cci->second));
+
+	//the fork's profile includes the time until the fork
+	if(other._profile)
+	{
+		_profile.reset(new RunProfile(*other._profile));
+		_monica->setProfile(_profile.get());
+	}
+
+	//the copied daily values are accessed by the same ids, as the worksteps are registered in the same order
+	registerDailyFunctions();
+
+	//the fork counts its own allocations only
+	_allocationsAtStart = MemoryAccounting::threadAllocationCount();
+	_stepNoAtStart = _stepNo;
+}
+
+void MonicaRun::registerDailyFunctions()
+{
 	// create a way for worksteps to let the runtime calculate at a daily basis things a workstep needs when being executed
 	// e.g. to actually accumulate values from days before the workstep (for calculating a moving window of past values)
 	int dailyFuncId = 0;
-	map<int, vector<double>> dailyValues;
-	vector<function<void()>> applyDailyFuncs;
+	_applyDailyFuncs.clear();
 
 	//iterate through all the worksteps in the croprotation(s) and check for functions which have to run daily
-	for (auto& cr : env.cropRotations) {
+	for (auto& cr : _env.cropRotations) {
 		for (auto& cm : cr.cropRotation) {
 			for (auto wsptr : cm.getWorksteps()) {
-				auto df = wsptr->registerDailyFunction([&dailyValues, dailyFuncId]() -> vector<double> & {
-					return dailyValues[dailyFuncId];
+				auto df = wsptr->registerDailyFunction([this, dailyFuncId]() -> vector<double> & {
+					return _dailyValues[dailyFuncId];
 					});
 				if (df) {
-					applyDailyFuncs.push_back([&monica, df, dailyFuncId, &dailyValues] {
-						dailyValues[dailyFuncId].push_back(df(&monica));
+					_applyDailyFuncs.push_back([this, df, dailyFuncId] {
+						_dailyValues[dailyFuncId].push_back(df(_monica.get()));
 						});
 				}
 				dailyFuncId++;
 			}
 		}
 	}
+}
 
-	//auto crit = env.cropRotations.empty() ? env.cropRotations.end() : env.cropRotations.begin();
-	auto crit = env.cropRotations.begin();
-
-	//cropRotation is a shadow of the env.cropRotation, which will hold pointers to CMs in env.cropRotation, but might shrink
-	//if pure absolute CMs are finished
-	vector<CultivationMethod*> cropRotation;
-
-	auto checkAndInitShadowOfNextCropRotation = [&](Date currentDate)
+bool MonicaRun::checkAndInitShadowOfNextCropRotation(Date currentDate)
+{
+	if(_crIndex < _env.cropRotations.size())
 	{
-		if(crit != env.cropRotations.end())
+		//if current cropRotation is finished, try to move to next
+		const auto& cr = _env.cropRotations.at(_crIndex);
+		if(cr.end.isValid()
+			 && currentDate == cr.end + 1)
 		{
-			//if current cropRotation is finished, try to move to next
-			if(crit->end.isValid()
-				 && currentDate == crit->end + 1)
-			{
-				crit++;
-				cropRotation.clear();
-			}
+			_crIndex++;
+			_cropRotation.clear();
+		}
 
-			//check again, because we might have moved to next cropRotation
-			if(crit != env.cropRotations.end())
+		//check again, because we might have moved to next cropRotation
+		if(_crIndex < _env.cropRotations.size())
+		{
+			//if a new cropRotation starts, copy the the pointers to the CMs to the shadow CR
+			auto& ncr = _env.cropRotations.at(_crIndex);
+			if(ncr.start.isValid() 
+				 && currentDate == ncr.start)
 			{
-				//if a new cropRotation starts, copy the the pointers to the CMs to the shadow CR
-				if(crit->start.isValid() 
-					 && currentDate == crit->start)
-				{
-					for(auto& cm : crit->cropRotation)
-						cropRotation.push_back(&cm);
-					return true;
-				}
+				for(auto& cm : ncr.cropRotation)
+					_cropRotation.push_back(&cm);
+				return true;
 			}
 		}
-		return false;
-	};
+	}
+	return false;
+}
 
-	//iterator through the crop rotation
-	//auto cmit = cropRotation.empty() ? cropRotation.end() : cropRotation.begin();
-	auto cmit = cropRotation.begin();
+pair<CultivationMethod*, Date> MonicaRun::findNextCultivationMethod(Date currentDate, 
+																																		bool advanceToNextCM)
+{
+	CultivationMethod* currentCM = nullptr;
+	Date nextAbsoluteCMApplicationDate;
 
-	auto findNextCultivationMethod = [&](Date currentDate,
-																			 bool advanceToNextCM = true)
+	//it might be possible that the next cultivation method has to be skipped (if cover/catch crop)
+	bool notFoundNextCM = true;
+	while(notFoundNextCM)
 	{
-		CultivationMethod* currentCM = nullptr;
-		Date nextAbsoluteCMApplicationDate;
-
-		//it might be possible that the next cultivation method has to be skipped (if cover/catch crop)
-		bool notFoundNextCM = true;
-		while(notFoundNextCM)
+		if(advanceToNextCM && _cmIndex < _cropRotation.size())
 		{
-			if(advanceToNextCM)
-			{
-				//delete fully cultivation methods with only absolute worksteps,
-				//because they won't participate in a new run when wrapping the crop rotation 
-				if((*cmit)->areOnlyAbsoluteWorksteps() 
-					 || !(*cmit)->repeat())
-					cmit = cropRotation.erase(cmit);
-				else
-					cmit++;
+			//delete fully cultivation methods with only absolute worksteps,
+			//because they won't participate in a new run when wrapping the crop rotation 
+			auto cm = _cropRotation.at(_cmIndex);
+			if(cm->areOnlyAbsoluteWorksteps() 
+				 || !cm->repeat())
+				_cropRotation.erase(_cropRotation.begin() + _cmIndex);
+			else
+				_cmIndex++;
 
-				//start anew if we reached the end of the crop rotation
-				if(cmit == cropRotation.end())
-					cmit = cropRotation.begin();
-			}
+			//start anew if we reached the end of the crop rotation
+			if(_cmIndex == _cropRotation.size())
+				_cmIndex = 0;
+		}
 
-			//check if there's at least a cultivation method left in cropRotation
-			if(cmit != cropRotation.end())
+		//check if there's at least a cultivation method left in cropRotation
+		if(_cmIndex < _cropRotation.size())
+		{
+			advanceToNextCM = true;
+			currentCM = _cropRotation.at(_cmIndex);
+			
+			//addedYear tells that the start of the cultivation method was before currentDate and thus the whole 
+			//CM had to be moved into the next year
+			//is possible for relative dates
+			bool addedYear = currentCM->reinit(currentDate);
+			if(addedYear)
 			{
-				advanceToNextCM = true;
-				currentCM = *cmit;
-				
-				//addedYear tells that the start of the cultivation method was before currentDate and thus the whole 
-				//CM had to be moved into the next year
-				//is possible for relative dates
-				bool addedYear = currentCM->reinit(currentDate);
-				if(addedYear)
-				{
-					//current CM is a cover crop, check if the latest sowing date would have been before current date, 
-					//if so, skip current CM
-					if(currentCM->isCoverCrop())
-					{
-						//if current CM's latest sowing date is actually after current date, we have to 
-						//reinit current CM again, but this time prevent shifting it to the next year
-						if(!(notFoundNextCM = currentCM->absLatestSowingDate().withYear(currentDate.year()) < currentDate))
-							currentCM->reinit(currentDate, true);
-					}
-					else //if current CM was marked skipable, skip it
-						notFoundNextCM = currentCM->canBeSkipped();
-				}
-				else //not added year or CM was had also absolute dates
+				//current CM is a cover crop, check if the latest sowing date would have been before current date, 
+				//if so, skip current CM
+				if(currentCM->isCoverCrop())
 				{
-					if(currentCM->isCoverCrop())
-						notFoundNextCM = currentCM->absLatestSowingDate() < currentDate;
-					else if(currentCM->canBeSkipped())
-						notFoundNextCM = currentCM->absStartDate() < currentDate;
-					else
-						notFoundNextCM = false;
+					//if current CM's latest sowing date is actually after current date, we have to 
+					//reinit current CM again, but this time prevent shifting it to the next year
+					if(!(notFoundNextCM = currentCM->absLatestSowingDate().withYear(currentDate.year()) < currentDate))
+						currentCM->reinit(currentDate, true);
 				}
-
-				if(notFoundNextCM)
-					nextAbsoluteCMApplicationDate = Date();
+				else //if current CM was marked skipable, skip it
+					notFoundNextCM = currentCM->canBeSkipped();
+			}
+			else //not added year or CM was had also absolute dates
+			{
+				if(currentCM->isCoverCrop())
+					notFoundNextCM = currentCM->absLatestSowingDate() < currentDate;
+				else if(currentCM->canBeSkipped())
+					notFoundNextCM = currentCM->absStartDate() < currentDate;
 				else
-				{
-					nextAbsoluteCMApplicationDate = currentCM->staticWorksteps().empty() ? Date() : currentCM->absStartDate(false);
-					debug() << "new valid next abs app-date: " << nextAbsoluteCMApplicationDate.toString() << endl;
-				}
+					notFoundNextCM = false;
 			}
+
+			if(notFoundNextCM)
+				nextAbsoluteCMApplicationDate = Date();
 			else
 			{
-				currentCM = nullptr;
-				nextAbsoluteCMApplicationDate = Date();
-				notFoundNextCM = false;
+				nextAbsoluteCMApplicationDate = currentCM->staticWorksteps().empty() ? Date() : currentCM->absStartDate(false);
+				debug() << "new valid next abs app-date: " << nextAbsoluteCMApplicationDate.toString() << endl;
 			}
 		}
+		else
+		{
+			currentCM = nullptr;
+			nextAbsoluteCMApplicationDate = Date();
+			notFoundNextCM = false;
+		}
+	}
 
-		return make_pair(currentCM, nextAbsoluteCMApplicationDate);
-	};
+	return make_pair(currentCM, nextAbsoluteCMApplicationDate);
+}
 
-	//direct handle to current cultivation method
-	CultivationMethod* currentCM;
-	Date nextAbsoluteCMApplicationDate;
-	tie(currentCM, nextAbsoluteCMApplicationDate) = findNextCultivationMethod(currentDate, false);
+void MonicaRun::step()
+{
+	if(!hasNextStep())
+		return;
 
-	vector<StoreData> store = setupStorage(env.events, env.climateData.startDate(), env.climateData.endDate());
-	
-	for(size_t d = 0, nods = env.climateData.noOfStepsPossible(); d < nods; ++d, ++currentDate)
+	if(TraceWriter::instance())
+		traceYear();
+
+	auto& monica = *_monica;
+	auto profile = _profile.get();
+	ProfileTimer stepTimer(profile, RunProfile::Step);
+
+	debug() << "currentDate: " << _currentDate.toString() << endl;
+
+	if(checkAndInitShadowOfNextCropRotation(_currentDate))
 	{
-		debug() << "currentDate: " << currentDate.toString() << endl;
+		_cmIndex = 0;
+		tie(_currentCM, _nextAbsoluteCMApplicationDate) = findNextCultivationMethod(_currentDate, false);
+	}
+	
+	monica.dailyReset();
 
-		if(checkAndInitShadowOfNextCropRotation(currentDate))
-		{
-			//cmit = cropRotation.empty() ? cropRotation.end() : cropRotation.begin();
-			cmit = cropRotation.begin();
-			tie(currentCM, nextAbsoluteCMApplicationDate) = findNextCultivationMethod(currentDate, false);
-		}
-		
-		monica.dailyReset();
+	monica.setCurrentStepDate(_currentDate);
+	{
+		ProfileTimer timer(profile, RunProfile::ClimateData);
+		monica.setCurrentStepClimateData(_env.climateData.allDataForStep(_stepNo, _env.params.siteParameters.vs_Latitude));
+	}
 
-		monica.setCurrentStepDate(currentDate);
-		monica.setCurrentStepClimateData(env.climateData.allDataForStep(d, env.params.siteParameters.vs_Latitude));
+	{
+		ProfileTimer timer(profile, RunProfile::Worksteps);
 
 		// test if monica's crop has been dying in previous step
 		// if yes, it will be incorporated into soil
@@ -836,57 +959,108 @@ Output Monica::runMonica(Env env)
 			monica.incorporateCurrentCrop();
 
 		//try to apply dynamic worksteps
-		if(currentCM)
-			currentCM->apply(&monica);
+		if(_currentCM)
+			_currentCM->apply(&monica);
 
 		//apply worksteps and cycle through crop rotation
-		if(currentCM && nextAbsoluteCMApplicationDate == currentDate)
+		if(_currentCM && _nextAbsoluteCMApplicationDate == _currentDate)
 		{
-			debug() << "applying absolute-at: " << nextAbsoluteCMApplicationDate.toString() << endl;
-			currentCM->absApply(nextAbsoluteCMApplicationDate, &monica);
+			debug() << "applying absolute-at: " << _nextAbsoluteCMApplicationDate.toString() << endl;
+			_currentCM->absApply(_nextAbsoluteCMApplicationDate, &monica);
+
+			_nextAbsoluteCMApplicationDate = _currentCM->nextAbsDate(_nextAbsoluteCMApplicationDate);
 
-			nextAbsoluteCMApplicationDate = currentCM->nextAbsDate(nextAbsoluteCMApplicationDate);
-						
-			debug() << " next abs app-date: " << nextAbsoluteCMApplicationDate.toString() << endl;
+			debug() << " next abs app-date: " << _nextAbsoluteCMApplicationDate.toString() << endl;
 		}
 
-		//monica main stepping method
-		monica.step();
+		//apply the worksteps added to this run only
+		for(auto ws : _additionalWorksteps)
+			if(ws->absDate() == _currentDate)
+				ws->apply(&monica);
+	}
 
-		// call all daily functions, assuming it's better to do this after the steps, than before
-		// so the daily monica calculations will be taken into account
-		// but means also that a workstep which gets executed before the steps, can't take the
-		// values into account by applying a daily function
-		for (auto& f : applyDailyFuncs)
+	//monica main stepping method
+	monica.step();
+
+	// call all daily functions, assuming it's better to do this after the steps, than before
+	// so the daily monica calculations will be taken into account
+	// but means also that a workstep which gets executed before the steps, can't take the
+	// values into account by applying a daily function
+	{
+		ProfileTimer timer(profile, RunProfile::DailyFunctions);
+		for (auto& f : _applyDailyFuncs)
 			f();
+	}
 
-		//store results
-		for(auto& s : store)
-			s.storeResultsIfSpecApplies(monica, returnObjOutputs);
+	//store results
+	{
+		ProfileTimer timer(profile, RunProfile::OutputEvents);
+		for(auto& s : _store)
+			s.storeResultsIfSpecApplies(monica, _returnObjOutputs, profile);
+	}
 
-		//if the next application date is not valid, we're at the end
-		//of the application list of this cultivation method
-		//and go to the next one in the crop rotation
-		if(currentCM 
-			 && currentCM->allDynamicWorkstepsFinished()
-			 && !nextAbsoluteCMApplicationDate.isValid())
-		{
-			//to count the applied fertiliser for the next production process
-			monica.resetFertiliserCounter();
+	//if the next application date is not valid, we're at the end
+	//of the application list of this cultivation method
+	//and go to the next one in the crop rotation
+	if(_currentCM 
+		 && _currentCM->allDynamicWorkstepsFinished()
+		 && !_nextAbsoluteCMApplicationDate.isValid())
+	{
+		//to count the applied fertiliser for the next production process
+		monica.resetFertiliserCounter();
 
-			tie(currentCM, nextAbsoluteCMApplicationDate) = findNextCultivationMethod(currentDate + 1);
-		}
+		tie(_currentCM, _nextAbsoluteCMApplicationDate) = findNextCultivationMethod(_currentDate + 1);
 	}
-	
-	for(auto& sd : store)
+
+	Date simulatedDate = _currentDate;
+	++_stepNo;
+	++_currentDate;
+
+	//the checkpoint contains the state at the end of the simulated date
+	const auto& cpds = _env.checkpointDates;
+	if(!cpds.empty() && find(cpds.begin(), cpds.end(), simulatedDate) != cpds.end())
+	{
+		string path = fixSystemSeparator(_env.pathToCheckpoints.empty() ? string(".") : _env.pathToCheckpoints);
+		if(ensureDirExists(path))
+			saveCheckpointToFile(path + "/checkpoint-" + simulatedDate.toIsoDateString() + ".bin");
+		else
+			addError(string("Couldn't create checkpoint directory: '") + path + "'.");
+	}
+}
+
+void MonicaRun::runUntil(Date date)
+{
+	while(hasNextStep() && _currentDate < date)
+		step();
+}
+
+void MonicaRun::runToEnd()
+{
+	while(hasNextStep())
+		step();
+}
+
+Output MonicaRun::finish()
+{
+	Output out;
+	out.customId = _env.customId;
+
+	for(auto& sd : _store)
 	{
 		//aggregate results of while events or unfinished other from/to ranges (where to event didn't happen yet)
-		if(returnObjOutputs)
+		if(_returnObjOutputs)
 			sd.aggregateResultsObj();
 		else
 			sd.aggregateResults();
 		out.data.push_back({sd.spec.origSpec.dump(), sd.outputIds, sd.results, sd.resultsObj});
 	}
+	out.errors.insert(out.errors.end(), _errors.begin(), _errors.end());
+	if(_profile)
+		out.profile = _profile->to_json();
+	if(_env.memoryStats)
+		out.memoryStats = memoryStats();
+	if(TraceWriter::instance())
+		traceYear(true);
 
 	debug() << "returning from runMonica" << endl;
 
@@ -896,3 +1070,554 @@ Output Monica::runMonica(Env env)
 
 	return out;
 }
+
+void MonicaRun::traceYear(bool endOfRun)
+{
+	auto tw = TraceWriter::instance();
+	int year = _currentDate.year();
+	if(_tracedYear != 0 && (endOfRun || year != _tracedYear))
+	{
+		tw->complete("simulate-year", "monica", _tracedYearStartUs, TraceWriter::nowUs(),
+								 J11Object{{"customId", _env.customId}, {"year", _tracedYear}});
+		_tracedYear = 0;
+	}
+	if(!endOfRun && _tracedYear == 0)
+	{
+		_tracedYear = year;
+		_tracedYearStartUs = TraceWriter::nowUs();
+	}
+}
+
+Json MonicaRun::memoryStats() const
+{
+	using namespace MemoryAccounting;
+
+	auto arrayBytes = [](const J11Array& a)
+	{
+		size_t bytes = a.capacity() * sizeof(Json);
+		for(const auto& j : a)
+			bytes += approxHeapBytes(j);
+		return bytes;
+	};
+
+	size_t storeBytes = 0;
+	for(const auto& sd : _store)
+	{
+		for(const auto& a : sd.intermediateResults)
+			storeBytes += sizeof(J11Array) + arrayBytes(a);
+		for(const auto& a : sd.results)
+			storeBytes += sizeof(J11Array) + arrayBytes(a);
+		for(const auto& o : sd.resultsObj)
+			storeBytes += sizeof(J11Object) + approxHeapBytes(Json(o));
+	}
+
+	size_t aomPoolBytes = 0;
+	for(const auto& layer : _monica->soilColumn())
+		aomPoolBytes += layer.vo_AOM_Pool.capacity() * sizeof(AOM_Properties);
+
+	auto noOfDays = _stepNo - _stepNoAtStart;
+	J11Object res
+	{{"simulatedDays", int(noOfDays)}
+	,{"storeBytes", double(storeBytes)}
+	,{"climateHistoryBytes", double(approxHeapBytes(_monica->climateData()))}
+	,{"aomPoolBytes", double(aomPoolBytes)}
+	//the high-water mark of the process, not of this run (see monica-bench for the peak of single runs)
+	,{"processPeakRSSKiB", double(peakRSSKiB())}
+	};
+
+	//if the run moved to another thread, the counts are meaningless
+	auto now = threadAllocationCount();
+	if(allocationsCounted() && now.allocations >= _allocationsAtStart.allocations)
+	{
+		double allocations = double(now.allocations - _allocationsAtStart.allocations);
+		double bytes = double(now.bytes - _allocationsAtStart.bytes);
+		double days = double(max(size_t(1), noOfDays));
+		res["allocations"] = allocations;
+		res["allocatedBytes"] = bytes;
+		res["allocationsPerDay"] = allocations / days;
+		res["allocatedBytesPerDay"] = bytes / days;
+	}
+
+	return res;
+}
+
+Output MonicaRun::takeResults()
+{
+	Output out;
+	out.customId = _env.customId;
+
+	for(auto& sd : _store)
+	{
+		auto noOfColumns = sd.results.size();
+		out.data.push_back({sd.spec.origSpec.dump(), sd.outputIds, move(sd.results), move(sd.resultsObj)});
+		sd.results = vector<J11Array>(noOfColumns);
+		sd.resultsObj.clear();
+	}
+
+	return out;
+}
+
+void MonicaRun::addError(const string& error)
+{
+	cerr << error << endl;
+	_errors.push_back(error);
+}
+
+ostream& MonicaRun::debug() const
+{
+	//a stream without buffer just drops everything, one per thread as failing writes set its state
+	static thread_local ostream discard(nullptr);
+	return _debugMode ? cout : discard;
+}
+
+namespace
+{
+	const char checkpointMagic[8] = {'M', 'O', 'N', 'I', 'C', 'A', 'C', 'P'};
+}
+
+/*!
+ * Layout of a checkpoint:
+ * header: magic, version, start date of the run, next date to simulate
+ * body: location of the current crop, model state, state of the crop rotation and the collected results
+ * The model state comes first, so a checkpoint can be used to just initialize the soil of another run.
+ */
+template<class Archive>
+void MonicaRun::serializeRunState(Archive& ar)
+{
+	//the crop rotations are part of the configuration, so references to CMs are stored as indices
+	auto& crs = _env.cropRotations;
+	auto cmToIndex = [&](const CultivationMethod* cm)
+	{
+		if(cm && _crIndex < crs.size())
+		{
+			const auto& cr = crs[_crIndex].cropRotation;
+			for(size_t i = 0; i < cr.size(); i++)
+				if(&cr[i] == cm)
+					return int32_t(i);
+		}
+		return int32_t(-1);
+	};
+
+	//find the cultivation method the model's current crop belongs to
+	int32_t cropCRI = -1, cropCMI = -1;
+	auto crop = _monica->currentCrop();
+	for(size_t i = 0; crop && cropCRI < 0 && i < crs.size(); i++)
+		for(size_t k = 0; k < crs[i].cropRotation.size(); k++)
+			if(crs[i].cropRotation[k].crop() == crop)
+			{
+				cropCRI = int32_t(i);
+				cropCMI = int32_t(k);
+				break;
+			}
+	ar(cropCRI, cropCMI);
+	if(Archive::isReading)
+	{
+		if(cropCRI >= 0 && size_t(cropCRI) < crs.size() && cropCMI >= 0 && size_t(cropCMI) < crs[cropCRI].cropRotation.size())
+			crop = crs[cropCRI].cropRotation[cropCMI].crop();
+		else
+			crop.reset();
+	}
+	serializeModel(ar, crop);
+
+	uint64_t stepNo = _stepNo, crIndex = _crIndex, cmIndex = _cmIndex;
+	ar(stepNo, crIndex, cmIndex);
+
+	vector<int32_t> shadowCRIs;
+	for(auto cm : _cropRotation)
+		shadowCRIs.push_back(cmToIndex(cm));
+	int32_t currentCMI = cmToIndex(_currentCM);
+	ar(shadowCRIs, currentCMI, _nextAbsoluteCMApplicationDate, _dailyValues);
+
+	if(Archive::isReading)
+	{
+		_stepNo = size_t(stepNo);
+		_crIndex = size_t(crIndex);
+		_cmIndex = size_t(cmIndex);
+		auto indexToCM = [&](int32_t i) -> CultivationMethod*
+		{
+			if(i < 0)
+				return nullptr;
+			if(_crIndex >= crs.size() || size_t(i) >= crs[_crIndex].cropRotation.size())
+			{
+				ar.setFailed();
+				return nullptr;
+			}
+			return &crs[_crIndex].cropRotation[i];
+		};
+		_cropRotation.clear();
+		for(auto i : shadowCRIs)
+			if(auto cm = indexToCM(i))
+				_cropRotation.push_back(cm);
+		_currentCM = indexToCM(currentCMI);
+	}
+
+	//the number of outputs is defined by the events, so has to be the same when reading
+	uint64_t noOfStores = _store.size();
+	ar(noOfStores);
+	if(noOfStores != _store.size())
+	{
+		ar.setFailed();
+		return;
+	}
+	for(auto& sd : _store)
+		ar(sd);
+
+	//crop rotations after the current one haven't been touched yet, leaving them out
+	//allows to continue with different management after the checkpoint (e.g. after a spin-up)
+	uint64_t noOfTouchedCRs = min(_crIndex + 1, crs.size());
+	ar(noOfTouchedCRs);
+	if(noOfTouchedCRs > crs.size())
+	{
+		ar.setFailed();
+		return;
+	}
+	for(size_t i = 0; i < noOfTouchedCRs; i++)
+		for(auto& cm : crs[i].cropRotation)
+			ar(cm);
+}
+
+string MonicaRun::saveCheckpoint() const
+{
+	StateWriter sw;
+	sw.writeBytes(checkpointMagic, sizeof(checkpointMagic));
+	uint32_t version = checkpointVersion;
+	Date runStartDate = _env.climateData.startDate();
+	Date nextDate = _currentDate;
+	sw(version, runStartDate, nextDate);
+
+	//writing doesn't change the run, the non const serialize is just shared with reading
+	const_cast<MonicaRun*>(this)->serializeRunState(sw);
+
+	return sw.data();
+}
+
+bool MonicaRun::saveCheckpointToFile(const string& pathToFile)
+{
+	ofstream ofs(pathToFile, ios::binary | ios::trunc);
+	if(ofs.fail())
+	{
+		addError(string("Couldn't open checkpoint file for writing: '") + pathToFile + "'.");
+		return false;
+	}
+	auto cp = saveCheckpoint();
+	ofs.write(cp.data(), cp.size());
+	ofs.close();
+	if(ofs.fail())
+	{
+		addError(string("Couldn't write checkpoint file: '") + pathToFile + "'.");
+		return false;
+	}
+	return true;
+}
+
+bool MonicaRun::restoreCheckpoint(const string& checkpoint)
+{
+	StateReader sr(checkpoint);
+	char magic[sizeof(checkpointMagic)];
+	uint32_t version = 0;
+	Date runStartDate, nextDate;
+	if(!sr.readBytes(magic, sizeof(magic))
+		 || !equal(magic, magic + sizeof(magic), checkpointMagic))
+	{
+		addError("Couldn't restore checkpoint: not a MONICA checkpoint.");
+		return false;
+	}
+	sr(version);
+	if(version != checkpointVersion)
+	{
+		addError(string("Couldn't restore checkpoint: version ") + to_string(version)
+						 + " is not supported, expected version " + to_string(checkpointVersion) + ".");
+		return false;
+	}
+	sr(runStartDate, nextDate);
+
+	if(runStartDate == _env.climateData.startDate())
+	{
+		//resume the very same run
+		serializeRunState(sr);
+		_currentDate = nextDate;
+		if(!sr.good() || !(_currentDate == _env.climateData.startDate() + int(_stepNo)))
+		{
+			addError("Couldn't restore checkpoint: it doesn't match the setup of this run.");
+			//the state is only partially restored and thus unusable
+			_stepNo = _noOfSteps;
+			return false;
+		}
+	}
+	else
+	{
+		//initialize the soil of this run by the state of another (e.g. spin-up) run
+		auto noOfLayers = _monica->soilColumn().size();
+		int32_t cropCRI = -1, cropCMI = -1;
+		sr(cropCRI, cropCMI);
+		if(!_monica->restoreSoilState(sr) || _monica->soilColumn().size() != noOfLayers)
+		{
+			addError("Couldn't initialize soil state from checkpoint: it doesn't match the soil of this run.");
+			_stepNo = _noOfSteps;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool MonicaRun::restoreCheckpointFromFile(const string& pathToFile)
+{
+	ifstream ifs(pathToFile, ios::binary);
+	if(ifs.fail())
+	{
+		addError(string("Couldn't open checkpoint file: '") + pathToFile + "'.");
+		_stepNo = _noOfSteps;
+		return false;
+	}
+	string checkpoint((istreambuf_iterator<char>(ifs)), istreambuf_iterator<char>());
+	return restoreCheckpoint(checkpoint);
+}
+
+//-----------------------------------------------------------------------------
+
+namespace
+{
+	//! 64bit FNV-1a hash over the spin-up inputs
+	struct SpinUpKeyHasher
+	{
+		void add(const void* p, size_t n)
+		{
+			auto bs = static_cast<const unsigned char*>(p);
+			for(size_t i = 0; i < n; i++)
+				hash = (hash ^ bs[i]) * 1099511628211ULL;
+		}
+
+		void add(const string& s)
+		{
+			uint64_t size = s.size();
+			add(&size, sizeof(size));
+			add(s.data(), s.size());
+		}
+
+		string key() const
+		{
+			ostringstream oss;
+			oss << hex << setw(16) << setfill('0') << hash;
+			return oss.str();
+		}
+
+		uint64_t hash{14695981039346656037ULL};
+	};
+
+	//! everything the state at the end of the spin-up depends on
+	string spinUpCacheKey(const Env& env)
+	{
+		SpinUpKeyHasher h;
+		uint32_t version = MonicaRun::checkpointVersion;
+		h.add(&version, sizeof(version));
+		//states of other MONICA versions come from different model code
+		h.add(string(VER_FILE_VERSION_STR));
+
+		//the end of the simulation isn't relevant for the spin-up
+		auto params = env.params;
+		params.simulationParameters.startDate = Date();
+		params.simulationParameters.endDate = Date();
+		h.add(params.to_json().dump());
+
+		auto start = env.climateData.startDate();
+		h.add(start.toIsoDateString());
+		h.add(env.spinUpUntil.toIsoDateString());
+		auto latitude = env.params.siteParameters.vs_Latitude;
+		size_t stepNo = 0;
+		for(Date d = start; !(env.spinUpUntil < d); ++d, ++stepNo)
+		{
+			for(auto p : env.climateData.allDataForStep(stepNo, latitude))
+			{
+				int acd = int(p.first);
+				h.add(&acd, sizeof(acd));
+				h.add(&p.second, sizeof(p.second));
+			}
+		}
+
+		//the collected results are part of the state
+		h.add(env.events.dump());
+		h.add(env.outputs.dump());
+
+		//just the crop rotations which might have been used within the spin-up period
+		for(const auto& cr : env.cropRotations)
+		{
+			if(cr.start.isValid() && env.spinUpUntil < cr.start)
+				break;
+			h.add(cr.start.toIsoDateString());
+			h.add(cr.end.isValid() && cr.end < env.spinUpUntil ? cr.end.toIsoDateString() : string());
+			for(const auto& cm : cr.cropRotation)
+			{
+				auto cmj = cm.to_json().object_items();
+				cmj.erase("worksteps");
+				h.add(Json(cmj).dump());
+
+				//the checkpoint restores the structure and dates of all worksteps of the touched crop rotations,
+				//but the settings of worksteps with absolute dates after the spin-up haven't been used yet,
+				//so management after the spin-up may differ
+				const auto& wss = cm.getWorksteps();
+				uint64_t noOfWorksteps = wss.size();
+				h.add(&noOfWorksteps, sizeof(noOfWorksteps));
+				for(const auto& ws : wss)
+				{
+					h.add(ws->type());
+					h.add(ws->date().toIsoDateString());
+					auto ed = ws->earliestDate();
+					bool afterSpinUp = ed.isValid() && ed.isAbsoluteDate() && env.spinUpUntil < ed;
+					h.add(afterSpinUp ? string() : ws->to_json().dump());
+				}
+			}
+		}
+
+		return h.key();
+	}
+
+	//! end states of spin-up runs, held in memory and optionally on disk
+	class SpinUpCache
+	{
+	public:
+		shared_ptr<const string> get(const string& key, const string& pathToCacheDir)
+		{
+			lock_guard<mutex> lock(_mutex);
+			auto it = _states.find(key);
+			if(it != _states.end())
+				return it->second;
+
+			if(pathToCacheDir.empty())
+				return shared_ptr<const string>();
+
+			ifstream ifs(pathToFile(key, pathToCacheDir), ios::binary);
+			if(ifs.fail())
+				return shared_ptr<const string>();
+			auto state = make_shared<const string>(istreambuf_iterator<char>(ifs), istreambuf_iterator<char>());
+			insert(key, state);
+			return state;
+		}
+
+		void put(const string& key, string state, const string& pathToCacheDir)
+		{
+			auto s = make_shared<const string>(move(state));
+			lock_guard<mutex> lock(_mutex);
+			insert(key, s);
+
+			if(pathToCacheDir.empty())
+				return;
+
+			string dir = fixSystemSeparator(pathToCacheDir);
+			if(!ensureDirExists(dir))
+			{
+				cerr << "Error couldn't create spin-up cache directory: '" << dir << "'." << endl;
+				return;
+			}
+			//write to a temporary file first, so other processes never see a partially written state
+			auto path = pathToFile(key, dir);
+			auto tmpPath = path + "." + to_string(hash<thread::id>()(this_thread::get_id())) + ".tmp";
+			ofstream ofs(tmpPath, ios::binary | ios::trunc);
+			ofs.write(s->data(), s->size());
+			ofs.close();
+			if(ofs.fail() || rename(tmpPath.c_str(), path.c_str()) != 0)
+			{
+				cerr << "Error couldn't write spin-up state to: '" << path << "'." << endl;
+				remove(tmpPath.c_str());
+			}
+		}
+
+	private:
+		static string pathToFile(const string& key, const string& pathToCacheDir)
+		{
+			return fixSystemSeparator(pathToCacheDir + "/spin-up-" + key + ".bin");
+		}
+
+		void insert(const string& key, shared_ptr<const string> state)
+		{
+			if(_states.find(key) == _states.end())
+			{
+				_insertionOrder.push_back(key);
+				if(_insertionOrder.size() > maxNoOfStates)
+				{
+					_states.erase(_insertionOrder.front());
+					_insertionOrder.pop_front();
+				}
+			}
+			_states[key] = state;
+		}
+
+		static const size_t maxNoOfStates = 32;
+		mutex _mutex;
+		map<string, shared_ptr<const string>> _states;
+		list<string> _insertionOrder;
+	};
+
+	SpinUpCache& spinUpCache()
+	{
+		static SpinUpCache cache;
+		return cache;
+	}
+}
+
+namespace
+{
+	unique_ptr<MonicaRun> startRun(Env env)
+	{
+		unique_ptr<MonicaRun> run(new MonicaRun(env));
+
+		//start from the cached end state of the spin-up if another run had the same spin-up
+		Date spinUpUntil = run->env().spinUpUntil;
+		if(spinUpUntil.isValid() 
+			 && run->env().startFromCheckpoint.empty()
+			 && !(spinUpUntil < env.climateData.startDate())
+			 && spinUpUntil < env.climateData.endDate())
+		{
+			auto key = spinUpCacheKey(run->env());
+			auto pathToCache = env.pathToSpinUpCache;
+			auto state = spinUpCache().get(key, pathToCache);
+			if(!state || !run->restoreCheckpoint(*state))
+			{
+				//a cached state which couldn't be restored leaves the run unusable
+				if(state)
+					run.reset(new MonicaRun(env));
+				run->runUntil(spinUpUntil + 1);
+				spinUpCache().put(key, run->saveCheckpoint(), pathToCache);
+			}
+		}
+
+		return run;
+	}
+}
+
+Output Monica::runMonica(Env env)
+{
+	auto run = startRun(env);
+	run->runToEnd();
+	return run->finish();
+}
+
+Output Monica::runMonicaStreaming(Env env,
+																	function<void(Output&)> onResults,
+																	size_t noOfStepsPerBlock)
+{
+	auto run = startRun(env);
+	noOfStepsPerBlock = max(size_t(1), noOfStepsPerBlock);
+
+	while(run->hasNextStep())
+	{
+		for(size_t i = 0; i < noOfStepsPerBlock && run->hasNextStep(); i++)
+			run->step();
+
+		if(run->hasNextStep())
+		{
+			auto out = run->takeResults();
+			bool hasResults = false;
+			for(const auto& d : out.data)
+			{
+				for(const auto& column : d.results)
+					hasResults = hasResults || !column.empty();
+				hasResults = hasResults || !d.resultsObj.empty();
+			}
+			if(hasResults)
+				onResults(out);
+		}
+	}
+
+	return run->finish();
+}
@@ -20,11 +20,16 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 
 #include <ostream>
 #include <vector>
+#include <map>
+#include <memory>
+#include <cstdint>
+#include <functional>
 
 #include "json11/json11.hpp"
 
 #include "common/dll-exports.h"
 #include "../core/monica-model.h"
+#include "../core/memory-accounting.h"
 #include "cultivation-method.h"
 #include "climate/climate-common.h"
 #include "../io/output.h"
@@ -117,6 +122,28 @@ namespace Monica
     //std::string outputDatastreamPort;
 
 		bool debugMode{false};
+
+		std::vector<Tools::Date> checkpointDates;
+		// write a checkpoint of the run after these dates have been simulated
+
+		std::string pathToCheckpoints;
+		// directory the checkpoints are written to
+
+		std::string startFromCheckpoint;
+		// path to a checkpoint file to continue the run from
+
+		Tools::Date spinUpUntil;
+		// the run until (including) this date is spin-up, its end state will be cached and reused by runs with the same spin-up inputs
+		// (worksteps with absolute dates after the spin-up may have different settings, but not different dates)
+
+		std::string pathToSpinUpCache;
+		// optional directory to cache the spin-up states also on disk
+
+		bool profile{false};
+		// time the model's modules and the run's management and output machinery, the profile is returned in Output::profile
+
+		bool memoryStats{false};
+		// account the allocations and the memory held by the run's results, climate history and AOM pools, returned in Output::memoryStats
   };
 
   //------------------------------------------------------------------------------------------
@@ -147,7 +174,30 @@ namespace Monica
 	{
 		void aggregateResults();
 		void aggregateResultsObj();
-		void storeResultsIfSpecApplies(const MonicaModel& monica, bool storeObjOutputs = false);
+		void storeResultsIfSpecApplies(const MonicaModel& monica, bool storeObjOutputs = false, RunProfile* profile = nullptr);
+
+		//! the spec and output ids are configuration, only the collected results are state
+		template<class Archive>
+		void serialize(Archive& ar)
+		{
+			serializeMaybe(ar, withinEventStartEndRange);
+			serializeMaybe(ar, withinEventFromToRange);
+			ar(intermediateResults, results, resultsObj);
+		}
+
+		template<class Archive>
+		static void serializeMaybe(Archive& ar, Tools::Maybe<bool>& m)
+		{
+			bool isNothing = m.isNothing(), value = isNothing ? false : m.value();
+			ar(isNothing, value);
+			if(Archive::isReading)
+			{
+				if(isNothing)
+					m = Tools::Maybe<bool>();
+				else
+					m = value;
+			}
+		}
 
 		Tools::Maybe<bool> withinEventStartEndRange;
 		Tools::Maybe<bool> withinEventFromToRange;
@@ -160,6 +210,126 @@ namespace Monica
 
 	//----------------------------------------------------------------------------
 
+	//! a MONICA run which can be advanced day by day and be forked at any day,
+	//! e.g. to simulate alternative management strategies from a decision date onwards
+	//! without simulating the common period before that date again
+	class DLL_API MonicaRun
+	{
+	public:
+		MonicaRun(Env env);
+
+		//! fork other at its current day, the copy owns its model, crop rotation state and results
+		MonicaRun(const MonicaRun& other);
+
+		MonicaRun& operator=(const MonicaRun&) = delete;
+
+		bool hasNextStep() const { return _stepNo < _noOfSteps; }
+
+		//! the date which will be simulated by the next call to step()
+		Tools::Date currentDate() const { return _currentDate; }
+
+		//! simulate a single day
+		void step();
+
+		//! simulate all days before date, so currentDate() == date afterwards (if within the climate data)
+		void runUntil(Tools::Date date);
+
+		void runToEnd();
+
+		//! aggregate the pending results and return the output of the run
+		Output finish();
+
+		//! return the results finished so far and remove them from the run,
+		//! so that finish() returns just the results collected afterwards
+		Output takeResults();
+
+		//! add a workstep which will be applied at its absolute date in addition to the crop rotation,
+		//! e.g. to let a fork follow an alternative fertilisation or irrigation strategy
+		void addWorkstep(WSPtr ws) { _additionalWorksteps.push_back(ws); }
+
+		const MonicaModel& model() const { return *_monica; }
+		MonicaModel& modelNC() { return *_monica; }
+
+		const Env& env() const { return _env; }
+
+		//! the allocations of the run (counted on the thread running it, if the counting allocator is linked in),
+		//! the estimated bytes held by its results, climate data history and AOM pools and
+		//! the peak RSS of the whole process (processPeakRSSKiB), which isn't reset per run, so in a server it covers all jobs so far
+		json11::Json memoryStats() const;
+
+		//! version of the binary checkpoint format, checkpoints of other versions will be rejected
+		static const std::uint32_t checkpointVersion = 2;
+
+		//! the complete state of the run (model, crop rotation progress, collected results) in binary form,
+		//! worksteps added via addWorkstep are not part of the checkpoint
+		std::string saveCheckpoint() const;
+		bool saveCheckpointToFile(const std::string& pathToFile);
+
+		//! continue the run from a checkpoint created by a run of the same setup,
+		//! if the checkpoint comes from a run with a different start date (e.g. a spin-up run)
+		//! only the soil state will be taken as initial state of this run
+		bool restoreCheckpoint(const std::string& checkpoint);
+		bool restoreCheckpointFromFile(const std::string& pathToFile);
+
+		//! errors which occurred while writing or restoring checkpoints
+		const std::vector<std::string>& errors() const { return _errors; }
+
+	private:
+		void registerDailyFunctions();
+
+		template<class Archive>
+		void serializeRunState(Archive& ar);
+
+		void serializeModel(StateWriter& sw, CropPtr) { _monica->saveState(sw); }
+		void serializeModel(StateReader& sr, CropPtr currentCrop) { _monica->restoreState(sr, currentCrop); }
+
+		void addError(const std::string& error);
+
+		//! the debug stream of this run, discarding everything if the run's env isn't in debug mode
+		std::ostream& debug() const;
+
+		//! end the trace span of the simulated year if a new year starts (or the run ends) and start the next one
+		void traceYear(bool endOfRun = false);
+
+		bool checkAndInitShadowOfNextCropRotation(Tools::Date currentDate);
+
+		std::pair<CultivationMethod*, Tools::Date> findNextCultivationMethod(Tools::Date currentDate,
+																																				 bool advanceToNextCM = true);
+
+		Env _env;
+		std::unique_ptr<MonicaModel> _monica;
+		bool _returnObjOutputs{false};
+		bool _debugMode{false};
+		std::size_t _stepNo{0};
+		std::size_t _noOfSteps{0};
+		Tools::Date _currentDate;
+
+		//! index of the current crop rotation in _env.cropRotations
+		std::size_t _crIndex{0};
+
+		//! shadow of the current crop rotation, holding pointers to the CMs in _env.cropRotations,
+		//! but might shrink if pure absolute CMs are finished
+		std::vector<CultivationMethod*> _cropRotation;
+		std::size_t _cmIndex{0};
+
+		//! direct handle to current cultivation method
+		CultivationMethod* _currentCM{nullptr};
+		Tools::Date _nextAbsoluteCMApplicationDate;
+
+		std::map<int, std::vector<double>> _dailyValues;
+		std::vector<std::function<void()>> _applyDailyFuncs;
+		std::vector<StoreData> _store;
+		std::vector<WSPtr> _additionalWorksteps;
+		std::vector<std::string> _errors;
+		std::unique_ptr<RunProfile> _profile;
+		MemoryAccounting::AllocationCount _allocationsAtStart;
+		std::size_t _stepNoAtStart{0};
+		int _tracedYear{0};
+		std::int64_t _tracedYearStartUs{0};
+	};
+
+	//----------------------------------------------------------------------------
+
 	//! can be called initially to set alternative path for the MONICA dll/so to db-connections.ini
 	DLL_API void initPathToDB(const std::string& initialPathToIniFile = "db-connections.ini");
 
@@ -170,6 +340,13 @@ namespace Monica
 	//! @param env the environment completely defining what the model needs and gets
 	//! @return a structure with all the Monica results
   DLL_API Output runMonica(Env env);
+
+	//! run env and hand the results finished so far to onResults every noOfStepsPerBlock days,
+	//! so the results of the whole run are never held in memory
+	//! @return the results of the last block together with the errors and warnings of the run
+	DLL_API Output runMonicaStreaming(Env env,
+																		std::function<void(Output&)> onResults,
+																		std::size_t noOfStepsPerBlock = 365);
 }
 
 #endif
@@ -0,0 +1,328 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+Authors:
+Michael Berg <michael.berg@zalf.de>
+
+Maintainers:
+Currently maintained by the authors.
+
+This file is part of the MONICA model.
+Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+
+#include "scenario-setup.h"
+#include "tools/helper.h"
+#include "tools/algorithms.h"
+#include "env-json-from-json-config.h"
+#include "climate/climate-file-io.h"
+
+using namespace Monica;
+using namespace Tools;
+using namespace json11;
+using namespace std;
+
+namespace
+{
+	bool isLeapYear(int y) { return (y % 4 == 0 && y % 100 != 0) || y % 400 == 0; }
+
+	int daysInMonth(int y, int m)
+	{
+		static const int dim[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+		return m == 2 && isLeapYear(y) ? 29 : dim[m - 1];
+	}
+
+	struct Ymd { int y{0}, m{0}, d{0}; };
+
+	//! parse the DE (dd.mm.yyyy) or ISO (yyyy-mm-dd) dates of the climate files
+	Ymd parseDate(const string& s, bool deDate)
+	{
+		Ymd r;
+		if(deDate && sscanf(s.c_str(), "%d.%d.%d", &r.d, &r.m, &r.y) == 3)
+			return r;
+		if(!deDate && sscanf(s.c_str(), "%d-%d-%d", &r.y, &r.m, &r.d) == 3)
+			return r;
+		return Ymd();
+	}
+
+	string formatDate(const Ymd& ymd, bool deDate)
+	{
+		char buf[16];
+		if(deDate)
+			snprintf(buf, sizeof(buf), "%02d.%02d.%04d", ymd.d, ymd.m, ymd.y);
+		else
+			snprintf(buf, sizeof(buf), "%04d-%02d-%02d", ymd.y, ymd.m, ymd.d);
+		return buf;
+	}
+
+	//! the lines of a climate CSV split into columns
+	struct ClimateCSV
+	{
+		string sep;
+		vector<string> headerLines;
+		vector<string> names; //!< lower case climate element names of the columns
+		int dateCol{-1};
+		bool deDate{true};
+		vector<pair<Ymd, vector<string>>> rows;
+
+		string toString() const
+		{
+			ostringstream oss;
+			for(const auto& hl : headerLines)
+				oss << hl << "\n";
+			for(const auto& r : rows)
+			{
+				for(size_t i = 0; i < r.second.size(); i++)
+					oss << (i > 0 ? sep : "") << r.second[i];
+				oss << "\n";
+			}
+			return oss.str();
+		}
+	};
+
+	EResult<ClimateCSV> readClimateCSV(const ScenarioSetup& setup)
+	{
+		ClimateCSV csv;
+		string text = setup.climateCSV;
+		if(text.empty())
+		{
+			auto rf = readFile(setup.pathToClimateCSV);
+			if(rf.failure())
+				return {csv, rf.errors};
+			text = rf.result;
+		}
+
+		const auto& csvOptions = setup.sim["climate.csv-options"];
+		csv.sep = csvOptions["csv-separator"].string_value();
+		if(csv.sep.empty())
+			csv.sep = ",";
+		int noOfHeaderLines = max(1, csvOptions["no-of-climate-file-header-lines"].int_value());
+
+		istringstream iss(text);
+		string line;
+		for(int i = 0; i < noOfHeaderLines && getline(iss, line); i++)
+			csv.headerLines.push_back(trim(line, "\r"));
+		if(csv.headerLines.empty())
+			return {csv, string("Empty climate file: ") + setup.pathToClimateCSV};
+
+		//map the headers to the climate element names, the date column is either de-date or iso-date
+		const auto& h2acd = csvOptions["header-to-acd-names"];
+		for(auto name : splitString(csv.headerLines.front(), csv.sep))
+		{
+			if(h2acd[name].is_string())
+				name = h2acd[name].string_value();
+			else if(h2acd[name].is_array())
+				name = h2acd[name][0].string_value();
+			name = toLower(name);
+			if(csv.dateCol < 0 && (name == "de-date" || name == "iso-date"))
+				csv.dateCol = int(csv.names.size()), csv.deDate = name == "de-date";
+			csv.names.push_back(name);
+		}
+		if(csv.dateCol < 0)
+			return {csv, string("No de-date or iso-date column in climate file: ") + setup.pathToClimateCSV};
+
+		while(getline(iss, line))
+		{
+			auto cols = splitString(trim(line, "\r"), csv.sep);
+			if(int(cols.size()) <= csv.dateCol)
+				continue;
+			auto ymd = parseDate(cols[csv.dateCol], csv.deDate);
+			if(ymd.y > 0)
+				csv.rows.push_back(make_pair(ymd, cols));
+		}
+		return {csv};
+	}
+}
+
+EResult<ScenarioSetup> Monica::readScenarioSetup(const string& pathToSimJson)
+{
+	ScenarioSetup setup;
+
+	string pathOfSimJson, simFileName;
+	tie(pathOfSimJson, simFileName) = splitPathToFile(pathToSimJson);
+	auto makeAbsolute = [&](const string& path) { return isAbsolutePath(path) ? path : pathOfSimJson + path; };
+
+	auto sim = readAndParseJsonFile(pathToSimJson);
+	if(sim.failure())
+		return {setup, sim.errors};
+	setup.sim = sim.result;
+
+	auto crop = readAndParseJsonFile(makeAbsolute(setup.sim["crop.json"].string_value()));
+	auto site = readAndParseJsonFile(makeAbsolute(setup.sim["site.json"].string_value()));
+	if(crop.failure() || site.failure())
+	{
+		Errors es;
+		es.append(crop);
+		es.append(site);
+		return {setup, es.errors};
+	}
+	setup.crop = crop.result;
+	setup.site = site.result;
+
+	setup.pathToClimateCSV = makeAbsolute(setup.sim["climate.csv"].string_value());
+	setup.sim = withValue(setup.sim, "climate.csv", setup.pathToClimateCSV);
+	return {setup};
+}
+
+EResult<Env> Monica::createScenarioEnv(const ScenarioSetup& setup)
+{
+	Env env;
+	auto sim = setup.climateCSV.empty() ? setup.sim : withValue(setup.sim, "climate.csv", "");
+	auto envj = createEnvJsonFromJsonObjects({{"crop", setup.crop}, {"site", setup.site}, {"sim", sim}});
+	if(envj.is_null())
+		return {env, string("Couldn't create env from setup: ") + setup.sim.dump()};
+	auto es = env.merge(envj);
+	if(es.failure())
+		return {env, es.errors};
+
+	if(!setup.climateCSV.empty())
+	{
+		auto eda = readClimateDataFromCSVStringViaHeaders(setup.climateCSV, env.csvViaHeaderOptions);
+		if(eda.failure())
+			return {env, eda.errors};
+		env.climateData = eda.result;
+	}
+
+	return {env};
+}
+
+Json Monica::withValue(const Json& j, const string& key, const Json& value)
+{
+	auto m = j.object_items();
+	m[key] = value;
+	return m;
+}
+
+Json Monica::withoutKey(const Json& j, const string& key)
+{
+	auto m = j.object_items();
+	m.erase(key);
+	return m;
+}
+
+Errors Monica::tileClimate(ScenarioSetup& setup, int noOfYears)
+{
+	auto ecsv = readClimateCSV(setup);
+	if(ecsv.failure())
+		return ecsv;
+	auto& csv = ecsv.result;
+
+	auto csvOptions = setup.sim["climate.csv-options"];
+	auto sd = parseDate(csvOptions["start-date"].string_value(), false);
+	auto ed = parseDate(csvOptions["end-date"].string_value(), false);
+
+	//the data lines of all days, keyed by date and year
+	map<int, map<pair<int, int>, vector<string>>> year2md2line;
+	for(const auto& r : csv.rows)
+	{
+		const auto& ymd = r.first;
+		if((sd.y > 0 && ymd.y < sd.y) || (ed.y > 0 && ymd.y > ed.y))
+			continue;
+		year2md2line[ymd.y][make_pair(ymd.m, ymd.d)] = r.second;
+	}
+
+	//use full years only
+	vector<int> years;
+	for(const auto& p : year2md2line)
+		if(p.second.size() >= 365)
+			years.push_back(p.first);
+	if(years.empty())
+		return Errors(Errors::ERR, string("No full year of data in climate file: ") + setup.pathToClimateCSV);
+
+	csv.rows.clear();
+	int firstYear = years.front();
+	for(int y = firstYear; y < firstYear + noOfYears; y++)
+	{
+		const auto& md2line = year2md2line[years[(y - firstYear) % years.size()]];
+		for(int m = 1; m <= 12; m++)
+		{
+			for(int d = 1; d <= daysInMonth(y, m); d++)
+			{
+				auto it = md2line.find(make_pair(m, d));
+				if(it == md2line.end())
+					it = md2line.find(make_pair(m, d - 1));
+				if(it == md2line.end())
+					continue;
+				Ymd ymd{y, m, d};
+				auto cols = it->second;
+				cols[csv.dateCol] = formatDate(ymd, csv.deDate);
+				csv.rows.push_back(make_pair(ymd, cols));
+			}
+		}
+	}
+	setup.climateCSV = csv.toString();
+
+	auto os = csvOptions.object_items();
+	os["start-date"] = formatDate({firstYear, 1, 1}, false);
+	os["end-date"] = formatDate({firstYear + noOfYears - 1, 12, 31}, false);
+	setup.sim = withValue(setup.sim, "climate.csv-options", os);
+	return Errors();
+}
+
+Errors Monica::modifyClimate(ScenarioSetup& setup, function<void(int month, map<string, double>& values)> modify)
+{
+	auto ecsv = readClimateCSV(setup);
+	if(ecsv.failure())
+		return ecsv;
+	auto& csv = ecsv.result;
+
+	for(auto& r : csv.rows)
+	{
+		auto& cols = r.second;
+		map<string, double> values;
+		for(size_t i = 0; i < cols.size() && i < csv.names.size(); i++)
+		{
+			char* end = nullptr;
+			double v = strtod(cols[i].c_str(), &end);
+			if(int(i) != csv.dateCol && !cols[i].empty() && end && *end == '\0')
+				values[csv.names[i]] = v;
+		}
+
+		auto orig = values;
+		modify(r.first.m, values);
+
+		for(size_t i = 0; i < cols.size() && i < csv.names.size(); i++)
+		{
+			auto it = values.find(csv.names[i]);
+			if(it != values.end() && it->second != orig[csv.names[i]])
+			{
+				ostringstream oss;
+				oss << it->second;
+				cols[i] = oss.str();
+			}
+		}
+	}
+	setup.climateCSV = csv.toString();
+	return Errors();
+}
+
+Json Monica::heavyOrganicFertilizationRotation()
+{
+	auto organicFertilization = [](string date)
+	{
+		return J11Object
+		{{"date", date}
+		,{"type", "OrganicFertilization"}
+		,{"amount", J11Array{10000, "kg"}}
+		,{"parameters", J11Array{"ref", "fert-params", "CADLM"}}
+		,{"incorporation", true}
+		};
+	};
+
+	J11Array wss
+	{J11Object{{"date", "0000-09-23"}, {"type", "Sowing"}, {"crop", J11Array{"ref", "crops", "WW"}}}};
+	for(auto date : {"0000-10-05", "0000-11-05", "0001-03-05", "0001-04-05", "0001-05-05", "0001-06-05"})
+		wss.push_back(organicFertilization(date));
+	wss.push_back(J11Object{{"date", "0001-07-27"}, {"type", "Harvest"}});
+	for(auto date : {"0001-08-05", "0001-08-20", "0001-09-05"})
+		wss.push_back(organicFertilization(date));
+	return J11Array{J11Object{{"worksteps", wss}}};
+}
@@ -0,0 +1,69 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+Authors:
+Michael Berg <michael.berg@zalf.de>
+
+Maintainers:
+Currently maintained by the authors.
+
+This file is part of the MONICA model.
+Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
+*/
+
+#ifndef MONICA_SCENARIO_SETUP_H_
+#define MONICA_SCENARIO_SETUP_H_
+
+#include <string>
+#include <map>
+#include <functional>
+
+#include "json11/json11.hpp"
+#include "json11/json11-helper.h"
+#include "run-monica.h"
+
+namespace Monica
+{
+	/*!
+	 * The parsed JSON files (sim.json, crop.json, site.json) of a simulation setup,
+	 * copies of it are modified by the scenarios of monica-bench and monica-regression before creating their Env.
+	 */
+	struct ScenarioSetup
+	{
+		json11::Json sim, crop, site;
+		std::string pathToClimateCSV;
+		std::string climateCSV; //!< the climate data as CSV text, used instead of pathToClimateCSV if not empty
+	};
+
+	//! read the sim.json and the crop.json, site.json and climate.csv it references (relative paths are relative to sim.json)
+	Tools::EResult<ScenarioSetup> readScenarioSetup(const std::string& pathToSimJson);
+
+	Tools::EResult<Env> createScenarioEnv(const ScenarioSetup& setup);
+
+	//! a copy of the JSON object j with key set to value
+	json11::Json withValue(const json11::Json& j, const std::string& key, const json11::Json& value);
+
+	//! a copy of the JSON object j without key
+	json11::Json withoutKey(const json11::Json& j, const std::string& key);
+
+	/*!
+	 * Tile the setup's climate data to noOfYears years starting at its first year
+	 * by repeating its full years (within the start and end date of the csv options), day by day.
+	 * Missing leap days are taken from the 28th of February. Sets the start and end date of the csv options.
+	 */
+	Tools::Errors tileClimate(ScenarioSetup& setup, int noOfYears);
+
+	/*!
+	 * Change the setup's climate data day by day. The values of a day are keyed by the lower case climate element names
+	 * (the csv headers after applying 'header-to-acd-names', e.g. "tmin"), changed values are written back.
+	 */
+	Tools::Errors modifyClimate(ScenarioSetup& setup,
+															std::function<void(int month, std::map<std::string, double>& values)> modify);
+
+	//! a rotation of winter wheat (crops.WW) with nine heavy organic fertilizations (fert-params.CADLM) per cycle
+	json11::Json heavyOrganicFertilizationRotation();
+}
+
+#endif //MONICA_SCENARIO_SETUP_H_
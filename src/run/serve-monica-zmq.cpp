@@ -22,6 +22,15 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 #include <chrono>
 #include <thread>
 #include <tuple>
+#include <deque>
+#include <atomic>
+#include <condition_variable>
+
+#ifdef WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
 
 #include "zeromq/zmq.hpp"
 #include "zeromq/zhelpers.hpp"
@@ -34,6 +43,12 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 #include "run-monica.h"
 #include "../io/output.h"
 #include "climate/climate-file-io.h"
+#include "../io/binary-json.h"
+#include "env-template-cache.h"
+#include "env-config-cache.h"
+#include "result-cache.h"
+#include "metrics.h"
+#include "trace.h"
 
 using namespace std;
 using namespace Monica;
@@ -386,10 +401,184 @@ void Monica::ZmqServer::startZeroMQMonica(zmq::context_t* zmqContext,
 
 //-----------------------------------------------------------------------------
 
+namespace
+{
+	const string phaseSeconds = "monica_job_phase_seconds";
+
+	//! sent with the ack of a "finish" message, so a supervisor knows which of its processes is stopping
+	int processId()
+	{
+#ifdef WIN32
+		return _getpid();
+#else
+		return int(getpid());
+#endif
+	}
+
+	//! receive a job message, which can be JSON text or binary encoded (see binary-json.h)
+	Msg receiveJobMsg(zmq::socket_t& socket)
+	{
+		Msg msg;
+		TraceSpan receiveSpan("receive");
+		MetricsTimer receiveTimer(phaseSeconds, label("phase", "receive"));
+		string raw = s_recv(socket);
+		receiveTimer.stop();
+		receiveSpan.arg("bytes", double(raw.size()));
+		receiveSpan.end();
+		TraceSpan parseSpan("parse");
+		MetricsTimer parseTimer(phaseSeconds, label("phase", "parse"));
+		auto r = parseJsonOrBinaryJson(raw);
+		for(auto e : r.errors)
+			cerr << e << endl;
+		parseSpan.arg("type", r.result["type"]);
+		parseSpan.arg("customId", r.result["customId"]);
+		msg.json = r.result;
+		msg.msg = isBinaryJson(raw) ? string("binary message of type: ") + r.result["type"].string_value() : raw;
+		return msg;
+	}
+
+	//! the kinds of jobs: a complete Env, a delta against a registered template or sim/crop/site.json (see EnvConfigCache)
+	enum JobKind { FullEnv, Delta, FromConfig };
+
+	//! the errors of creating a job's Env and the template or config it referred to, if the server didn't know it
+	struct JobErrors : public Errors
+	{
+		string unknownTemplateId;
+		string unknownConfigId;
+	};
+
+	//! the Env of an "Env" job, of a delta job against a registered template
+	//! or of sim/crop/site.json configurations, errors go to es
+	Env createJobEnv(EnvTemplateCache& templates, 
+									 EnvConfigCache& configs,
+									 const Json& job, 
+									 const string& templateId, 
+									 JobKind kind, 
+									 JobErrors& es)
+	{
+		TraceSpan span("create-env");
+		span.arg("customId", job["customId"]);
+		MetricsTimer timer(phaseSeconds, label("phase", "create-env"));
+		Env env;
+		if(kind == FromConfig)
+		{
+			auto ej = configs.createEnvJson(job);
+			if(ej.success())
+				env.merge(ej.result);
+			else
+			{
+				env.customId = job["customId"];
+				es.errors.insert(es.errors.end(), ej.errors.begin(), ej.errors.end());
+				auto id = EnvConfigCache::configId(job);
+				if(!id.empty() && !configs.hasConfig(id))
+					es.unknownConfigId = id;
+			}
+		}
+		else if(kind == Delta)
+		{
+			auto ee = templates.createEnv(templateId, job);
+			env = ee.result;
+			if(ee.failure())
+			{
+				//make the failed job identifiable for the client
+				env.customId = job["customId"];
+				es.errors.insert(es.errors.end(), ee.errors.begin(), ee.errors.end());
+				if(!templates.hasTemplate(templateId))
+					es.unknownTemplateId = templateId;
+			}
+		}
+		else
+			env.merge(job);
+		return env;
+	}
+
+	//! run env like a single job, the climate data are being read if not part of the env
+	//! if onResults is set, the results are streamed to it every noOfStepsPerBlock days,
+	//! else a resultCache, if given, will answer runs of envs which have been run before
+	Monica::Output runJobEnv(Env env, 
+													 const JobErrors& es, 
+													 bool startedServerInDebugMode,
+													 ResultCache* resultCache = nullptr,
+													 function<void(Monica::Output&)> onResults = function<void(Monica::Output&)>(),
+													 size_t noOfStepsPerBlock = 365)
+	{
+		auto start = chrono::steady_clock::now();
+
+		EResult<DataAccessor> eda;
+		eda.errors = es.errors;
+		TraceSpan climateSpan("climate-load");
+		climateSpan.arg("customId", env.customId);
+		MetricsTimer climateTimer(phaseSeconds, label("phase", "climate-load"));
+		if (eda.success() && !env.climateData.isValid()) {
+			if (!env.climateCSV.empty())
+				eda = readClimateDataFromCSVStringViaHeaders(env.climateCSV, env.csvViaHeaderOptions);
+			else if (!env.pathsToClimateCSV.empty())
+				eda = readClimateDataFromCSVFilesViaHeaders(env.pathsToClimateCSV, env.csvViaHeaderOptions);
+		}
+
+		climateTimer.stop();
+		climateSpan.end();
+
+		Monica::Output out;
+		if (eda.success()) {
+			//keep climate data sent with the env (or template)
+			if (eda.result.isValid())
+				env.climateData = eda.result;
+
+			env.debugMode = startedServerInDebugMode && env.debugMode;
+
+			env.params.userSoilMoistureParameters.getCapillaryRiseRate =
+				[](string soilTexture, int distance) {
+				return Soil::readCapillaryRiseRates().getRate(soilTexture, distance);
+			};
+
+			TraceSpan simulateSpan("simulate");
+			simulateSpan.arg("customId", env.customId);
+			MetricsTimer simulateTimer(phaseSeconds, label("phase", "simulate"));
+			if(onResults)
+				out = runMonicaStreaming(env, onResults, noOfStepsPerBlock);
+			else
+				out = resultCache ? resultCache->runMonica(env) : runMonica(env);
+		}
+		else
+			out.customId = env.customId;
+
+		//keep the errors and warnings of the run itself
+		out.errors.insert(out.errors.end(), eda.errors.begin(), eda.errors.end());
+		out.warnings.insert(out.warnings.end(), eda.warnings.begin(), eda.warnings.end());
+		out.unknownTemplateId = es.unknownTemplateId;
+		out.unknownConfigId = es.unknownConfigId;
+
+		//count the job only now, a run failing inside runMonica has to count as failed
+		bool failed = !out.errors.empty();
+		metrics().inc(failed ? "monica_jobs_failed_total" : "monica_jobs_completed_total");
+		metrics().inc("monica_busy_seconds_total", chrono::duration<double>(chrono::steady_clock::now() - start).count());
+		return out;
+	}
+
+	//! the reply message for out, binary encoded as "Output.bin" message if requested
+	string outputMsg(const Monica::Output& out, bool binary, string type = "Output")
+	{
+		TraceSpan span("serialize");
+		span.arg("customId", out.customId);
+		MetricsTimer timer(phaseSeconds, label("phase", "serialize"));
+		auto outj = out.to_json().object_items();
+		outj["type"] = binary ? type + ".bin" : type;
+		auto msg = binary ? encodeBinaryJson(outj) : Json(outj).dump();
+		metrics().observe("monica_result_bytes", double(msg.size()));
+		return msg;
+	}
+}
+
 void Monica::ZmqServer::serveZmqMonicaFull(zmq::context_t* zmqContext,
-																					 map<SocketRole, SocketConfig> socketAddresses)
+																					 map<SocketRole, SocketConfig> socketAddresses,
+																					 int noOfBatchThreads,
+																					 shared_ptr<ResultCache> resultCache,
+																					 function<void(size_t)> onJobsDone)
 {
 	bool startedServerInDebugMode = activateDebug;
+	size_t noOfJobsDone = 0;
+	describeJobMetrics();
 
 	if(socketAddresses.empty())
 	{
@@ -441,6 +630,11 @@ void Monica::ZmqServer::serveZmqMonicaFull(zmq::context_t* zmqContext,
 		zmq::socket_t controlSocket(*zmqContext, controlSocketType);
 		bool distinctControlSocket = cAddresses != rAddresses;
 
+		//base envs registered by clients, jobs can then be sent as deltas against them
+		EnvTemplateCache envTemplates;
+		//sim/crop/site.json configurations registered by clients, resolved once and then used by many jobs
+		EnvConfigCache envConfigs;
+
 		zmq::pollitem_t items[] =
 		{{(void*)socket, 0, ZMQ_POLLIN, 0}
 		,{(void*)controlSocket, 0, ZMQ_POLLIN, 0}
@@ -472,7 +666,7 @@ void Monica::ZmqServer::serveZmqMonicaFull(zmq::context_t* zmqContext,
 						zmq::poll(&items[0], distinctControlSocket ? 2 : 1, -1);
 
 						if(items[0].revents & ZMQ_POLLIN)
-							msg = receiveMsg(socket);
+							msg = receiveJobMsg(socket);
 						if(distinctControlSocket
 							 && items[1].revents & ZMQ_POLLIN)
 							msg = receiveMsg(controlSocket, topicCharCount);
@@ -487,6 +681,7 @@ void Monica::ZmqServer::serveZmqMonicaFull(zmq::context_t* zmqContext,
 							{
 								J11Object resultMsg;
 								resultMsg["type"] = "ack";
+								resultMsg["pid"] = processId();
 								try
 								{
 									s_send(distinctSendSocket ? sendSocket : socket, Json(resultMsg).dump());
@@ -511,43 +706,158 @@ void Monica::ZmqServer::serveZmqMonicaFull(zmq::context_t* zmqContext,
 
 							break;
 						}
-						else if(msgType == "Env")
+						else if(baseMsgType(msgType) == "EnvTemplate")
 						{
-							Json& fullMsg = msg.json;
+							auto id = EnvTemplateCache::templateId(msg.json);
+							J11Object resultMsg;
+							resultMsg["type"] = "ack";
+							if(msg.json["env"].is_null())
+								envTemplates.removeTemplate(id);
+							else
+							{
+								auto es = envTemplates.registerTemplate(id, msg.json["env"]);
+								resultMsg["errors"] = toPrimJsonArray(es.errors);
+								resultMsg["warnings"] = toPrimJsonArray(es.warnings);
+							}
+							debug() << "MONICA: " << envTemplates.size() << " env templates registered" << endl;
 
-              Env env;
-              auto errors = env.merge(msg.json);
+							//only send reply when not in pipeline configuration
+							if(rconfig.type != Pull)
+							{
+								try
+								{
+									s_send(distinctSendSocket ? sendSocket : socket, Json(resultMsg).dump());
+								}
+								catch(zmq::error_t e)
+								{
+									cerr << "Exception on trying to reply to 'EnvTemplate' request with 'ack' message on zmq socket with address(es): ";
+									int i = 0;
+									for(auto address : sAddresses)
+										cerr << (i > 0 ? "," : "") << address, ++i;
+									cerr << "! Will continue to receive requests! Error: [" << e.what() << "]" << endl;
+								}
+							}
+						}
+						else if(baseMsgType(msgType) == "EnvConfig")
+						{
+							auto id = EnvConfigCache::configId(msg.json);
+							J11Object resultMsg;
+							resultMsg["type"] = "ack";
+							bool hasParts = false;
+							for(auto name : {"sim", "crop", "site"})
+								hasParts = hasParts || !msg.json[name].is_null();
+							if(!hasParts)
+								envConfigs.removeConfig(id);
+							else
+							{
+								auto es = envConfigs.registerConfig(id, msg.json);
+								resultMsg["errors"] = toPrimJsonArray(es.errors);
+								resultMsg["warnings"] = toPrimJsonArray(es.warnings);
+							}
+							debug() << "MONICA: " << envConfigs.size() << " env configs registered" << endl;
 
-              EResult<DataAccessor> eda;
-							if (!env.climateData.isValid()) {
-								if (!env.climateCSV.empty())
-									eda = readClimateDataFromCSVStringViaHeaders(env.climateCSV, env.csvViaHeaderOptions);
-								else if (!env.pathsToClimateCSV.empty())
-									eda = readClimateDataFromCSVFilesViaHeaders(env.pathsToClimateCSV, env.csvViaHeaderOptions);
+							//only send reply when not in pipeline configuration
+							if(rconfig.type != Pull)
+							{
+								try
+								{
+									s_send(distinctSendSocket ? sendSocket : socket, Json(resultMsg).dump());
+								}
+								catch(zmq::error_t e)
+								{
+									cerr << "Exception on trying to reply to 'EnvConfig' request with 'ack' message on zmq socket with address(es): ";
+									int i = 0;
+									for(auto address : sAddresses)
+										cerr << (i > 0 ? "," : "") << address, ++i;
+									cerr << "! Will continue to receive requests! Error: [" << e.what() << "]" << endl;
+								}
 							}
+						}
+						else if(msgType == "Stats")
+						{
+							J11Object resultMsg;
+							resultMsg["type"] = "Stats";
+							resultMsg["resultCache"] = resultCache ? resultCache->stats().to_json() : Json();
+							resultMsg["metrics"] = metrics().to_json();
 
-              Monica::Output out;
-              if (eda.success()) {
-                env.climateData = eda.result;
-                
-                env.debugMode = startedServerInDebugMode && env.debugMode;
+							//only send reply when not in pipeline configuration
+							if(rconfig.type != Pull)
+							{
+								try
+								{
+									s_send(distinctSendSocket ? sendSocket : socket, Json(resultMsg).dump());
+								}
+								catch(zmq::error_t e)
+								{
+									cerr << "Exception on trying to reply to 'Stats' request on zmq socket with address(es): ";
+									int i = 0;
+									for(auto address : sAddresses)
+										cerr << (i > 0 ? "," : "") << address, ++i;
+									cerr << "! Will continue to receive requests! Error: [" << e.what() << "]" << endl;
+								}
+							}
+						}
+						else if(baseMsgType(msgType) == "Env" 
+										|| baseMsgType(msgType) == "EnvDelta" 
+										|| baseMsgType(msgType) == "EnvFromConfig")
+						{
+							//clients sending "Env.bin" messages get the result as binary "Output.bin" message
+							bool binaryReply = isBinaryMsgType(msgType);
 
-                env.params.userSoilMoistureParameters.getCapillaryRiseRate =
-                  [](string soilTexture, int distance) {
-                  return Soil::readCapillaryRiseRates().getRate(soilTexture, distance);
-                };
+							Json& fullMsg = msg.json;
+							metrics().inc("monica_jobs_received_total");
+							metrics().inc("monica_jobs_in_progress");
+
+							JobErrors es;
+							bool isDelta = baseMsgType(msgType) == "EnvDelta";
+							auto kind = isDelta ? Delta : baseMsgType(msgType) == "EnvFromConfig" ? FromConfig : FullEnv;
+							//the job may carry its template or config, for servers which don't know it (yet)
+							if(kind == Delta)
+								es.append(envTemplates.registerIfUnknown(EnvTemplateCache::templateId(fullMsg), fullMsg));
+							else if(kind == FromConfig)
+								es.append(envConfigs.registerIfUnknown(EnvConfigCache::configId(fullMsg), fullMsg));
+							auto env = createJobEnv(envTemplates, envConfigs, isDelta ? fullMsg["delta"] : fullMsg,
+																			EnvTemplateCache::templateId(fullMsg), kind, es);
+
+							//"streamResults": true | number of days -> send the results in blocks while running,
+							//in a pipeline (PUSH/ROUTER send socket) every "OutputBlock" is an own message and the terminal
+							//"OutputEnd" carries the rest of the results and the errors and warnings,
+							//a reply socket can't stream (a multipart reply arrives only as a whole), so it gets a single "Output" reply
+							const auto& sr = fullMsg["streamResults"];
+							size_t noOfStepsPerBlock = rconfig.type != Pull ? 0
+								: sr.is_number() ? size_t(max(0, sr.int_value())) : sr.bool_value() ? 365 : 0;
+							auto& replySocket = distinctSendSocket ? sendSocket : socket;
+							auto sendBlock = [&](Monica::Output& block)
+							{
+								try
+								{
+									if(!env.sharedId.empty())
+										s_sendmore(replySocket, env.sharedId);
+									s_send(replySocket, outputMsg(block, binaryReply, "OutputBlock"));
+								}
+								catch(zmq::error_t e)
+								{
+									cerr << "Exception on trying to send result block on zmq socket with address: ";
+									int i = 0;
+									for(auto address : sAddresses)
+										cerr << (i > 0 ? "," : "") << address, ++i;
+									cerr << "! Will continue the run! Error: [" << e.what() << "]" << endl;
+								}
+							};
 
-                out = runMonica(env);
-              }
-              
-              out.errors = eda.errors;
-              out.warnings = eda.warnings;
+							auto out = noOfStepsPerBlock > 0 
+								? runJobEnv(env, es, startedServerInDebugMode, nullptr, sendBlock, noOfStepsPerBlock)
+								: runJobEnv(env, es, startedServerInDebugMode, resultCache.get());
 
 							try
 							{
 								if(!env.sharedId.empty())
-									s_sendmore(distinctSendSocket ? sendSocket : socket, env.sharedId);
-								s_send(distinctSendSocket ? sendSocket : socket, out.to_json().dump());
+									s_sendmore(replySocket, env.sharedId);
+								auto msg = outputMsg(out, binaryReply, noOfStepsPerBlock > 0 ? "OutputEnd" : "Output");
+								TraceSpan span("send");
+								span.arg("customId", out.customId);
+								MetricsTimer timer(phaseSeconds, label("phase", "send"));
+								s_send(replySocket, msg);
 							}
 							catch(zmq::error_t e)
 							{
@@ -557,6 +867,164 @@ void Monica::ZmqServer::serveZmqMonicaFull(zmq::context_t* zmqContext,
 									cerr << (i > 0 ? "," : "") << address, ++i;
 								cerr << "! Will continue to receive requests! Error: [" << e.what() << "]" << endl;
 							}
+							metrics().inc("monica_jobs_in_progress", -1);
+
+							if(onJobsDone)
+								onJobsDone(++noOfJobsDone);
+						}
+						else if(baseMsgType(msgType) == "EnvBatch")
+						{
+							//{"type": "EnvBatch", "customId": ..., "envs": [...]} or
+							//{"type": "EnvBatch", "customId": ..., "templateId": "...", "deltas": [...]} or
+							//{"type": "EnvBatch", "customId": ..., "configId": "...", "jobs": [...EnvFromConfig jobs...]}
+							bool binaryReply = isBinaryMsgType(msgType);
+
+							Json& fullMsg = msg.json;
+
+							bool isDelta = fullMsg["deltas"].is_array();
+							bool isFromConfig = fullMsg["jobs"].is_array();
+							auto kind = isDelta ? Delta : isFromConfig ? FromConfig : FullEnv;
+							auto templateId = EnvTemplateCache::templateId(fullMsg);
+							const auto& jobs = isDelta ? fullMsg["deltas"].array_items() 
+								: isFromConfig ? fullMsg["jobs"].array_items() 
+								: fullMsg["envs"].array_items();
+							size_t noOfJobs = jobs.size();
+							metrics().inc("monica_jobs_received_total", double(noOfJobs));
+							metrics().inc("monica_jobs_in_progress", double(noOfJobs));
+
+							vector<Env> envs;
+							vector<JobErrors> ess(noOfJobs);
+							auto batchConfigId = EnvConfigCache::configId(fullMsg);
+							//the batch may carry its template or config, for servers which don't know it (yet)
+							Errors registrationErrors = isDelta
+								? envTemplates.registerIfUnknown(templateId, fullMsg)
+								: isFromConfig ? envConfigs.registerIfUnknown(batchConfigId, fullMsg) : Errors();
+							for(auto& es : ess)
+								es.append(registrationErrors);
+							for(size_t i = 0; i < noOfJobs; i++)
+							{
+								//the jobs of a batch use the batch's config, if they don't name their own
+								if(isFromConfig && !batchConfigId.empty() && EnvConfigCache::configId(jobs[i]).empty())
+								{
+									auto job = jobs[i].object_items();
+									job["configId"] = batchConfigId;
+									envs.push_back(createJobEnv(envTemplates, envConfigs, job, templateId, kind, ess[i]));
+								}
+								else
+									envs.push_back(createJobEnv(envTemplates, envConfigs, jobs[i], templateId, kind, ess[i]));
+							}
+
+							//in a pipeline every result is sent as soon as it is available,
+							//a reply socket has to send all results in a single reply
+							bool streamResults = rconfig.type == Pull;
+
+							vector<Monica::Output> outs(noOfJobs);
+							deque<size_t> finished;
+							mutex finishedMutex;
+							condition_variable finishedCond;
+							atomic<size_t> nextJob{0};
+							auto work = [&]()
+							{
+								for(size_t i = nextJob++; i < noOfJobs; i = nextJob++)
+								{
+									Monica::Output out;
+									//an exception escaping a worker thread would terminate the whole server
+									try
+									{
+										out = runJobEnv(envs[i], ess[i], startedServerInDebugMode, resultCache.get());
+									}
+									catch(exception& e)
+									{
+										out.customId = envs[i].customId;
+										out.errors.push_back(string("Exception while running job of batch: ") + e.what());
+										metrics().inc("monica_jobs_failed_total");
+									}
+									catch(...)
+									{
+										out.customId = envs[i].customId;
+										out.errors.push_back("Unknown exception while running job of batch.");
+										metrics().inc("monica_jobs_failed_total");
+									}
+									lock_guard<mutex> lock(finishedMutex);
+									outs[i] = out;
+									finished.push_back(i);
+									finishedCond.notify_one();
+								}
+							};
+							vector<thread> workers;
+							for(size_t t = 0, ts = min(size_t(max(1, noOfBatchThreads)), noOfJobs); t < ts; t++)
+								workers.push_back(thread(work));
+
+							for(size_t noOfFinished = 0; noOfFinished < noOfJobs; noOfFinished++)
+							{
+								unique_lock<mutex> lock(finishedMutex);
+								finishedCond.wait(lock, [&](){ return !finished.empty(); });
+								auto i = finished.front();
+								finished.pop_front();
+								if(onJobsDone)
+									onJobsDone(++noOfJobsDone);
+								if(!streamResults)
+									continue;
+								metrics().inc("monica_jobs_in_progress", -1);
+								auto out = move(outs[i]);
+								lock.unlock();
+
+								try
+								{
+									if(!envs[i].sharedId.empty())
+										s_sendmore(distinctSendSocket ? sendSocket : socket, envs[i].sharedId);
+									auto msg = outputMsg(out, binaryReply);
+									TraceSpan span("send");
+									span.arg("customId", out.customId);
+									MetricsTimer timer(phaseSeconds, label("phase", "send"));
+									s_send(distinctSendSocket ? sendSocket : socket, msg);
+								}
+								catch(zmq::error_t e)
+								{
+									cerr << "Exception on trying to send result message of batch on zmq socket with address: ";
+									int i = 0;
+									for(auto address : sAddresses)
+										cerr << (i > 0 ? "," : "") << address, ++i;
+									cerr << "! Will continue to send the results! Error: [" << e.what() << "]" << endl;
+								}
+							}
+							for(auto& w : workers)
+								w.join();
+
+							if(!streamResults)
+							{
+								TraceSpan serializeSpan("serialize");
+								serializeSpan.arg("customId", fullMsg["customId"]);
+								MetricsTimer serializeTimer(phaseSeconds, label("phase", "serialize"));
+								J11Array outjs;
+								for(const auto& out : outs)
+									outjs.push_back(out.to_json());
+								J11Object resultMsg
+								{{"type", binaryReply ? "OutputBatch.bin" : "OutputBatch"}
+								,{"customId", fullMsg["customId"]}
+								,{"outputs", outjs}
+								};
+								auto msg = binaryReply ? encodeBinaryJson(resultMsg) : Json(resultMsg).dump();
+								serializeTimer.stop();
+								serializeSpan.end();
+								metrics().observe("monica_result_bytes", double(msg.size()));
+								metrics().inc("monica_jobs_in_progress", -double(noOfJobs));
+								try
+								{
+									TraceSpan span("send");
+									span.arg("customId", fullMsg["customId"]);
+									MetricsTimer timer(phaseSeconds, label("phase", "send"));
+									s_send(distinctSendSocket ? sendSocket : socket, msg);
+								}
+								catch(zmq::error_t e)
+								{
+									cerr << "Exception on trying to reply with batch result message on zmq socket with address: ";
+									int i = 0;
+									for(auto address : sAddresses)
+										cerr << (i > 0 ? "," : "") << address, ++i;
+									cerr << "! Will continue to receive requests! Error: [" << e.what() << "]" << endl;
+								}
+							}
 						}
 						else
 						{
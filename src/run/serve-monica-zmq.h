@@ -25,6 +25,7 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 #include <iostream>
 #include <map>
 #include <memory>
+#include <functional>
 
 #include "zmq.hpp"
 
@@ -33,6 +34,8 @@ Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
 
 namespace Monica
 {
+	class ResultCache;
+
 	namespace ZmqServer
 	{
 		//void startZeroMQMonica(zmq::context_t* zmqContext,
@@ -49,8 +52,16 @@ namespace Monica
 			std::vector<std::string> addresses;
 			SocketOp op;
 		};
+		//! serve MONICA runs, "EnvBatch" messages are being run in parallel on noOfBatchThreads threads,
+		//! if a resultCache is given, envs which have been run before will be answered from the cache
+		//! and a "Stats" message will be answered with its hit statistics,
+		//! jobs may also be sent as sim/crop/site.json configurations ("EnvConfig", "EnvFromConfig", see EnvConfigCache),
+		//! onJobsDone gets the number of jobs run so far after every finished job
 		void serveZmqMonicaFull(zmq::context_t* zmqContext,
-														std::map<SocketRole, SocketConfig> socketAddresses);
+														std::map<SocketRole, SocketConfig> socketAddresses,
+														int noOfBatchThreads = 1,
+														std::shared_ptr<ResultCache> resultCache = std::shared_ptr<ResultCache>(),
+														std::function<void(std::size_t)> onJobsDone = std::function<void(std::size_t)>());
 	}
 }
 
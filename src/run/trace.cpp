@@ -0,0 +1,133 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+Authors:
+Michael Berg <michael.berg@zalf.de>
+
+Maintainers:
+Currently maintained by the authors.
+
+This file is part of the MONICA model.
+Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
+*/
+
+#include <chrono>
+#include <thread>
+
+#ifdef WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "trace.h"
+#include "json11/json11-helper.h"
+
+using namespace Monica;
+using namespace Tools;
+using namespace json11;
+using namespace std;
+
+atomic<TraceWriter*> TraceWriter::_instance{nullptr};
+
+namespace
+{
+	int processId()
+	{
+#ifdef WIN32
+		return _getpid();
+#else
+		return int(getpid());
+#endif
+	}
+
+	//! small ids for the threads of the process, in the order of their first event
+	int threadId()
+	{
+		static atomic<int> nextId{1};
+		thread_local int id = nextId++;
+		return id;
+	}
+}
+
+bool TraceWriter::start(string pathToFile, const string& processName, string workerId)
+{
+	if(instance())
+		return false;
+
+	//the writer is never deleted, spans on other threads might still hold it after stop()
+	auto tw = new TraceWriter;
+	tw->_pid = processId();
+	tw->_workerId = workerId.empty() ? to_string(tw->_pid) : workerId;
+
+	auto pos = pathToFile.find("{pid}");
+	if(pos != string::npos)
+		pathToFile.replace(pos, 5, to_string(tw->_pid));
+	tw->_out.open(pathToFile);
+	if(!tw->_out)
+	{
+		delete tw;
+		return false;
+	}
+
+	//the closing bracket is optional in the JSON array format, so a killed process still leaves a valid trace
+	tw->_out << "[\n";
+	tw->write(J11Object
+	{{"name", "process_name"}
+	,{"ph", "M"}
+	,{"pid", tw->_pid}
+	,{"tid", 0}
+	,{"args", J11Object{{"name", processName + " " + tw->_workerId}}}
+	});
+
+	_instance.store(tw, memory_order_release);
+	return true;
+}
+
+void TraceWriter::stop()
+{
+	auto tw = _instance.exchange(nullptr, memory_order_acq_rel);
+	if(!tw)
+		return;
+	lock_guard<mutex> lock(tw->_mutex);
+	tw->_out << "\n]\n";
+	tw->_out.close();
+}
+
+int64_t TraceWriter::nowUs()
+{
+	return chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void TraceWriter::complete(const string& name,
+													 const string& category,
+													 int64_t startUs,
+													 int64_t endUs,
+													 Json::object args)
+{
+	args["worker"] = _workerId;
+	write(J11Object
+	{{"name", name}
+	,{"cat", category}
+	,{"ph", "X"}
+	,{"ts", double(startUs)}
+	,{"dur", double(max(int64_t(0), endUs - startUs))}
+	,{"pid", _pid}
+	,{"tid", threadId()}
+	,{"args", args}
+	});
+}
+
+void TraceWriter::write(const Json& event)
+{
+	auto line = event.dump();
+	lock_guard<mutex> lock(_mutex);
+	if(!_out.is_open())
+		return;
+	_out << (_firstEvent ? "" : ",\n") << line;
+	_firstEvent = false;
+	//keep the file usable if the process gets killed
+	_out.flush();
+}
@@ -0,0 +1,118 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+Authors:
+Michael Berg <michael.berg@zalf.de>
+
+Maintainers:
+Currently maintained by the authors.
+
+This file is part of the MONICA model.
+Copyright (C) Leibniz Centre for Agricultural Landscape Research (ZALF)
+*/
+
+#ifndef MONICA_TRACE_H_
+#define MONICA_TRACE_H_
+
+#include <string>
+#include <fstream>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+#include "json11/json11.hpp"
+
+namespace Monica
+{
+	/*!
+	 * Writes the spans of this process as Chrome trace events (JSON array format, loadable by chrome://tracing and Perfetto).
+	 * Tracing is off until start() is called, until then TraceSpans just check the null instance.
+	 * Timestamps are microseconds since the epoch, so the traces of the processes of a distributed setup
+	 * (client, proxy, servers) can be loaded together. Every event is tagged with the worker id of the process.
+	 */
+	class TraceWriter
+	{
+	public:
+		/*!
+		 * start tracing into pathToFile ("{pid}" is replaced by the process id, to let multiple processes share a command line),
+		 * processName names the process in the trace viewer, workerId defaults to the process id
+		 */
+		static bool start(std::string pathToFile, const std::string& processName, std::string workerId = std::string());
+
+		//! stop tracing and close the trace file
+		static void stop();
+
+		//! the writer if tracing is on, else nullptr
+		static TraceWriter* instance() { return _instance.load(std::memory_order_acquire); }
+
+		//! microseconds since the epoch
+		static std::int64_t nowUs();
+
+		//! add a complete event of the calling thread, lasting from startUs until endUs
+		void complete(const std::string& name,
+									const std::string& category,
+									std::int64_t startUs,
+									std::int64_t endUs,
+									json11::Json::object args = json11::Json::object());
+
+		const std::string& workerId() const { return _workerId; }
+
+	private:
+		TraceWriter() {}
+
+		void write(const json11::Json& event);
+
+		static std::atomic<TraceWriter*> _instance;
+
+		std::mutex _mutex;
+		std::ofstream _out;
+		bool _firstEvent{true};
+		int _pid{0};
+		std::string _workerId;
+	};
+
+	//! a span from construction until end() (or destruction), does nothing if tracing is off
+	class TraceSpan
+	{
+	public:
+		TraceSpan(const char* name, const char* category = "monica")
+			: _writer(TraceWriter::instance()), _name(name), _category(category)
+		{
+			if(_writer)
+				_startUs = TraceWriter::nowUs();
+		}
+
+		~TraceSpan() { end(); }
+
+		TraceSpan(const TraceSpan&) = delete;
+		TraceSpan& operator=(const TraceSpan&) = delete;
+
+		bool active() const { return _writer != nullptr; }
+
+		//! tag the span, e.g. with the job's customId
+		template<class T>
+		void arg(const char* key, const T& value)
+		{
+			if(_writer)
+				_args[key] = json11::Json(value);
+		}
+
+		void end()
+		{
+			if(_writer)
+				_writer->complete(_name, _category, _startUs, TraceWriter::nowUs(), std::move(_args));
+			_writer = nullptr;
+		}
+
+	private:
+		TraceWriter* _writer;
+		const char* _name;
+		const char* _category;
+		std::int64_t _startUs{0};
+		json11::Json::object _args;
+	};
+}
+
+#endif //MONICA_TRACE_H_